@@ -0,0 +1,483 @@
+/*
+Program: Arena
+Created by: Ian Penrose & Lindsay Wax
+Course: CYBV 489
+
+
+Description: Per process heaps. Each process that calls k_malloc gets an arena, which
+takes memory from the host ARENA_CHUNK_BYTES at a time and carves blocks out of its
+current chunk with a bump pointer. Requests are rounded up to a size class, powers of
+two from ARENA_MIN_SMALL to ARENA_MAX_SMALL, and freed blocks go on their class's free
+list, where the next request of the class finds them. Only the process itself uses its
+arena, so allocating and freeing from the current chunk or a free list take no locks.
+Interrupts are disabled only while the host allocates or frees memory. Requests bigger
+than ARENA_MAX_SMALL get memory of their own from the host.
+
+When a process is cleaned up its blocks are not freed one by one. The arena's chunks
+are spliced whole onto a cache of chunks shared by every arena, which later arenas take
+chunks from before asking the host, so releasing an arena costs the same however much
+the process allocated. Only large blocks still allocated are given back one at a time.
+arena_shrink gives the cached chunks back to the host.
+*/
+
+
+
+#define _CRT_SECURE_NO_WARNINGS
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <stddef.h>
+#include "THREADSLib.h"
+#include "Scheduler.h"
+#include "Slab.h"
+#include "Arena.h"
+#include "Processes.h"
+
+#define HEADER_BYTES    16              // Blocks and chunks keep their data 16 byte aligned
+#define LARGE_CLASS     -1
+#define BLOCK_IN_USE    0xA110CA7E
+#define BLOCK_FREE      0xF4EEB10C
+
+/* Chunks are linked through their first bytes. */
+typedef struct _chunk
+{
+    struct _chunk*  pNext;
+} Chunk;
+
+/* Every block starts with a header, followed by the memory k_malloc returns. */
+typedef struct
+{
+    struct _arena*  pArena;         // Arena the block was allocated from
+    int             sizeClass;      // Index of its size class, LARGE_CLASS if it has memory of its own
+    unsigned int    magic;          // BLOCK_IN_USE or BLOCK_FREE
+} BlockHeader;
+
+/* Large blocks are also linked into their arena, to free them when it is released. */
+typedef struct _large_block
+{
+    struct _large_block*    pNext;
+    struct _large_block*    pPrev;
+    BlockHeader             header;
+} LargeBlock;
+
+/*
+Arenas are the heap of one process.
+*/
+typedef struct _arena
+{
+    BlockHeader*    freeLists[ARENA_CLASSES];   // Free blocks of each class, linked through their memory
+    char*           pBump;          // Next free byte of the current chunk
+    char*           pEnd;           // End of the current chunk
+    Chunk*          pChunks;        // Chunks of the arena, newest first
+    Chunk*          pLastChunk;     // Oldest chunk, where the list is spliced onto the cache
+    LargeBlock*     pLarge;
+    arena_stats_t   stats;
+
+} Arena;
+
+static int arenaCache;
+static Chunk* pCachedChunks;
+static arena_chunk_stats_t chunkStats;
+
+static Arena* getArena(Process* pProcess);
+static int classOf(int size);
+static int getChunk(Arena* pArena);
+static void* allocateLarge(Arena* pArena, int size);
+
+/**************************************************************************
+   Name - arena_initialize
+
+   Purpose - Empties the chunk cache. Called once from bootstrap.
+*************************************************************************/
+void arena_initialize(void)
+{
+    pCachedChunks = NULL;
+    memset(&chunkStats, 0, sizeof(chunkStats));
+
+    arenaCache = slab_cache_create("arenas", sizeof(Arena), NULL);
+}
+
+/**************************************************************************
+   Name - k_malloc
+
+   Purpose - Allocates memory from the running process's arena. It stays
+             allocated until k_free or until the process is cleaned up.
+
+   Parameters - size, the number of bytes
+
+   Returns - the memory, 16 byte aligned, or NULL if size is invalid or
+        the host has no memory left
+*************************************************************************/
+void* k_malloc(int size)
+{
+    Arena* pArena;
+    BlockHeader* pHeader;
+    int sizeClass;
+    int slotBytes;
+
+    check_kernel_mode("k_malloc");
+
+    if (size <= 0 || (pArena = getArena(runningProcess)) == NULL)
+    {
+        return NULL;
+    }
+
+    sizeClass = classOf(size);
+    if (sizeClass == LARGE_CLASS)
+    {
+        return allocateLarge(pArena, size);
+    }
+
+    pHeader = pArena->freeLists[sizeClass];
+    if (pHeader != NULL)
+    {
+        pArena->freeLists[sizeClass] = *(BlockHeader**)((char*)pHeader + HEADER_BYTES);
+        pArena->stats.reused++;
+    }
+    else
+    {
+        slotBytes = HEADER_BYTES + (ARENA_MIN_SMALL << sizeClass);
+        if (pArena->pEnd - pArena->pBump < slotBytes && getChunk(pArena) != 0)
+        {
+            pArena->stats.failures++;
+            return NULL;
+        }
+        pHeader = (BlockHeader*)pArena->pBump;
+        pArena->pBump += slotBytes;
+        pHeader->pArena = pArena;
+        pHeader->sizeClass = sizeClass;
+    }
+
+    pHeader->magic = BLOCK_IN_USE;
+    pArena->stats.allocations++;
+    pArena->stats.bytesInUse += ARENA_MIN_SMALL << sizeClass;
+    if (pArena->stats.bytesInUse > pArena->stats.peakBytesInUse)
+    {
+        pArena->stats.peakBytesInUse = pArena->stats.bytesInUse;
+    }
+
+    return (char*)pHeader + HEADER_BYTES;
+}
+
+/**************************************************************************
+   Name - k_free
+
+   Purpose - Frees memory k_malloc gave the running process.
+
+   Parameters - pMemory, the memory, or NULL to do nothing
+
+   Returns - 0 if successful, -1 if pMemory is not memory of the running
+        process's arena or was already freed
+*************************************************************************/
+int k_free(void* pMemory)
+{
+    Arena* pArena = runningProcess->pArena;
+    BlockHeader* pHeader;
+
+    check_kernel_mode("k_free");
+
+    if (pMemory == NULL)
+    {
+        return 0;
+    }
+
+    pHeader = (BlockHeader*)((char*)pMemory - HEADER_BYTES);
+    if (pArena == NULL || ((uintptr_t)pMemory & (HEADER_BYTES - 1)) != 0 || pHeader->pArena != pArena ||
+        pHeader->magic != BLOCK_IN_USE)
+    {
+        return -1;
+    }
+
+    pArena->stats.frees++;
+
+    if (pHeader->sizeClass == LARGE_CLASS)
+    {
+        LargeBlock* pBlock = (LargeBlock*)((char*)pHeader - offsetof(LargeBlock, header));
+        uint32_t psr = get_psr();
+
+        if (pBlock->pPrev != NULL)
+        {
+            pBlock->pPrev->pNext = pBlock->pNext;
+        }
+        else
+        {
+            pArena->pLarge = pBlock->pNext;
+        }
+        if (pBlock->pNext != NULL)
+        {
+            pBlock->pNext->pPrev = pBlock->pPrev;
+        }
+        pArena->stats.largeBlocks--;
+
+        disableInterrupts();
+        free(pBlock);
+        set_psr(psr);
+        return 0;
+    }
+
+    pHeader->magic = BLOCK_FREE;
+    *(BlockHeader**)((char*)pHeader + HEADER_BYTES) = pArena->freeLists[pHeader->sizeClass];
+    pArena->freeLists[pHeader->sizeClass] = pHeader;
+    pArena->stats.bytesInUse -= ARENA_MIN_SMALL << pHeader->sizeClass;
+
+    return 0;
+}
+
+/**************************************************************************
+   Name - arena_release
+
+   Purpose - Releases the arena of a process being cleaned up, splicing its
+             chunks onto the chunk cache and freeing its large blocks.
+
+   Parameters - pProcess, the process, which must not be running
+*************************************************************************/
+void arena_release(Process* pProcess)
+{
+    Arena* pArena = pProcess->pArena;
+    uint32_t psr = get_psr();
+
+    if (pArena == NULL)
+    {
+        return;
+    }
+
+    disableInterrupts();
+
+    while (pArena->pLarge != NULL)
+    {
+        LargeBlock* pBlock = pArena->pLarge;
+
+        pArena->pLarge = pBlock->pNext;
+        free(pBlock);
+    }
+
+    if (pArena->pChunks != NULL)
+    {
+        pArena->pLastChunk->pNext = pCachedChunks;
+        pCachedChunks = pArena->pChunks;
+        chunkStats.cached += pArena->stats.chunks;
+    }
+    chunkStats.arenasReleased++;
+    set_psr(psr);
+
+    slab_free(arenaCache, pArena);
+    pProcess->pArena = NULL;
+}
+
+/**************************************************************************
+   Name - arena_shrink
+
+   Purpose - Gives the chunks in the chunk cache back to the host.
+
+   Returns - the number of chunks given back
+*************************************************************************/
+int arena_shrink(void)
+{
+    Chunk* pChunk;
+    int released = 0;
+
+    check_kernel_mode("arena_shrink");
+
+    disableInterrupts();
+
+    pChunk = pCachedChunks;
+    pCachedChunks = NULL;
+    chunkStats.cached = 0;
+
+    while (pChunk != NULL)
+    {
+        Chunk* pNext = pChunk->pNext;
+
+        free(pChunk);
+        pChunk = pNext;
+        released++;
+    }
+
+    enableInterrupts();
+
+    return released;
+}
+
+/**************************************************************************
+   Name - get_arena_stats
+
+   Purpose - Copies the heap counters of a process.
+
+   Parameters - pid, the process
+                pStats, where to copy them
+
+   Returns - 0 if successful, -1 if there is no such process or it has
+        never called k_malloc
+*************************************************************************/
+int get_arena_stats(int pid, arena_stats_t* pStats)
+{
+    for (int i = 0; i < MAX_PROCESSES; i++)
+    {
+        if (processTable[i].pid == pid && pid != 0 && processTable[i].pArena != NULL)
+        {
+            if (pStats != NULL)
+            {
+                *pStats = processTable[i].pArena->stats;
+            }
+            return 0;
+        }
+    }
+
+    return -1;
+}
+
+/**************************************************************************
+   Name - get_arena_chunk_stats
+
+   Purpose - Copies the chunk cache counters.
+*************************************************************************/
+void get_arena_chunk_stats(arena_chunk_stats_t* pStats)
+{
+    if (pStats != NULL)
+    {
+        *pStats = chunkStats;
+    }
+}
+
+/**************************************************************************
+   Name - reset_arena_chunk_stats
+
+   Purpose - Zeroes the chunk cache counters, except the chunks cached.
+*************************************************************************/
+void reset_arena_chunk_stats(void)
+{
+    int cached = chunkStats.cached;
+
+    memset(&chunkStats, 0, sizeof(chunkStats));
+    chunkStats.cached = cached;
+}
+
+/**************************************************************************
+   Name - getArena
+
+   Returns - the process's arena, created empty the first time, or NULL if
+        it cannot be allocated
+*************************************************************************/
+static Arena* getArena(Process* pProcess)
+{
+    if (pProcess->pArena == NULL)
+    {
+        pProcess->pArena = slab_alloc(arenaCache);
+        if (pProcess->pArena != NULL)
+        {
+            memset(pProcess->pArena, 0, sizeof(Arena));
+        }
+    }
+
+    return pProcess->pArena;
+}
+
+/**************************************************************************
+   Name - classOf
+
+   Returns - the smallest size class that holds size, or LARGE_CLASS if
+        size is bigger than ARENA_MAX_SMALL
+*************************************************************************/
+static int classOf(int size)
+{
+    for (int sizeClass = 0; sizeClass < ARENA_CLASSES; sizeClass++)
+    {
+        if (size <= (ARENA_MIN_SMALL << sizeClass))
+        {
+            return sizeClass;
+        }
+    }
+
+    return LARGE_CLASS;
+}
+
+/**************************************************************************
+   Name - getChunk
+
+   Purpose - Gives an arena a new current chunk, from the chunk cache if
+             it has one, otherwise from the host. What was left of the
+             old chunk is not used.
+
+   Returns - 0 if successful, -1 if the host has no memory left
+*************************************************************************/
+static int getChunk(Arena* pArena)
+{
+    uint32_t psr = get_psr();
+    Chunk* pChunk;
+
+    disableInterrupts();
+
+    pChunk = pCachedChunks;
+    if (pChunk != NULL)
+    {
+        pCachedChunks = pChunk->pNext;
+        chunkStats.cached--;
+        chunkStats.reused++;
+    }
+    else
+    {
+        pChunk = malloc(ARENA_CHUNK_BYTES);
+        if (pChunk == NULL)
+        {
+            set_psr(psr);
+            return -1;
+        }
+        chunkStats.created++;
+    }
+
+    set_psr(psr);
+
+    pChunk->pNext = pArena->pChunks;
+    pArena->pChunks = pChunk;
+    if (pArena->pLastChunk == NULL)
+    {
+        pArena->pLastChunk = pChunk;
+    }
+    pArena->stats.chunks++;
+
+    pArena->pBump = (char*)pChunk + HEADER_BYTES;
+    pArena->pEnd = (char*)pChunk + ARENA_CHUNK_BYTES;
+
+    return 0;
+}
+
+/**************************************************************************
+   Name - allocateLarge
+
+   Returns - memory of its own from the host for an allocation bigger than
+        ARENA_MAX_SMALL, or NULL if the host has no memory left
+*************************************************************************/
+static void* allocateLarge(Arena* pArena, int size)
+{
+    uint32_t psr = get_psr();
+    LargeBlock* pBlock;
+
+    disableInterrupts();
+    pBlock = malloc(offsetof(LargeBlock, header) + HEADER_BYTES + size);
+    set_psr(psr);
+
+    if (pBlock == NULL)
+    {
+        pArena->stats.failures++;
+        return NULL;
+    }
+
+    pBlock->header.pArena = pArena;
+    pBlock->header.sizeClass = LARGE_CLASS;
+    pBlock->header.magic = BLOCK_IN_USE;
+    pBlock->pPrev = NULL;
+    pBlock->pNext = pArena->pLarge;
+    if (pArena->pLarge != NULL)
+    {
+        pArena->pLarge->pPrev = pBlock;
+    }
+    pArena->pLarge = pBlock;
+
+    pArena->stats.allocations++;
+    pArena->stats.large++;
+    pArena->stats.largeBlocks++;
+
+    return (char*)&pBlock->header + HEADER_BYTES;
+}
@@ -0,0 +1,1083 @@
+/*
+Program: BufferCache
+Created by: Ian Penrose & Lindsay Wax
+Course: CYBV 489
+
+
+Description: Cache of disk sectors kept in CACHE_BUFFERS buffers, found through a hash
+table keyed on the sector's position. Reads that miss queue their sectors on the disk
+driver and wait for the I/O interrupt; a process reading a sector somebody else is
+already reading waits for that read instead of starting another one. A process reading
+sequentially has the next track read ahead while it works on the current one.
+
+Writes only dirty the buffers. The flusher, a low priority kernel daemon, lets a burst
+of writes collect for FLUSH_DELAY_MS and then writes the dirty buffers back in batches
+sorted by position, so the elevator can sweep over them. Writers only wait for it when
+more than DIRTY_LIMIT buffers are dirty.
+
+Replacement is 2Q. A sector read for the first time goes on the A1in FIFO, and only a
+sector read again after it was pushed out of A1in (which is remembered on the A1out
+ghost list) is moved to the Am LRU list. A long sequential scan therefore only cycles
+through A1in and cannot push the sectors that are used over and over out of Am.
+*/
+
+
+
+#define _CRT_SECURE_NO_WARNINGS
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "THREADSLib.h"
+#include "Scheduler.h"
+#include "Disk.h"
+#include "BufferCache.h"
+#include "Processes.h"
+
+#define HASH_BUCKETS    1024                    // Power of 2
+#define GHOSTS          (CACHE_BUFFERS / 2)     // Sectors remembered on A1out
+#define A1IN_TARGET     (CACHE_BUFFERS / 4)     // A1in is trimmed before Am while it is bigger than this
+#define DIRTY_LIMIT     (CACHE_BUFFERS / 2)     // Writers wait for the flusher above this many dirty buffers
+#define FLUSH_DELAY_MS  30                      // How long the flusher lets writes collect
+#define FLUSH_BATCH     64                      // Most writes the flusher queues on the disks at once
+#define FLUSHER_PRIORITY    (LOWEST_PRIORITY + 1)
+
+/*
+A process pins at most MAX_PINNED buffers at a time, so with MAX_PROCESSES processes
+there is always an unpinned buffer to reuse.
+*/
+#define MAX_PINNED      16
+
+#define BUF_EMPTY       0   // Not holding a sector
+#define BUF_READING     1   // Waiting for the disk to read the sector
+#define BUF_VALID       2   // Holds the sector
+#define BUF_ERROR       3   // The read failed, the buffer is emptied once unpinned
+#define BUF_FILLING     4   // A writer that missed has it pinned and has not copied the sector in yet
+
+#define LIST_NONE       0
+#define LIST_FREE       1
+#define LIST_A1IN       2
+#define LIST_AM         3
+
+/* Keys number the sectors in disk order, starting at 1 so that 0 can mean none. */
+#define SECTOR_KEY(unit, platter, track, sector) \
+    ((((unsigned int)(unit) * THREADS_DISK_MAX_PLATTERS + (platter)) * 256 + (track)) * THREADS_DISK_SECTOR_COUNT + (sector) + 1)
+#define HASH(key)       (((key) * 2654435761u) >> 22 & (HASH_BUCKETS - 1))
+
+/*
+Buffers hold one sector each. They are on exactly one of the free, A1in and Am lists
+and, unless empty, in a hash chain.
+*/
+typedef struct _buffer
+{
+    struct _buffer*     hashNext;       // Next buffer in the same hash chain
+    struct _buffer*     next;           // Toward the tail of the buffer's list
+    struct _buffer*     prev;           // Toward the head of the buffer's list
+    int                 list;           // LIST_*
+    unsigned int        key;            // SECTOR_KEY of the sector held
+    int                 state;          // BUF_*
+    int                 pins;           // Processes using the buffer, it is not reused while pinned
+    int                 dirty;          // TRUE if the data has not been written back yet
+    int                 writing;        // TRUE while the flusher is writing the data back
+    int                 prefetched;     // TRUE if read ahead and not read since
+    WaitQueue           waiters;        // Processes waiting for the read, fill or write back to finish
+    DiskRequest         request;        // Read of the sector while BUF_READING, or its write back
+    char                data[THREADS_DISK_SECTOR_SIZE];
+
+} Buffer;
+
+/* Ghosts remember the keys of sectors evicted from A1in. */
+typedef struct _ghost
+{
+    struct _ghost*      hashNext;
+    unsigned int        key;
+    int                 used;
+
+} Ghost;
+
+/* BufferLists are doubly linked with the most recently added buffer at the head. */
+typedef struct _buffer_list
+{
+    Buffer*     head;
+    Buffer*     tail;
+    int         size;
+
+} BufferList;
+
+static Buffer buffers[CACHE_BUFFERS];
+static Buffer* hashTable[HASH_BUCKETS];
+static BufferList freeList, a1in, am;
+static Ghost ghosts[GHOSTS];            // A1out, a ring replaced oldest first
+static Ghost* ghostTable[HASH_BUCKETS];
+static int nextGhost;
+static int policy = CACHE_POLICY_2Q;
+static int readAhead = TRUE;
+static cache_stats_t stats;
+
+static int dirtyBuffers;                // Buffers waiting to be written back
+static int flushing;                    // Write backs queued on the disks
+static int flushUrgent;                 // Somebody is waiting for the flusher, so it skips the delay
+static int flusherPid;                  // 0 until the first write starts the flusher
+static WaitQueue flusherQueue;          // The flusher, while it waits for work or for its writes
+static WaitQueue cleanWaiters;          // Processes waiting for dirty buffers to be written back
+static Buffer* flushOrder[CACHE_BUFFERS];
+
+static int cache_transfer(int unit, int platter, int track, int sector, int sectors, char* pBuffer, int write);
+static Buffer* pinBuffer(int unit, int platter, int track, int sector, int write);
+static void unpinBuffer(Buffer* pBuffer);
+static Buffer* findBuffer(unsigned int key);
+static Buffer* reuseBuffer(void);
+static Buffer* takeVictim(BufferList* pList);
+static int takeGhost(unsigned int key);
+static void addGhost(unsigned int key);
+static void unhash(Buffer* pBuffer);
+static void readDone(DiskRequest* pRequest);
+static void readAheadFor(int unit, int platter, int track, int sector, int sectors, int tracks);
+static void prefetchSector(unsigned int key, int unit, int platter, int track, int sector);
+static void insertBuffer(Buffer* pBuffer, unsigned int key, int read);
+static void startRead(Buffer* pBuffer, int unit, int platter, int track, int sector);
+static void waitForClean(void);
+static void wakeFlusher(int urgent);
+static int flusher(void* arg);
+static void flushBatch(void);
+static int compareKeys(const void* pFirst, const void* pSecond);
+static void writeDone(DiskRequest* pRequest);
+static void listAdd(BufferList* pList, int list, Buffer* pBuffer);
+static void listRemove(Buffer* pBuffer);
+
+
+/**************************************************************************
+   Name - cache_initialize
+
+   Purpose - Empties the cache. Called once from bootstrap.
+*************************************************************************/
+void cache_initialize(void)
+{
+    memset(buffers, 0, sizeof(buffers));
+    memset(hashTable, 0, sizeof(hashTable));
+    memset(ghosts, 0, sizeof(ghosts));
+    memset(ghostTable, 0, sizeof(ghostTable));
+    memset(&freeList, 0, sizeof(freeList));
+    memset(&a1in, 0, sizeof(a1in));
+    memset(&am, 0, sizeof(am));
+    memset(&stats, 0, sizeof(stats));
+    memset(&flusherQueue, 0, sizeof(flusherQueue));
+    memset(&cleanWaiters, 0, sizeof(cleanWaiters));
+    nextGhost = 0;
+    dirtyBuffers = 0;
+    flushing = 0;
+    flushUrgent = FALSE;
+    flusherPid = 0;
+
+    for (int i = 0; i < CACHE_BUFFERS; i++)
+    {
+        listAdd(&freeList, LIST_FREE, &buffers[i]);
+    }
+}
+
+/**************************************************************************
+   Name - k_cache_read
+
+   Purpose - Reads consecutive sectors through the cache, blocking until
+             any that were not cached have been read from the disk.
+
+   Parameters - same as k_disk_read
+
+   Returns - 0 if successful, -1 if the parameters are invalid, or
+        DISK_IO_ERROR if the disk failed a read
+*************************************************************************/
+int k_cache_read(int unit, int platter, int track, int sector, int sectors, void* pBuffer)
+{
+    check_kernel_mode("k_cache_read");
+
+    return cache_transfer(unit, platter, track, sector, sectors, pBuffer, FALSE);
+}
+
+/**************************************************************************
+   Name - k_cache_write
+
+   Purpose - Writes consecutive sectors into the cache. The flusher writes
+             them to the disk later, k_cache_sync waits for that. Only
+             blocks while too many buffers are dirty.
+
+   Parameters - same as k_disk_write
+
+   Returns - 0 if successful, -1 if the parameters are invalid
+*************************************************************************/
+int k_cache_write(int unit, int platter, int track, int sector, int sectors, void* pBuffer)
+{
+    check_kernel_mode("k_cache_write");
+
+    return cache_transfer(unit, platter, track, sector, sectors, pBuffer, TRUE);
+}
+
+/**************************************************************************
+   Name - k_cache_sync
+
+   Purpose - Blocks until every sector written so far has been written
+             back to the disk.
+
+   Returns - 0
+*************************************************************************/
+int k_cache_sync(void)
+{
+    check_kernel_mode("k_cache_sync");
+
+    disableInterrupts();
+
+    while (dirtyBuffers > 0 || flushing > 0)
+    {
+        wakeFlusher(TRUE);
+        block_on(&cleanWaiters, BLOCKED_DISK);
+    }
+
+    enableInterrupts();
+
+    return 0;
+}
+
+/**************************************************************************
+   Name - cache_set_policy
+
+   Purpose - Switches the replacement policy. The cache is emptied of
+             every clean buffer that is not in use, so the new policy
+             starts cold.
+
+   Parameters - newPolicy, CACHE_POLICY_LRU or CACHE_POLICY_2Q
+
+   Returns - the previous policy, or -1 if newPolicy is invalid
+*************************************************************************/
+int cache_set_policy(int newPolicy)
+{
+    int previous = policy;
+
+    if (newPolicy != CACHE_POLICY_LRU && newPolicy != CACHE_POLICY_2Q)
+    {
+        return -1;
+    }
+
+    disableInterrupts();
+
+    policy = newPolicy;
+
+    for (int i = 0; i < CACHE_BUFFERS; i++)
+    {
+        Buffer* pBuffer = &buffers[i];
+
+        if (pBuffer->list != LIST_FREE && pBuffer->pins == 0 && pBuffer->state == BUF_VALID &&
+            !pBuffer->dirty && !pBuffer->writing)
+        {
+            unhash(pBuffer);
+            listRemove(pBuffer);
+            listAdd(&freeList, LIST_FREE, pBuffer);
+        }
+    }
+
+    memset(ghosts, 0, sizeof(ghosts));
+    memset(ghostTable, 0, sizeof(ghostTable));
+
+    enableInterrupts();
+
+    return previous;
+}
+
+/**************************************************************************
+   Name - cache_set_read_ahead
+
+   Purpose - Turns reading ahead for sequential readers on or off.
+
+   Returns - TRUE if it was on before
+*************************************************************************/
+int cache_set_read_ahead(int enabled)
+{
+    int previous = readAhead;
+
+    readAhead = enabled != 0;
+
+    return previous;
+}
+
+/**************************************************************************
+   Name - get_cache_stats
+
+   Purpose - Copies the cache counters.
+*************************************************************************/
+void get_cache_stats(cache_stats_t* pStats)
+{
+    *pStats = stats;
+}
+
+/**************************************************************************
+   Name - reset_cache_stats
+
+   Purpose - Clears the cache counters.
+*************************************************************************/
+void reset_cache_stats(void)
+{
+    memset(&stats, 0, sizeof(stats));
+}
+
+/**************************************************************************
+   Name - display_cache_stats
+
+   Purpose - Prints the cache counters and hit ratio.
+*************************************************************************/
+void display_cache_stats(void)
+{
+    console_output(FALSE, "Cache (%s): %u reads, %u hits, %u coalesced, %u misses, %u ghost hits\n",
+        policy == CACHE_POLICY_2Q ? "2Q" : "LRU", stats.reads, stats.hits, stats.coalesced, stats.misses, stats.ghostHits);
+    console_output(FALSE, "Cache (%s): %u.%u%% hit ratio, %u disk reads saved, %u evictions, %u writes\n",
+        policy == CACHE_POLICY_2Q ? "2Q" : "LRU",
+        stats.reads ? stats.hits * 100 / stats.reads : 0, stats.reads ? stats.hits * 1000 / stats.reads % 10 : 0,
+        stats.ioSaved, stats.evictions, stats.writes);
+    console_output(FALSE, "Cache (%s): %u sectors read ahead, %u read ahead hits, %u written back, %u throttled\n",
+        policy == CACHE_POLICY_2Q ? "2Q" : "LRU", stats.readAheads, stats.readAheadHits, stats.writeBacks, stats.throttled);
+}
+
+/**************************************************************************
+   Name - cache_transfer
+
+   Purpose - Common path for k_cache_read and k_cache_write. The sectors
+             are handled MAX_PINNED at a time: the buffers for all of them
+             are pinned first, so the reads that miss are queued on the
+             disk together with any read ahead and the elevator can order
+             them, and the data is copied once every read has completed.
+
+   Returns - 0 if successful, -1 if the parameters are invalid, or
+        DISK_IO_ERROR if the disk failed a transfer
+*************************************************************************/
+static int cache_transfer(int unit, int platter, int track, int sector, int sectors, char* pBuffer, int write)
+{
+    Buffer* pinned[MAX_PINNED];
+    int platters, tracks, lastTrack;
+    int result = 0;
+
+    if (k_disk_info(unit, &platters, &tracks) != 0 || pBuffer == NULL || sectors <= 0 ||
+        platter < 0 || platter >= platters || track < 0 || sector < 0 || sector >= THREADS_DISK_SECTOR_COUNT)
+    {
+        return -1;
+    }
+
+    lastTrack = track + (sector + sectors - 1) / THREADS_DISK_SECTOR_COUNT;
+    if (lastTrack >= tracks)
+    {
+        return -1;
+    }
+
+    disableInterrupts();
+
+    for (int first = 0; first < sectors && result == 0; first += MAX_PINNED)
+    {
+        int count = sectors - first < MAX_PINNED ? sectors - first : MAX_PINNED;
+
+        for (int i = 0; i < count; i++)
+        {
+            int position = sector + first + i;
+
+            pinned[i] = pinBuffer(unit, platter, track + position / THREADS_DISK_SECTOR_COUNT,
+                position % THREADS_DISK_SECTOR_COUNT, write);
+        }
+
+        if (first == 0 && !write && readAhead)
+        {
+            readAheadFor(unit, platter, track, sector, sectors, tracks);
+        }
+
+        for (int i = 0; i < count; i++)
+        {
+            Buffer* pSector = pinned[i];
+            char* pData = pBuffer + (first + i) * THREADS_DISK_SECTOR_SIZE;
+
+            // The disk may still be reading a buffer being written back, so it cannot change yet,
+            // and a reader must wait for a writer that missed to fill the buffer
+            while (pSector->state == BUF_READING || (write && pSector->writing) ||
+                (!write && pSector->state == BUF_FILLING))
+            {
+                block_on(&pSector->waiters, BLOCKED_DISK);
+            }
+
+            if (write)
+            {
+                int filling = pSector->state == BUF_FILLING;
+
+                memcpy(pSector->data, pData, THREADS_DISK_SECTOR_SIZE);
+                pSector->state = BUF_VALID;
+                while (filling && pSector->waiters.size > 0)
+                {
+                    ready_process(wait_queue_pop(&pSector->waiters));
+                }
+                if (!pSector->dirty)
+                {
+                    pSector->dirty = TRUE;
+                    if (dirtyBuffers++ == 0)
+                    {
+                        wakeFlusher(FALSE);
+                    }
+                }
+            }
+            else if (pSector->state == BUF_VALID)
+            {
+                memcpy(pData, pSector->data, THREADS_DISK_SECTOR_SIZE);
+            }
+            else
+            {
+                result = DISK_IO_ERROR;
+            }
+        }
+
+        for (int i = 0; i < count; i++)
+        {
+            unpinBuffer(pinned[i]);
+        }
+
+        if (write)
+        {
+            stats.writes += count;
+            while (dirtyBuffers > DIRTY_LIMIT)
+            {
+                waitForClean();
+            }
+        }
+    }
+
+    enableInterrupts();
+
+    return result;
+}
+
+/**************************************************************************
+   Name - pinBuffer
+
+   Purpose - Finds or sets up the buffer for a sector and pins it. A read
+             that misses reuses a buffer and queues the read of the sector
+             on the disk without waiting for it. A write that misses leaves
+             the buffer BUF_FILLING until the writer copies the sector in.
+             Called with interrupts disabled.
+
+   Parameters - unit, platter, track and sector, the sector
+                write, TRUE if the whole sector is about to be written,
+                    so there is no need to read it on a miss
+
+   Returns - the pinned buffer
+*************************************************************************/
+static Buffer* pinBuffer(int unit, int platter, int track, int sector, int write)
+{
+    unsigned int key = SECTOR_KEY(unit, platter, track, sector);
+    Buffer* pBuffer = findBuffer(key);
+    Buffer* pFree = NULL;
+
+    if (!write)
+    {
+        stats.reads++;
+    }
+
+    // Every buffer can be dirty, then wait for the flusher and look again
+    while (pBuffer == NULL && (pFree = reuseBuffer()) == NULL)
+    {
+        waitForClean();
+        pBuffer = findBuffer(key);
+    }
+
+    if (pBuffer != NULL)
+    {
+        if (!write)
+        {
+            if (pBuffer->state == BUF_READING || pBuffer->state == BUF_FILLING)
+            {
+                stats.coalesced++;
+            }
+            else
+            {
+                stats.hits++;
+            }
+            stats.ioSaved++;
+
+            if (pBuffer->prefetched)
+            {
+                pBuffer->prefetched = FALSE;
+                stats.readAheadHits++;
+            }
+        }
+
+        // A1in is a FIFO, only hits on Am move the buffer
+        if (pBuffer->list == LIST_AM)
+        {
+            listRemove(pBuffer);
+            listAdd(&am, LIST_AM, pBuffer);
+        }
+
+        pBuffer->pins++;
+        return pBuffer;
+    }
+
+    pBuffer = pFree;
+    insertBuffer(pBuffer, key, !write);
+    pBuffer->pins = 1;
+    pBuffer->prefetched = FALSE;
+
+    // Readers that find the buffer before the writer has copied the sector in wait for it
+    if (write)
+    {
+        pBuffer->state = BUF_FILLING;
+        return pBuffer;
+    }
+
+    stats.misses++;
+    startRead(pBuffer, unit, platter, track, sector);
+
+    return pBuffer;
+}
+
+/**************************************************************************
+   Name - insertBuffer
+
+   Purpose - Sets a reused buffer up for a sector, hashing it and adding
+             it to A1in, or to Am if the sector was seen again soon after
+             it left A1in.
+
+   Parameters - pBuffer, a buffer from reuseBuffer
+                key, the sector's key
+                read, TRUE if the sector is being read, for the counters
+*************************************************************************/
+static void insertBuffer(Buffer* pBuffer, unsigned int key, int read)
+{
+    int hot = policy == CACHE_POLICY_LRU || takeGhost(key);
+
+    if (hot && policy == CACHE_POLICY_2Q && read)
+    {
+        stats.ghostHits++;
+    }
+
+    pBuffer->key = key;
+    pBuffer->hashNext = hashTable[HASH(key)];
+    hashTable[HASH(key)] = pBuffer;
+    listAdd(hot ? &am : &a1in, hot ? LIST_AM : LIST_A1IN, pBuffer);
+}
+
+/**************************************************************************
+   Name - startRead
+
+   Purpose - Queues the read of a sector into a buffer on the disk.
+*************************************************************************/
+static void startRead(Buffer* pBuffer, int unit, int platter, int track, int sector)
+{
+    pBuffer->state = BUF_READING;
+    pBuffer->request.unit = unit;
+    pBuffer->request.platter = platter;
+    pBuffer->request.track = track;
+    pBuffer->request.sector = sector;
+    pBuffer->request.sectors = 1;
+    pBuffer->request.write = FALSE;
+    pBuffer->request.buffer = pBuffer->data;
+    pBuffer->request.callback = readDone;
+    pBuffer->request.pContext = pBuffer;
+
+    if (disk_submit(&pBuffer->request) != 0)
+    {
+        pBuffer->state = BUF_ERROR;
+    }
+}
+
+/**************************************************************************
+   Name - unpinBuffer
+
+   Purpose - Drops a pin. A buffer whose read failed is emptied once
+             nobody is using it any more.
+*************************************************************************/
+static void unpinBuffer(Buffer* pBuffer)
+{
+    if (--pBuffer->pins == 0 && (pBuffer->state == BUF_ERROR || pBuffer->state == BUF_EMPTY))
+    {
+        unhash(pBuffer);
+        listRemove(pBuffer);
+        listAdd(&freeList, LIST_FREE, pBuffer);
+    }
+}
+
+/**************************************************************************
+   Name - findBuffer
+
+   Returns - the buffer holding the sector with key, or NULL
+*************************************************************************/
+static Buffer* findBuffer(unsigned int key)
+{
+    Buffer* pBuffer = hashTable[HASH(key)];
+
+    while (pBuffer != NULL && pBuffer->key != key)
+    {
+        pBuffer = pBuffer->hashNext;
+    }
+
+    return pBuffer;
+}
+
+/**************************************************************************
+   Name - reuseBuffer
+
+   Purpose - Takes a free buffer, or evicts a clean one. A1in gives up its
+             oldest buffer while it is over its target size, otherwise the
+             least recently used buffer of Am goes. Sectors evicted from
+             A1in are remembered on A1out.
+
+   Returns - the buffer, off every list and hash chain, or NULL if every
+        buffer is dirty or in use
+*************************************************************************/
+static Buffer* reuseBuffer(void)
+{
+    Buffer* pBuffer = freeList.tail;
+
+    if (pBuffer != NULL)
+    {
+        listRemove(pBuffer);
+        return pBuffer;
+    }
+
+    if (a1in.size > A1IN_TARGET)
+    {
+        pBuffer = takeVictim(&a1in);
+    }
+    if (pBuffer == NULL)
+    {
+        pBuffer = takeVictim(&am);
+    }
+    if (pBuffer == NULL)
+    {
+        pBuffer = takeVictim(&a1in);
+    }
+    if (pBuffer == NULL)
+    {
+        return NULL;
+    }
+
+    if (pBuffer->list == LIST_A1IN)
+    {
+        addGhost(pBuffer->key);
+    }
+
+    stats.evictions++;
+    unhash(pBuffer);
+    listRemove(pBuffer);
+
+    return pBuffer;
+}
+
+/**************************************************************************
+   Name - takeVictim
+
+   Returns - the buffer closest to the tail of pList that is clean and
+        not in use, or NULL
+*************************************************************************/
+static Buffer* takeVictim(BufferList* pList)
+{
+    Buffer* pBuffer = pList->tail;
+
+    while (pBuffer != NULL &&
+        (pBuffer->pins > 0 || pBuffer->state == BUF_READING || pBuffer->dirty || pBuffer->writing))
+    {
+        pBuffer = pBuffer->prev;
+    }
+
+    return pBuffer;
+}
+
+/**************************************************************************
+   Name - takeGhost
+
+   Purpose - Looks for key on A1out and forgets it if it is there.
+
+   Returns - TRUE if the key was on A1out
+*************************************************************************/
+static int takeGhost(unsigned int key)
+{
+    Ghost** ppGhost = &ghostTable[HASH(key)];
+
+    while (*ppGhost != NULL)
+    {
+        if ((*ppGhost)->key == key)
+        {
+            (*ppGhost)->used = FALSE;
+            *ppGhost = (*ppGhost)->hashNext;
+            return TRUE;
+        }
+        ppGhost = &(*ppGhost)->hashNext;
+    }
+
+    return FALSE;
+}
+
+/**************************************************************************
+   Name - addGhost
+
+   Purpose - Remembers key on A1out in place of its oldest entry.
+*************************************************************************/
+static void addGhost(unsigned int key)
+{
+    Ghost* pGhost = &ghosts[nextGhost];
+
+    nextGhost = (nextGhost + 1) % GHOSTS;
+
+    if (pGhost->used)
+    {
+        takeGhost(pGhost->key);
+    }
+
+    pGhost->key = key;
+    pGhost->used = TRUE;
+    pGhost->hashNext = ghostTable[HASH(key)];
+    ghostTable[HASH(key)] = pGhost;
+}
+
+/**************************************************************************
+   Name - unhash
+
+   Purpose - Takes a buffer out of its hash chain, if it is in one.
+*************************************************************************/
+static void unhash(Buffer* pBuffer)
+{
+    Buffer** ppBuffer = &hashTable[HASH(pBuffer->key)];
+
+    while (*ppBuffer != NULL)
+    {
+        if (*ppBuffer == pBuffer)
+        {
+            *ppBuffer = pBuffer->hashNext;
+            break;
+        }
+        ppBuffer = &(*ppBuffer)->hashNext;
+    }
+
+    pBuffer->hashNext = NULL;
+    pBuffer->state = BUF_EMPTY;
+}
+
+/**************************************************************************
+   Name - readDone
+
+   Purpose - DiskRequest callback for the read of a buffer. Readies every
+             process waiting for the sector. A failed read ahead nobody
+             is waiting for is dropped.
+*************************************************************************/
+static void readDone(DiskRequest* pRequest)
+{
+    Buffer* pBuffer = pRequest->pContext;
+
+    pBuffer->state = pRequest->status == 0 ? BUF_VALID : BUF_ERROR;
+
+    while (pBuffer->waiters.size > 0)
+    {
+        ready_process(wait_queue_pop(&pBuffer->waiters));
+    }
+
+    if (pBuffer->state == BUF_ERROR && pBuffer->pins == 0)
+    {
+        unhash(pBuffer);
+        listRemove(pBuffer);
+        listAdd(&freeList, LIST_FREE, pBuffer);
+    }
+}
+
+/**************************************************************************
+   Name - readAheadFor
+
+   Purpose - Called for each read. If the read starts where the running
+             process's last read ended, the process is reading
+             sequentially and the track after this read is read ahead,
+             once per track.
+
+   Parameters - the sectors read, and the number of tracks on the disk
+*************************************************************************/
+static void readAheadFor(int unit, int platter, int track, int sector, int sectors, int tracks)
+{
+    int sequential = runningProcess->nextReadKey == SECTOR_KEY(unit, platter, track, sector);
+    int nextTrack = track + (sector + sectors) / THREADS_DISK_SECTOR_COUNT;
+    int nextSector = (sector + sectors) % THREADS_DISK_SECTOR_COUNT;
+    int aheadTrack = nextSector == 0 ? nextTrack : nextTrack + 1;
+    unsigned int aheadKey = SECTOR_KEY(unit, platter, aheadTrack, 0);
+
+    runningProcess->nextReadKey = SECTOR_KEY(unit, platter, nextTrack, nextSector);
+
+    if (!sequential || aheadTrack >= tracks || runningProcess->readAheadKey == aheadKey)
+    {
+        return;
+    }
+
+    runningProcess->readAheadKey = aheadKey;
+    for (int i = 0; i < THREADS_DISK_SECTOR_COUNT; i++)
+    {
+        prefetchSector(aheadKey + i, unit, platter, aheadTrack, i);
+    }
+}
+
+/**************************************************************************
+   Name - prefetchSector
+
+   Purpose - Starts reading a sector into an unpinned buffer if it is not
+             cached already and a clean buffer can be had without waiting.
+*************************************************************************/
+static void prefetchSector(unsigned int key, int unit, int platter, int track, int sector)
+{
+    Buffer* pBuffer;
+
+    if (findBuffer(key) != NULL || (pBuffer = reuseBuffer()) == NULL)
+    {
+        return;
+    }
+
+    stats.readAheads++;
+    insertBuffer(pBuffer, key, TRUE);
+    pBuffer->pins = 0;
+    pBuffer->prefetched = TRUE;
+
+    startRead(pBuffer, unit, platter, track, sector);
+}
+
+/**************************************************************************
+   Name - waitForClean
+
+   Purpose - Hurries the flusher along and blocks until it has written
+             back a batch. Called with interrupts disabled.
+*************************************************************************/
+static void waitForClean(void)
+{
+    stats.throttled++;
+    wakeFlusher(TRUE);
+    block_on(&cleanWaiters, BLOCKED_DISK);
+}
+
+/**************************************************************************
+   Name - wakeFlusher
+
+   Purpose - Readies the flusher if it is waiting, starting it the first
+             time there is something to write back.
+
+   Parameters - urgent, TRUE if somebody is waiting for the write back,
+                    so the flusher should not let writes collect first
+*************************************************************************/
+static void wakeFlusher(int urgent)
+{
+    if (urgent)
+    {
+        flushUrgent = TRUE;
+    }
+
+    if (flusherPid == 0)
+    {
+        flusherPid = spawn_process("flusher", flusher, NULL, THREADS_MIN_STACK_SIZE, FLUSHER_PRIORITY, SPAWN_DAEMON);
+        disableInterrupts();
+    }
+    else if (flusherQueue.size > 0)
+    {
+        ready_process(wait_queue_pop(&flusherQueue));
+    }
+}
+
+/**************************************************************************
+   Name - flusher
+
+   Purpose - Kernel daemon that writes dirty buffers back. Once there is
+             something dirty it waits FLUSH_DELAY_MS for more writes,
+             unless somebody is waiting, and then writes back everything
+             dirty a sorted batch at a time, letting waiting processes go
+             after each batch.
+*************************************************************************/
+static int flusher(void* arg)
+{
+    disableInterrupts();
+
+    while (TRUE)
+    {
+        while (dirtyBuffers == 0)
+        {
+            block_on(&flusherQueue, BLOCKED_DISK);
+        }
+
+        if (!flushUrgent)
+        {
+            block_on_timeout(&flusherQueue, BLOCKED_DISK, FLUSH_DELAY_MS);
+        }
+
+        while (dirtyBuffers > 0 || flushing > 0)
+        {
+            flushBatch();
+            while (flushing > 0)
+            {
+                block_on(&flusherQueue, BLOCKED_DISK);
+            }
+
+            while (cleanWaiters.size > 0)
+            {
+                ready_process(wait_queue_pop(&cleanWaiters));
+            }
+        }
+
+        flushUrgent = FALSE;
+    }
+
+    return 0;
+}
+
+/**************************************************************************
+   Name - flushBatch
+
+   Purpose - Queues the write back of up to FLUSH_BATCH dirty buffers on
+             the disks, lowest position first.
+*************************************************************************/
+static void flushBatch(void)
+{
+    int count = 0;
+
+    for (int i = 0; i < CACHE_BUFFERS; i++)
+    {
+        if (buffers[i].dirty && !buffers[i].writing)
+        {
+            flushOrder[count++] = &buffers[i];
+        }
+    }
+
+    qsort(flushOrder, count, sizeof(flushOrder[0]), compareKeys);
+
+    for (int i = 0; i < count && i < FLUSH_BATCH; i++)
+    {
+        Buffer* pBuffer = flushOrder[i];
+        unsigned int position = pBuffer->key - 1;
+
+        pBuffer->dirty = FALSE;
+        pBuffer->writing = TRUE;
+        dirtyBuffers--;
+        flushing++;
+        stats.writeBacks++;
+
+        pBuffer->request.sector = position % THREADS_DISK_SECTOR_COUNT;
+        position /= THREADS_DISK_SECTOR_COUNT;
+        pBuffer->request.track = position % 256;
+        position /= 256;
+        pBuffer->request.platter = position % THREADS_DISK_MAX_PLATTERS;
+        pBuffer->request.unit = position / THREADS_DISK_MAX_PLATTERS;
+        pBuffer->request.sectors = 1;
+        pBuffer->request.write = TRUE;
+        pBuffer->request.buffer = pBuffer->data;
+        pBuffer->request.callback = writeDone;
+        pBuffer->request.pContext = pBuffer;
+
+        if (disk_submit(&pBuffer->request) != 0)
+        {
+            pBuffer->request.status = -1;
+            writeDone(&pBuffer->request);
+        }
+    }
+}
+
+/**************************************************************************
+   Name - compareKeys
+
+   Purpose - qsort comparison putting buffers in disk order.
+*************************************************************************/
+static int compareKeys(const void* pFirst, const void* pSecond)
+{
+    unsigned int first = (*(Buffer**)pFirst)->key;
+    unsigned int second = (*(Buffer**)pSecond)->key;
+
+    return first < second ? -1 : first > second;
+}
+
+/**************************************************************************
+   Name - writeDone
+
+   Purpose - DiskRequest callback for a write back. Lets writers waiting
+             for the buffer change it again, and readies the flusher once
+             its batch is done. A failed write back is reported and the
+             data is kept in the cache.
+*************************************************************************/
+static void writeDone(DiskRequest* pRequest)
+{
+    Buffer* pBuffer = pRequest->pContext;
+
+    if (pRequest->status != 0)
+    {
+        console_output(FALSE, "writeDone(): write back of disk%d platter %d track %d sector %d failed\n",
+            pRequest->unit, pRequest->platter, pRequest->track, pRequest->sector);
+    }
+
+    pBuffer->writing = FALSE;
+    while (pBuffer->waiters.size > 0)
+    {
+        ready_process(wait_queue_pop(&pBuffer->waiters));
+    }
+
+    if (--flushing == 0 && flusherQueue.size > 0)
+    {
+        ready_process(wait_queue_pop(&flusherQueue));
+    }
+}
+
+/**************************************************************************
+   Name - listAdd
+
+   Purpose - Adds a buffer at the head of a list.
+*************************************************************************/
+static void listAdd(BufferList* pList, int list, Buffer* pBuffer)
+{
+    pBuffer->list = list;
+    pBuffer->prev = NULL;
+    pBuffer->next = pList->head;
+
+    if (pList->head == NULL)
+    {
+        pList->tail = pBuffer;
+    }
+    else
+    {
+        pList->head->prev = pBuffer;
+    }
+
+    pList->head = pBuffer;
+    pList->size++;
+}
+
+/**************************************************************************
+   Name - listRemove
+
+   Purpose - Unlinks a buffer from whichever list it is on.
+*************************************************************************/
+static void listRemove(Buffer* pBuffer)
+{
+    BufferList* pList;
+
+    switch (pBuffer->list)
+    {
+    case LIST_FREE:
+        pList = &freeList;
+        break;
+    case LIST_A1IN:
+        pList = &a1in;
+        break;
+    case LIST_AM:
+        pList = &am;
+        break;
+    default:
+        return;
+    }
+
+    if (pBuffer->prev == NULL)
+    {
+        pList->head = pBuffer->next;
+    }
+    else
+    {
+        pBuffer->prev->next = pBuffer->next;
+    }
+
+    if (pBuffer->next == NULL)
+    {
+        pList->tail = pBuffer->prev;
+    }
+    else
+    {
+        pBuffer->next->prev = pBuffer->prev;
+    }
+
+    pList->size--;
+    pBuffer->list = LIST_NONE;
+    pBuffer->next = NULL;
+    pBuffer->prev = NULL;
+}
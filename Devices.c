@@ -0,0 +1,426 @@
+/*
+Program: Devices
+Created by: Ian Penrose & Lindsay Wax
+Course: CYBV 489
+
+
+Description: Kernel-wide accounting of outstanding I/O. Every device a driver uses is
+registered as an IoDevice that counts the commands in flight on it and the processes
+waiting on it, and a running total over all devices is kept as commands are issued and
+completed. The watchdog only has to look at the total to know whether an I/O interrupt
+is still coming that could wake a blocked process.
+
+The I/O interrupt is passed to the driver of the device that interrupted. Once deferred
+handling is turned on, the interrupt handler only records the interrupt in a ring and
+readies the bottom half, a kernel daemon that runs the drivers' interrupt code. The ring
+has one producer, the handler, and one consumer, the bottom half, so neither has to lock
+it. Interrupts that arrive while the bottom half is already ready or running are picked
+up by the same pass, and the processes they complete are all readied before the
+dispatcher next runs.
+*/
+
+
+
+#define _CRT_SECURE_NO_WARNINGS
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "THREADSLib.h"
+#include "Scheduler.h"
+#include "Devices.h"
+#include "Processes.h"
+
+#define IO_RING_SIZE            64      // Interrupts the ring holds, a power of 2
+#define BOTTOM_HALF_PRIORITY    HIGHEST_PRIORITY
+
+/*
+IoEvents are the interrupts waiting in the ring for the bottom half.
+*/
+typedef struct _io_event
+{
+    char            type;           // First letter of the device name, 'd' or 't'
+    uint8_t         unit;
+    uint8_t         command;
+    uint32_t        status;
+
+} IoEvent;
+
+static IoDevice* deviceList;        // Registered devices, in the order they were registered
+static int totalInFlight;           // Sum of inFlight over all devices
+
+static IoEvent ioRing[IO_RING_SIZE];
+static volatile LONG ringHead;      // Next interrupt the bottom half handles
+static volatile LONG ringTail;      // Where the handler records the next interrupt
+static int deferInterrupts;         // TRUE once interrupts are handled by the bottom half
+static int bottomHalfPid;           // 0 until deferred handling is first turned on
+static WaitQueue bottomHalfQueue;   // The bottom half, while the ring is empty
+static interrupt_stats_t interruptStats;
+
+static int deliverInterrupt(char type, int unit, uint8_t command, uint32_t status);
+static int bottomHalf(void* arg);
+static unsigned long long readTicks(void);
+
+
+/**************************************************************************
+   Name - io_initialize
+
+   Purpose - Forgets every registered device. Called once from bootstrap
+             before the drivers are initialized.
+*************************************************************************/
+void io_initialize(void)
+{
+    deviceList = NULL;
+    totalInFlight = 0;
+
+    memset(&bottomHalfQueue, 0, sizeof(bottomHalfQueue));
+    memset(&interruptStats, 0, sizeof(interruptStats));
+    ringHead = 0;
+    ringTail = 0;
+    deferInterrupts = FALSE;
+    bottomHalfPid = 0;
+}
+
+/**************************************************************************
+   Name - io_register
+
+   Purpose - Adds a driver's IoDevice to the kernel's list with nothing
+             outstanding on it.
+
+   Parameters - pDevice, the device, which must stay in place for as long
+                    as the kernel runs
+                name, the library's name for the device
+*************************************************************************/
+void io_register(IoDevice* pDevice, char* name)
+{
+    IoDevice** ppLink = &deviceList;
+
+    memset(pDevice, 0, sizeof(IoDevice));
+    strncpy(pDevice->name, name, sizeof(pDevice->name) - 1);
+
+    while (*ppLink != NULL)
+    {
+        ppLink = &(*ppLink)->next;
+    }
+    *ppLink = pDevice;
+}
+
+/**************************************************************************
+   Name - io_issue
+
+   Purpose - Counts a command the device has accepted. Called with
+             interrupts disabled, after device_control has returned 0.
+*************************************************************************/
+void io_issue(IoDevice* pDevice)
+{
+    pDevice->inFlight++;
+    pDevice->issued++;
+    totalInFlight++;
+}
+
+/**************************************************************************
+   Name - io_complete
+
+   Purpose - Counts a command the device has completed. Called from the
+             I/O interrupt. An interrupt with nothing in flight is not
+             counted.
+*************************************************************************/
+void io_complete(IoDevice* pDevice)
+{
+    if (pDevice->inFlight > 0)
+    {
+        pDevice->inFlight--;
+        pDevice->completed++;
+        totalInFlight--;
+    }
+}
+
+/**************************************************************************
+   Name - io_wait
+
+   Purpose - Blocks the running process on a device until the driver
+             wakes it. Called with interrupts disabled.
+
+   Parameters - pDevice, the device
+                target, the driver's queue to wait on, or NULL to wait on
+                    the device's own waiters queue
+                blockStatus, the reason for blocking (see BLOCKED_*)
+*************************************************************************/
+void io_wait(IoDevice* pDevice, WaitQueue* target, int blockStatus)
+{
+    pDevice->waiting++;
+    block_on(target != NULL ? target : &pDevice->waiters, blockStatus);
+    pDevice->waiting--;
+}
+
+/**************************************************************************
+   Name - io_wake
+
+   Purpose - Readies one process waiting on the device's own waiters
+             queue. A process that is not blocked on it is left alone.
+*************************************************************************/
+void io_wake(IoDevice* pDevice, Process* pProcess)
+{
+    if (pProcess->status == BLOCKED && pProcess->pWaitQueue == &pDevice->waiters)
+    {
+        wait_queue_remove(&pDevice->waiters, pProcess);
+        ready_process(pProcess);
+    }
+}
+
+/**************************************************************************
+   Name - io_interrupt
+
+   Purpose - The top half of the I/O interrupt. Passes the interrupt to
+             its driver straight away, or, when deferred handling is on,
+             records it in the ring and readies the bottom half if it is
+             waiting for work. Interrupts are disabled throughout.
+
+   Parameters - deviceId, command and status, from the interrupt
+
+   Returns - TRUE if a process was readied, so the caller should let the
+        dispatcher run, otherwise FALSE
+*************************************************************************/
+int io_interrupt(char deviceId[32], uint8_t command, uint32_t status)
+{
+    unsigned long long start = readTicks();
+    int readied = FALSE;
+
+    interruptStats.interrupts++;
+
+    if (deferInterrupts && ringTail - ringHead < IO_RING_SIZE)
+    {
+        IoEvent* pEvent = &ioRing[ringTail & (IO_RING_SIZE - 1)];
+
+        pEvent->type = deviceId[0];
+        pEvent->unit = (uint8_t)atoi(deviceId + 4);
+        pEvent->command = command;
+        pEvent->status = status;
+
+        // Publish the event only once it is filled in
+        InterlockedIncrement(&ringTail);
+        interruptStats.deferred++;
+
+        if (bottomHalfQueue.size > 0)
+        {
+            ready_process(wait_queue_pop(&bottomHalfQueue));
+            interruptStats.wakeups++;
+            readied = TRUE;
+        }
+    }
+    else
+    {
+        if (deferInterrupts)
+        {
+            interruptStats.overflows++;
+        }
+        readied = deliverInterrupt(deviceId[0], atoi(deviceId + 4), command, status);
+    }
+
+    interruptStats.handlerTicks += readTicks() - start;
+
+    return readied;
+}
+
+/**************************************************************************
+   Name - io_set_deferred
+
+   Purpose - Turns deferred interrupt handling on or off. The bottom half
+             is started the first time it is turned on. Interrupts already
+             in the ring are still handled by the bottom half after it is
+             turned off.
+
+   Parameters - deferred, TRUE to queue interrupts for the bottom half,
+                    FALSE to handle them in the interrupt handler
+*************************************************************************/
+void io_set_deferred(int deferred)
+{
+    check_kernel_mode("io_set_deferred");
+
+    if (deferred && bottomHalfPid == 0)
+    {
+        bottomHalfPid = spawn_process("bottom half", bottomHalf, NULL, THREADS_MIN_STACK_SIZE,
+            BOTTOM_HALF_PRIORITY, SPAWN_DAEMON);
+        if (bottomHalfPid < 0)
+        {
+            bottomHalfPid = 0;
+            return;
+        }
+    }
+
+    deferInterrupts = deferred;
+}
+
+/**************************************************************************
+   Name - get_interrupt_stats
+
+   Purpose - Copies the I/O interrupt counters.
+*************************************************************************/
+void get_interrupt_stats(interrupt_stats_t* pStats)
+{
+    if (pStats != NULL)
+    {
+        *pStats = interruptStats;
+    }
+}
+
+/**************************************************************************
+   Name - get_bottom_half_pid
+
+   Returns - the pid of the bottom half, or 0 if deferred handling has
+        never been turned on
+*************************************************************************/
+int get_bottom_half_pid(void)
+{
+    return bottomHalfPid;
+}
+
+/**************************************************************************
+   Name - reset_interrupt_stats
+
+   Purpose - Zeroes the I/O interrupt counters.
+*************************************************************************/
+void reset_interrupt_stats(void)
+{
+    memset(&interruptStats, 0, sizeof(interruptStats));
+}
+
+/**************************************************************************
+   Name - io_in_flight
+
+   Returns - the number of commands outstanding on all devices
+*************************************************************************/
+int io_in_flight(void)
+{
+    return totalInFlight;
+}
+
+/**************************************************************************
+   Name - get_device_stats
+
+   Purpose - Copies the accounting of a registered device.
+
+   Parameters - name, the library's name for the device
+                pStats, where to store it
+
+   Returns - 0 if successful, -1 if no such device is registered
+*************************************************************************/
+int get_device_stats(char* name, device_stats_t* pStats)
+{
+    for (IoDevice* pDevice = deviceList; pDevice != NULL; pDevice = pDevice->next)
+    {
+        if (strcmp(pDevice->name, name) == 0)
+        {
+            if (pStats != NULL)
+            {
+                pStats->inFlight = pDevice->inFlight;
+                pStats->waiting = pDevice->waiting;
+                pStats->issued = pDevice->issued;
+                pStats->completed = pDevice->completed;
+            }
+            return 0;
+        }
+    }
+
+    return -1;
+}
+
+/**************************************************************************
+   Name - display_device_stats
+
+   Purpose - Prints the accounting of every registered device.
+*************************************************************************/
+void display_device_stats(void)
+{
+    console_output(FALSE, "%-8s %9s %8s %10s %10s\n", "Device", "In Flight", "Waiting", "Issued", "Completed");
+
+    for (IoDevice* pDevice = deviceList; pDevice != NULL; pDevice = pDevice->next)
+    {
+        console_output(FALSE, "%-8s %9d %8d %10u %10u\n", pDevice->name, pDevice->inFlight,
+            pDevice->waiting, pDevice->issued, pDevice->completed);
+    }
+    console_output(FALSE, "%d commands in flight\n", totalInFlight);
+}
+
+/**************************************************************************
+   Name - deliverInterrupt
+
+   Purpose - Passes an I/O interrupt to the driver of the device that
+             finished a command. Called with interrupts disabled.
+
+   Returns - TRUE if the driver readied a process, otherwise FALSE
+*************************************************************************/
+static int deliverInterrupt(char type, int unit, uint8_t command, uint32_t status)
+{
+    if (type == 'd')
+    {
+        return disk_interrupt(unit, command, status);
+    }
+    else if (type == 't')
+    {
+        return terminal_interrupt(unit, command, status);
+    }
+
+    return FALSE;
+}
+
+/**************************************************************************
+   Name - bottomHalf
+
+   Purpose - Kernel daemon that handles the interrupts in the ring. Each
+             pass runs the drivers' interrupt code for every interrupt in
+             the ring, letting interrupts in between them, and then waits
+             for the handler to record more. The processes the pass
+             readies run once it waits.
+*************************************************************************/
+static int bottomHalf(void* arg)
+{
+    disableInterrupts();
+
+    while (TRUE)
+    {
+        unsigned int batch = 0;
+
+        while (ringHead != ringTail)
+        {
+            IoEvent event = ioRing[ringHead & (IO_RING_SIZE - 1)];
+            unsigned long long start = readTicks();
+
+            // The slot can be reused once the event is copied out of it
+            InterlockedIncrement(&ringHead);
+
+            deliverInterrupt(event.type, event.unit, event.command, event.status);
+            interruptStats.bottomHalfTicks += readTicks() - start;
+            batch++;
+
+            enableInterrupts();
+            disableInterrupts();
+        }
+
+        if (batch > 0)
+        {
+            interruptStats.passes++;
+            if (batch > interruptStats.maxBatch)
+            {
+                interruptStats.maxBatch = batch;
+            }
+        }
+
+        block_on(&bottomHalfQueue, BLOCKED_INTERRUPT);
+    }
+
+    return 0;
+}
+
+/**************************************************************************
+   Name - readTicks
+
+   Returns - the current QueryPerformanceCounter value
+*************************************************************************/
+static unsigned long long readTicks(void)
+{
+    LARGE_INTEGER now;
+
+    QueryPerformanceCounter(&now);
+    return (unsigned long long)now.QuadPart;
+}
@@ -0,0 +1,1201 @@
+/*
+Program: Disk
+Created by: Ian Penrose & Lindsay Wax
+Course: CYBV 489
+
+
+Description: Interrupt driven disk driver. Each disk keeps a queue of DiskRequests and
+works on one of them at a time, issuing a DISK_SEEK when the request is on another track
+and then one DISK_READ or DISK_WRITE per sector, each started from the I/O interrupt of
+the command before it. Which queued request goes next is chosen by the disk's policy:
+FIFO, or an elevator (SCAN or C-LOOK) ordered by track that keeps the head moving in one
+direction for as long as there are requests ahead of it.
+
+Vectored transfers take a list of sectors, each with its own buffer. Runs of the list that
+are consecutive sectors of one track become a single request, so the run is scheduled,
+seeked to and completed as one, and the caller is woken once when the last run is done.
+
+The units after the library's disks are image disks, backed by a host file mapped into
+memory. A request on an image disk is copied to or from the mapping as soon as it is
+submitted, and the file keeps the data from one run to the next, so a disk prepared once
+can be attached again without writing it sector by sector through the device.
+*/
+
+
+
+#define _CRT_SECURE_NO_WARNINGS
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "THREADSLib.h"
+#ifndef _WIN32
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+#include "Scheduler.h"
+#include "Disk.h"
+#include "Slab.h"
+#include "Processes.h"
+
+#define DEVICE_UNITS    THREADS_MAX_DISKS
+#define DISK_UNITS      (DEVICE_UNITS + DISK_IMAGE_UNITS)
+#define VECTOR_SEGMENTS 256     // Segments a pooled vector holds, enough for the largest swap cluster
+
+/*
+Disks are the driver's state for each unit. The geometry is asked for with DISK_INFO
+when the driver starts and requests are not accepted until it has arrived.
+*/
+typedef struct _disk
+{
+    int             present;        // TRUE if the device could be initialized
+    char            name[THREADS_MAX_DEVICE_NAME];
+    int             platters;       // Geometry from DISK_INFO, 0 until it arrives
+    int             tracks;
+    int             currentTrack;   // Track the head was last sent to
+    int             direction;      // 1 while the SCAN elevator moves up, -1 while it moves down
+    int             policy;         // DISK_SCHED_*
+    DiskRequest*    queueHead;      // Requests waiting for the disk, in submission order
+    DiskRequest*    queueTail;
+    int             queued;         // Number of requests in the queue
+    DiskRequest*    active;         // Request the disk is working on, NULL if it is idle
+    IoDevice        io;             // Commands in flight, and processes blocked on the disk
+    char*           pImage;         // Mapping of the host file behind an image disk, NULL for a device
+    size_t          imageSize;
+#ifdef _WIN32
+    HANDLE          hImageFile;
+    HANDLE          hImageMapping;
+#endif
+    disk_stats_t    stats;
+
+} Disk;
+
+static Disk disks[DISK_UNITS];
+
+/*
+A VectorTransfer tracks the requests a vectored transfer was split into, so the caller
+is only woken once all of them have completed.
+*/
+typedef struct
+{
+    Process*        pProcess;       // Caller blocked on the transfer
+    int             pending;        // Requests not completed yet
+    int             status;         // 0, or the status of the first request that failed
+
+} VectorTransfer;
+
+/*
+VectorArrays are the requests and sector pointers of a vectored transfer, kept in a slab
+cache so the I/O path does not go to the host allocator. Bigger transfers use malloc.
+*/
+typedef struct
+{
+    DiskRequest     requests[VECTOR_SEGMENTS];
+    char*           pSectors[VECTOR_SEGMENTS];
+
+} VectorArrays;
+
+static int vectorCache;
+
+static int disk_transfer(int unit, int platter, int track, int sector, int sectors, void* pBuffer, int write);
+static int disk_transfer_vector(int unit, disk_segment_t* pSegments, int count, int write);
+static int validRequest(Disk* pDisk, DiskRequest* pRequest);
+static Disk* getDisk(int unit);
+static void waitForGeometry(Disk* pDisk);
+static DiskRequest* takeNext(Disk* pDisk);
+static void startNext(Disk* pDisk);
+static void issueCommand(Disk* pDisk);
+static void completeRequest(Disk* pDisk, int status);
+static void wakeRequester(DiskRequest* pRequest);
+static void vectorDone(DiskRequest* pRequest);
+static VectorArrays* allocVector(int count, DiskRequest** ppRequests, char*** pppSectors);
+static void freeVector(VectorArrays* pArrays, DiskRequest* pRequests, char** ppSectors);
+static void transferImage(Disk* pDisk, DiskRequest* pRequest);
+static char* mapImage(Disk* pDisk, char* path, size_t size);
+static void unmapImage(Disk* pDisk);
+
+
+/**************************************************************************
+   Name - disk_initialize
+
+   Purpose - Initializes every disk the library accepts and asks each one
+             for its geometry. Called once from bootstrap.
+*************************************************************************/
+void disk_initialize(void)
+{
+    device_control_block_t controlBlock;
+
+    // Images left attached by an earlier bootstrap are written out and let go
+    for (int unit = DEVICE_UNITS; unit < DISK_UNITS; unit++)
+    {
+        if (disks[unit].pImage != NULL)
+        {
+            unmapImage(&disks[unit]);
+        }
+    }
+    memset(disks, 0, sizeof(disks));
+    vectorCache = slab_cache_create("disk vectors", sizeof(VectorArrays), NULL);
+
+    for (int unit = 0; unit < DEVICE_UNITS; unit++)
+    {
+        Disk* pDisk = &disks[unit];
+
+        snprintf(pDisk->name, sizeof(pDisk->name), "disk%d", unit);
+        pDisk->direction = 1;
+        pDisk->policy = DISK_SCHED_CLOOK;
+
+        if (device_initialize(pDisk->name) != 0)
+        {
+            continue;
+        }
+        io_register(&pDisk->io, pDisk->name);
+
+        memset(&controlBlock, 0, sizeof(controlBlock));
+        controlBlock.command = DISK_INFO;
+        pDisk->present = device_control(pDisk->name, controlBlock) == 0;
+        if (pDisk->present)
+        {
+            io_issue(&pDisk->io);
+        }
+    }
+}
+
+/**************************************************************************
+   Name - k_disk_read
+
+   Purpose - Reads consecutive sectors, continuing onto the following
+             tracks of the platter, and blocks until they have arrived.
+
+   Parameters - unit, the disk to read
+                platter, track and sector, where the first sector is
+                sectors, the number of sectors to read
+                pBuffer, sectors * THREADS_DISK_SECTOR_SIZE bytes
+
+   Returns - 0 if successful, -1 if the parameters are invalid, or
+        DISK_IO_ERROR if the device failed the read
+*************************************************************************/
+int k_disk_read(int unit, int platter, int track, int sector, int sectors, void* pBuffer)
+{
+    check_kernel_mode("k_disk_read");
+
+    return disk_transfer(unit, platter, track, sector, sectors, pBuffer, FALSE);
+}
+
+/**************************************************************************
+   Name - k_disk_write
+
+   Purpose - Writes consecutive sectors, continuing onto the following
+             tracks of the platter, and blocks until they are written.
+
+   Parameters - unit, the disk to write
+                platter, track and sector, where the first sector is
+                sectors, the number of sectors to write
+                pBuffer, sectors * THREADS_DISK_SECTOR_SIZE bytes
+
+   Returns - 0 if successful, -1 if the parameters are invalid, or
+        DISK_IO_ERROR if the device failed the write
+*************************************************************************/
+int k_disk_write(int unit, int platter, int track, int sector, int sectors, void* pBuffer)
+{
+    check_kernel_mode("k_disk_write");
+
+    return disk_transfer(unit, platter, track, sector, sectors, pBuffer, TRUE);
+}
+
+/**************************************************************************
+   Name - k_disk_readv
+
+   Purpose - Reads a list of sectors, each into its own buffer, and
+             blocks until all of them have arrived. Sectors that follow
+             one another on the same track are read as one request.
+
+   Parameters - unit, the disk to read
+                pSegments, the sectors and where to put them
+                count, the number of segments
+
+   Returns - 0 if successful, -1 if any segment is invalid, in which case
+        nothing is read, or DISK_IO_ERROR if the device failed a read
+*************************************************************************/
+int k_disk_readv(int unit, disk_segment_t* pSegments, int count)
+{
+    check_kernel_mode("k_disk_readv");
+
+    return disk_transfer_vector(unit, pSegments, count, FALSE);
+}
+
+/**************************************************************************
+   Name - k_disk_writev
+
+   Purpose - Writes a list of sectors, each from its own buffer, and
+             blocks until all of them are written. Sectors that follow
+             one another on the same track are written as one request.
+
+   Parameters - unit, the disk to write
+                pSegments, the sectors and the data for each of them
+                count, the number of segments
+
+   Returns - 0 if successful, -1 if any segment is invalid, in which case
+        nothing is written, or DISK_IO_ERROR if the device failed a write
+*************************************************************************/
+int k_disk_writev(int unit, disk_segment_t* pSegments, int count)
+{
+    check_kernel_mode("k_disk_writev");
+
+    return disk_transfer_vector(unit, pSegments, count, TRUE);
+}
+
+/**************************************************************************
+   Name - k_disk_info
+
+   Purpose - Gets the geometry of a disk, blocking until the disk has
+             reported it if the driver has only just started.
+
+   Parameters - unit, the disk
+                pPlatters and pTracks, where to store the geometry
+
+   Returns - 0 if successful, -1 if there is no such disk
+*************************************************************************/
+int k_disk_info(int unit, int* pPlatters, int* pTracks)
+{
+    Disk* pDisk;
+
+    check_kernel_mode("k_disk_info");
+
+    disableInterrupts();
+
+    pDisk = getDisk(unit);
+    if (pDisk == NULL)
+    {
+        enableInterrupts();
+        return -1;
+    }
+
+    waitForGeometry(pDisk);
+
+    if (pPlatters != NULL)
+    {
+        *pPlatters = pDisk->platters;
+    }
+    if (pTracks != NULL)
+    {
+        *pTracks = pDisk->tracks;
+    }
+
+    enableInterrupts();
+
+    return 0;
+}
+
+/**************************************************************************
+   Name - disk_set_scheduler
+
+   Purpose - Changes the order in which a disk serves its queued requests.
+
+   Parameters - unit, the disk
+                policy, one of DISK_SCHED_*
+
+   Returns - the previous policy, or -1 if the parameters are invalid
+*************************************************************************/
+int disk_set_scheduler(int unit, int policy)
+{
+    Disk* pDisk = getDisk(unit);
+    int previous;
+
+    if (pDisk == NULL || policy < DISK_SCHED_FIFO || policy > DISK_SCHED_CLOOK)
+    {
+        return -1;
+    }
+
+    previous = pDisk->policy;
+    pDisk->policy = policy;
+
+    return previous;
+}
+
+/**************************************************************************
+   Name - disk_attach_image
+
+   Purpose - Maps a host file as the next free image disk. An existing
+             file is used as it is, so the disk has whatever was written
+             to it before; a new one is created filled with zeros.
+
+   Parameters - path, the host file
+                platters and tracks, the geometry of the disk, which an
+                    existing file must be the size of
+
+   Returns - the unit of the image disk, or -1 if the parameters are
+        invalid, every image unit is in use, or the file cannot be mapped
+*************************************************************************/
+int disk_attach_image(char* path, int platters, int tracks)
+{
+    size_t size = (size_t)platters * tracks * THREADS_DISK_SECTOR_COUNT * THREADS_DISK_SECTOR_SIZE;
+    Disk* pDisk = NULL;
+    int unit;
+
+    if (path == NULL || platters <= 0 || platters > THREADS_DISK_MAX_PLATTERS || tracks <= 0 || tracks > 256)
+    {
+        return -1;
+    }
+
+    for (unit = DEVICE_UNITS; unit < DISK_UNITS && pDisk == NULL; unit++)
+    {
+        if (!disks[unit].present)
+        {
+            pDisk = &disks[unit];
+        }
+    }
+    if (pDisk == NULL)
+    {
+        return -1;
+    }
+    unit--;
+
+    memset(pDisk, 0, sizeof(Disk));
+    if (mapImage(pDisk, path, size) == NULL)
+    {
+        return -1;
+    }
+
+    snprintf(pDisk->name, sizeof(pDisk->name), "disk%d", unit);
+    pDisk->platters = platters;
+    pDisk->tracks = tracks;
+    pDisk->policy = DISK_SCHED_FIFO;
+    pDisk->present = TRUE;
+
+    return unit;
+}
+
+/**************************************************************************
+   Name - disk_detach_image
+
+   Purpose - Writes an image disk's mapping out to its file and unmaps
+             it. Anything the buffer cache holds for the disk must have
+             been synced first.
+
+   Returns - 0 if successful, -1 if unit is not an image disk
+*************************************************************************/
+int disk_detach_image(int unit)
+{
+    Disk* pDisk = getDisk(unit);
+
+    if (pDisk == NULL || pDisk->pImage == NULL)
+    {
+        return -1;
+    }
+
+    unmapImage(pDisk);
+    pDisk->present = FALSE;
+
+    return 0;
+}
+
+/**************************************************************************
+   Name - get_disk_stats
+
+   Purpose - Copies the counters of a disk.
+
+   Returns - 0 if successful, -1 if there is no such disk
+*************************************************************************/
+int get_disk_stats(int unit, disk_stats_t* pStats)
+{
+    Disk* pDisk = getDisk(unit);
+
+    if (pDisk == NULL || pStats == NULL)
+    {
+        return -1;
+    }
+
+    *pStats = pDisk->stats;
+
+    return 0;
+}
+
+/**************************************************************************
+   Name - reset_disk_stats
+
+   Purpose - Clears the counters of a disk.
+*************************************************************************/
+void reset_disk_stats(int unit)
+{
+    Disk* pDisk = getDisk(unit);
+
+    if (pDisk != NULL)
+    {
+        memset(&pDisk->stats, 0, sizeof(pDisk->stats));
+    }
+}
+
+/**************************************************************************
+   Name - disk_submit
+
+   Purpose - Queues a request on its disk without waiting for it. The
+             disk starts on it right away if it is idle, and the request's
+             callback is called from the I/O interrupt once it completes.
+             A request on an image disk completes, callback and all,
+             before disk_submit returns. Must be called with interrupts
+             disabled.
+
+   Parameters - pRequest, the request with everything but next, done and
+                    status filled in
+
+   Returns - 0 if the request was queued, -1 if it is invalid or the
+        disk's geometry has not arrived yet
+*************************************************************************/
+int disk_submit(DiskRequest* pRequest)
+{
+    Disk* pDisk = getDisk(pRequest->unit);
+
+    if (pDisk == NULL || !validRequest(pDisk, pRequest))
+    {
+        return -1;
+    }
+
+    pRequest->next = NULL;
+    pRequest->done = 0;
+    pRequest->status = 0;
+    pRequest->submitTime = read_clock();
+
+    // Image disks have nothing to wait for
+    if (pDisk->pImage != NULL)
+    {
+        transferImage(pDisk, pRequest);
+        return 0;
+    }
+
+    if (pDisk->queueTail == NULL)
+    {
+        pDisk->queueHead = pRequest;
+    }
+    else
+    {
+        pDisk->queueTail->next = pRequest;
+    }
+    pDisk->queueTail = pRequest;
+    pDisk->queued++;
+
+    if (pDisk->active == NULL)
+    {
+        startNext(pDisk);
+    }
+
+    return 0;
+}
+
+/**************************************************************************
+   Name - disk_interrupt
+
+   Purpose - Handles the I/O interrupt for a command a disk finished.
+             Moves the active request along and starts the next command.
+
+   Parameters - unit, the disk that interrupted
+                command and status, from the interrupt
+
+   Returns - TRUE if a request completed, so the caller should let the
+        dispatcher run, otherwise FALSE
+*************************************************************************/
+int disk_interrupt(int unit, uint8_t command, uint32_t status)
+{
+    Disk* pDisk = getDisk(unit);
+    DiskRequest* pRequest;
+    int completed = FALSE;
+
+    if (pDisk == NULL)
+    {
+        return FALSE;
+    }
+
+    pRequest = pDisk->active;
+    io_complete(&pDisk->io);
+
+    switch (command)
+    {
+    case DISK_INFO:
+        pDisk->platters = (status >> 16) & 0xffff;
+        pDisk->tracks = status & 0xffff;
+
+        // Let everyone waiting for the geometry go, no request can be waiting yet
+        while (pDisk->io.waiters.size > 0)
+        {
+            ready_process(wait_queue_pop(&pDisk->io.waiters));
+            completed = TRUE;
+        }
+        startNext(pDisk);
+        break;
+
+    case DISK_SEEK:
+        if (pRequest != NULL)
+        {
+            issueCommand(pDisk);
+        }
+        break;
+
+    case DISK_READ:
+    case DISK_WRITE:
+        if (pRequest == NULL)
+        {
+            break;
+        }
+
+        if (status != 0)
+        {
+            completeRequest(pDisk, status);
+            completed = TRUE;
+        }
+        else if (++pRequest->done == pRequest->sectors)
+        {
+            completeRequest(pDisk, 0);
+            completed = TRUE;
+        }
+        else
+        {
+            issueCommand(pDisk);
+        }
+        break;
+    }
+
+    return completed;
+}
+
+/**************************************************************************
+   Name - disk_transfer
+
+   Purpose - Common path for k_disk_read and k_disk_write. Submits a
+             request kept on the caller's stack and blocks until the I/O
+             interrupt completes it. The block is not interrupted by
+             signals, as the request must not go away while the disk is
+             still using it.
+
+   Returns - 0 if successful, -1 if the parameters are invalid, or
+        DISK_IO_ERROR if the device failed the transfer
+*************************************************************************/
+static int disk_transfer(int unit, int platter, int track, int sector, int sectors, void* pBuffer, int write)
+{
+    DiskRequest request;
+    Disk* pDisk;
+
+    disableInterrupts();
+
+    pDisk = getDisk(unit);
+    if (pDisk == NULL)
+    {
+        enableInterrupts();
+        return -1;
+    }
+
+    waitForGeometry(pDisk);
+
+    request.unit = unit;
+    request.platter = platter;
+    request.track = track;
+    request.sector = sector;
+    request.sectors = sectors;
+    request.write = write;
+    request.buffer = pBuffer;
+    request.ppSectors = NULL;
+    request.callback = wakeRequester;
+    request.pContext = runningProcess;
+
+    if (disk_submit(&request) != 0)
+    {
+        enableInterrupts();
+        return -1;
+    }
+
+    // Interrupts stay disabled until the block, so the completion cannot be missed
+    while (request.done < request.sectors && request.status == 0)
+    {
+        io_wait(&pDisk->io, NULL, BLOCKED_DISK);
+    }
+
+    enableInterrupts();
+
+    return request.status == 0 ? 0 : DISK_IO_ERROR;
+}
+
+/**************************************************************************
+   Name - disk_transfer_vector
+
+   Purpose - Common path for k_disk_readv and k_disk_writev. Splits the
+             segments into runs of consecutive sectors on one track,
+             submits a request for each run and blocks until the last of
+             them completes. Every run is checked before any is submitted.
+             The block is not interrupted by signals.
+
+   Returns - 0 if successful, -1 if the parameters are invalid, or
+        DISK_IO_ERROR if the device failed a transfer
+*************************************************************************/
+static int disk_transfer_vector(int unit, disk_segment_t* pSegments, int count, int write)
+{
+    VectorTransfer vector;
+    VectorArrays* pArrays;
+    DiskRequest* pRequests;
+    char** ppSectors;
+    Disk* pDisk;
+    int runs = 0;
+    int result = 0;
+
+    if (pSegments == NULL || count <= 0)
+    {
+        return -1;
+    }
+
+    disableInterrupts();
+
+    pDisk = getDisk(unit);
+    if (pDisk == NULL)
+    {
+        enableInterrupts();
+        return -1;
+    }
+
+    waitForGeometry(pDisk);
+
+    pArrays = allocVector(count, &pRequests, &ppSectors);
+    if (pRequests == NULL || ppSectors == NULL)
+    {
+        freeVector(pArrays, pRequests, ppSectors);
+        enableInterrupts();
+        return -1;
+    }
+
+    for (int i = 0; i < count && result == 0; i++)
+    {
+        disk_segment_t* pSegment = &pSegments[i];
+        DiskRequest* pRun = runs > 0 ? &pRequests[runs - 1] : NULL;
+
+        ppSectors[i] = pSegment->pBuffer;
+
+        // Extend the current run if this sector follows on from it
+        if (pRun != NULL && pSegment->platter == pRun->platter && pSegment->track == pRun->track &&
+            pSegment->sector == pRun->sector + pRun->sectors && pSegment->sector < THREADS_DISK_SECTOR_COUNT &&
+            pSegment->pBuffer != NULL)
+        {
+            pRun->sectors++;
+            continue;
+        }
+
+        pRun = &pRequests[runs++];
+        pRun->unit = unit;
+        pRun->platter = pSegment->platter;
+        pRun->track = pSegment->track;
+        pRun->sector = pSegment->sector;
+        pRun->sectors = 1;
+        pRun->write = write;
+        pRun->buffer = pSegment->pBuffer;
+        pRun->ppSectors = &ppSectors[i];
+        pRun->callback = vectorDone;
+        pRun->pContext = &vector;
+
+        if (pSegment->pBuffer == NULL)
+        {
+            result = -1;
+        }
+    }
+
+    for (int i = 0; i < runs && result == 0; i++)
+    {
+        if (!validRequest(pDisk, &pRequests[i]))
+        {
+            result = -1;
+        }
+    }
+
+    if (result == 0)
+    {
+        vector.pProcess = runningProcess;
+        vector.pending = runs;
+        vector.status = 0;
+
+        for (int i = 0; i < runs; i++)
+        {
+            disk_submit(&pRequests[i]);
+        }
+
+        // Interrupts stay disabled until the block, so the last completion cannot be missed
+        while (vector.pending > 0)
+        {
+            io_wait(&pDisk->io, NULL, BLOCKED_DISK);
+        }
+
+        result = vector.status == 0 ? 0 : DISK_IO_ERROR;
+    }
+
+    // Still with interrupts disabled, so no other process is switched to inside the host's allocator
+    freeVector(pArrays, pRequests, ppSectors);
+
+    enableInterrupts();
+
+    return result;
+}
+
+/**************************************************************************
+   Name - allocVector
+
+   Purpose - Gets the request and sector pointer arrays for a vectored
+             transfer of count segments, from the slab cache when they
+             fit, otherwise from the host. Called with interrupts
+             disabled.
+
+   Returns - the pooled arrays, or NULL if they came from the host; the
+        arrays are NULL if they could not be allocated
+*************************************************************************/
+static VectorArrays* allocVector(int count, DiskRequest** ppRequests, char*** pppSectors)
+{
+    VectorArrays* pArrays = NULL;
+
+    if (count <= VECTOR_SEGMENTS)
+    {
+        pArrays = slab_alloc(vectorCache);
+    }
+
+    if (pArrays != NULL)
+    {
+        *ppRequests = pArrays->requests;
+        *pppSectors = pArrays->pSectors;
+    }
+    else
+    {
+        *ppRequests = malloc(count * sizeof(DiskRequest));
+        *pppSectors = malloc(count * sizeof(char*));
+    }
+
+    return pArrays;
+}
+
+/**************************************************************************
+   Name - freeVector
+
+   Purpose - Gives back the arrays allocVector got. Called with interrupts
+             disabled.
+*************************************************************************/
+static void freeVector(VectorArrays* pArrays, DiskRequest* pRequests, char** ppSectors)
+{
+    if (pArrays != NULL)
+    {
+        slab_free(vectorCache, pArrays);
+    }
+    else
+    {
+        free(pRequests);
+        free(ppSectors);
+    }
+}
+
+/**************************************************************************
+   Name - validRequest
+
+   Returns - TRUE if the request's sectors are all on the disk and the
+        disk's geometry has arrived, otherwise FALSE
+*************************************************************************/
+static int validRequest(Disk* pDisk, DiskRequest* pRequest)
+{
+    int lastTrack;
+
+    if (pDisk->tracks == 0 || pRequest->buffer == NULL || pRequest->sectors <= 0 ||
+        pRequest->platter < 0 || pRequest->platter >= pDisk->platters ||
+        pRequest->sector < 0 || pRequest->sector >= THREADS_DISK_SECTOR_COUNT || pRequest->track < 0)
+    {
+        return FALSE;
+    }
+
+    lastTrack = pRequest->track + (pRequest->sector + pRequest->sectors - 1) / THREADS_DISK_SECTOR_COUNT;
+
+    return lastTrack < pDisk->tracks;
+}
+
+/**************************************************************************
+   Name - getDisk
+
+   Returns - the disk for unit, or NULL if there is no such disk
+*************************************************************************/
+static Disk* getDisk(int unit)
+{
+    if (unit < 0 || unit >= DISK_UNITS || !disks[unit].present)
+    {
+        return NULL;
+    }
+
+    return &disks[unit];
+}
+
+/**************************************************************************
+   Name - waitForGeometry
+
+   Purpose - Blocks the running process until DISK_INFO has completed.
+             Called with interrupts disabled.
+*************************************************************************/
+static void waitForGeometry(Disk* pDisk)
+{
+    while (pDisk->tracks == 0)
+    {
+        io_wait(&pDisk->io, NULL, BLOCKED_DISK);
+    }
+}
+
+/**************************************************************************
+   Name - takeNext
+
+   Purpose - Unlinks the queued request the disk's policy serves next.
+
+             SCAN takes the closest request in the direction the head is
+             moving and turns around when there are none left ahead of it.
+             C-LOOK only serves requests while moving up and then starts
+             over from the lowest track, so requests at the edges of the
+             disk do not wait twice as long as the ones in the middle.
+             Requests on the same track are served in submission order.
+
+   Returns - the request, or NULL if the queue is empty
+*************************************************************************/
+static DiskRequest* takeNext(Disk* pDisk)
+{
+    DiskRequest* pBest = NULL;
+    DiskRequest* pBestPrevious = NULL;
+    DiskRequest* pPrevious = NULL;
+    int head = pDisk->currentTrack;
+
+    if (pDisk->queueHead == NULL)
+    {
+        return NULL;
+    }
+
+    if (pDisk->policy == DISK_SCHED_FIFO)
+    {
+        pBest = pDisk->queueHead;
+    }
+    else
+    {
+        for (int pass = 0; pass < 2 && pBest == NULL; pass++)
+        {
+            int direction = pDisk->policy == DISK_SCHED_SCAN ? pDisk->direction : 1;
+
+            pPrevious = NULL;
+            for (DiskRequest* pRequest = pDisk->queueHead; pRequest != NULL; pRequest = pRequest->next)
+            {
+                int distance = (pRequest->track - head) * direction;
+
+                if (distance >= 0 &&
+                    (pBest == NULL || distance < (pBest->track - head) * direction))
+                {
+                    pBest = pRequest;
+                    pBestPrevious = pPrevious;
+                }
+                pPrevious = pRequest;
+            }
+
+            // Nothing ahead of the head, turn around or go back to the start
+            if (pBest == NULL)
+            {
+                if (pDisk->policy == DISK_SCHED_SCAN)
+                {
+                    pDisk->direction = -pDisk->direction;
+                }
+                else
+                {
+                    head = 0;
+                }
+            }
+        }
+    }
+
+    if (pBestPrevious == NULL)
+    {
+        pDisk->queueHead = pBest->next;
+    }
+    else
+    {
+        pBestPrevious->next = pBest->next;
+    }
+    if (pDisk->queueTail == pBest)
+    {
+        pDisk->queueTail = pBestPrevious;
+    }
+    pDisk->queued--;
+
+    pBest->next = NULL;
+    return pBest;
+}
+
+/**************************************************************************
+   Name - startNext
+
+   Purpose - Makes the next queued request active and starts it, if the
+             disk is idle and knows its geometry.
+*************************************************************************/
+static void startNext(Disk* pDisk)
+{
+    if (pDisk->active != NULL || pDisk->tracks == 0)
+    {
+        return;
+    }
+
+    pDisk->active = takeNext(pDisk);
+    if (pDisk->active != NULL)
+    {
+        issueCommand(pDisk);
+    }
+}
+
+/**************************************************************************
+   Name - issueCommand
+
+   Purpose - Sends the active request's next command to the device: a
+             seek if the next sector is on another track, otherwise the
+             transfer of that sector. The request fails if the library
+             does not accept the command.
+*************************************************************************/
+static void issueCommand(Disk* pDisk)
+{
+    DiskRequest* pRequest = pDisk->active;
+    device_control_block_t controlBlock;
+    int position = pRequest->sector + pRequest->done;
+    int track = pRequest->track + position / THREADS_DISK_SECTOR_COUNT;
+
+    memset(&controlBlock, 0, sizeof(controlBlock));
+
+    if (track != pDisk->currentTrack)
+    {
+        controlBlock.command = DISK_SEEK;
+        controlBlock.control1 = (uint8_t)track;
+
+        pDisk->stats.seeks++;
+        pDisk->stats.tracksMoved += abs(track - pDisk->currentTrack);
+        pDisk->currentTrack = track;
+    }
+    else
+    {
+        char* pSector = pRequest->ppSectors != NULL ? pRequest->ppSectors[pRequest->done] :
+            pRequest->buffer + pRequest->done * THREADS_DISK_SECTOR_SIZE;
+
+        controlBlock.command = pRequest->write ? DISK_WRITE : DISK_READ;
+        controlBlock.control1 = (uint8_t)pRequest->platter;
+        controlBlock.control2 = (uint8_t)(position % THREADS_DISK_SECTOR_COUNT);
+        controlBlock.data_length = THREADS_DISK_SECTOR_SIZE;
+        if (pRequest->write)
+        {
+            controlBlock.output_data = pSector;
+        }
+        else
+        {
+            controlBlock.input_data = pSector;
+        }
+    }
+
+    if (device_control(pDisk->name, controlBlock) != 0)
+    {
+        console_output(FALSE, "issueCommand(): %s did not accept command %d\n", pDisk->name, controlBlock.command);
+        completeRequest(pDisk, -1);
+        return;
+    }
+
+    io_issue(&pDisk->io);
+}
+
+/**************************************************************************
+   Name - completeRequest
+
+   Purpose - Finishes the active request, calls its callback and starts
+             the next request.
+
+   Parameters - pDisk, the disk
+                status, 0 if the request succeeded, otherwise the status
+                    of the command that failed
+*************************************************************************/
+static void completeRequest(Disk* pDisk, int status)
+{
+    DiskRequest* pRequest = pDisk->active;
+
+    pDisk->active = NULL;
+
+    pRequest->status = status;
+    pDisk->stats.requests++;
+    pDisk->stats.sectors += pRequest->done;
+    pDisk->stats.waitTime += read_clock() - pRequest->submitTime;
+
+    if (pRequest->callback != NULL)
+    {
+        pRequest->callback(pRequest);
+    }
+
+    startNext(pDisk);
+}
+
+/**************************************************************************
+   Name - wakeRequester
+
+   Purpose - DiskRequest callback that readies the process blocked in
+             disk_transfer. A request that fails while it is being
+             submitted completes before the process has blocked, and
+             io_wake leaves it alone.
+*************************************************************************/
+static void wakeRequester(DiskRequest* pRequest)
+{
+    disks[pRequest->unit].stats.wakeups++;
+    io_wake(&disks[pRequest->unit].io, pRequest->pContext);
+}
+
+/**************************************************************************
+   Name - vectorDone
+
+   Purpose - DiskRequest callback for one run of a vectored transfer.
+             Only the last run to complete readies the caller.
+*************************************************************************/
+static void vectorDone(DiskRequest* pRequest)
+{
+    VectorTransfer* pVector = pRequest->pContext;
+
+    if (pRequest->status != 0 && pVector->status == 0)
+    {
+        pVector->status = pRequest->status;
+    }
+
+    if (--pVector->pending == 0)
+    {
+        disks[pRequest->unit].stats.wakeups++;
+        io_wake(&disks[pRequest->unit].io, pVector->pProcess);
+    }
+}
+
+/**************************************************************************
+   Name - transferImage
+
+   Purpose - Completes a request on an image disk by copying between its
+             buffer and the mapping, and calls the request's callback
+             before returning.
+*************************************************************************/
+static void transferImage(Disk* pDisk, DiskRequest* pRequest)
+{
+    size_t offset = (((size_t)pRequest->platter * pDisk->tracks + pRequest->track) * THREADS_DISK_SECTOR_COUNT +
+        pRequest->sector) * THREADS_DISK_SECTOR_SIZE;
+    size_t length = (size_t)pRequest->sectors * THREADS_DISK_SECTOR_SIZE;
+
+    if (pRequest->ppSectors != NULL)
+    {
+        for (int i = 0; i < pRequest->sectors; i++, offset += THREADS_DISK_SECTOR_SIZE)
+        {
+            if (pRequest->write)
+            {
+                memcpy(pDisk->pImage + offset, pRequest->ppSectors[i], THREADS_DISK_SECTOR_SIZE);
+            }
+            else
+            {
+                memcpy(pRequest->ppSectors[i], pDisk->pImage + offset, THREADS_DISK_SECTOR_SIZE);
+            }
+        }
+    }
+    else if (pRequest->write)
+    {
+        memcpy(pDisk->pImage + offset, pRequest->buffer, length);
+    }
+    else
+    {
+        memcpy(pRequest->buffer, pDisk->pImage + offset, length);
+    }
+
+    pRequest->done = pRequest->sectors;
+    pRequest->status = 0;
+    pDisk->stats.requests++;
+    pDisk->stats.sectors += pRequest->sectors;
+    pDisk->stats.waitTime += read_clock() - pRequest->submitTime;
+
+    if (pRequest->callback != NULL)
+    {
+        pRequest->callback(pRequest);
+    }
+}
+
+/**************************************************************************
+   Name - mapImage
+
+   Purpose - Opens or creates the host file behind an image disk, sizes
+             it and maps all of it.
+
+   Returns - the mapping, or NULL if the file cannot be opened, is not
+        size bytes long, or cannot be mapped
+*************************************************************************/
+static char* mapImage(Disk* pDisk, char* path, size_t size)
+{
+#ifdef _WIN32
+    LARGE_INTEGER existing;
+
+    pDisk->hImageFile = CreateFileA(path, GENERIC_READ | GENERIC_WRITE, FILE_SHARE_READ, NULL, OPEN_ALWAYS,
+        FILE_ATTRIBUTE_NORMAL, NULL);
+    if (pDisk->hImageFile == INVALID_HANDLE_VALUE)
+    {
+        return NULL;
+    }
+
+    // Mapping a new, empty file extends it to the mapping's size
+    if (!GetFileSizeEx(pDisk->hImageFile, &existing) || (existing.QuadPart != 0 && (size_t)existing.QuadPart != size))
+    {
+        CloseHandle(pDisk->hImageFile);
+        return NULL;
+    }
+
+    pDisk->hImageMapping = CreateFileMappingA(pDisk->hImageFile, NULL, PAGE_READWRITE,
+        (DWORD)((unsigned long long)size >> 32), (DWORD)size, NULL);
+    if (pDisk->hImageMapping == NULL)
+    {
+        CloseHandle(pDisk->hImageFile);
+        return NULL;
+    }
+
+    pDisk->pImage = MapViewOfFile(pDisk->hImageMapping, FILE_MAP_ALL_ACCESS, 0, 0, size);
+    if (pDisk->pImage == NULL)
+    {
+        CloseHandle(pDisk->hImageMapping);
+        CloseHandle(pDisk->hImageFile);
+        return NULL;
+    }
+#else
+    struct stat status;
+    void* pMapping;
+    int fd = open(path, O_RDWR | O_CREAT, 0644);
+
+    if (fd < 0)
+    {
+        return NULL;
+    }
+
+    if (fstat(fd, &status) != 0 || (status.st_size != 0 && (size_t)status.st_size != size) ||
+        (status.st_size == 0 && ftruncate(fd, (off_t)size) != 0))
+    {
+        close(fd);
+        return NULL;
+    }
+
+    // The mapping keeps the file open
+    pMapping = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (pMapping == MAP_FAILED)
+    {
+        return NULL;
+    }
+    pDisk->pImage = pMapping;
+#endif
+
+    pDisk->imageSize = size;
+    return pDisk->pImage;
+}
+
+/**************************************************************************
+   Name - unmapImage
+
+   Purpose - Writes an image disk's mapping to its file and unmaps it.
+*************************************************************************/
+static void unmapImage(Disk* pDisk)
+{
+#ifdef _WIN32
+    FlushViewOfFile(pDisk->pImage, 0);
+    UnmapViewOfFile(pDisk->pImage);
+    CloseHandle(pDisk->hImageMapping);
+    CloseHandle(pDisk->hImageFile);
+#else
+    msync(pDisk->pImage, pDisk->imageSize, MS_SYNC);
+    munmap(pDisk->pImage, pDisk->imageSize);
+#endif
+
+    pDisk->pImage = NULL;
+    pDisk->imageSize = 0;
+}
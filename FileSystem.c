@@ -0,0 +1,1170 @@
+/*
+Program: FileSystem
+Created by: Ian Penrose & Lindsay Wax
+Course: CYBV 489
+
+
+Description: A small extent based file system on one of the disks. The disk is seen as
+a row of 512 byte blocks, numbered along each platter track by track so consecutive
+blocks are consecutive sectors of a platter and a run of blocks is a run of tracks the
+head sweeps without seeking back. The disk starts with a superblock, a free space bitmap
+with a bit per block, the inode table and the directory, which maps names to inodes.
+Each inode keeps its file's blocks as up to FS_EXTENTS extents (first block, length),
+and a file that grows is extended in place whenever the blocks after its last extent
+are free, so a file written sequentially ends up in one contiguous run. All blocks go
+through the buffer cache, and the metadata is kept in memory while the file system is
+mounted and written back as it changes.
+*/
+
+
+
+#define _CRT_SECURE_NO_WARNINGS
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "THREADSLib.h"
+#include "Scheduler.h"
+#include "Synchronization.h"
+#include "Disk.h"
+#include "BufferCache.h"
+#include "Slab.h"
+#include "FileSystem.h"
+#include "Processes.h"
+
+#define FS_MAGIC            0x31535846                  // "FXS1"
+#define FS_BLOCK_SIZE       THREADS_DISK_SECTOR_SIZE
+#define BITS_PER_BLOCK      (FS_BLOCK_SIZE * 8)
+#define INODES_PER_BLOCK    (FS_BLOCK_SIZE / sizeof(Inode))
+#define ENTRIES_PER_BLOCK   (FS_BLOCK_SIZE / sizeof(DirectoryEntry))
+#define INODE_BLOCKS        (FS_MAX_FILES / INODES_PER_BLOCK)
+#define DIRECTORY_BLOCKS    (FS_MAX_FILES / ENTRIES_PER_BLOCK)
+
+/* A run of consecutive blocks. */
+typedef struct
+{
+    uint32_t    start;
+    uint32_t    length;
+
+} Extent;
+
+/* On disk inode, 128 bytes so a whole number fit in a block. */
+typedef struct
+{
+    uint32_t    size;                   // Bytes in the file
+    uint16_t    used;                   // TRUE if the inode belongs to a file
+    uint16_t    extentCount;            // Extents in use, in file order
+    Extent      extents[FS_EXTENTS];
+
+} Inode;
+
+/* On disk directory entry, the file is unused when inode is -1. */
+typedef struct
+{
+    char        name[FS_NAME_MAX];
+    int32_t     inode;
+
+} DirectoryEntry;
+
+/* Block 0, where everything else is. */
+typedef struct
+{
+    uint32_t    magic;
+    uint32_t    blocks;                 // Blocks on the disk
+    uint32_t    bitmapStart;
+    uint32_t    bitmapBlocks;
+    uint32_t    inodeStart;
+    uint32_t    directoryStart;
+    uint32_t    dataStart;              // First block files can use
+
+} SuperBlock;
+
+static int mounted = FALSE;
+static int fsUnit;
+static int blocksPerPlatter;            // Blocks numbered along one platter before the next
+static int fsMutex = -1;                // Held by the process using the file system
+static int fileTableCache = -1;         // Processes' tables of open files, made with fsMutex
+static SuperBlock superBlock;
+static unsigned char* pBitmap;          // Bit per block, set when the block is in use
+static Inode inodes[FS_MAX_FILES];
+static DirectoryEntry directory[FS_MAX_FILES];
+static int openCount[FS_MAX_FILES];     // Descriptors open on each inode
+static uint32_t rotor;                  // Where the search for a new file's first extent starts
+static char bounce[FS_BLOCK_SIZE];      // Partial blocks are read and written through here
+static fs_stats_t stats;
+
+static int lockFileSystem(void);
+static void unlockFileSystem(void);
+static OpenFile* getOpenFile(int fd, int flags);
+static int lookup(char* name);
+static int blockIO(uint32_t block, int count, void* pBuffer, int write);
+static int writeInode(int inode);
+static int writeDirectoryEntry(int entry);
+static int writeBitmap(uint32_t start, uint32_t length);
+static uint32_t mapBlock(Inode* pInode, uint32_t fileBlock, uint32_t* pRun);
+static uint32_t blocksOf(Inode* pInode);
+static int growFile(Inode* pInode, uint32_t blocksNeeded);
+static void freeBlocks(Inode* pInode);
+static void trimFile(Inode* pInode);
+static uint32_t freeRunAt(uint32_t start, uint32_t wanted);
+static uint32_t findRun(uint32_t goal, uint32_t wanted, uint32_t* pLength);
+static void markBlocks(uint32_t start, uint32_t length, int used);
+static int blockUsed(uint32_t block);
+
+
+/**************************************************************************
+   Name - fs_format
+
+   Purpose - Writes an empty file system on a disk and mounts it. Must not
+             be called while files are open.
+
+   Parameters - unit, the disk
+
+   Returns - 0 if successful, -1 if there is no such disk, or
+        FS_IO_ERROR if the disk failed a write
+*************************************************************************/
+int fs_format(int unit)
+{
+    int platters, tracks;
+    uint32_t metadataBlocks;
+    int result;
+
+    check_kernel_mode("fs_format");
+
+    if (k_disk_info(unit, &platters, &tracks) != 0)
+    {
+        return -1;
+    }
+
+    result = lockFileSystem();
+    if (result != 0)
+    {
+        return result;
+    }
+
+    mounted = FALSE;
+    fsUnit = unit;
+    blocksPerPlatter = tracks * THREADS_DISK_SECTOR_COUNT;
+
+    memset(&superBlock, 0, sizeof(superBlock));
+    superBlock.magic = FS_MAGIC;
+    superBlock.blocks = platters * blocksPerPlatter;
+    superBlock.bitmapStart = 1;
+    superBlock.bitmapBlocks = (superBlock.blocks + BITS_PER_BLOCK - 1) / BITS_PER_BLOCK;
+    superBlock.inodeStart = superBlock.bitmapStart + superBlock.bitmapBlocks;
+    superBlock.directoryStart = superBlock.inodeStart + INODE_BLOCKS;
+    superBlock.dataStart = superBlock.directoryStart + DIRECTORY_BLOCKS;
+    metadataBlocks = superBlock.dataStart;
+
+    free(pBitmap);
+    pBitmap = calloc(superBlock.bitmapBlocks, FS_BLOCK_SIZE);
+    markBlocks(0, metadataBlocks, TRUE);
+
+    memset(inodes, 0, sizeof(inodes));
+    memset(openCount, 0, sizeof(openCount));
+    for (int i = 0; i < FS_MAX_FILES; i++)
+    {
+        memset(&directory[i], 0, sizeof(DirectoryEntry));
+        directory[i].inode = -1;
+    }
+
+    memset(bounce, 0, sizeof(bounce));
+    memcpy(bounce, &superBlock, sizeof(superBlock));
+    result = blockIO(0, 1, bounce, TRUE);
+    if (result == 0)
+    {
+        result = blockIO(superBlock.bitmapStart, superBlock.bitmapBlocks, pBitmap, TRUE);
+    }
+    if (result == 0)
+    {
+        result = blockIO(superBlock.inodeStart, INODE_BLOCKS, inodes, TRUE);
+    }
+    if (result == 0)
+    {
+        result = blockIO(superBlock.directoryStart, DIRECTORY_BLOCKS, directory, TRUE);
+    }
+
+    rotor = superBlock.dataStart;
+    mounted = result == 0;
+
+    unlockFileSystem();
+
+    return result;
+}
+
+/**************************************************************************
+   Name - fs_mount
+
+   Purpose - Reads the file system on a disk into memory, so its files can
+             be opened. Must not be called while files are open.
+
+   Parameters - unit, the disk
+
+   Returns - 0 if successful, -1 if there is no such disk, FS_NOT_FOUND if
+        the disk has no file system, or FS_IO_ERROR if the disk failed a
+        read
+*************************************************************************/
+int fs_mount(int unit)
+{
+    int platters, tracks;
+    int result;
+
+    check_kernel_mode("fs_mount");
+
+    if (k_disk_info(unit, &platters, &tracks) != 0)
+    {
+        return -1;
+    }
+
+    result = lockFileSystem();
+    if (result != 0)
+    {
+        return result;
+    }
+
+    mounted = FALSE;
+    fsUnit = unit;
+    blocksPerPlatter = tracks * THREADS_DISK_SECTOR_COUNT;
+
+    result = blockIO(0, 1, bounce, FALSE);
+    if (result == 0)
+    {
+        memcpy(&superBlock, bounce, sizeof(superBlock));
+        if (superBlock.magic != FS_MAGIC || superBlock.blocks != (uint32_t)(platters * blocksPerPlatter))
+        {
+            result = FS_NOT_FOUND;
+        }
+    }
+
+    if (result == 0)
+    {
+        free(pBitmap);
+        pBitmap = calloc(superBlock.bitmapBlocks, FS_BLOCK_SIZE);
+        result = blockIO(superBlock.bitmapStart, superBlock.bitmapBlocks, pBitmap, FALSE);
+    }
+    if (result == 0)
+    {
+        result = blockIO(superBlock.inodeStart, INODE_BLOCKS, inodes, FALSE);
+    }
+    if (result == 0)
+    {
+        result = blockIO(superBlock.directoryStart, DIRECTORY_BLOCKS, directory, FALSE);
+    }
+
+    memset(openCount, 0, sizeof(openCount));
+    rotor = superBlock.dataStart;
+    mounted = result == 0;
+
+    unlockFileSystem();
+
+    return result;
+}
+
+/**************************************************************************
+   Name - k_open
+
+   Purpose - Opens a file, creating or emptying it if flags ask for it.
+
+   Parameters - name, the file's name
+                flags, FS_READ and/or FS_WRITE, with FS_CREATE and
+                    FS_TRUNCATE if wanted
+
+   Returns - the file descriptor, -1 if the parameters are invalid,
+        FS_NOT_FOUND if there is no such file and FS_CREATE was not
+        given, FS_NO_SPACE if the file system or the process has no room
+        for another file, or FS_IO_ERROR
+*************************************************************************/
+int k_open(char* name, int flags)
+{
+    OpenFile* pFile;
+    int fd, entry, inode;
+    int result;
+
+    check_kernel_mode("k_open");
+
+    if (name == NULL || name[0] == '\0' || strlen(name) >= FS_NAME_MAX || (flags & (FS_READ | FS_WRITE)) == 0)
+    {
+        return -1;
+    }
+
+    result = lockFileSystem();
+    if (result != 0)
+    {
+        return result;
+    }
+
+    if (!mounted)
+    {
+        unlockFileSystem();
+        return FS_NOT_FOUND;
+    }
+
+    if (runningProcess->pFiles == NULL)
+    {
+        runningProcess->pFiles = slab_alloc(fileTableCache);
+        if (runningProcess->pFiles == NULL)
+        {
+            unlockFileSystem();
+            return FS_NO_SPACE;
+        }
+    }
+    for (fd = 0; fd < FS_OPEN_MAX && runningProcess->pFiles[fd].flags != 0; fd++)
+    {
+    }
+    if (fd == FS_OPEN_MAX)
+    {
+        unlockFileSystem();
+        return FS_NO_SPACE;
+    }
+    pFile = &runningProcess->pFiles[fd];
+
+    entry = lookup(name);
+    if (entry < 0)
+    {
+        if ((flags & FS_CREATE) == 0)
+        {
+            unlockFileSystem();
+            return FS_NOT_FOUND;
+        }
+
+        // A free directory entry and a free inode
+        for (entry = 0; entry < FS_MAX_FILES && directory[entry].inode >= 0; entry++)
+        {
+        }
+        for (inode = 0; inode < FS_MAX_FILES && inodes[inode].used; inode++)
+        {
+        }
+        if (entry == FS_MAX_FILES || inode == FS_MAX_FILES)
+        {
+            unlockFileSystem();
+            return FS_NO_SPACE;
+        }
+
+        memset(&inodes[inode], 0, sizeof(Inode));
+        inodes[inode].used = TRUE;
+        memset(&directory[entry], 0, sizeof(DirectoryEntry));
+        strcpy(directory[entry].name, name);
+        directory[entry].inode = inode;
+
+        result = writeInode(inode);
+        if (result == 0)
+        {
+            result = writeDirectoryEntry(entry);
+        }
+        stats.creates++;
+    }
+    else
+    {
+        inode = directory[entry].inode;
+
+        if ((flags & FS_TRUNCATE) && (flags & FS_WRITE) && inodes[inode].size > 0)
+        {
+            freeBlocks(&inodes[inode]);
+            inodes[inode].size = 0;
+            result = writeInode(inode);
+        }
+    }
+
+    if (result == 0)
+    {
+        pFile->flags = flags & (FS_READ | FS_WRITE);
+        pFile->inode = inode;
+        pFile->position = 0;
+        openCount[inode]++;
+        stats.opens++;
+        result = fd;
+    }
+
+    unlockFileSystem();
+
+    return result;
+}
+
+/**************************************************************************
+   Name - k_read
+
+   Purpose - Reads from an open file at its current position and moves
+             the position past what was read. Whole blocks are read
+             straight into pBuffer, a contiguous run of them at a time.
+
+   Parameters - fd, the file descriptor
+                pBuffer, where to store the data
+                size, the most bytes to read
+
+   Returns - the number of bytes read, 0 at the end of the file, -1 if
+        the descriptor is not open for reading, or FS_IO_ERROR
+*************************************************************************/
+int k_read(int fd, void* pBuffer, int size)
+{
+    OpenFile* pFile;
+    Inode* pInode;
+    char* pOut = pBuffer;
+    int done = 0;
+    int result;
+
+    check_kernel_mode("k_read");
+
+    if (pBuffer == NULL || size < 0)
+    {
+        return -1;
+    }
+
+    result = lockFileSystem();
+    if (result != 0)
+    {
+        return result;
+    }
+
+    pFile = getOpenFile(fd, FS_READ);
+    if (pFile == NULL)
+    {
+        unlockFileSystem();
+        return -1;
+    }
+
+    // Another descriptor may have truncated the file under this one
+    pInode = &inodes[pFile->inode];
+    if (pFile->position >= pInode->size)
+    {
+        size = 0;
+    }
+    else if ((unsigned int)size > pInode->size - pFile->position)
+    {
+        size = pInode->size - pFile->position;
+    }
+
+    while (done < size && result == 0)
+    {
+        uint32_t offset = pFile->position % FS_BLOCK_SIZE;
+        uint32_t run;
+        uint32_t block = mapBlock(pInode, pFile->position / FS_BLOCK_SIZE, &run);
+        int count;
+
+        if (offset == 0 && size - done >= FS_BLOCK_SIZE)
+        {
+            if (run > (uint32_t)(size - done) / FS_BLOCK_SIZE)
+            {
+                run = (size - done) / FS_BLOCK_SIZE;
+            }
+            result = blockIO(block, run, pOut + done, FALSE);
+            count = run * FS_BLOCK_SIZE;
+        }
+        else
+        {
+            int room = (int)(FS_BLOCK_SIZE - offset);
+
+            count = room < size - done ? room : size - done;
+            result = blockIO(block, 1, bounce, FALSE);
+            memcpy(pOut + done, bounce + offset, count);
+        }
+
+        if (result == 0)
+        {
+            done += count;
+            pFile->position += count;
+        }
+    }
+
+    stats.bytesRead += done;
+
+    unlockFileSystem();
+
+    return result == 0 || done > 0 ? done : result;
+}
+
+/**************************************************************************
+   Name - k_write
+
+   Purpose - Writes to an open file at its current position, growing the
+             file as needed, and moves the position past what was written.
+             Whole blocks are written straight from pBuffer.
+
+   Parameters - fd, the file descriptor
+                pBuffer, the data
+                size, the number of bytes to write
+
+   Returns - the number of bytes written, -1 if the descriptor is not open
+        for writing, FS_NO_SPACE if no room could be found for any of the
+        data, or FS_IO_ERROR
+*************************************************************************/
+int k_write(int fd, void* pBuffer, int size)
+{
+    OpenFile* pFile;
+    Inode* pInode;
+    char* pIn = pBuffer;
+    uint32_t allocated;
+    int done = 0;
+    int result;
+
+    check_kernel_mode("k_write");
+
+    if (pBuffer == NULL || size < 0)
+    {
+        return -1;
+    }
+
+    result = lockFileSystem();
+    if (result != 0)
+    {
+        return result;
+    }
+
+    pFile = getOpenFile(fd, FS_WRITE);
+    if (pFile == NULL)
+    {
+        unlockFileSystem();
+        return -1;
+    }
+
+    pInode = &inodes[pFile->inode];
+
+    // Allocate everything up front so the blocks can be found in as few extents as possible
+    growFile(pInode, (pFile->position + size + FS_BLOCK_SIZE - 1) / FS_BLOCK_SIZE);
+    allocated = blocksOf(pInode) * FS_BLOCK_SIZE;
+    if (allocated < pFile->position + size)
+    {
+        size = allocated - pFile->position;
+        if (size == 0)
+        {
+            unlockFileSystem();
+            return FS_NO_SPACE;
+        }
+    }
+
+    while (done < size && result == 0)
+    {
+        uint32_t offset = pFile->position % FS_BLOCK_SIZE;
+        uint32_t run;
+        uint32_t block = mapBlock(pInode, pFile->position / FS_BLOCK_SIZE, &run);
+        int count;
+
+        if (offset == 0 && size - done >= FS_BLOCK_SIZE)
+        {
+            if (run > (uint32_t)(size - done) / FS_BLOCK_SIZE)
+            {
+                run = (size - done) / FS_BLOCK_SIZE;
+            }
+            result = blockIO(block, run, pIn + done, TRUE);
+            count = run * FS_BLOCK_SIZE;
+        }
+        else
+        {
+            int room = (int)(FS_BLOCK_SIZE - offset);
+
+            count = room < size - done ? room : size - done;
+
+            // Only a block that already holds part of the file has to be read first
+            if (pFile->position - offset < pInode->size)
+            {
+                result = blockIO(block, 1, bounce, FALSE);
+            }
+            else
+            {
+                memset(bounce, 0, sizeof(bounce));
+            }
+            if (result == 0)
+            {
+                memcpy(bounce + offset, pIn + done, count);
+                result = blockIO(block, 1, bounce, TRUE);
+            }
+        }
+
+        if (result == 0)
+        {
+            done += count;
+            pFile->position += count;
+            if (pFile->position > pInode->size)
+            {
+                pInode->size = pFile->position;
+            }
+        }
+    }
+
+    writeInode(pFile->inode);
+    stats.bytesWritten += done;
+
+    unlockFileSystem();
+
+    return result == 0 || done > 0 ? done : result;
+}
+
+/**************************************************************************
+   Name - k_close
+
+   Purpose - Closes a file descriptor. Once the file's last descriptor is
+             closed, the blocks it was given beyond its end are freed.
+
+   Returns - 0 if successful, -1 if the descriptor is not open
+*************************************************************************/
+int k_close(int fd)
+{
+    OpenFile* pFile;
+    int result;
+
+    check_kernel_mode("k_close");
+
+    result = lockFileSystem();
+    if (result != 0)
+    {
+        return result;
+    }
+
+    pFile = getOpenFile(fd, 0);
+    if (pFile == NULL)
+    {
+        unlockFileSystem();
+        return -1;
+    }
+
+    if (--openCount[pFile->inode] == 0)
+    {
+        trimFile(&inodes[pFile->inode]);
+    }
+    pFile->flags = 0;
+
+    unlockFileSystem();
+
+    return 0;
+}
+
+/**************************************************************************
+   Name - k_unlink
+
+   Purpose - Removes a file and frees its blocks.
+
+   Returns - 0 if successful, -1 if the name is invalid, FS_NOT_FOUND if
+        there is no such file, FS_BUSY if it is open, or FS_IO_ERROR
+*************************************************************************/
+int k_unlink(char* name)
+{
+    int entry, inode;
+    int result;
+
+    check_kernel_mode("k_unlink");
+
+    if (name == NULL)
+    {
+        return -1;
+    }
+
+    result = lockFileSystem();
+    if (result != 0)
+    {
+        return result;
+    }
+
+    entry = lookup(name);
+    if (entry < 0)
+    {
+        unlockFileSystem();
+        return FS_NOT_FOUND;
+    }
+
+    inode = directory[entry].inode;
+    if (openCount[inode] > 0)
+    {
+        unlockFileSystem();
+        return FS_BUSY;
+    }
+
+    freeBlocks(&inodes[inode]);
+    memset(&inodes[inode], 0, sizeof(Inode));
+    memset(&directory[entry], 0, sizeof(DirectoryEntry));
+    directory[entry].inode = -1;
+
+    result = writeInode(inode);
+    if (result == 0)
+    {
+        result = writeDirectoryEntry(entry);
+    }
+
+    unlockFileSystem();
+
+    return result;
+}
+
+/**************************************************************************
+   Name - get_file_info
+
+   Purpose - Describes how a file is laid out on the disk.
+
+   Returns - 0 if successful, FS_NOT_FOUND if there is no such file
+*************************************************************************/
+int get_file_info(char* name, fs_file_info_t* pInfo)
+{
+    int entry;
+    Inode* pInode;
+
+    if (name == NULL || pInfo == NULL)
+    {
+        return -1;
+    }
+
+    entry = lookup(name);
+    if (entry < 0)
+    {
+        return FS_NOT_FOUND;
+    }
+
+    pInode = &inodes[directory[entry].inode];
+    pInfo->size = pInode->size;
+    pInfo->blocks = blocksOf(pInode);
+    pInfo->extents = pInode->extentCount;
+
+    return 0;
+}
+
+/**************************************************************************
+   Name - get_fs_stats
+
+   Purpose - Copies the file system counters.
+*************************************************************************/
+void get_fs_stats(fs_stats_t* pStats)
+{
+    if (pStats != NULL)
+    {
+        *pStats = stats;
+    }
+}
+
+/**************************************************************************
+   Name - reset_fs_stats
+
+   Purpose - Clears the file system counters.
+*************************************************************************/
+void reset_fs_stats(void)
+{
+    memset(&stats, 0, sizeof(stats));
+}
+
+/**************************************************************************
+   Name - fs_release_files
+
+   Purpose - Closes every file a process left open. Called when the
+             process is cleaned up, so it does not take the file system
+             mutex, as nothing else can be using the process's files, and
+             does no I/O. Blocks given to these files beyond their end
+             stay allocated until the file is next closed.
+*************************************************************************/
+void fs_release_files(Process* pProcess)
+{
+    if (pProcess->pFiles == NULL)
+    {
+        return;
+    }
+
+    for (int fd = 0; fd < FS_OPEN_MAX; fd++)
+    {
+        if (pProcess->pFiles[fd].flags != 0)
+        {
+            openCount[pProcess->pFiles[fd].inode]--;
+            pProcess->pFiles[fd].flags = 0;
+        }
+    }
+
+    slab_free(fileTableCache, pProcess->pFiles);
+    pProcess->pFiles = NULL;
+}
+
+/**************************************************************************
+   Name - lockFileSystem
+
+   Purpose - Takes the file system mutex, creating it and the cache of
+             open file tables the first time.
+
+   Returns - 0 once it is held, or the error from k_mutex_lock
+*************************************************************************/
+static int lockFileSystem(void)
+{
+    disableInterrupts();
+    if (fsMutex < 0)
+    {
+        fsMutex = k_mutex_create();
+        fileTableCache = slab_cache_create("open file tables", FS_OPEN_MAX * sizeof(OpenFile), NULL);
+    }
+    enableInterrupts();
+
+    return k_mutex_lock(fsMutex);
+}
+
+static void unlockFileSystem(void)
+{
+    k_mutex_unlock(fsMutex);
+}
+
+/**************************************************************************
+   Name - getOpenFile
+
+   Returns - the running process's open file for fd if it was opened with
+        all of flags, otherwise NULL
+*************************************************************************/
+static OpenFile* getOpenFile(int fd, int flags)
+{
+    OpenFile* pFile;
+
+    if (runningProcess->pFiles == NULL || fd < 0 || fd >= FS_OPEN_MAX)
+    {
+        return NULL;
+    }
+
+    pFile = &runningProcess->pFiles[fd];
+    if (pFile->flags == 0 || (pFile->flags & flags) != flags)
+    {
+        return NULL;
+    }
+
+    return pFile;
+}
+
+/**************************************************************************
+   Name - lookup
+
+   Returns - the directory entry for name, or -1 if there is none
+*************************************************************************/
+static int lookup(char* name)
+{
+    if (!mounted)
+    {
+        return -1;
+    }
+
+    for (int entry = 0; entry < FS_MAX_FILES; entry++)
+    {
+        if (directory[entry].inode >= 0 && strncmp(directory[entry].name, name, FS_NAME_MAX) == 0)
+        {
+            return entry;
+        }
+    }
+
+    return -1;
+}
+
+/**************************************************************************
+   Name - blockIO
+
+   Purpose - Reads or writes consecutive blocks through the buffer cache,
+             as one transfer for each platter the blocks are on.
+
+   Returns - 0 if successful, or FS_IO_ERROR
+*************************************************************************/
+static int blockIO(uint32_t block, int count, void* pBuffer, int write)
+{
+    char* pData = pBuffer;
+
+    while (count > 0)
+    {
+        int platter = block / blocksPerPlatter;
+        int offset = block % blocksPerPlatter;
+        int sectors = count < blocksPerPlatter - offset ? count : blocksPerPlatter - offset;
+        int result;
+
+        if (write)
+        {
+            result = k_cache_write(fsUnit, platter, offset / THREADS_DISK_SECTOR_COUNT,
+                offset % THREADS_DISK_SECTOR_COUNT, sectors, pData);
+        }
+        else
+        {
+            result = k_cache_read(fsUnit, platter, offset / THREADS_DISK_SECTOR_COUNT,
+                offset % THREADS_DISK_SECTOR_COUNT, sectors, pData);
+        }
+        if (result != 0)
+        {
+            return FS_IO_ERROR;
+        }
+
+        block += sectors;
+        count -= sectors;
+        pData += sectors * FS_BLOCK_SIZE;
+    }
+
+    return 0;
+}
+
+/* Writes the block of the inode table holding inode. */
+static int writeInode(int inode)
+{
+    int first = inode - inode % INODES_PER_BLOCK;
+
+    return blockIO(superBlock.inodeStart + inode / INODES_PER_BLOCK, 1, &inodes[first], TRUE);
+}
+
+/* Writes the block of the directory holding entry. */
+static int writeDirectoryEntry(int entry)
+{
+    int first = entry - entry % ENTRIES_PER_BLOCK;
+
+    return blockIO(superBlock.directoryStart + entry / ENTRIES_PER_BLOCK, 1, &directory[first], TRUE);
+}
+
+/* Writes the blocks of the bitmap covering blocks start to start + length - 1. */
+static int writeBitmap(uint32_t start, uint32_t length)
+{
+    uint32_t first = start / BITS_PER_BLOCK;
+    uint32_t last = (start + length - 1) / BITS_PER_BLOCK;
+
+    return blockIO(superBlock.bitmapStart + first, last - first + 1, pBitmap + first * FS_BLOCK_SIZE, TRUE);
+}
+
+/**************************************************************************
+   Name - mapBlock
+
+   Purpose - Finds where a block of a file is on the disk.
+
+   Parameters - pInode, the file
+                fileBlock, the block's index in the file, which must be
+                    allocated
+                pRun, where to store how many blocks from there on are
+                    contiguous on the disk
+
+   Returns - the disk block
+*************************************************************************/
+static uint32_t mapBlock(Inode* pInode, uint32_t fileBlock, uint32_t* pRun)
+{
+    for (int i = 0; i < pInode->extentCount; i++)
+    {
+        Extent* pExtent = &pInode->extents[i];
+
+        if (fileBlock < pExtent->length)
+        {
+            *pRun = pExtent->length - fileBlock;
+            return pExtent->start + fileBlock;
+        }
+        fileBlock -= pExtent->length;
+    }
+
+    *pRun = 0;
+    return 0;
+}
+
+/* Returns the number of blocks allocated to a file. */
+static uint32_t blocksOf(Inode* pInode)
+{
+    uint32_t blocks = 0;
+
+    for (int i = 0; i < pInode->extentCount; i++)
+    {
+        blocks += pInode->extents[i].length;
+    }
+
+    return blocks;
+}
+
+/**************************************************************************
+   Name - growFile
+
+   Purpose - Allocates blocks to a file until it has blocksNeeded. The
+             last extent is lengthened while the blocks after it are free,
+             otherwise a new extent is started at the first free run that
+             holds everything still needed, or failing that the longest
+             free run there is. A new file starts its search at the rotor,
+             past the last file started, so files created one after
+             another do not fill each other's gaps.
+
+             A file that has to leave its last extent is given room for
+             as many blocks again as it already has, so files written at
+             the same time take turns in a few long extents instead of
+             many short ones. What it does not use is trimmed when the
+             file is closed.
+
+   Returns - 0 if successful, FS_NO_SPACE if the file could not be given
+        all of the blocks, though it keeps the ones it got
+*************************************************************************/
+static int growFile(Inode* pInode, uint32_t blocksNeeded)
+{
+    uint32_t blocks = blocksOf(pInode);
+
+    while (blocks < blocksNeeded)
+    {
+        uint32_t wanted = blocksNeeded - blocks;
+        uint32_t start, length;
+
+        if (pInode->extentCount > 0)
+        {
+            Extent* pLast = &pInode->extents[pInode->extentCount - 1];
+
+            length = freeRunAt(pLast->start + pLast->length, wanted);
+            if (length > 0)
+            {
+                markBlocks(pLast->start + pLast->length, length, TRUE);
+                writeBitmap(pLast->start + pLast->length, length);
+                pLast->length += length;
+                blocks += length;
+                stats.blocksAllocated += length;
+                stats.extendedInPlace++;
+                continue;
+            }
+        }
+
+        if (pInode->extentCount == FS_EXTENTS)
+        {
+            return FS_NO_SPACE;
+        }
+
+        if (wanted < blocks)
+        {
+            wanted = blocks;
+        }
+        start = findRun(pInode->extentCount > 0 ? pInode->extents[pInode->extentCount - 1].start : rotor,
+            wanted, &length);
+        if (length == 0)
+        {
+            return FS_NO_SPACE;
+        }
+
+        markBlocks(start, length, TRUE);
+        writeBitmap(start, length);
+        pInode->extents[pInode->extentCount].start = start;
+        pInode->extents[pInode->extentCount].length = length;
+        pInode->extentCount++;
+        blocks += length;
+        stats.blocksAllocated += length;
+        stats.extentsAllocated++;
+
+        if (pInode->extentCount == 1)
+        {
+            rotor = start + length;
+        }
+    }
+
+    return 0;
+}
+
+/* Returns a file's blocks to the free space. */
+static void freeBlocks(Inode* pInode)
+{
+    for (int i = 0; i < pInode->extentCount; i++)
+    {
+        markBlocks(pInode->extents[i].start, pInode->extents[i].length, FALSE);
+        writeBitmap(pInode->extents[i].start, pInode->extents[i].length);
+    }
+
+    pInode->extentCount = 0;
+}
+
+/**************************************************************************
+   Name - trimFile
+
+   Purpose - Frees the blocks allocated past the end of a file, and
+             writes its inode if any were.
+*************************************************************************/
+static void trimFile(Inode* pInode)
+{
+    uint32_t keep = (pInode->size + FS_BLOCK_SIZE - 1) / FS_BLOCK_SIZE;
+    int trimmed = FALSE;
+
+    for (int i = 0; i < pInode->extentCount; i++)
+    {
+        Extent* pExtent = &pInode->extents[i];
+
+        if (keep >= pExtent->length)
+        {
+            keep -= pExtent->length;
+            continue;
+        }
+
+        markBlocks(pExtent->start + keep, pExtent->length - keep, FALSE);
+        writeBitmap(pExtent->start + keep, pExtent->length - keep);
+        pExtent->length = keep;
+        keep = 0;
+        trimmed = TRUE;
+    }
+
+    while (pInode->extentCount > 0 && pInode->extents[pInode->extentCount - 1].length == 0)
+    {
+        pInode->extentCount--;
+    }
+
+    if (trimmed)
+    {
+        writeInode((int)(pInode - inodes));
+    }
+}
+
+/* Returns how many of the wanted blocks from start on are free, stopping at the first used one. */
+static uint32_t freeRunAt(uint32_t start, uint32_t wanted)
+{
+    uint32_t length = 0;
+
+    while (length < wanted && start + length < superBlock.blocks && !blockUsed(start + length))
+    {
+        length++;
+    }
+
+    return length;
+}
+
+/**************************************************************************
+   Name - findRun
+
+   Purpose - Looks for free blocks, from goal to the end of the disk and
+             then from the start of the data blocks up to goal.
+
+   Parameters - goal, where to start looking
+                wanted, how many blocks are wanted
+                pLength, where to store the length of the run found, at
+                    most wanted, or 0 if there are no free blocks
+
+   Returns - the first block of the first free run of at least wanted
+        blocks, or of the longest one if none is long enough
+*************************************************************************/
+static uint32_t findRun(uint32_t goal, uint32_t wanted, uint32_t* pLength)
+{
+    uint32_t dataBlocks = superBlock.blocks - superBlock.dataStart;
+    uint32_t bestStart = 0, bestLength = 0;
+    uint32_t scanned = 0;
+
+    if (goal < superBlock.dataStart || goal >= superBlock.blocks)
+    {
+        goal = superBlock.dataStart;
+    }
+
+    while (scanned < dataBlocks)
+    {
+        uint32_t block = goal + scanned < superBlock.blocks ? goal + scanned : goal + scanned - dataBlocks;
+        uint32_t length;
+
+        if (blockUsed(block))
+        {
+            scanned++;
+            continue;
+        }
+
+        // Runs stop at the end of the disk, where the scan wraps around
+        length = freeRunAt(block, wanted);
+        if (length > bestLength)
+        {
+            bestStart = block;
+            bestLength = length;
+            if (length == wanted)
+            {
+                break;
+            }
+        }
+        scanned += length;
+    }
+
+    *pLength = bestLength;
+    return bestStart;
+}
+
+/* Sets or clears the bitmap bits of blocks start to start + length - 1. */
+static void markBlocks(uint32_t start, uint32_t length, int used)
+{
+    for (uint32_t block = start; block < start + length; block++)
+    {
+        if (used)
+        {
+            pBitmap[block / 8] |= 1 << (block % 8);
+        }
+        else
+        {
+            pBitmap[block / 8] &= ~(1 << (block % 8));
+        }
+    }
+}
+
+static int blockUsed(uint32_t block)
+{
+    return (pBitmap[block / 8] >> (block % 8)) & 1;
+}
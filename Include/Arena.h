@@ -0,0 +1,39 @@
+#pragma once
+
+#define ARENA_CHUNK_BYTES   65536   /* Memory an arena gets from the host at a time */
+#define ARENA_CLASSES       8       /* Size classes, 16 bytes doubling up to ARENA_MAX_SMALL */
+#define ARENA_MIN_SMALL     16
+#define ARENA_MAX_SMALL     2048    /* Bigger allocations get memory of their own */
+
+/* Per process heap counters. */
+typedef struct
+{
+    unsigned int    allocations;
+    unsigned int    frees;
+    unsigned int    reused;         /* Allocations taken from a size class's free list */
+    unsigned int    large;          /* Allocations bigger than ARENA_MAX_SMALL */
+    unsigned int    failures;       /* Allocations the host had no memory for */
+    int             chunks;         /* Chunks the arena has */
+    int             largeBlocks;    /* Large allocations not freed yet */
+    int             bytesInUse;     /* Bytes of small allocations not freed, rounded up to their size class */
+    int             peakBytesInUse;
+} arena_stats_t;
+
+/* Counters of the chunks kept for reuse when arenas are released. */
+typedef struct
+{
+    unsigned int    created;        /* Chunks allocated from the host */
+    unsigned int    reused;         /* Chunks given to an arena from the cache */
+    unsigned int    arenasReleased;
+    int             cached;         /* Chunks in the cache now */
+} arena_chunk_stats_t;
+
+/* Functions that will become system calls. */
+void* k_malloc(int size);
+int   k_free(void* pMemory);
+
+/* Additional kernel-only functions. */
+int   arena_shrink(void);
+int   get_arena_stats(int pid, arena_stats_t* pStats);
+void  get_arena_chunk_stats(arena_chunk_stats_t* pStats);
+void  reset_arena_chunk_stats(void);
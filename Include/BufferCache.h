@@ -0,0 +1,36 @@
+#pragma once
+
+#define CACHE_BUFFERS       1024    /* Sectors the cache holds */
+
+/* Replacement policies. */
+#define CACHE_POLICY_LRU    0       /* Plain least recently used */
+#define CACHE_POLICY_2Q     1       /* 2Q, sectors read once cannot push out the ones read again */
+
+/* Buffer cache counters. ioSaved is hits + coalesced, the reads that never went to the disk. */
+typedef struct
+{
+    unsigned int    reads;          /* Sectors read through the cache */
+    unsigned int    hits;           /* Reads of sectors already in the cache */
+    unsigned int    coalesced;      /* Reads that waited on another process's read or fill of the sector */
+    unsigned int    misses;         /* Reads that went to the disk */
+    unsigned int    ghostHits;      /* Misses on sectors 2Q evicted recently, which go straight to its hot list */
+    unsigned int    evictions;      /* Buffers reused for another sector */
+    unsigned int    writes;         /* Sectors written through the cache */
+    unsigned int    ioSaved;
+    unsigned int    readAheads;     /* Sectors read ahead of sequential readers */
+    unsigned int    readAheadHits;  /* Reads that found a sector read ahead for them */
+    unsigned int    writeBacks;     /* Dirty sectors written back to the disk */
+    unsigned int    throttled;      /* Times a process waited for dirty sectors to be written back */
+} cache_stats_t;
+
+/* Functions that will become system calls. */
+int   k_cache_read(int unit, int platter, int track, int sector, int sectors, void* pBuffer);
+int   k_cache_write(int unit, int platter, int track, int sector, int sectors, void* pBuffer);
+int   k_cache_sync(void);
+
+/* Additional kernel-only functions. */
+int   cache_set_policy(int policy);
+int   cache_set_read_ahead(int enabled);
+void  get_cache_stats(cache_stats_t* pStats);
+void  reset_cache_stats(void);
+void  display_cache_stats(void);
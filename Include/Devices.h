@@ -0,0 +1,31 @@
+#pragma once
+
+/* I/O accounting for one device. */
+typedef struct
+{
+    int             inFlight;       /* Commands the device has accepted and not yet completed */
+    int             waiting;        /* Processes blocked waiting on the device */
+    unsigned int    issued;         /* Commands issued to the device */
+    unsigned int    completed;      /* Commands the device has completed */
+} device_stats_t;
+
+/* I/O interrupt counters, times in QueryPerformanceCounter ticks. */
+typedef struct
+{
+    unsigned int        interrupts;     /* I/O interrupts taken */
+    unsigned int        deferred;       /* Interrupts queued for the bottom half */
+    unsigned int        wakeups;        /* Times an interrupt had to ready the bottom half */
+    unsigned int        passes;         /* Times the bottom half emptied the ring */
+    unsigned int        maxBatch;       /* Most interrupts handled in one pass */
+    unsigned int        overflows;      /* Interrupts handled at once because the ring was full */
+    unsigned long long  handlerTicks;   /* In the interrupt handler, where interrupts are disabled */
+    unsigned long long  bottomHalfTicks;    /* In the drivers' interrupt code run by the bottom half */
+} interrupt_stats_t;
+
+/* Additional kernel-only functions. */
+int   get_device_stats(char* name, device_stats_t* pStats);
+void  display_device_stats(void);
+void  io_set_deferred(int deferred);
+void  get_interrupt_stats(interrupt_stats_t* pStats);
+void  reset_interrupt_stats(void);
+int   get_bottom_half_pid(void);
@@ -0,0 +1,44 @@
+#pragma once
+
+/* Orders in which a disk serves its queued requests. */
+#define DISK_SCHED_FIFO     0   /* In the order they were submitted */
+#define DISK_SCHED_SCAN     1   /* Elevator sweeping up and down, turning at the last request */
+#define DISK_SCHED_CLOOK    2   /* Elevator sweeping up only, then back to the lowest request */
+
+#define DISK_IO_ERROR       -2  /* Returned when the device fails a transfer */
+
+#define DISK_IMAGE_UNITS    2   /* Units after the library's disks that host files can back */
+
+/* Per disk counters. */
+typedef struct
+{
+    unsigned int        requests;       /* Requests completed */
+    unsigned int        sectors;        /* Sectors transferred */
+    unsigned int        seeks;          /* DISK_SEEK commands issued */
+    unsigned long long  tracksMoved;    /* Total seek distance in tracks */
+    unsigned long long  waitTime;       /* Submission to completion, summed over requests, in microseconds */
+    unsigned int        wakeups;        /* Completions signalled to the caller of a transfer */
+} disk_stats_t;
+
+/* One sector of a vectored transfer and the memory it goes to or comes from. */
+typedef struct
+{
+    int                 platter;
+    int                 track;
+    int                 sector;
+    void*               pBuffer;        /* THREADS_DISK_SECTOR_SIZE bytes */
+} disk_segment_t;
+
+/* Functions that will become system calls. */
+int   k_disk_read(int unit, int platter, int track, int sector, int sectors, void* pBuffer);
+int   k_disk_write(int unit, int platter, int track, int sector, int sectors, void* pBuffer);
+int   k_disk_info(int unit, int* pPlatters, int* pTracks);
+int   k_disk_readv(int unit, disk_segment_t* pSegments, int count);
+int   k_disk_writev(int unit, disk_segment_t* pSegments, int count);
+
+/* Additional kernel-only functions. */
+int   disk_set_scheduler(int unit, int policy);
+int   disk_attach_image(char* path, int platters, int tracks);
+int   disk_detach_image(int unit);
+int   get_disk_stats(int unit, disk_stats_t* pStats);
+void  reset_disk_stats(int unit);
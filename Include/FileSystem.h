@@ -0,0 +1,52 @@
+#pragma once
+
+#define FS_MAX_FILES        64      /* Files a file system holds */
+#define FS_NAME_MAX         28      /* Longest file name, including the terminating '\0' */
+#define FS_EXTENTS          15      /* Extents per file */
+#define FS_OPEN_MAX         16      /* Files each process can have open */
+
+/* k_open flags. */
+#define FS_READ             0x1
+#define FS_WRITE            0x2
+#define FS_CREATE           0x4     /* Create the file if it does not exist */
+#define FS_TRUNCATE         0x8     /* Empty the file when it is opened for writing */
+
+/* Errors, besides -1 for invalid parameters and SIGNAL_INTERRUPTED. */
+#define FS_NOT_FOUND        -2      /* No file by that name, or no file system mounted */
+#define FS_NO_SPACE         -3      /* Out of free blocks, extents, inodes or descriptors */
+#define FS_IO_ERROR         -4      /* The disk failed a transfer */
+#define FS_BUSY             -7      /* The file is open */
+
+/* File system counters. */
+typedef struct
+{
+    unsigned int        opens;          /* Successful k_open calls */
+    unsigned int        creates;        /* Files created */
+    unsigned long long  bytesRead;
+    unsigned long long  bytesWritten;
+    unsigned int        blocksAllocated;
+    unsigned int        extentsAllocated;   /* New extents started */
+    unsigned int        extendedInPlace;    /* Times a file grew by lengthening its last extent */
+} fs_stats_t;
+
+/* Layout of one file. */
+typedef struct
+{
+    unsigned int        size;           /* Bytes */
+    unsigned int        blocks;         /* Blocks allocated */
+    int                 extents;        /* Extents the blocks are in */
+} fs_file_info_t;
+
+/* Functions that will become system calls. */
+int   k_open(char* name, int flags);
+int   k_read(int fd, void* pBuffer, int size);
+int   k_write(int fd, void* pBuffer, int size);
+int   k_close(int fd);
+int   k_unlink(char* name);
+
+/* Additional kernel-only functions. */
+int   fs_format(int unit);
+int   fs_mount(int unit);
+int   get_file_info(char* name, fs_file_info_t* pInfo);
+void  get_fs_stats(fs_stats_t* pStats);
+void  reset_fs_stats(void);
@@ -0,0 +1,13 @@
+#pragma once
+
+#define MAXMBOX           200
+#define MAXSLOTS          2500
+#define MAX_MESSAGE       256
+
+/* Functions that will become system calls. */
+int   k_mailbox_create(int slots, int slot_size);
+int   k_mailbox_release(int mbox_id);
+int   k_mailbox_send(int mbox_id, void* pMsg, int msg_size);
+int   k_mailbox_receive(int mbox_id, void* pMsg, int max_msg_size);
+int   k_mailbox_send_cond(int mbox_id, void* pMsg, int msg_size);
+int   k_mailbox_receive_cond(int mbox_id, void* pMsg, int max_msg_size);
@@ -8,7 +8,14 @@
 #define MAXPROC           50
 
 /* Kill signals */
-#define SIG_TERM			15
+#define SIG_TERM			15	/* Stays pending until the process exits, other signals interrupt one block */
+#define MAXSIG				32	/* Signals are numbered 1 to MAXSIG - 1 */
+#define SIGNAL_BIT(sig)		(1u << (sig))
+#define SIGNAL_INTERRUPTED	-5	/* Returned by blocking calls when a signal arrives */
+
+/* Timeouts */
+#define NO_TIMEOUT			-1	/* Passed as the timeout to block until woken */
+#define TIMED_OUT			-6	/* Returned by the timed variants when the timeout expires */
 
 int bootstrap(void* pArgs);
 
@@ -17,6 +24,7 @@ extern check_io_function check_io;
 
 /* Functions that will become system calls. */
 int  k_spawn(char* name, int(*entryPoint)(void*), void* arg, int stacksize, int priority);
+int  k_spawn_cow(char* name, int(*entryPoint)(void*), void* arg, int stacksize, int priority);
 
 #ifdef BUILD_DLL
 __declspec(dllexport) void SchedulerSetEntryPoint(int(*entryPoint)(void*));
@@ -24,14 +32,24 @@ __declspec(dllexport) void SchedulerSetEntryPoint(int(*entryPoint)(void*));
 
 int   k_wait(int* pChildExitCode);
 int   k_join(int pid, int* pChildExitCode);
+int   k_wait_timeout(int* pChildExitCode, int milliseconds);
+int   k_join_timeout(int pid, int* pChildExitCode, int milliseconds);
 int   k_kill(int pid, int signal);
+unsigned int k_sigmask(unsigned int blocked_signals);
 void  k_exit(int exitCode);
 int	  k_getpid(void);
+int   k_sleep(int milliseconds);
+int   k_sleep_until(int clockMillis);
+int   k_setpgid(int pid, int pgid);
+int   k_getpgid(int pid);
+int   k_killpg(int pgid, int signal);
+int   k_waitpg(int pgid, int* pChildExitCode);
 
 /* Additional kernel-only functions. */
 int	  signaled(void);
 void  display_process_table(void);
 int   block(int block_status);
+int   block_timeout(int block_status, int milliseconds);
 int   unblock(int pid);
 int   get_start_time(void);
 void  time_slice(void);
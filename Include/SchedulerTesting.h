@@ -12,5 +12,7 @@ int SpawnOnePriorityOne(char* strArgs);
 int SpawnTwoPriorityTwo(char* strArgs);
 int SignalAndJoinTwoLower(char* strArgs);
 int DelayAndDump(char* strArgs);
+int SleepAndDump(char* strArgs);
 int GetChildNumber(char* name);
 void SystemDelay(int millisTime);
+int SleepingDelays(void);
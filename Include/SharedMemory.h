@@ -0,0 +1,30 @@
+#pragma once
+
+#define SHM_MAX_SEGMENTS    32
+#define SHM_NAME_LENGTH     32
+
+/* Errors, besides -1 for invalid parameters. */
+#define SHM_EXISTS          -2      /* A segment with the name already exists */
+#define SHM_NOT_FOUND       -3      /* No segment has the name */
+#define SHM_NO_SPACE        -4      /* Every segment is in use or the host has no memory left */
+
+/* Shared memory counters. */
+typedef struct
+{
+    int             segments;       /* Segments that exist now */
+    int             bytes;          /* Bytes of memory they have */
+    unsigned int    created;
+    unsigned int    destroyed;      /* Segments freed when their last process detached or was cleaned up */
+    unsigned int    attaches;       /* Attaches, the ones k_shm_create makes included */
+    unsigned int    detaches;       /* Detaches by k_shm_detach */
+    unsigned int    cleanedUp;      /* Detaches made when an attached process was cleaned up */
+} shm_stats_t;
+
+/* Functions that will become system calls. */
+int   k_shm_create(char* name, int size, void** ppAddress);
+int   k_shm_attach(char* name, void** ppAddress, int* pSize);
+int   k_shm_detach(void* pAddress);
+
+/* Additional kernel-only functions. */
+int   get_shm_refs(char* name);
+void  get_shm_stats(shm_stats_t* pStats);
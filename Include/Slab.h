@@ -0,0 +1,41 @@
+#pragma once
+
+#define SLAB_MAX_CACHES     16
+#define SLAB_NAME_LENGTH    32
+#define SLAB_CACHE_LINE     64      /* Objects start on a boundary of this many bytes */
+
+/* Called on each object when its slab is created. Objects must be freed back in this state. */
+typedef void (*slab_constructor_t)(void* pObject);
+
+/* Per cache counters. Only some allocations and frees are timed, allocTicks and freeTicks
+   are the QueryPerformanceCounter ticks those took. */
+typedef struct
+{
+    char                name[SLAB_NAME_LENGTH];
+    int                 objectSize;
+    int                 slotSize;       /* objectSize rounded up to a whole number of cache lines */
+    int                 objectsPerSlab;
+    int                 slabBytes;
+    int                 slabs;          /* Slabs the cache has now */
+    int                 objectsInUse;
+    int                 peakInUse;
+    unsigned int        allocations;
+    unsigned int        frees;
+    unsigned int        failures;       /* Allocations that could not get a new slab */
+    unsigned int        slabsCreated;
+    unsigned int        slabsReleased;
+    unsigned int        constructed;    /* Constructor calls */
+    unsigned int        timedAllocations;
+    unsigned int        timedFrees;
+    unsigned long long  allocTicks;
+    unsigned long long  freeTicks;
+} slab_stats_t;
+
+/* Additional kernel-only functions. */
+int   slab_cache_create(char* name, int size, slab_constructor_t pConstructor);
+void* slab_alloc(int cache);
+void  slab_free(int cache, void* pObject);
+int   slab_cache_shrink(int cache);
+int   get_slab_stats(int cache, slab_stats_t* pStats);
+void  reset_slab_stats(int cache);
+void  display_slab_stats(void);
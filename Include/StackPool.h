@@ -0,0 +1,26 @@
+#pragma once
+
+#define STACK_POOL_BUCKETS  6       /* Stacks of THREADS_MIN_STACK_SIZE up to 32 times that are pooled */
+#define STACK_POOL_DEPTH    16      /* Most stacks kept in each bucket */
+#define STACK_GUARD_BYTES   256     /* Guard zone at the bottom of the stack, checked at context switches while the opt-in guard is on */
+
+/* Stack pool counters, for every bucket together. */
+typedef struct
+{
+    unsigned int    reused;         /* Spawns given a pooled stack */
+    unsigned int    created;        /* Spawns given a new stack by THREADS */
+    unsigned int    prefilled;      /* Stacks created by stack_pool_prefill */
+    unsigned int    returned;       /* Stacks put back in the pool when their process was cleaned up */
+    unsigned int    released;       /* Stacks given back to THREADS because their bucket was full or too big */
+    int             pooled[STACK_POOL_BUCKETS];     /* Stacks in each bucket now */
+    unsigned int    highWater[STACK_POOL_BUCKETS];  /* Most stack used by a cleaned up process of each bucket */
+    unsigned int    exhausted;      /* Cleaned up processes that used all of their painted stack */
+} stack_pool_stats_t;
+
+/* Additional kernel-only functions. */
+int   stack_pool_prefill(int stacksize, int count);
+int   stack_pool_set_guard(int enabled);
+int   stack_pool_set_paint(int enabled);
+int   get_stack_usage(int pid, unsigned int* pUsed, unsigned int* pSize);
+void  get_stack_pool_stats(stack_pool_stats_t* pStats);
+void  reset_stack_pool_stats(void);
@@ -0,0 +1,13 @@
+#pragma once
+
+#define MAXMUTEX          200
+#define FUTEX_HASH_SIZE   64    /* Number of futex wait queues, must be a power of 2 */
+
+/* Functions that will become system calls. */
+int   k_futex_wait(volatile int* pAddress, int expected);
+int   k_futex_wake(volatile int* pAddress, int count);
+
+int   k_mutex_create(void);
+int   k_mutex_release(int mutex_id);
+int   k_mutex_lock(int mutex_id);
+int   k_mutex_unlock(int mutex_id);
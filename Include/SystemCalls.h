@@ -0,0 +1,129 @@
+#pragma once
+
+#include <stdint.h>
+
+/* System call ids, the index of each call in the system call vector. */
+#define SYS_SPAWN           0
+#define SYS_WAIT            1   /* k_wait, or k_waitpg when a pgid is given */
+#define SYS_EXIT            2
+#define SYS_KILL            3   /* k_kill, or k_killpg for a negative pid */
+#define SYS_GETPID          4
+#define SYS_JOIN            5
+#define SYS_SLEEP           6
+#define SYS_SIGMASK         7
+#define SYS_SETPGID         8
+#define SYS_GETPGID         9
+#define SYS_MBOX_CREATE     10
+#define SYS_MBOX_RELEASE    11
+#define SYS_MBOX_SEND       12  /* Blocking or conditional send */
+#define SYS_MBOX_RECEIVE    13  /* Blocking or conditional receive */
+#define SYS_FUTEX_WAIT      14
+#define SYS_FUTEX_WAKE      15
+#define SYS_RING_SETUP      16
+#define SYS_RING_ENTER      17
+#define SYS_TERM_READ       18
+#define SYS_TERM_WRITE      19
+#define SYS_OPEN            20
+#define SYS_READ            21
+#define SYS_WRITE           22
+#define SYS_CLOSE           23
+#define SYS_CALL_COUNT      24  /* Must not exceed THREADS_MAX_SYSCALLS */
+
+#define SYS_MAX_ARGS        5
+#define SYS_RING_ENTRIES    64  /* Entries in each ring, must be a power of 2 */
+
+/*
+A system call frame starts with the library's argument block, whose 32 bit fields
+cannot hold a pointer, so the arguments follow it in pointer sized slots. The kernel
+gets the block through the system call vector and finds the rest of the frame behind it.
+*/
+typedef struct
+{
+    system_call_arguments_t call;               /* call_id is the SYS_* id */
+    intptr_t                arg[SYS_MAX_ARGS];  /* Arguments in the order of the kernel function */
+    intptr_t                result;             /* Value returned by the kernel function */
+    LARGE_INTEGER           trapTime;           /* When the caller trapped into the kernel */
+    LARGE_INTEGER           returnTime;         /* When the kernel function returned */
+} system_call_frame_t;
+
+/* A system call queued on a process's submission ring. */
+typedef struct
+{
+    int         call_id;                /* SYS_* id, SYS_RING_* calls are not allowed */
+    intptr_t    arg[SYS_MAX_ARGS];      /* Same arguments as in a system call frame */
+    intptr_t    userData;               /* Handed back unchanged in the completion */
+} system_call_sqe_t;
+
+/* The result of a queued system call, posted on the completion ring. */
+typedef struct
+{
+    intptr_t    userData;               /* userData of the submission */
+    intptr_t    result;                 /* Value returned by the kernel function */
+} system_call_cqe_t;
+
+/*
+Each process can have one pair of rings shared with the kernel. The process queues
+submissions at sqTail and the kernel takes them from sqHead whenever the process
+enters the kernel, running them in order and posting a completion for each at cqTail.
+The process reaps completions from cqHead without a system call.
+*/
+typedef struct _system_call_ring
+{
+    volatile unsigned int   sqHead;         /* Next submission the kernel will run */
+    volatile unsigned int   sqTail;         /* End of the submissions handed to the kernel */
+    unsigned int            sqReserved;     /* End of the submissions the process has started filling in */
+    volatile unsigned int   cqHead;         /* Next completion the process will reap */
+    volatile unsigned int   cqTail;         /* End of the completions posted by the kernel */
+    system_call_sqe_t       sq[SYS_RING_ENTRIES];
+    system_call_cqe_t       cq[SYS_RING_ENTRIES];
+} system_call_ring_t;
+
+/* Per call instrumentation, in QueryPerformanceCounter ticks. */
+typedef struct
+{
+    unsigned int        calls;          /* Number of times the call was trapped */
+    unsigned int        ringCalls;      /* Number of times the call was run from a submission ring */
+    unsigned long long  entryTicks;     /* Trap to the start of the kernel function */
+    unsigned long long  kernelTicks;    /* In the kernel function, including any time blocked */
+    unsigned long long  exitTicks;      /* Kernel function return back to the caller */
+} system_call_stats_t;
+
+/* System calls, usable from user mode. */
+int   sys_spawn(char* name, int(*entryPoint)(void*), void* arg, int stacksize, int priority);
+int   sys_wait(int* pChildExitCode);
+int   sys_waitpg(int pgid, int* pChildExitCode);
+void  sys_exit(int exitCode);
+int   sys_kill(int pid, int signal);
+int   sys_killpg(int pgid, int signal);
+int   sys_getpid(void);
+int   sys_join(int pid, int* pChildExitCode);
+int   sys_sleep(int milliseconds);
+unsigned int sys_sigmask(unsigned int blocked_signals);
+int   sys_setpgid(int pid, int pgid);
+int   sys_getpgid(int pid);
+int   sys_mailbox_create(int slots, int slot_size);
+int   sys_mailbox_release(int mbox_id);
+int   sys_mailbox_send(int mbox_id, void* pMsg, int msg_size);
+int   sys_mailbox_send_cond(int mbox_id, void* pMsg, int msg_size);
+int   sys_mailbox_receive(int mbox_id, void* pMsg, int max_msg_size);
+int   sys_mailbox_receive_cond(int mbox_id, void* pMsg, int max_msg_size);
+int   sys_futex_wait(volatile int* pAddress, int expected);
+int   sys_futex_wake(volatile int* pAddress, int count);
+int   sys_term_read(int unit, char* pBuffer, int size);
+int   sys_term_write(int unit, char* pBuffer, int size);
+int   sys_open(char* name, int flags);
+int   sys_read(int fd, void* pBuffer, int size);
+int   sys_write(int fd, void* pBuffer, int size);
+int   sys_close(int fd);
+
+/* System call rings. Only setup and submit enter the kernel. */
+system_call_ring_t* sys_ring_setup(void);
+system_call_sqe_t*  sys_ring_get_sqe(system_call_ring_t* pRing);
+void  sys_ring_queue(system_call_ring_t* pRing);
+int   sys_ring_submit(system_call_ring_t* pRing);
+int   sys_ring_reap(system_call_ring_t* pRing, system_call_cqe_t* pCompletion);
+
+/* Additional kernel-only functions. */
+int   get_system_call_stats(int call_id, system_call_stats_t* pStats);
+void  reset_system_call_stats(void);
+void  display_system_call_stats(void);
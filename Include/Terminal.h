@@ -0,0 +1,31 @@
+#pragma once
+
+#define TERM_RING_SIZE      256     /* Characters each terminal buffers in each direction */
+#define TERM_LINE_MAX       80      /* Longest input line, including its newline */
+
+/* Line discipline control characters. */
+#define TERM_ERASE          '\b'    /* Erases the last character of the line, as does 0x7f */
+#define TERM_KILL           0x15    /* Ctrl-U, erases the whole line */
+#define TERM_EOF            0x04    /* Ctrl-D, ends the input */
+
+/* Per terminal counters. */
+typedef struct
+{
+    unsigned int    charsIn;        /* Characters read from the device */
+    unsigned int    linesIn;        /* Lines handed to k_term_read */
+    unsigned int    charsOut;       /* Characters written to the device */
+    unsigned int    writes;         /* k_term_write calls */
+    unsigned int    writerBlocks;   /* Times a writer waited for room in the output ring */
+    unsigned int    interrupts;     /* I/O interrupts from the terminal */
+    unsigned int    errors;         /* Commands the device failed */
+} terminal_stats_t;
+
+/* Functions that will become system calls. */
+int   k_term_read(int unit, char* pBuffer, int size);
+int   k_term_write(int unit, char* pBuffer, int size);
+int   k_term_flush(int unit);
+
+/* Additional kernel-only functions. */
+int   term_set_echo(int unit, int enabled);
+int   get_terminal_stats(int unit, terminal_stats_t* pStats);
+void  reset_terminal_stats(int unit);
@@ -0,0 +1,55 @@
+#pragma once
+
+#define VM_PAGE_SIZE        4096    /* Bytes in a page and in a frame */
+#define VM_MAX_PAGES        256     /* Pages in each process's address space */
+#define VM_MAX_FRAMES       1024    /* Most frames physical memory can be given */
+#define VM_DEFAULT_FRAMES   64      /* Frames physical memory has until vm_set_frames */
+#define VM_TLB_ENTRIES      16
+#define VM_MAX_CLUSTER      32      /* Most pages written to the swap disk together */
+
+/* Errors, besides -1 for invalid parameters. */
+#define VM_FAULT            -2      /* The address was never allocated */
+#define VM_NO_SPACE         -3      /* The address space is full */
+
+/* Per process paging counters. */
+typedef struct
+{
+    unsigned int        tlbHits;
+    unsigned int        tlbMisses;
+    unsigned int        pageFaults;     /* Accesses to a page that was not in a frame */
+    unsigned int        zeroFills;      /* Faults on a page never used before, given a zeroed frame */
+    unsigned int        pageIns;        /* Faults on a page that had been paged out */
+    unsigned int        pageOuts;       /* Pages copied out of a frame when it was taken away */
+    unsigned int        evictions;      /* Frames taken away from the process by replacement */
+    unsigned int        cowFaults;      /* Writes to a page shared by k_spawn_cow that copied it */
+    int                 allocatedPages;
+    int                 residentPages;  /* Pages of its own in a frame now */
+    int                 sharedPages;    /* Pages shared copy-on-write with a parent or child */
+    unsigned long long  faultTime;      /* Microseconds spent in page faults, waiting for the swap disk included */
+} vm_stats_t;
+
+/* Swap counters. */
+typedef struct
+{
+    int                 unit;           /* Swap disk, -1 if pages are kept in memory */
+    int                 slots;          /* Pages the swap disk holds */
+    int                 slotsUsed;
+    unsigned int        clusters;       /* Writes of evicted pages */
+    unsigned int        pagesWritten;
+    unsigned int        pagesRead;
+    unsigned long long  writeTime;      /* Microseconds spent writing clusters */
+    unsigned long long  readTime;       /* Microseconds spent reading pages back */
+    unsigned int        errors;         /* Transfers the swap disk failed */
+} vm_swap_stats_t;
+
+/* Functions that will become system calls. */
+int   k_vm_allocate(int size);
+int   k_vm_read(int address, void* pBuffer, int size);
+int   k_vm_write(int address, void* pBuffer, int size);
+
+/* Additional kernel-only functions. */
+int   vm_set_frames(int count);
+int   vm_set_swap(int unit, int cluster);
+int   get_vm_stats(int pid, vm_stats_t* pStats);
+void  get_swap_stats(vm_swap_stats_t* pStats);
+void  reset_swap_stats(void);
@@ -0,0 +1,428 @@
+/*
+Program: Mailbox
+Created by: Ian Penrose & Lindsay Wax
+Course: CYBV 489
+
+
+Description: Bounded mailboxes used by processes to pass messages to each other. Each
+mailbox owns a fixed ring of slots that buffers messages when nobody is waiting for them.
+When a receiver is already blocked on an empty mailbox, the sender copies its message
+straight into the receiver's buffer instead of going through a slot.
+*/
+
+
+
+#define _CRT_SECURE_NO_WARNINGS
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "THREADSLib.h"
+#include "Scheduler.h"
+#include "Messaging.h"
+#include "Processes.h"
+
+#define MBOX_FREE       0   // Mailbox entry is unused
+#define MBOX_IN_USE     1   // Mailbox entry was created and can be used
+
+/*
+Mailboxes buffer up to slotCount messages of at most slotSize bytes each in a ring.
+*/
+typedef struct _mailbox
+{
+    int         status;         // MBOX_FREE or MBOX_IN_USE
+    int         slotCount;      // Number of messages the mailbox can buffer
+    int         slotSize;       // Largest message the mailbox accepts
+    int         head;           // Ring index of the oldest buffered message
+    int         count;          // Number of messages currently buffered
+    char*       slotData;       // slotCount * slotSize bytes of message storage
+    int*        slotLengths;    // Length of the message stored in each slot
+    WaitQueue   senders;        // Processes blocked sending to the full mailbox
+    WaitQueue   receivers;      // Processes blocked receiving from the empty mailbox
+
+} Mailbox;
+
+static Mailbox mailboxes[MAXMBOX];
+static int slotsInUse = 0;      // Total slots allocated across all mailboxes
+
+static int mailbox_send(int mbox_id, void* pMsg, int msg_size, int wait);
+static int mailbox_receive(int mbox_id, void* pMsg, int max_msg_size, int wait);
+static Mailbox* getMailbox(int mbox_id);
+static int takeSlot(Mailbox* pMailbox, void* pMsg, int max_msg_size);
+static void putSlot(Mailbox* pMailbox, void* pMsg, int msg_size);
+
+
+/**************************************************************************
+   Name - k_mailbox_create
+
+   Purpose - Creates a mailbox that buffers up to slots messages of at
+             most slot_size bytes. A mailbox with zero slots only passes
+             messages directly between a blocked sender and a receiver.
+
+   Parameters - slots, the number of buffered messages
+                slot_size, the largest message in bytes
+
+   Returns - the id of the new mailbox, or
+        -1 if the parameters are invalid or no mailbox/slots are left
+*************************************************************************/
+int k_mailbox_create(int slots, int slot_size)
+{
+    int mbox_id = -1;
+    Mailbox* pMailbox;
+
+    check_kernel_mode("k_mailbox_create");
+
+    if (slots < 0 || slot_size < 0 || slot_size > MAX_MESSAGE)
+    {
+        return -1;
+    }
+
+    disableInterrupts();
+
+    // Checked with interrupts disabled, so two creators cannot both take the last slots
+    if (slotsInUse + slots > MAXSLOTS)
+    {
+        enableInterrupts();
+        return -1;
+    }
+
+    for (int i = 0; i < MAXMBOX; i++)
+    {
+        if (mailboxes[i].status == MBOX_FREE)
+        {
+            mbox_id = i;
+            break;
+        }
+    }
+
+    if (mbox_id < 0)
+    {
+        enableInterrupts();
+        return -1;
+    }
+
+    pMailbox = &mailboxes[mbox_id];
+    memset(pMailbox, 0, sizeof(Mailbox));
+    pMailbox->slotCount = slots;
+    pMailbox->slotSize = slot_size;
+
+    if (slots > 0)
+    {
+        pMailbox->slotData = malloc((size_t)slots * slot_size + 1);
+        pMailbox->slotLengths = malloc(slots * sizeof(int));
+        if (pMailbox->slotData == NULL || pMailbox->slotLengths == NULL)
+        {
+            free(pMailbox->slotData);
+            free(pMailbox->slotLengths);
+            enableInterrupts();
+            return -1;
+        }
+    }
+
+    pMailbox->status = MBOX_IN_USE;
+    slotsInUse += slots;
+
+    enableInterrupts();
+    return mbox_id;
+}
+
+/**************************************************************************
+   Name - k_mailbox_release
+
+   Purpose - Releases a mailbox. Any process blocked on it is woken up and
+             its send or receive returns -3.
+
+   Parameters - mbox_id, the mailbox to release
+
+   Returns - 0 on success, -1 if the mailbox does not exist
+*************************************************************************/
+int k_mailbox_release(int mbox_id)
+{
+    Mailbox* pMailbox;
+    Process* waiter;
+
+    check_kernel_mode("k_mailbox_release");
+
+    disableInterrupts();
+
+    // Looked up with interrupts disabled, so two releases cannot both free it
+    pMailbox = getMailbox(mbox_id);
+    if (pMailbox == NULL)
+    {
+        enableInterrupts();
+        return -1;
+    }
+
+    pMailbox->status = MBOX_FREE;
+    slotsInUse -= pMailbox->slotCount;
+    free(pMailbox->slotData);
+    free(pMailbox->slotLengths);
+    pMailbox->slotData = NULL;
+    pMailbox->slotLengths = NULL;
+
+    while ((waiter = wait_queue_pop(&pMailbox->senders)) != NULL)
+    {
+        waiter->waitResult = -3;
+        ready_process(waiter);
+    }
+    while ((waiter = wait_queue_pop(&pMailbox->receivers)) != NULL)
+    {
+        waiter->waitResult = -3;
+        ready_process(waiter);
+    }
+
+    dispatcher();
+
+    enableInterrupts();
+    return 0;
+}
+
+/**************************************************************************
+   Name - k_mailbox_send
+
+   Purpose - Sends a message, blocking while the mailbox is full.
+
+   Parameters - mbox_id, pMsg and msg_size of the message
+
+   Returns - 0 on success
+        -1 if the parameters are invalid
+        -3 if the mailbox was released while blocked
+        -5 if the process was signaled while blocked
+*************************************************************************/
+int k_mailbox_send(int mbox_id, void* pMsg, int msg_size)
+{
+    return mailbox_send(mbox_id, pMsg, msg_size, TRUE);
+}
+
+/**************************************************************************
+   Name - k_mailbox_send_cond
+
+   Purpose - Sends a message without blocking.
+
+   Returns - same as k_mailbox_send, or -2 if the mailbox is full
+*************************************************************************/
+int k_mailbox_send_cond(int mbox_id, void* pMsg, int msg_size)
+{
+    return mailbox_send(mbox_id, pMsg, msg_size, FALSE);
+}
+
+/**************************************************************************
+   Name - k_mailbox_receive
+
+   Purpose - Receives a message, blocking while the mailbox is empty.
+
+   Parameters - mbox_id, pMsg buffer and its size max_msg_size
+
+   Returns - the size of the message received
+        -1 if the parameters are invalid or the message did not fit, when
+            it is left in the mailbox
+        -3 if the mailbox was released while blocked
+        -5 if the process was signaled while blocked
+*************************************************************************/
+int k_mailbox_receive(int mbox_id, void* pMsg, int max_msg_size)
+{
+    return mailbox_receive(mbox_id, pMsg, max_msg_size, TRUE);
+}
+
+/**************************************************************************
+   Name - k_mailbox_receive_cond
+
+   Purpose - Receives a message without blocking.
+
+   Returns - same as k_mailbox_receive, or -2 if the mailbox is empty
+*************************************************************************/
+int k_mailbox_receive_cond(int mbox_id, void* pMsg, int max_msg_size)
+{
+    return mailbox_receive(mbox_id, pMsg, max_msg_size, FALSE);
+}
+
+
+/**************************************************************************
+   Name - mailbox_send
+
+   Purpose - Common send path. A waiting receiver gets the message copied
+        straight into its own buffer, otherwise the message goes into a
+        free slot, otherwise the sender blocks (or fails if !wait) with
+        its buffer parked on the Process until a receiver frees a slot.
+        Waiting receivers whose buffers are too small for the message
+        are woken with -1 and the message goes on to the next one, or to
+        a slot, so it is never lost.
+   *************************************************************************/
+static int mailbox_send(int mbox_id, void* pMsg, int msg_size, int wait)
+{
+    Mailbox* pMailbox;
+    Process* receiver;
+
+    check_kernel_mode("k_mailbox_send");
+
+    disableInterrupts();
+
+    pMailbox = getMailbox(mbox_id);
+    if (pMailbox == NULL || msg_size < 0 || msg_size > pMailbox->slotSize || (pMsg == NULL && msg_size > 0))
+    {
+        enableInterrupts();
+        return -1;
+    }
+
+    receiver = wait_queue_pop(&pMailbox->receivers);
+    while (receiver != NULL && msg_size > receiver->messageSize)
+    {
+        receiver->waitResult = -1;
+        ready_process(receiver);
+        receiver = wait_queue_pop(&pMailbox->receivers);
+    }
+
+    if (receiver != NULL)
+    {
+        // Hand the message directly to the blocked receiver
+        memcpy(receiver->pMessage, pMsg, msg_size);
+        receiver->waitResult = msg_size;
+        ready_process(receiver);
+        dispatcher();
+    }
+    else if (pMailbox->count < pMailbox->slotCount)
+    {
+        putSlot(pMailbox, pMsg, msg_size);
+    }
+    else if (!wait)
+    {
+        enableInterrupts();
+        return -2;
+    }
+    else
+    {
+        // The receiver that frees a slot copies the message out of pMsg
+        runningProcess->pMessage = pMsg;
+        runningProcess->messageSize = msg_size;
+        block_on(&pMailbox->senders, BLOCKED_SEND);
+
+        enableInterrupts();
+        return runningProcess->waitResult;
+    }
+
+    enableInterrupts();
+    return 0;
+}
+
+/**************************************************************************
+   Name - mailbox_receive
+
+   Purpose - Common receive path. Buffered messages are taken first, and a
+        blocked sender's message is moved into the freed slot. A mailbox
+        with no buffered messages takes straight from a blocked sender
+        (zero-slot mailboxes), otherwise the receiver blocks (or fails if
+        !wait) and the next sender fills its buffer. A message that does
+        not fit, buffered or from a blocked sender, is left for a bigger
+        receive.
+   *************************************************************************/
+static int mailbox_receive(int mbox_id, void* pMsg, int max_msg_size, int wait)
+{
+    Mailbox* pMailbox;
+    Process* sender;
+    int result;
+
+    check_kernel_mode("k_mailbox_receive");
+
+    disableInterrupts();
+
+    pMailbox = getMailbox(mbox_id);
+    if (pMailbox == NULL || max_msg_size < 0 || (pMsg == NULL && max_msg_size > 0))
+    {
+        enableInterrupts();
+        return -1;
+    }
+
+    if (pMailbox->count > 0)
+    {
+        result = takeSlot(pMailbox, pMsg, max_msg_size);
+
+        sender = result >= 0 ? wait_queue_pop(&pMailbox->senders) : NULL;
+        if (sender != NULL)
+        {
+            putSlot(pMailbox, sender->pMessage, sender->messageSize);
+            sender->waitResult = 0;
+            ready_process(sender);
+            dispatcher();
+        }
+    }
+    else if (pMailbox->senders.head != NULL && pMailbox->senders.head->messageSize > max_msg_size)
+    {
+        result = -1;
+    }
+    else if ((sender = wait_queue_pop(&pMailbox->senders)) != NULL)
+    {
+        memcpy(pMsg, sender->pMessage, sender->messageSize);
+        result = sender->messageSize;
+        sender->waitResult = 0;
+        ready_process(sender);
+        dispatcher();
+    }
+    else if (!wait)
+    {
+        result = -2;
+    }
+    else
+    {
+        // The next sender copies its message straight into pMsg
+        runningProcess->pMessage = pMsg;
+        runningProcess->messageSize = max_msg_size;
+        block_on(&pMailbox->receivers, BLOCKED_RECEIVE);
+        result = runningProcess->waitResult;
+    }
+
+    enableInterrupts();
+    return result;
+}
+
+/**************************************************************************
+   Name - getMailbox
+
+   Returns - a pointer to the mailbox, or NULL if mbox_id is not in use
+   *************************************************************************/
+static Mailbox* getMailbox(int mbox_id)
+{
+    if (mbox_id < 0 || mbox_id >= MAXMBOX || mailboxes[mbox_id].status != MBOX_IN_USE)
+    {
+        return NULL;
+    }
+
+    return &mailboxes[mbox_id];
+}
+
+/**************************************************************************
+   Name - takeSlot
+
+   Purpose - Removes the oldest buffered message and copies it into pMsg.
+        A message larger than max_msg_size is left for a bigger receive.
+
+   Returns - the message size, or -1 if it did not fit in pMsg
+   *************************************************************************/
+static int takeSlot(Mailbox* pMailbox, void* pMsg, int max_msg_size)
+{
+    int length = pMailbox->slotLengths[pMailbox->head];
+
+    if (length > max_msg_size)
+    {
+        return -1;
+    }
+
+    memcpy(pMsg, pMailbox->slotData + (size_t)pMailbox->head * pMailbox->slotSize, length);
+    pMailbox->head = (pMailbox->head + 1) % pMailbox->slotCount;
+    pMailbox->count -= 1;
+
+    return length;
+}
+
+/**************************************************************************
+   Name - putSlot
+
+   Purpose - Copies a message into the next free slot of the ring.
+   *************************************************************************/
+static void putSlot(Mailbox* pMailbox, void* pMsg, int msg_size)
+{
+    int slot = (pMailbox->head + pMailbox->count) % pMailbox->slotCount;
+
+    memcpy(pMailbox->slotData + (size_t)slot * pMailbox->slotSize, pMsg, msg_size);
+    pMailbox->slotLengths[slot] = msg_size;
+    pMailbox->count += 1;
+}
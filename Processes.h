@@ -6,11 +6,76 @@ Course: CYBV 489
 
 #pragma once
 
+#include <setjmp.h>
+
 #define READY 1		// Waiting to run
 #define QUIT 2		// Waiting to be cleaned up and removed
 #define BLOCKED 3	// Waiting for a child or joined process to finish running
 #define RUNNING 4	// Actively running; is the current running process
 
+/*
+Reasons a process can be BLOCKED, kept in Process.blockStatus. block() takes
+statuses from 11 up to BLOCKED_KERNEL, the kernel's own reasons start after it.
+*/
+#define BLOCKED_USER_MIN	11
+#define BLOCKED_KERNEL		1000
+#define BLOCKED_WAIT		(BLOCKED_KERNEL + 1)	// Blocked in k_wait() for a child to quit
+#define BLOCKED_SEND		(BLOCKED_KERNEL + 2)	// Blocked sending to a full mailbox
+#define BLOCKED_RECEIVE		(BLOCKED_KERNEL + 3)	// Blocked receiving from an empty mailbox
+#define BLOCKED_FUTEX		(BLOCKED_KERNEL + 4)	// Blocked in k_futex_wait() on an address
+#define BLOCKED_MUTEX		(BLOCKED_KERNEL + 5)	// Blocked locking a kernel mutex held by another process
+#define BLOCKED_SLEEP		(BLOCKED_KERNEL + 6)	// Blocked in k_sleep() until its timer expires
+#define BLOCKED_JOIN		(BLOCKED_KERNEL + 7)	// Blocked in k_join() for a process to quit
+#define BLOCKED_DISK		(BLOCKED_KERNEL + 8)	// Blocked until its disk request completes
+#define BLOCKED_TERMINAL	(BLOCKED_KERNEL + 9)	// Blocked on a terminal's input or output ring
+#define BLOCKED_INTERRUPT	(BLOCKED_KERNEL + 10)	// The bottom half, waiting for interrupts to handle
+
+/* Signals do not wake these blocks, the process handles them once it is woken. */
+#define BLOCKED_UNINTERRUPTIBLE(status)	((status) == BLOCKED_DISK || (status) == BLOCKED_INTERRUPT)
+
+struct _process;
+
+/*
+WaitQueues are FIFO linked lists of BLOCKED Processes, linked through nextWaitingProcess.
+Unlike the ready Queues, processes of any priority can wait in the same WaitQueue.
+*/
+typedef struct _wait_queue
+{
+	struct _process*	head;		// First process in the linked list
+	struct _process*	tail;		// Last process in the linked list
+	int					size;		// Total number of processes in queue
+
+} WaitQueue;
+
+/*
+Timers are kept in the kernel's timing wheel and call their callback once the
+clock reaches expires. They are linked into a wheel slot, so they are usually
+embedded in whatever they belong to rather than allocated.
+*/
+typedef struct _timer
+{
+	struct _timer*		next;			// Next timer in the same wheel slot
+	struct _timer*		prev;			// Previous timer in the same wheel slot
+	DWORD				expires;		// Clock tick (ms) at which the timer fires
+	int					active;			// TRUE while the timer is in the wheel
+	void (*callback)(struct _timer*);	// Called from the clock interrupt when the timer fires
+	struct _process*	pProcess;		// Process the timer belongs to, if any
+
+} Timer;
+
+/*
+ProcessGroups collect the Processes sharing a pgid in an intrusive doubly linked
+list through nextGroupMember/prevGroupMember, so a group can be signaled in one pass
+without searching the process table.
+*/
+typedef struct _process_group
+{
+	int					pgid;		// Id of the group, 0 if the entry is unused
+	struct _process*	head;		// First member of the group
+	int					size;		// Number of members, including those that have quit
+
+} ProcessGroup;
+
 /*
 Processes are the simulated processes created and used by the "Operating System" in the THREADS environment.
 */
@@ -27,13 +92,101 @@ typedef struct _process
 	short          pid;					// Process id (pid) 
 	int            priority;			// The priority of the process, determines how quickly the dispatcher will run it 
 	int (*entryPoint) (void*);			// The entry point (function pointer) that is called from launch 
-	char*	       stack;				// Contents of the process' memory stack 
-	unsigned int   stacksize;			// Size of the memory stack allocated to the process 
+	char*	       stack;				// Bottom of the process' memory stack if it is painted or guarded, otherwise NULL
+	char*	       stackTop;			// Top of the memory stack, where its use is measured from
+	int			   stackPainted;		// TRUE if the stack was painted when the process started
+	int			   stackGuarded;		// TRUE if the guard zone is checked when the process gives up the CPU
+	unsigned int   stacksize;			// Size of the memory stack the process asked for
+	unsigned int   stackBytes;			// Size of the stack its context has, at least stacksize
+	jmp_buf*	   pRestart;			// Start of launch on the context's stack, for when the context is reused
 	int            status;				// READY, QUIT, BLOCKED, etc. 
 	int			   exitCode;			// The code needed by k_wait() and is input into k_exit()
+	int			   blockStatus;			// Why the process is BLOCKED (see BLOCKED_* above), 0 if it is not
+
+	struct _process*	nextWaitingProcess;	// Points to the next process in the wait queue this process is blocked on
+	WaitQueue*			pWaitQueue;			// The wait queue this process is blocked on, NULL if there is none
+	void*			pMessage;			// Message buffer being handed to or from a mailbox while blocked
+	int				messageSize;		// Size of pMessage; the received length once a receive completes
+	int				waitResult;			// Result handed to this process by whoever woke it up
+	volatile int*	pFutexAddress;		// Address the process is waiting on in k_futex_wait
+	Timer			timer;				// Wakes the process from k_sleep() or a timed out block
+	WaitQueue		joiners;			// Processes blocked in k_join() on this process
+	int*			pJoinExitCode;		// Where k_exit stores the exit code for a blocked k_join
+	unsigned int	pendingSignals;		// Bit per signal sent and not yet consumed by a block; SIG_TERM stays until exit
+	unsigned int	blockedSignals;		// Bit per signal the process has masked with k_sigmask
+	DWORD			startTime;			// read_clock() when the process was last given the CPU
+	DWORD			cpuTime;			// Total CPU time used in microseconds, excluding the current run
+	int				pgid;				// Process group id, inherited from the parent by k_spawn
+	ProcessGroup*	pGroup;				// The group the process is a member of
+	struct _process*	nextGroupMember;	// Next process in the same group
+	struct _process*	prevGroupMember;	// Previous process in the same group
+	int				userMode;			// TRUE if the process runs without PSR_KERNEL_MODE and uses system calls
+	int				daemon;				// TRUE for a kernel daemon, which cannot be signaled
+	struct _system_call_ring*	pRing;	// System call rings shared with the process, NULL until it sets them up
+	unsigned int	nextReadKey;		// Buffer cache key of the sector after the last one read, 0 if none
+	unsigned int	readAheadKey;		// Buffer cache key of the last track read ahead for the process
+	struct _open_file*	pFiles;		// FS_OPEN_MAX open files indexed by descriptor, NULL until the first k_open
+	struct _address_space*	pAddressSpace;	// Page table of the process's virtual memory, NULL until first used
+	struct _arena*	pArena;				// Heap of the process, NULL until the first k_malloc
 
 } Process;
 
+/*
+DiskRequests are queued on a disk by disk_submit() and transfer sectors consecutive
+sectors starting at track/sector, continuing onto the following tracks of the same
+platter. They belong to the caller, who must keep them until callback is called
+from the I/O interrupt.
+*/
+typedef struct _disk_request
+{
+	struct _disk_request*	next;		// Next request queued on the same disk
+	int				unit;				// Disk the request is for
+	int				platter;			// Platter to transfer on
+	int				track;				// Track of the first sector
+	int				sector;				// First sector within track
+	int				sectors;			// Number of sectors to transfer
+	int				write;				// TRUE to write buffer to the disk, FALSE to read into it
+	char*			buffer;				// sectors * THREADS_DISK_SECTOR_SIZE bytes, unless ppSectors is set
+	char**			ppSectors;			// Where each sector goes when they are scattered, otherwise NULL
+	int				done;				// Sectors transferred so far
+	int				status;				// 0 once completed successfully, otherwise the device status
+	DWORD			submitTime;			// read_clock() when the request was submitted
+	void (*callback)(struct _disk_request*);	// Called from the I/O interrupt once the request completes
+	void*			pContext;			// For the callback's own use
+
+} DiskRequest;
+
+/*
+OpenFiles are the files a process has open, in an array indexed by file descriptor.
+*/
+typedef struct _open_file
+{
+	int				flags;				// FS_READ and FS_WRITE as opened, 0 if the descriptor is free
+	int				inode;				// Inode of the file
+	unsigned int	position;			// Offset of the next read or write
+
+} OpenFile;
+
+/*
+IoDevices are the kernel's account of the commands outstanding on each device, so
+check_io can tell processes waiting on a device from a deadlock without asking every
+driver. Drivers embed one per unit, call io_issue() whenever the device accepts a
+command and io_complete() from its I/O interrupt, and block processes that wait on
+the device with io_wait(), on the device's own waiters queue unless the driver keeps
+queues of its own.
+*/
+typedef struct _io_device
+{
+	struct _io_device*	next;			// Next device in the kernel's list
+	char			name[THREADS_MAX_DEVICE_NAME];
+	int				inFlight;			// Commands the device has accepted and not yet completed
+	int				waiting;			// Processes blocked in io_wait() on the device
+	WaitQueue		waiters;			// Processes waiting for the device, if the driver has no queue of its own
+	unsigned int	issued;				// Commands issued since the device was registered
+	unsigned int	completed;			// Commands completed since the device was registered
+
+} IoDevice;
+
 /*
 Queues are FIFO linked lists whose nodes are Processes.
 */
@@ -44,4 +197,69 @@ typedef struct _queue
 	int			size;		// Total number of processes in queue
 	int			priority;	// The priority of the processes in the queue
 
-} Queue;
\ No newline at end of file
+} Queue;
+
+
+/* Kernel state and helpers shared between the kernel source files. */
+extern Process processTable[];
+extern Process* runningProcess;
+
+/* spawn_process flags */
+#define SPAWN_USER_MODE		0x1		// Run without PSR_KERNEL_MODE, using system calls
+#define SPAWN_DAEMON		0x2		// Kernel daemon with no parent, in a group of its own
+#define SPAWN_COW			0x4		// Child of k_spawn_cow, sharing its parent's memory
+
+int  spawn_process(char* name, int (*entryPoint)(void*), void* arg, int stacksize, int priority, int flags);
+void check_kernel_mode(char* functionName);
+void system_call_initialize(void);
+void sys_ring_release(Process* pProcess);
+
+void disableInterrupts();
+void enableInterrupts();
+void block_on(WaitQueue* target, int blockStatus);
+void block_on_timeout(WaitQueue* target, int blockStatus, int milliseconds);
+void ready_process(Process* target);
+int  signal_pending(Process* target);
+void wait_queue_push(WaitQueue* target, Process* node);
+Process* wait_queue_pop(WaitQueue* target);
+void wait_queue_remove(WaitQueue* target, Process* node);
+
+void io_initialize(void);
+void io_register(IoDevice* pDevice, char* name);
+void io_issue(IoDevice* pDevice);
+void io_complete(IoDevice* pDevice);
+void io_wait(IoDevice* pDevice, WaitQueue* target, int blockStatus);
+void io_wake(IoDevice* pDevice, Process* pProcess);
+int  io_in_flight(void);
+int  io_interrupt(char deviceId[32], uint8_t command, uint32_t status);
+
+void slab_initialize(void);
+
+void disk_initialize(void);
+int  disk_submit(DiskRequest* pRequest);
+int  disk_interrupt(int unit, uint8_t command, uint32_t status);
+void cache_initialize(void);
+void fs_release_files(Process* pProcess);
+void terminal_initialize(void);
+int  terminal_interrupt(int unit, uint8_t command, uint32_t status);
+void vm_initialize(void);
+void vm_release(Process* pProcess);
+int  vm_inherit(Process* pParent, Process* pChild);
+
+void arena_initialize(void);
+void arena_release(Process* pProcess);
+void shm_initialize(void);
+void shm_release(Process* pProcess);
+void shm_inherit(Process* pParent, Process* pChild);
+
+void stack_pool_initialize(process_entrypoint_t entryPoint);
+void* stack_pool_get(int stacksize, unsigned int* pStackBytes);
+void stack_pool_put(Process* pProcess);
+void stack_prepare(Process* pProcess, char* pTop);
+void stack_guard_check(Process* pProcess);
+
+void timer_initialize(DWORD now);
+void timer_start(Timer* pTimer, DWORD expires);
+void timer_cancel(Timer* pTimer);
+void timer_advance(DWORD now);
+int  timer_pending(void);
@@ -15,25 +15,42 @@ robin with priority system, and then exit.
 #define _CRT_SECURE_NO_WARNINGS
 
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
 #include "THREADSLib.h"
 #include "Scheduler.h"
+#include "SystemCalls.h"
+#include "StackPool.h"
 #include "Processes.h"
 
 #define NUM_PRIORITIES (HIGHEST_PRIORITY + 1)   // +1 to account for the lowest priority being 0
+#define TIME_SLICE_MS 80                        // How long a process runs before others of its priority get a turn
 
 Process processTable[MAX_PROCESSES];    // This table holds every currently existing process, regardless of their status
 Process *runningProcess = NULL;         // The currently running process, aka the current context
 Queue readyLists[NUM_PRIORITIES];       // +1 to account for priority 0; index = priority
+ProcessGroup processGroups[MAX_PROCESSES]; // A group always has a member, so there are never more groups than processes
 int nextPid = 1;                        // Controls the id of the next created process
 int debugFlag = 1;                      // If set for console output, the text may not appear if debugging mode is off
 
 /* Provided functions */
 static int watchdog(char*);
-static inline void disableInterrupts();
 void dispatcher();
 static int launch(void *);
 static void check_deadlock();
 static void DebugConsole(char* format, ...);
+static void clock_handler(char deviceId[32], uint8_t command, uint32_t status);
+static void io_handler(char deviceId[32], uint8_t command, uint32_t status);
+static void sleep_expired(Timer* pTimer);
+static void timeout_expired(Timer* pTimer);
+static Process* getProcess(int pid);
+static void reapChildren();
+static int waitForChild(int pgid, int* code, int milliseconds);
+static int deliverSignal(Process* target, int signal);
+static void consumeSignals(Process* target);
+static ProcessGroup* getGroup(int pgid);
+static void joinGroup(Process* target, int pgid);
+static void leaveGroup(Process* target);
 
 /* New functions */
 static int push(Queue* target, Process* node);
@@ -96,8 +113,26 @@ int bootstrap(void *pArgs)
         readyLists[i].priority = i;
     }
 
-    /* Initialize the clock interrupt handler */
+    /* Kernel object caches, created by the modules initialized below, and the pool of stacks */
+    slab_initialize();
+    stack_pool_initialize(launch);
 
+    /* Initialize the clock interrupt handler */
+    timer_initialize(read_clock() / 1000);
+    get_interrupt_handlers()[THREADS_TIMER_INTERRUPT] = clock_handler;
+
+    /* Initialize the I/O interrupt handler and the device drivers */
+    get_interrupt_handlers()[THREADS_IO_INTERRUPT] = io_handler;
+    io_initialize();
+    disk_initialize();
+    cache_initialize();
+    terminal_initialize();
+    vm_initialize();
+    arena_initialize();
+    shm_initialize();
+
+    /* Fill in the system call vector */
+    system_call_initialize();
 
     /* startup a watchdog process */
     result = k_spawn("watchdog", watchdog, NULL, THREADS_MIN_STACK_SIZE, LOWEST_PRIORITY); // Will always be pid = 1
@@ -139,48 +174,120 @@ int bootstrap(void *pArgs)
 
    Returns - The Process ID (pid) of the new child process 
              The function must return if the process cannot be created.
+             -1 if the name or entry point is NULL, arg does not fit in
+                MAXARG or the process table is full
+             -3 if called while in user mode
+             -4 if the stack size is too small
+             -5 if the priority is invalid
 
 ************************************************************************ */
 int k_spawn(char* name, int (*entryPoint)(void *), void* arg, int stacksize, int priority)
 {
-    int proc_slot;
-    struct _process* pNewProc;
-
-    /*
-    if (get_psr() != PSR_KERNEL_MODE)
+    if ((get_psr() & PSR_KERNEL_MODE) == 0)
     {
         console_output(debugFlag, "spawn(): Not in Kernel Mode.\n");
         return -3;
     }
-    */
 
-    // Documentation says to check for Kernel Mode, but it doesn't say where Kernel mode should be activated?
-    // This will likely need to be fixed while working on future milestones when we have more information!
-    set_psr(PSR_KERNEL_MODE); 
+    return spawn_process(name, entryPoint, arg, stacksize, priority, 0);
+
+} /* spawn */
+
+/*************************************************************************
+   k_spawn_cow()
+
+   Purpose - Spawns a child that inherits the calling process's virtual
+             memory pages, shared with it copy-on-write so neither is
+             copied until one of them writes it, and is attached to its
+             shared memory segments. Nothing else is inherited, so this
+             is not POSIX fork: the child starts fresh at entryPoint on
+             a new stack, with none of the caller's stack contents or
+             k_malloc memory, and the call returns only once, in the
+             caller.
+
+   Parameters - same as k_spawn
+
+   Returns - same as k_spawn, or -6 if the child's page table could not
+        be allocated
+
+************************************************************************ */
+int k_spawn_cow(char* name, int (*entryPoint)(void *), void* arg, int stacksize, int priority)
+{
+    if ((get_psr() & PSR_KERNEL_MODE) == 0)
+    {
+        console_output(debugFlag, "spawn_cow(): Not in Kernel Mode.\n");
+        return -3;
+    }
+
+    return spawn_process(name, entryPoint, arg, stacksize, priority, SPAWN_COW);
+
+} /* spawn_cow */
+
+/*************************************************************************
+   spawn_process()
+
+   Purpose - Does the work of k_spawn. Processes spawned by the kernel
+             run in kernel mode, those spawned through the spawn system
+             call run in user mode and can only use system calls. Kernel
+             daemons are not children of whoever happened to start them,
+             so nobody waits for them.
+
+   Parameters - same as k_spawn, plus flags, SPAWN_USER_MODE to run the
+                process without PSR_KERNEL_MODE, SPAWN_DAEMON for a
+                process without a parent and SPAWN_COW for k_spawn_cow
+
+   Returns - same as k_spawn, and -1 if the name of a user process is
+        too long, if arg does not fit in MAXARG or the process table is
+        full, -2 if the process could not be added to its ready list.
+        The caller's interrupt state is restored on every return.
+
+************************************************************************ */
+int spawn_process(char* name, int (*entryPoint)(void *), void* arg, int stacksize, int priority, int flags)
+{
+    uint32_t psr = get_psr();
+    int proc_slot = -1;
+    int pid;
+    struct _process* pNewProc;
 
     DebugConsole("spawn(): creating process %s\n", name);
 
     disableInterrupts();
 
     /* Validate all of the parameters*/
-    if (name == NULL)
+    if (name == NULL || entryPoint == NULL)
     {
-        console_output(debugFlag, "spawn(): Name value is NULL.\n");
+        console_output(debugFlag, "spawn(): Name or entry point is NULL.\n");
+        set_psr(psr);
         return -1;
     }
     if (strlen(name) >= (MAXNAME - 1))
     {
+        // A user process cannot halt the kernel
+        if ((flags & SPAWN_USER_MODE) != 0)
+        {
+            console_output(debugFlag, "spawn(): Process name is too long.\n");
+            set_psr(psr);
+            return -1;
+        }
         console_output(debugFlag, "spawn(): Process name is too long.  Halting...\n");
         stop( 1);
     }
+    if (arg != NULL && strlen(arg) >= MAXARG)
+    {
+        console_output(debugFlag, "spawn(): Process arguments are too long.\n");
+        set_psr(psr);
+        return -1;
+    }
     if (stacksize < THREADS_MIN_STACK_SIZE)
     {
         console_output(debugFlag, "spawn(): Stack size is too small.\n");
+        set_psr(psr);
         return -4;
     }
     if (priority < LOWEST_PRIORITY || priority > HIGHEST_PRIORITY)
     {
         console_output(debugFlag, "spawn(): Invalid priority.\n");
+        set_psr(psr);
         return -5;
     }
 
@@ -193,6 +300,12 @@ int k_spawn(char* name, int (*entryPoint)(void *), void* arg, int stacksize, int
             break;
         }
     }
+    if (proc_slot < 0)
+    {
+        console_output(debugFlag, "spawn(): The process table is full.\n");
+        set_psr(psr);
+        return -1;
+    }
     
     // Point to memory location for the new procedure
     pNewProc = &processTable[proc_slot]; 
@@ -206,6 +319,8 @@ int k_spawn(char* name, int (*entryPoint)(void *), void* arg, int stacksize, int
     pNewProc->stacksize = stacksize;
     pNewProc->status = READY;
     pNewProc->exitCode = 0;
+    pNewProc->userMode = (flags & SPAWN_USER_MODE) != 0;
+    pNewProc->daemon = (flags & SPAWN_DAEMON) != 0;
 
     // Some processes don't have args, so we need to account for NULL
     if (arg != NULL)
@@ -213,9 +328,31 @@ int k_spawn(char* name, int (*entryPoint)(void *), void* arg, int stacksize, int
         strcpy(pNewProc->startArgs, arg);
     }
 
-    
+    // A copy-on-write child shares its parent's pages, which is all that can fail
+    if ((flags & SPAWN_COW) != 0)
+    {
+        if (vm_inherit(runningProcess, pNewProc) != 0)
+        {
+            console_output(debugFlag, "spawn(): No memory for the copy-on-write page table.\n");
+            memset(pNewProc, 0, sizeof(Process));
+            set_psr(psr);
+            return -6;
+        }
+        shm_inherit(runningProcess, pNewProc);
+    }
+
+    /* Add the process to the ready list. */
+    if (push(&readyLists[pNewProc->priority], pNewProc) < 0)
+    {
+        vm_release(pNewProc);
+        shm_release(pNewProc);
+        memset(pNewProc, 0, sizeof(Process));
+        set_psr(psr);
+        return -2;
+    }
+
     // If there is a parent process, link the parent and this process to each other.
-    if (runningProcess != NULL)
+    if (runningProcess != NULL && (flags & SPAWN_DAEMON) == 0)
     {
         if (runningProcess->pChildren == NULL)
         {
@@ -236,17 +373,15 @@ int k_spawn(char* name, int (*entryPoint)(void *), void* arg, int stacksize, int
         pNewProc->pParent = runningProcess;
     }
 
-    /* Add the process to the ready list. */
-    if (push(&readyLists[pNewProc->priority], pNewProc) == 0)
-    {
-        return -2;
-    }
+    // Children start in their parent's group, the first processes and daemons lead their own
+    joinGroup(pNewProc, pNewProc->pParent != NULL ? runningProcess->pgid : pNewProc->pid);
 
     /* 
     Initialize context for this process, but use launch function pointer for
     the initial value of the process's program counter (PC)
     */
-    pNewProc->context = context_initialize(launch, stacksize, arg);
+    pNewProc->context = stack_pool_get(stacksize, &pNewProc->stackBytes);
+    pid = pNewProc->pid;
 
     // Skip this function call for Watchdog and Scheduler, we need to finish initializing
     if (pNewProc->pid > 2) 
@@ -254,15 +389,20 @@ int k_spawn(char* name, int (*entryPoint)(void *), void* arg, int stacksize, int
         dispatcher();
     }
 
-    return pNewProc->pid;
+    // The dispatcher comes back with interrupts still off, so give the caller its own state
+    set_psr(psr);
 
-} /* spawn */
+    return pid;
+
+} /* spawn_process */
 
 /**************************************************************************
    Name - launch
 
    Purpose - Utility function that makes sure the environment is ready,
-             such as enabling interrupts, for the new process.  
+             such as enabling interrupts, for the new process. Every
+             context starts here, and starts over here each time the
+             stack pool hands it to another process.
 
    Parameters - none
 
@@ -270,19 +410,28 @@ int k_spawn(char* name, int (*entryPoint)(void *), void* arg, int stacksize, int
 *************************************************************************/
 static int launch(void *args)
 {
+    jmp_buf restart;    // k_exit comes back here when this context is reused for another process
     int result;
 
+    setjmp(restart);
+    runningProcess->pRestart = &restart;
+    stack_prepare(runningProcess, (char*)&restart);
+
     DebugConsole("launch(): started: %s\n", runningProcess->name);
 
-    /* Enable interrupts */
-    set_psr(PSR_INTERRUPTS);
+    /* Enable interrupts, and drop to user mode for user processes */
+    set_psr(runningProcess->userMode ? PSR_INTERRUPTS : PSR_INTERRUPTS | PSR_KERNEL_MODE);
 
     /* Call the function passed to spawn and capture its return value */
     result = runningProcess->entryPoint(runningProcess->startArgs);
 
     DebugConsole("Process %d returned to launch\n", runningProcess->pid);
 
-    /* Stop the process gracefully */
+    /* Stop the process gracefully, user processes have to ask the kernel */
+    if (runningProcess->userMode)
+    {
+        sys_exit(result);
+    }
     k_exit(result);
 
     return 0;
@@ -303,52 +452,54 @@ static int launch(void *args)
 ************************************************************************ */
 int k_wait(int* code)
 {
-    int result = 0;
-    Process* child = runningProcess->pChildren;
+    return k_wait_timeout(code, NO_TIMEOUT);
+}
 
-    // Case: Process has no children
-    if (child == NULL) 
-    {
-        return -1;
-    }
+/**************************************************************************
+   Name - k_wait_timeout
 
-    // Case: a child has already exited
-    while (child != NULL) 
-    {
-        if (child->status == QUIT) // Find the child and clean it up
-        {
-            *code = child->exitCode;
-            result = child->pid;
-            cleanUpChild(child);
-            return result;
-        }
+   Purpose - Same as k_wait, but gives up once milliseconds have passed
+             without a child quitting. The timeout is a kernel timer, so
+             the process stays blocked until a child quits or it expires.
 
-        child = child->nextSiblingProcess; // Set new head of children linked list for the parent
-    }
+   Parameters - Output parameter for the child's exit code, and the
+                timeout in milliseconds (NO_TIMEOUT to wait forever).
 
-    // Case: no child has exited yet and this process must wait
+   Returns - same as k_wait, or TIMED_OUT if the timeout expired
 
-    child = runningProcess->pChildren; // Reset to head of children linked list
+************************************************************************ */
+int k_wait_timeout(int* code, int milliseconds)
+{
+    check_kernel_mode("k_wait");
 
-    runningProcess->status = BLOCKED; // Block the parent and wait for control to be returned
-    dispatcher();
+    return waitForChild(0, code, milliseconds);
+}
 
-    while (child != NULL) // Find exited child
-    {
-        if (child->status == QUIT) // Find the child and clean it up
-        {
-            *code = child->exitCode;
-            result = child->pid;
-            cleanUpChild(child);
-            break;
-        }
+/**************************************************************************
+   Name - k_waitpg
 
-        child = child->nextSiblingProcess; // Set new head of children linked list for the parent
-    }
+   Purpose - Same as k_wait, but only for children in the process group
+             pgid. Children in other groups are left for k_wait.
 
-    return result;
+   Parameters - pgid, the process group, and an output parameter for the
+                child's exit code
 
-} 
+   Returns - the pid of the quitting child, or
+        -1 if the process has no children in the group
+        -5 if the process was signaled in the wait
+
+************************************************************************ */
+int k_waitpg(int pgid, int* code)
+{
+    check_kernel_mode("k_waitpg");
+
+    if (pgid <= 0)
+    {
+        return -1;
+    }
+
+    return waitForChild(pgid, code, NO_TIMEOUT);
+}
 
 /**************************************************************************
    Name - k_exit
@@ -363,6 +514,18 @@ int k_wait(int* code)
 *************************************************************************/
 void k_exit(int code)
 {
+    Process* joiner;
+    jmp_buf* pRestart;
+
+    check_kernel_mode("k_exit");
+
+    // A signal can cut a process short while it still has children, so
+    // it waits for them here rather than leaving them orphaned
+    if (runningProcess->pChildren != NULL && signal_pending(runningProcess))
+    {
+        reapChildren();
+    }
+
     // Exiting process should not have children, halt program if it does
     if (runningProcess->pChildren != NULL) 
     {
@@ -370,436 +533,1495 @@ void k_exit(int code)
         stop(1);
     }
 
-    // If the process has a blocked parent, unblock it
-    if (runningProcess->pParent != NULL && runningProcess->pParent->status == BLOCKED) 
+    // If the process has a parent blocked in k_wait, unblock it
+    if (runningProcess->pParent != NULL && runningProcess->pParent->status == BLOCKED &&
+        runningProcess->pParent->blockStatus == BLOCKED_WAIT) 
     {
-        int index = runningProcess->pParent->priority;
+        ready_process(runningProcess->pParent);
+    }
 
-        runningProcess->pParent->status = READY;
-        push(&readyLists[index], runningProcess->pParent);
+    // Hand the exit code to every process blocked in k_join on this one
+    while ((joiner = wait_queue_pop(&runningProcess->joiners)) != NULL)
+    {
+        *joiner->pJoinExitCode = code;
+        ready_process(joiner);
     }
     
     // Signal to parent that this process needs to be cleaned up
     runningProcess->status = QUIT;
     runningProcess->exitCode = code;
+    pRestart = runningProcess->pRestart;
 
-    // Surrender control and wait to be cleaned up
+    // Surrender control and wait to be cleaned up. The context only runs
+    // again if the pool hands it to a new process, which starts in launch.
     dispatcher();
+    longjmp(*pRestart, 1);
 }
 
 /**************************************************************************
    Name - k_kill
 
-   Purpose - Signals a process with the specified signal
+   Purpose - Signals a process with the specified signal. The signal is
+             marked pending on the process, and if the process is blocked
+             and has not masked the signal, it is taken off whatever it
+             is waiting on right away and its blocking call returns
+             SIGNAL_INTERRUPTED. A signal other than SIG_TERM is cleared
+             by the block it interrupts, so it interrupts one blocking
+             call. SIG_TERM asks the process to quit and stays pending,
+             interrupting every later blocking call, until it exits.
 
-   Parameters - Signal to send
+   Parameters - pid of the process, and the signal to send
 
-   Returns -
+   Returns - 0 on success, -1 if the pid or signal is invalid or the
+        process is a kernel daemon
 *************************************************************************/
 int k_kill(int pid, int signal)
 {
-    int result = 0;
-    return 0;
-}
+    Process* target = getProcess(pid);
 
-/**************************************************************************
-   Name - k_getpid
-*************************************************************************/
-int k_getpid()
-{
-    return 0;
-}
+    check_kernel_mode("k_kill");
 
-/**************************************************************************
-   Name - k_join
-***************************************************************************/
-int k_join(int pid, int* pChildExitCode)
-{
-    return 0;
-}
+    if (target == NULL || target->status == QUIT || target->daemon || signal <= 0 || signal >= MAXSIG)
+    {
+        return -1;
+    }
 
-/**************************************************************************
-   Name - unblock
-*************************************************************************/
-int unblock(int pid)
-{
-    return 0;
-}
+    disableInterrupts();
 
-/*************************************************************************
-   Name - block
-*************************************************************************/
-int block(int newStatus)
-{
-    return 0;
-}
+    if (deliverSignal(target, signal))
+    {
+        dispatcher();
+    }
 
-/*************************************************************************
-   Name - signaled
-*************************************************************************/
-int signaled()
-{
-    return 0;
-}
-/*************************************************************************
-   Name - readtime
-*************************************************************************/
-int read_time()
-{
+    enableInterrupts();
     return 0;
 }
 
-/*************************************************************************
-   Name - readClock
-*************************************************************************/
-DWORD read_clock()
-{
-    return system_clock();
-}
-
-void display_process_table()
-{
-
-}
-
 /**************************************************************************
-   Name - dispatcher
-
-   Purpose - This is where context changes to the next process to run.
+   Name - k_killpg
 
-   Parameters - none
+   Purpose - Signals every process in the process group pgid, the same
+             way k_kill signals one. The members are signaled in a single
+             pass over the group's list with interrupts disabled, and the
+             dispatcher is called once at the end rather than after each
+             process that is woken. Kernel daemons in the group are
+             skipped.
 
-   Returns - nothing
+   Parameters - pgid of the group, and the signal to send
 
+   Returns - the number of processes signaled, or -1 if the group or
+        signal is invalid
 *************************************************************************/
-void dispatcher()
+int k_killpg(int pgid, int signal)
 {
-    Process* nextProcess = NULL; // Points to the next process that should run
+    ProcessGroup* pGroup;
+    Process* member;
+    int count = 0;
+    int woken = FALSE;
 
-    // No process was running
-    if (runningProcess == NULL) 
-    {
-        nextProcess = getHighestPriorityProcess();
-    }
-    // Current process has been blocked by another process or has exited, do not add to readyLists
-    else if (runningProcess->status == BLOCKED || runningProcess->status == QUIT)
+    check_kernel_mode("k_killpg");
+
+    if (signal <= 0 || signal >= MAXSIG)
     {
-        nextProcess = getHighestPriorityProcess();
+        return -1;
     }
-    // Current process is still the higest priority
-    else if (isHighestPriorityProcess(runningProcess)) 
+
+    disableInterrupts();
+
+    pGroup = getGroup(pgid);
+    if (pGroup == NULL)
     {
-        return;
+        enableInterrupts();
+        return -1;
     }
-    // Otherwise, reassess which process should run after adding current process back into readyLists
-    else 
-    {
-        Process* previousProcess = runningProcess;
-        runningProcess = NULL;
-
-        // Add previous process back into the ready lists
-        previousProcess->status = READY;
-        push(&readyLists[previousProcess->priority], previousProcess);
 
-        nextProcess = getHighestPriorityProcess();
+    for (member = pGroup->head; member != NULL; member = member->nextGroupMember)
+    {
+        if (member->status != QUIT && !member->daemon)
+        {
+            woken |= deliverSignal(member, signal);
+            count++;
+        }
     }
 
-    if (nextProcess == NULL)
+    if (woken)
     {
-        console_output(debugFlag, "Dispatcher(): Attempting to switch context to NULL process, closing program...\n");
-        stop(1);
+        dispatcher();
     }
 
-    // Give control to the next process
-    runningProcess = nextProcess;
-    context_switch(runningProcess->context);
+    enableInterrupts();
+    return count;
 }
 
-
 /**************************************************************************
-   Name - watchdog
+   Name - k_setpgid
 
-   Purpose - The watchdoog keeps the system going when all other
-         processes are blocked.  It can be used to detect when the system
-         is shutting down as well as when a deadlock condition arises.
+   Purpose - Moves a process into a process group. A process can only
+             move itself or one of its children, and only into a group
+             that already exists or a new one with its own pid as pgid.
 
-   Parameters - none
+   Parameters - pid of the process, 0 for the calling process
+                pgid of the group, 0 to use pid as the pgid
 
-   Returns - nothing
-   *************************************************************************/
-static int watchdog(char* dummy)
+   Returns - 0 on success, -1 if the pid or pgid is invalid
+*************************************************************************/
+int k_setpgid(int pid, int pgid)
 {
-    DebugConsole("watchdog(): called\n");
-    while (1)
+    Process* target = pid == 0 ? runningProcess : getProcess(pid);
+
+    check_kernel_mode("k_setpgid");
+
+    if (target == NULL || target->status == QUIT ||
+        (target != runningProcess && target->pParent != runningProcess))
     {
-        check_deadlock();
+        return -1;
     }
-    return 0;
-} 
 
-/* check to determine if deadlock has occurred... */
-static void check_deadlock()
-{
-    if (check_io() == 1)
+    if (pgid == 0)
     {
-        return;
+        pgid = target->pid;
     }
 
-    if (boolAvailableProcesses())
+    disableInterrupts();
+
+    if (pgid < 0 || (pgid != target->pid && getGroup(pgid) == NULL))
     {
-        stop(1);
+        enableInterrupts();
+        return -1;
     }
-    else
+
+    if (pgid != target->pgid)
     {
-        console_output(false, "All processes completed.\n");
-        stop(0);
+        leaveGroup(target);
+        joinGroup(target, pgid);
     }
+
+    enableInterrupts();
+    return 0;
 }
 
-/*
- * Disables the interrupts.
- */
-static inline void disableInterrupts()
+/**************************************************************************
+   Name - k_getpgid
+
+   Parameters - pid of the process, 0 for the calling process
+
+   Returns - the process group id of the process, or -1 if there is no
+        such process
+*************************************************************************/
+int k_getpgid(int pid)
 {
+    Process* target = pid == 0 ? runningProcess : getProcess(pid);
 
-    /* We ARE in kernel mode */
+    check_kernel_mode("k_getpgid");
 
+    if (target == NULL)
+    {
+        return -1;
+    }
 
-    int psr = get_psr();
+    return target->pgid;
+}
 
-    psr = psr & ~PSR_INTERRUPTS;
+/**************************************************************************
+   Name - k_sigmask
 
-    set_psr( psr);
+   Purpose - Sets which signals the running process has blocked. Blocked
+             signals stay pending without interrupting anything until
+             they are unblocked again.
 
-} /* disableInterrupts */
+   Parameters - blocked_signals, a SIGNAL_BIT() for each signal to block
 
-/**************************************************************************
-   Name - DebugConsole
-   Purpose - Prints  the message to the console_output if in debug mode
-   Parameters - format string and va args
-   Returns - nothing
+   Returns - the previous mask
+*************************************************************************/
+unsigned int k_sigmask(unsigned int blocked_signals)
+{
+    unsigned int previous = runningProcess->blockedSignals;
+
+    check_kernel_mode("k_sigmask");
+
+    runningProcess->blockedSignals = blocked_signals;
+
+    return previous;
+}
+
+/**************************************************************************
+   Name - k_sleep
+
+   Purpose - Blocks the running process for the given number of
+             milliseconds. The process is woken by its timer from the
+             clock interrupt, so it uses no CPU while it sleeps.
+
+   Parameters - milliseconds, how long to sleep
+
+   Returns - 0 after sleeping, -1 if milliseconds is negative, or
+        -5 if the process was signaled while sleeping
+*************************************************************************/
+int k_sleep(int milliseconds)
+{
+    if (milliseconds < 0)
+    {
+        return -1;
+    }
+
+    return k_sleep_until((int)(read_clock() / 1000) + milliseconds);
+}
+
+/**************************************************************************
+   Name - k_sleep_until
+
+   Purpose - Blocks the running process until read_clock() / 1000
+             reaches clockMillis. Returns right away if it already has.
+
+   Parameters - clockMillis, the clock time in milliseconds to wake at
+
+   Returns - 0 after sleeping, -5 if signaled while sleeping
+*************************************************************************/
+int k_sleep_until(int clockMillis)
+{
+    check_kernel_mode("k_sleep");
+
+    if ((int)(clockMillis - read_clock() / 1000) <= 0)
+    {
+        return 0;
+    }
+
+    disableInterrupts();
+
+    runningProcess->timer.callback = sleep_expired;
+    runningProcess->timer.pProcess = runningProcess;
+    runningProcess->waitResult = 0;
+    timer_start(&runningProcess->timer, (DWORD)clockMillis);
+    block_on(NULL, BLOCKED_SLEEP);
+
+    enableInterrupts();
+    return runningProcess->waitResult;
+}
+
+/**************************************************************************
+   Name - k_getpid
+*************************************************************************/
+int k_getpid()
+{
+    check_kernel_mode("k_getpid");
+
+    return runningProcess->pid;
+}
+
+/**************************************************************************
+   Name - k_join
+
+   Purpose - Waits for the process pid to quit and gets its exit code.
+             The process is not cleaned up; its parent still has to
+             k_wait for it.
+
+   Parameters - pid of the process to join, output parameter for its
+                exit code
+
+   Returns - 0 once the process has quit
+        -1 if pid does not exist or is the calling process
+        -5 if the process was signaled in the join
+***************************************************************************/
+int k_join(int pid, int* pChildExitCode)
+{
+    return k_join_timeout(pid, pChildExitCode, NO_TIMEOUT);
+}
+
+/**************************************************************************
+   Name - k_join_timeout
+
+   Purpose - Same as k_join, but gives up once milliseconds have passed.
+
+   Returns - same as k_join, or TIMED_OUT if the timeout expired
+***************************************************************************/
+int k_join_timeout(int pid, int* pChildExitCode, int milliseconds)
+{
+    Process* target = getProcess(pid);
+
+    check_kernel_mode("k_join");
+
+    if (target == NULL || target == runningProcess)
+    {
+        return -1;
+    }
+
+    if (target->status == QUIT)
+    {
+        *pChildExitCode = target->exitCode;
+        return 0;
+    }
+
+    if (milliseconds == 0)
+    {
+        return TIMED_OUT;
+    }
+
+    disableInterrupts();
+
+    runningProcess->pJoinExitCode = pChildExitCode;
+    block_on_timeout(&target->joiners, BLOCKED_JOIN, milliseconds);
+
+    enableInterrupts();
+    return runningProcess->waitResult;
+}
+
+/**************************************************************************
+   Name - unblock
+
+   Purpose - Makes a process that called block() ready to run again.
+
+   Parameters - pid of the blocked process
+
+   Returns - 0 on success, -1 if pid is not blocked in block()
+*************************************************************************/
+int unblock(int pid)
+{
+    Process* target = getProcess(pid);
+
+    check_kernel_mode("unblock");
+
+    if (target == NULL || target->status != BLOCKED ||
+        target->blockStatus < BLOCKED_USER_MIN || target->blockStatus > BLOCKED_KERNEL)
+    {
+        return -1;
+    }
+
+    disableInterrupts();
+
+    target->waitResult = 0;
+    ready_process(target);
+    dispatcher();
+
+    enableInterrupts();
+    return 0;
+}
+
+/*************************************************************************
+   Name - block
+
+   Purpose - Blocks the running process until another process calls
+             unblock() on it.
+
+   Parameters - newStatus, the block status to show for the process,
+                from 11 up to BLOCKED_KERNEL
+
+   Returns - 0 once unblocked, -5 if the process was signaled
+*************************************************************************/
+int block(int newStatus)
+{
+    return block_timeout(newStatus, NO_TIMEOUT);
+}
+
+/*************************************************************************
+   Name - block_timeout
+
+   Purpose - Same as block, but gives up once milliseconds have passed.
+
+   Returns - same as block, or TIMED_OUT if the timeout expired
+*************************************************************************/
+int block_timeout(int newStatus, int milliseconds)
+{
+    check_kernel_mode("block");
+
+    if (newStatus < BLOCKED_USER_MIN || newStatus > BLOCKED_KERNEL)
+    {
+        console_output(debugFlag, "block(): Invalid block status %d.  Halting...\n", newStatus);
+        stop(1);
+    }
+
+    if (milliseconds == 0)
+    {
+        return TIMED_OUT;
+    }
+
+    disableInterrupts();
+
+    block_on_timeout(NULL, newStatus, milliseconds);
+
+    enableInterrupts();
+    return runningProcess->waitResult;
+}
+
+/*************************************************************************
+   Name - signaled
+
+   Purpose - Checks whether the running process has an unblocked signal
+             pending.
+
+   Returns - non-zero if it does, 0 otherwise
+*************************************************************************/
+int signaled()
+{
+    return signal_pending(runningProcess);
+}
+/*************************************************************************
+   Name - readtime
+
+   Purpose - Returns the CPU time used by the running process so far, in
+             milliseconds, including its current run.
+*************************************************************************/
+int read_time()
+{
+    return (int)((runningProcess->cpuTime + (read_clock() - runningProcess->startTime)) / 1000);
+}
+
+/*************************************************************************
+   Name - get_start_time
+
+   Purpose - Returns the read_clock() time when the running process was
+             last given the CPU.
+*************************************************************************/
+int get_start_time()
+{
+    return (int)runningProcess->startTime;
+}
+
+/*************************************************************************
+   Name - time_slice
+
+   Purpose - Called from the clock interrupt. Once the running process
+             has had the CPU for TIME_SLICE_MS, the dispatcher gives any
+             other ready process of the same priority a turn.
+*************************************************************************/
+void time_slice()
+{
+    if (runningProcess != NULL && (read_clock() - runningProcess->startTime) / 1000 >= TIME_SLICE_MS)
+    {
+        dispatcher();
+    }
+}
+
+/*************************************************************************
+   Name - readClock
+*************************************************************************/
+DWORD read_clock()
+{
+    return system_clock();
+}
+
+/**************************************************************************
+   Name - display_process_table
+
+   Purpose - Prints a row for each process in the process table, with how
+             much of its stack it has used if the stack was painted.
+*************************************************************************/
+void display_process_table()
+{
+    static char* statusNames[] = { "", "READY", "QUIT", "BLOCKED", "RUNNING" };
+
+    console_output(FALSE, "%-5s %-6s %-4s %-12s %10s %15s  %s\n", "PID", "Parent", "Prio", "Status", "CPU us",
+        "Stack", "Name");
+
+    for (int i = 0; i < MAX_PROCESSES; i++)
+    {
+        Process* pProcess = &processTable[i];
+        char status[16];
+        char stack[24];
+        unsigned int used;
+        unsigned int size;
+
+        if (pProcess->pid == 0)
+        {
+            continue;
+        }
+
+        if (pProcess->status == BLOCKED)
+        {
+            snprintf(status, sizeof(status), "BLOCKED %d", pProcess->blockStatus);
+        }
+        else
+        {
+            snprintf(status, sizeof(status), "%s",
+                pProcess->status >= READY && pProcess->status <= RUNNING ? statusNames[pProcess->status] : "?");
+        }
+
+        if (get_stack_usage(pProcess->pid, &used, &size) == 0)
+        {
+            snprintf(stack, sizeof(stack), "%u/%u", used, size);
+        }
+        else
+        {
+            snprintf(stack, sizeof(stack), "-/%u", pProcess->stackBytes);
+        }
+
+        console_output(FALSE, "%-5d %-6d %-4d %-12s %10lu %15s  %s\n", pProcess->pid,
+            pProcess->pParent != NULL ? pProcess->pParent->pid : 0, pProcess->priority, status,
+            (unsigned long)pProcess->cpuTime, stack, pProcess->name);
+    }
+}
+
+/**************************************************************************
+   Name - dispatcher
+
+   Purpose - This is where context changes to the next process to run.
+
+   Parameters - none
+
+   Returns - nothing
+
+*************************************************************************/
+void dispatcher()
+{
+    Process* nextProcess = NULL; // Points to the next process that should run
+    Process* previousProcess = runningProcess;
+    uint32_t psr = get_psr();   // Restored when this process gets the CPU back
+    DWORD now;
+
+    // The clock interrupt must not re-enter the dispatcher mid-switch
+    disableInterrupts();
+
+    // No process was running
+    if (runningProcess == NULL) 
+    {
+        nextProcess = getHighestPriorityProcess();
+    }
+    // Current process has been blocked by another process or has exited, do not add to readyLists
+    else if (runningProcess->status == BLOCKED || runningProcess->status == QUIT)
+    {
+        nextProcess = getHighestPriorityProcess();
+    }
+    // Current process is still the higest priority
+    else if (isHighestPriorityProcess(runningProcess)) 
+    {
+        set_psr(psr);
+        return;
+    }
+    // Otherwise, reassess which process should run after adding current process back into readyLists
+    else 
+    {
+        runningProcess = NULL;
+
+        // Add previous process back into the ready lists
+        previousProcess->status = READY;
+        push(&readyLists[previousProcess->priority], previousProcess);
+
+        nextProcess = getHighestPriorityProcess();
+    }
+
+    if (nextProcess == NULL)
+    {
+        console_output(debugFlag, "Dispatcher(): Attempting to switch context to NULL process, closing program...\n");
+        stop(1);
+    }
+
+    // Charge the previous process for the CPU time it used
+    now = read_clock();
+    if (previousProcess != NULL)
+    {
+        previousProcess->cpuTime += now - previousProcess->startTime;
+        stack_guard_check(previousProcess);
+    }
+    nextProcess->startTime = now;
+
+    // Give control to the next process
+    runningProcess = nextProcess;
+    runningProcess->status = RUNNING;
+    context_switch(runningProcess->context);
+
+    set_psr(psr);
+}
+
+
+/**************************************************************************
+   Name - watchdog
+
+   Purpose - The watchdoog keeps the system going when all other
+         processes are blocked.  It can be used to detect when the system
+         is shutting down as well as when a deadlock condition arises.
+
+   Parameters - none
+
+   Returns - nothing
+   *************************************************************************/
+static int watchdog(char* dummy)
+{
+    DebugConsole("watchdog(): called\n");
+    while (1)
+    {
+        check_deadlock();
+    }
+    return 0;
+} 
+
+/* check to determine if deadlock has occurred... */
+static void check_deadlock()
+{
+    if (check_io() == 1)
+    {
+        return;
+    }
+
+    // Sleeping processes will be woken by the clock, so keep idling
+    if (timer_pending() > 0)
+    {
+        return;
+    }
+
+    if (boolAvailableProcesses())
+    {
+        stop(1);
+    }
+    else
+    {
+        console_output(false, "All processes completed.\n");
+        stop(0);
+    }
+}
+
+/**************************************************************************
+   Name - check_kernel_mode
+
+   Purpose - Halts if a kernel function is called while the processor is
+             in user mode. User processes have to use the system calls.
+
+   Parameters - functionName, the kernel function being called
+*************************************************************************/
+void check_kernel_mode(char* functionName)
+{
+    if ((get_psr() & PSR_KERNEL_MODE) == 0)
+    {
+        console_output(debugFlag, "%s(): called while in user mode by process %d.  Halting...\n",
+            functionName, runningProcess->pid);
+        stop(1);
+    }
+}
+
+/*
+ * Disables the interrupts.
+ */
+void disableInterrupts()
+{
+
+    /* We ARE in kernel mode */
+
+
+    int psr = get_psr();
+
+    psr = psr & ~PSR_INTERRUPTS;
+
+    set_psr( psr);
+
+} /* disableInterrupts */
+
+/*
+ * Enables the interrupts.
+ */
+void enableInterrupts()
+{
+    int psr = get_psr();
+
+    psr = psr | PSR_INTERRUPTS;
+
+    set_psr(psr);
+
+} /* enableInterrupts */
+
+/**************************************************************************
+   Name - DebugConsole
+   Purpose - Prints  the message to the console_output if in debug mode
+   Parameters - format string and va args
+   Returns - nothing
    Side Effects -
 *************************************************************************/
-static void DebugConsole(char* format, ...)
+static void DebugConsole(char* format, ...)
+{
+    char buffer[2048];
+    va_list argptr;
+
+    if (debugFlag)
+    {
+        va_start(argptr, format);
+        vsprintf(buffer, format, argptr);
+        console_output(TRUE, buffer);
+        va_end(argptr);
+
+    }
+}
+
+
+/**************************************************************************
+   Name - clock_handler
+
+   Purpose - Handles the clock interrupt. Fires any expired timers and
+             then lets the running process's time slice be checked. The
+             dispatcher is always called when a timer fired, in case it
+             readied a process of higher priority.
+*************************************************************************/
+static void clock_handler(char deviceId[32], uint8_t command, uint32_t status)
+{
+    int pending = timer_pending();
+
+    timer_advance(read_clock() / 1000);
+
+    if (timer_pending() != pending)
+    {
+        dispatcher();
+    }
+    else
+    {
+        time_slice();
+    }
+}
+
+/**************************************************************************
+   Name - io_handler
+
+   Purpose - Handles the I/O interrupt by passing it to io_interrupt,
+             which hands it to the device's driver or to the bottom half.
+             The dispatcher is called when a process was readied.
+*************************************************************************/
+static void io_handler(char deviceId[32], uint8_t command, uint32_t status)
+{
+    if (io_interrupt(deviceId, command, status))
+    {
+        dispatcher();
+    }
+}
+
+/**************************************************************************
+   Name - sleep_expired
+
+   Purpose - Timer callback that wakes a process from k_sleep.
+*************************************************************************/
+static void sleep_expired(Timer* pTimer)
+{
+    ready_process(pTimer->pProcess);
+}
+
+/**************************************************************************
+   Name - timeout_expired
+
+   Purpose - Timer callback that gives up a timed block. The process is
+        taken off whatever wait queue it is on and sees TIMED_OUT.
+*************************************************************************/
+static void timeout_expired(Timer* pTimer)
+{
+    Process* target = pTimer->pProcess;
+
+    if (target->pWaitQueue != NULL)
+    {
+        wait_queue_remove(target->pWaitQueue, target);
+    }
+
+    target->waitResult = TIMED_OUT;
+    ready_process(target);
+}
+
+
+/* Returns 1 while any device has a command in flight that the I/O interrupt will complete. */
+int check_io_scheduler()
+{
+    return io_in_flight() > 0;
+}
+
+
+
+/* NEW FUNCTIONS */
+
+/**************************************************************************
+   Name - push
+
+   Purpose - The Process node is added to the end of the priority queue
+        pointed to by target.
+
+   Parameters - target, a pointer to a priority Queue
+                node, a pointed to a node that is to be added to target
+
+   Returns - -1 if an error occurs, otherwise returns the new size of target
+   *************************************************************************/
+static int push(Queue* target, Process* node)
+{
+    if (target->size == (MAX_PROCESSES - 1))
+    {
+        console_output(TRUE, "Could not add Process '%s' to Queue %d, the Queue is full.\n", node->name, target->priority);
+        return -1;
+    }
+    else if (target->priority != node->priority)
+    {
+        console_output(TRUE, "Could not add Process '%s' to Queue %d, Process and Queue priorities do not match.\n", node->name, target->priority);
+        return -1;
+    }
+    else if (target->size == 0)
+    {
+        target->head = node;
+        target->tail = node;
+        target->size += 1;
+        return target->size;
+    }
+    else
+    {
+        target->tail->nextReadyProcess = node;
+        target->tail = node;
+        target->size += 1;
+        return target->size;
+    }
+}
+
+/**************************************************************************
+   Name - pop
+
+   Purpose - Retrieves the first node of target priority Queue, removes it
+        from the Queue, and returns it.
+
+   Parameters - target, a pointer to a priority Queue
+
+   Returns - NULL if an error occurs, otherwise returns the Process popped
+        from target
+   *************************************************************************/
+static Process* pop(Queue* target)
+{
+    Process* node = NULL;
+
+    if (target->size == 0)
+    {
+        console_output(TRUE, "Could not pop from Queue %d, the Queue is empty.\n", target->priority);
+    }
+    else if (target->size == 1)
+    {
+        node = target->head;
+        target->head = NULL;
+        target->tail = NULL;
+        target->size -= 1;
+    }
+    else
+    {
+        node = target->head;
+        target->head = node->nextReadyProcess;
+        node->nextReadyProcess = NULL;
+        target->size -= 1;
+    }
+
+    return node;
+}
+
+/**************************************************************************
+   Name - boolAvailableProcesses
+
+   Purpose - Determines if there are any processes available, excluding 
+        Watchdog, and returns a boolean based on the determination.
+
+   Parameters - none
+
+   Returns - true if there are processes available (besides Watchdog), otherwise
+        returns false
+   *************************************************************************/
+static int boolAvailableProcesses()
+{
+    for (int i = 1; i < NUM_PRIORITIES; i++) // Skip lowest priority
+    {
+        if (readyLists[i].size > 0)
+        {
+            return true;
+        }
+    }
+    if (readyLists[0].size > 1) // Watchdog should be running
+    {
+        return true;
+    }
+
+    return false;
+}
+
+/**************************************************************************
+   Name - isHighestPriorityProcess
+
+   Purpose - Each priority Queue is searched to find any Process that is 
+        a higher or equal priority compared to the target's, and returns a 
+        boolean reflecting if there is one or not.
+
+   Parameters - target, a pointer to a Process
+
+   Returns - true if no Process is found with a higher or equal priority,
+        otherwise returns false
+   *************************************************************************/
+static int isHighestPriorityProcess(Process* target)
+{
+    for (int i = HIGHEST_PRIORITY; i >= target->priority; i--)
+    {
+        if (readyLists[i].size > 0)
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+/**************************************************************************
+   Name - getHighestPriorityProcess
+
+   Purpose - Each priority Queue is searched for the highest priority Process,
+        pops it from its Queue, and returns it.
+
+   Parameters - none
+
+   Returns - Null if there are no Processes (which is an error), otherwise
+        returns a pointer to the highest priority Process
+   *************************************************************************/
+static Process* getHighestPriorityProcess()
+{
+    for (int i = HIGHEST_PRIORITY; i >= 0; i--)
+    {
+        if (readyLists[i].size > 0)
+        {
+            return pop(&readyLists[i]);
+        }
+    }
+
+    return NULL; // This line should never run!
+}
+
+/**************************************************************************
+   Name - cleanUpChild
+
+   Purpose - This helper function is called by a parent Process to clean up
+        and remove a child Process pointed to by target. All pointers to
+        it from other Processes cleared or changed, and the child is
+        removed from the Process table.
+
+   Parameters - target, a pointer to a Process
+
+   Returns - none
+   *************************************************************************/
+static void cleanUpChild(Process* target)
+{
+    Process blankProcess = { 0 };
+
+    // Remove from parent, if it is the head of the children list
+    if (runningProcess->pChildren->pid == target->pid)
+    {
+        runningProcess->pChildren = target->nextSiblingProcess;
+    }
+    // Remove from sibling chain if it isn't
+    else
+    {
+        Process* child = runningProcess->pChildren;
+
+        while (child->nextSiblingProcess->pid != target->pid)
+        {
+            child = child->nextSiblingProcess;
+        }
+
+        child->nextSiblingProcess = target->nextSiblingProcess;
+    }
+
+    leaveGroup(target);
+    sys_ring_release(target);
+    fs_release_files(target);
+    vm_release(target);
+    shm_release(target);
+    arena_release(target);
+    stack_pool_put(target);
+
+    // Clear child from the process table
+    for (int i = 0; i < MAX_PROCESSES; i++)
+    {
+        if (processTable[i].pid == target->pid)
+        {
+            processTable[i] = blankProcess;
+        }
+    }
+}
+
+/**************************************************************************
+   Name - block_on
+
+   Purpose - Blocks the running Process, optionally adding it to the end
+        of the WaitQueue pointed to by target, and gives up the CPU. The
+        function returns once another Process has made it READY again,
+        or right away with a waitResult of SIGNAL_INTERRUPTED if the
+        Process already has a signal pending and the block is not
+        BLOCKED_UNINTERRUPTIBLE.
+
+   Parameters - target, a pointer to a WaitQueue, or NULL if the Process
+                    will be found some other way (e.g. by its pid)
+                blockStatus, the reason for blocking (see BLOCKED_*)
+
+   Returns - none
+   *************************************************************************/
+void block_on(WaitQueue* target, int blockStatus)
+{
+    // A pending signal interrupts the block before it starts
+    if (!BLOCKED_UNINTERRUPTIBLE(blockStatus) && signal_pending(runningProcess))
+    {
+        timer_cancel(&runningProcess->timer);
+        runningProcess->waitResult = SIGNAL_INTERRUPTED;
+        consumeSignals(runningProcess);
+        return;
+    }
+
+    runningProcess->status = BLOCKED;
+    runningProcess->blockStatus = blockStatus;
+
+    if (target != NULL)
+    {
+        wait_queue_push(target, runningProcess);
+    }
+
+    dispatcher();
+}
+
+/**************************************************************************
+   Name - block_on_timeout
+
+   Purpose - Same as block_on, but if the Process is still blocked after
+        milliseconds it is taken off target and woken with a waitResult
+        of TIMED_OUT. Whoever wakes it first cancels the other.
+
+   Parameters - target, a pointer to a WaitQueue, or NULL
+                blockStatus, the reason for blocking (see BLOCKED_*)
+                milliseconds, the timeout, or NO_TIMEOUT to wait forever
+
+   Returns - none
+   *************************************************************************/
+void block_on_timeout(WaitQueue* target, int blockStatus, int milliseconds)
 {
-    char buffer[2048];
-    va_list argptr;
+    runningProcess->waitResult = 0;
 
-    if (debugFlag)
+    if (milliseconds != NO_TIMEOUT)
     {
-        va_start(argptr, format);
-        vsprintf(buffer, format, argptr);
-        console_output(TRUE, buffer);
-        va_end(argptr);
-
+        runningProcess->timer.callback = timeout_expired;
+        runningProcess->timer.pProcess = runningProcess;
+        timer_start(&runningProcess->timer, read_clock() / 1000 + milliseconds);
     }
+
+    block_on(target, blockStatus);
 }
 
+/**************************************************************************
+   Name - ready_process
+
+   Purpose - Moves a BLOCKED Process back onto the ready list for its
+        priority. The caller decides when to call the dispatcher.
 
-/* there is no I/O yet, so return false. */
-int check_io_scheduler()
+   Parameters - target, a pointer to a Process
+
+   Returns - none
+   *************************************************************************/
+void ready_process(Process* target)
 {
-    return false;
+    timer_cancel(&target->timer);
+
+    target->status = READY;
+    target->blockStatus = 0;
+    push(&readyLists[target->priority], target);
 }
 
+/**************************************************************************
+   Name - signal_pending
 
+   Purpose - Checks the target Process for pending signals it has not
+        blocked.
 
-/* NEW FUNCTIONS */
+   Parameters - target, a pointer to a Process
+
+   Returns - non-zero if there is one, otherwise 0
+   *************************************************************************/
+int signal_pending(Process* target)
+{
+    return (target->pendingSignals & ~target->blockedSignals) != 0;
+}
 
 /**************************************************************************
-   Name - push
+   Name - wait_queue_push
 
-   Purpose - The Process node is added to the end of the priority queue
-        pointed to by target.
+   Purpose - The Process node is added to the end of the WaitQueue pointed
+        to by target.
 
-   Parameters - target, a pointer to a priority Queue
-                node, a pointed to a node that is to be added to target
+   Parameters - target, a pointer to a WaitQueue
+                node, a pointer to the Process that is waiting
 
-   Returns - -1 if an error occurs, otherwise returns the new size of target
+   Returns - none
    *************************************************************************/
-static int push(Queue* target, Process* node)
+void wait_queue_push(WaitQueue* target, Process* node)
 {
-    if (target->size == (MAX_PROCESSES - 1))
-    {
-        console_output(TRUE, "Could not add Process '%s' to Queue %d, the Queue is full.\n", node->name, target->priority);
-        return -1;
-    }
-    else if (target->priority != node->priority)
-    {
-        console_output(TRUE, "Could not add Process '%s' to Queue %d, Process and Queue priorities do not match.\n", node->name, target->priority);
-        return -1;
-    }
-    else if (target->size == 0)
+    node->nextWaitingProcess = NULL;
+    node->pWaitQueue = target;
+
+    if (target->size == 0)
     {
         target->head = node;
-        target->tail = node;
-        target->size += 1;
-        return target->size;
     }
     else
     {
-        target->tail->nextReadyProcess = node;
-        target->tail = node;
-        target->size += 1;
-        return target->size;
+        target->tail->nextWaitingProcess = node;
     }
+
+    target->tail = node;
+    target->size += 1;
 }
 
 /**************************************************************************
-   Name - pop
+   Name - wait_queue_pop
 
-   Purpose - Retrieves the first node of target priority Queue, removes it
-        from the Queue, and returns it.
+   Purpose - Removes the first Process waiting in the target WaitQueue and
+        returns it.
 
-   Parameters - target, a pointer to a priority Queue
+   Parameters - target, a pointer to a WaitQueue
 
-   Returns - NULL if an error occurs, otherwise returns the Process popped
-        from target
+   Returns - NULL if the WaitQueue is empty, otherwise the Process removed
    *************************************************************************/
-static Process* pop(Queue* target)
+Process* wait_queue_pop(WaitQueue* target)
 {
-    Process* node = NULL;
+    Process* node = target->head;
 
-    if (target->size == 0)
+    if (node != NULL)
     {
-        console_output(TRUE, "Could not pop from Queue %d, the Queue is empty.\n", target->priority);
+        target->head = node->nextWaitingProcess;
+        if (target->head == NULL)
+        {
+            target->tail = NULL;
+        }
+        target->size -= 1;
+
+        node->nextWaitingProcess = NULL;
+        node->pWaitQueue = NULL;
     }
-    else if (target->size == 1)
+
+    return node;
+}
+
+/**************************************************************************
+   Name - wait_queue_remove
+
+   Purpose - Unlinks the Process node from wherever it is in the target
+        WaitQueue.
+
+   Parameters - target, a pointer to a WaitQueue
+                node, a pointer to a Process waiting in target
+
+   Returns - none
+   *************************************************************************/
+void wait_queue_remove(WaitQueue* target, Process* node)
+{
+    Process* previous = NULL;
+    Process* current = target->head;
+
+    while (current != NULL && current != node)
     {
-        node = target->head;
-        target->head = NULL;
-        target->tail = NULL;
-        target->size -= 1;
+        previous = current;
+        current = current->nextWaitingProcess;
+    }
+
+    if (current == NULL)
+    {
+        return;
+    }
+
+    if (previous == NULL)
+    {
+        target->head = node->nextWaitingProcess;
     }
     else
     {
-        node = target->head;
-        target->head = node->nextReadyProcess;
-        node->nextReadyProcess = NULL;
-        target->size -= 1;
+        previous->nextWaitingProcess = node->nextWaitingProcess;
     }
 
-    return node;
+    if (target->tail == node)
+    {
+        target->tail = previous;
+    }
+    target->size -= 1;
+
+    node->nextWaitingProcess = NULL;
+    node->pWaitQueue = NULL;
 }
 
 /**************************************************************************
-   Name - boolAvailableProcesses
+   Name - getProcess
 
-   Purpose - Determines if there are any processes available, excluding 
-        Watchdog, and returns a boolean based on the determination.
+   Purpose - Finds the Process with the given pid in the Process table.
+
+   Parameters - pid, the Process id to look for
+
+   Returns - NULL if there is no such Process, otherwise a pointer to it
+   *************************************************************************/
+static Process* getProcess(int pid)
+{
+    if (pid <= 0)
+    {
+        return NULL;
+    }
+
+    for (int i = 0; i < MAX_PROCESSES; i++)
+    {
+        if (processTable[i].pid == pid)
+        {
+            return &processTable[i];
+        }
+    }
+
+    return NULL;
+}
+
+/**************************************************************************
+   Name - reapChildren
+
+   Purpose - Blocks the running Process until all of its children have
+        quit, cleaning each one up. Used by a signaled Process on its way
+        out, so unlike k_wait it is not interrupted by pending signals.
 
    Parameters - none
 
-   Returns - true if there are processes available (besides Watchdog), otherwise
-        returns false
+   Returns - none
    *************************************************************************/
-static int boolAvailableProcesses()
+static void reapChildren()
 {
-    for (int i = 1; i < NUM_PRIORITIES; i++) // Skip lowest priority
+    Process* child;
+    Process* next;
+
+    while (runningProcess->pChildren != NULL)
     {
-        if (readyLists[i].size > 0)
+        child = runningProcess->pChildren;
+        while (child != NULL)
         {
-            return true;
+            next = child->nextSiblingProcess;
+            if (child->status == QUIT)
+            {
+                cleanUpChild(child);
+            }
+            child = next;
+        }
+
+        if (runningProcess->pChildren != NULL)
+        {
+            runningProcess->status = BLOCKED;
+            runningProcess->blockStatus = BLOCKED_WAIT;
+            dispatcher();
         }
     }
-    if (readyLists[0].size > 1) // Watchdog should be running
+}
+
+/**************************************************************************
+   Name - waitForChild
+
+   Purpose - Cleans up a child of the running Process that has quit,
+        blocking until one does. Children that quit in other groups wake
+        the Process too, so it checks again until a matching one has quit.
+
+   Parameters - pgid, only consider children in this group, 0 for any
+                code, output parameter for the child's exit code
+                milliseconds, the timeout, or NO_TIMEOUT to wait forever
+
+   Returns - the pid of the child, -1 if there are no matching children,
+        or the waitResult if the block was interrupted or timed out
+   *************************************************************************/
+static int waitForChild(int pgid, int* code, int milliseconds)
+{
+    Process* child;
+    int found;
+    int result;
+    int remaining = milliseconds;
+    DWORD deadline = read_clock() / 1000 + milliseconds;
+
+    // A child quitting between the search and the block would not wake this Process
+    disableInterrupts();
+
+    while (TRUE)
     {
-        return true;
+        found = FALSE;
+        for (child = runningProcess->pChildren; child != NULL; child = child->nextSiblingProcess)
+        {
+            if (pgid != 0 && child->pgid != pgid)
+            {
+                continue;
+            }
+
+            found = TRUE;
+            if (child->status == QUIT) // Find the child and clean it up
+            {
+                *code = child->exitCode;
+                result = child->pid;
+                cleanUpChild(child);
+                enableInterrupts();
+                return result;
+            }
+        }
+
+        if (!found)
+        {
+            result = -1;
+            break;
+        }
+
+        if (milliseconds != NO_TIMEOUT)
+        {
+            remaining = (int)(deadline - read_clock() / 1000);
+            if (remaining <= 0)
+            {
+                result = TIMED_OUT;
+                break;
+            }
+        }
+
+        block_on_timeout(NULL, BLOCKED_WAIT, remaining); // Block the parent and wait for control to be returned
+
+        if (runningProcess->waitResult != 0)
+        {
+            result = runningProcess->waitResult;
+            break;
+        }
     }
 
-    return false;
+    enableInterrupts();
+    return result;
 }
 
 /**************************************************************************
-   Name - isHighestPriorityProcess
+   Name - deliverSignal
 
-   Purpose - Each priority Queue is searched to find any Process that is 
-        a higher or equal priority compared to the target's, and returns a 
-        boolean reflecting if there is one or not.
+   Purpose - Marks the signal pending on the target Process. If it is
+        blocked interruptibly and has not masked the signal, it is taken
+        off whatever it is waiting on and made ready with a waitResult of
+        SIGNAL_INTERRUPTED, which consumes the signal unless it is
+        SIG_TERM. The caller decides when to call the dispatcher.
+
+   Parameters - target, a pointer to a Process that has not quit
+                signal, the signal to send
+
+   Returns - TRUE if the Process was woken, otherwise FALSE
+   *************************************************************************/
+static int deliverSignal(Process* target, int signal)
+{
+    target->pendingSignals |= SIGNAL_BIT(signal);
+
+    if (target->status != BLOCKED || BLOCKED_UNINTERRUPTIBLE(target->blockStatus) || !signal_pending(target))
+    {
+        return FALSE;
+    }
+
+    if (target->pWaitQueue != NULL)
+    {
+        wait_queue_remove(target->pWaitQueue, target);
+    }
+    target->waitResult = SIGNAL_INTERRUPTED;
+    consumeSignals(target);
+    ready_process(target);
+
+    return TRUE;
+}
+
+/**************************************************************************
+   Name - consumeSignals
+
+   Purpose - Clears the unblocked signals pending on the target Process
+        once they have interrupted a block. SIG_TERM is left pending so
+        the Process keeps being interrupted until it exits, and masked
+        signals wait until they are unblocked.
 
    Parameters - target, a pointer to a Process
+   *************************************************************************/
+static void consumeSignals(Process* target)
+{
+    target->pendingSignals &= target->blockedSignals | SIGNAL_BIT(SIG_TERM);
+}
 
-   Returns - true if no Process is found with a higher or equal priority,
-        otherwise returns false
+/**************************************************************************
+   Name - getGroup
+
+   Purpose - Finds the ProcessGroup with the given pgid.
+
+   Parameters - pgid, the process group id to look for
+
+   Returns - NULL if there is no such group, otherwise a pointer to it
    *************************************************************************/
-static int isHighestPriorityProcess(Process* target)
+static ProcessGroup* getGroup(int pgid)
 {
-    for (int i = HIGHEST_PRIORITY; i >= target->priority; i--)
+    if (pgid <= 0)
     {
-        if (readyLists[i].size > 0)
+        return NULL;
+    }
+
+    for (int i = 0; i < MAX_PROCESSES; i++)
+    {
+        if (processGroups[i].pgid == pgid)
         {
-            return false;
+            return &processGroups[i];
         }
     }
 
-    return true;
+    return NULL;
 }
 
 /**************************************************************************
-   Name - getHighestPriorityProcess
+   Name - joinGroup
 
-   Purpose - Each priority Queue is searched for the highest priority Process,
-        pops it from its Queue, and returns it.
+   Purpose - Adds the target Process to the front of the group pgid,
+        creating the group if it does not exist yet.
 
-   Parameters - none
+   Parameters - target, a pointer to a Process that is in no group
+                pgid, the process group id
 
-   Returns - Null if there are no Processes (which is an error), otherwise
-        returns a pointer to the highest priority Process
+   Returns - none
    *************************************************************************/
-static Process* getHighestPriorityProcess()
+static void joinGroup(Process* target, int pgid)
 {
-    for (int i = HIGHEST_PRIORITY; i >= 0; i--)
+    ProcessGroup* pGroup = getGroup(pgid);
+
+    if (pGroup == NULL)
     {
-        if (readyLists[i].size > 0)
+        for (int i = 0; i < MAX_PROCESSES && pGroup == NULL; i++)
         {
-            return pop(&readyLists[i]);
+            if (processGroups[i].pgid == 0)
+            {
+                pGroup = &processGroups[i];
+            }
         }
+
+        pGroup->pgid = pgid;
+        pGroup->head = NULL;
+        pGroup->size = 0;
     }
 
-    return NULL; // This line should never run!
+    target->pgid = pgid;
+    target->pGroup = pGroup;
+    target->prevGroupMember = NULL;
+    target->nextGroupMember = pGroup->head;
+    if (pGroup->head != NULL)
+    {
+        pGroup->head->prevGroupMember = target;
+    }
+    pGroup->head = target;
+    pGroup->size++;
 }
 
 /**************************************************************************
-   Name - cleanUpChild
+   Name - leaveGroup
 
-   Purpose - This helper function is called by a parent Process to clean up
-        and remove a child Process pointed to by target. All pointers to
-        it from other Processes cleared or changed, and the child is
-        removed from the Process table.
+   Purpose - Removes the target Process from its group. The group is freed
+        once its last member leaves.
 
    Parameters - target, a pointer to a Process
 
    Returns - none
    *************************************************************************/
-static void cleanUpChild(Process* target)
+static void leaveGroup(Process* target)
 {
-    Process blankProcess;
+    ProcessGroup* pGroup = target->pGroup;
 
-    // Remove from parent, if it is the head of the children list
-    if (runningProcess->pChildren->pid == target->pid)
+    if (pGroup == NULL)
     {
-        runningProcess->pChildren = target->nextSiblingProcess;
+        return;
+    }
+
+    if (target->prevGroupMember != NULL)
+    {
+        target->prevGroupMember->nextGroupMember = target->nextGroupMember;
     }
-    // Remove from sibling chain if it isn't
     else
     {
-        Process* child = runningProcess->pChildren;
-
-        while (child->nextSiblingProcess->pid != target->pid);
-        {
-            child = child->nextSiblingProcess;
-        }
-
-        child->nextSiblingProcess = target->nextSiblingProcess;
+        pGroup->head = target->nextGroupMember;
+    }
+    if (target->nextGroupMember != NULL)
+    {
+        target->nextGroupMember->prevGroupMember = target->prevGroupMember;
     }
 
-    // Clear child from the process table
-    for (int i = 0; i < MAX_PROCESSES; i++)
+    target->nextGroupMember = NULL;
+    target->prevGroupMember = NULL;
+    target->pGroup = NULL;
+
+    if (--pGroup->size == 0)
     {
-        if (processTable[i].pid == target->pid)
-        {
-            blankProcess.pid = 0;
-            processTable[i] = blankProcess;
-        }
+        pGroup->pgid = 0;
     }
-}
\ No newline at end of file
+}
@@ -0,0 +1,198 @@
+#include <stdio.h>
+#include "THREADSLib.h"
+#include "SchedulerTesting.h"
+#include "Scheduler.h"
+#include "Messaging.h"
+
+#define MESSAGE_COUNT   2000
+#define FAN_COUNT       4
+#define MAILBOX_SLOTS   10
+
+typedef struct
+{
+    DWORD   sendTime;   // read_clock() when the message was sent
+    int     sequence;
+} BenchMessage;
+
+int Producer(char* strArgs);
+int Consumer(char* strArgs);
+int ShortReceiver(char* strArgs);
+int WaitingSender(char* strArgs);
+static void TestShortBuffers(char* testName);
+static void RunPattern(char* testName, char* pattern, int producers, int consumers);
+
+int gMailbox;
+int gMessagesPerProducer;
+int gMessagesPerConsumer;
+unsigned long gTotalLatency;
+int gMessagesReceived;
+
+/*********************************************************************************
+*
+* SchedulerTest32
+*
+* Benchmarks the mailboxes by passing MESSAGE_COUNT messages through a single
+* mailbox in three patterns:
+*    1:1  one producer, one consumer
+*    N:1  FAN_COUNT producers, one consumer
+*    1:N  one producer, FAN_COUNT consumers
+*
+* Each message carries the time it was sent so the consumers can measure the
+* send-to-receive latency. The throughput and average latency are reported
+* for each pattern.
+*
+* First, a message handed to a blocked receiver whose buffer is too small, or
+* taken by a receiver too small for a blocked sender's message, must fail the
+* receive without losing the message.
+*
+*********************************************************************************/
+int SchedulerEntryPoint(void* pArgs)
+{
+    char* testName = "SchedulerTest32";
+
+    console_output(FALSE, "\n%s: started\n", testName);
+
+    TestShortBuffers(testName);
+
+    RunPattern(testName, "1:1", 1, 1);
+    RunPattern(testName, "N:1", FAN_COUNT, 1);
+    RunPattern(testName, "1:N", 1, FAN_COUNT);
+
+    k_exit(0);
+
+    return 0;
+}
+
+static void TestShortBuffers(char* testName)
+{
+    char message[16] = "sixteen bytes..";
+    char buffer[sizeof(message)];
+    int status;
+    int result;
+
+    // The receiver blocks while this process sleeps, so the send hands the message to it
+    gMailbox = k_mailbox_create(1, sizeof(message));
+    k_spawn("ShortReceiver", ShortReceiver, "ShortReceiver", THREADS_MIN_STACK_SIZE, 4);
+    k_sleep(20);
+    result = k_mailbox_send(gMailbox, message, sizeof(message));
+    k_wait(&status);
+    console_output(FALSE, "%s: send to a short receiver returned %d, receiving again returned %d\n", testName,
+        result, k_mailbox_receive(gMailbox, buffer, sizeof(buffer)));
+    k_mailbox_release(gMailbox);
+
+    // With no slots the sender stays blocked until a receiver can take its message
+    gMailbox = k_mailbox_create(0, sizeof(message));
+    k_spawn("WaitingSender", WaitingSender, message, THREADS_MIN_STACK_SIZE, 4);
+    k_sleep(20);
+    result = k_mailbox_receive(gMailbox, buffer, 4);
+    console_output(FALSE, "%s: short receive from a blocked sender returned %d, then %d\n", testName,
+        result, k_mailbox_receive(gMailbox, buffer, sizeof(buffer)));
+    k_wait(&status);
+    k_mailbox_release(gMailbox);
+}
+
+int ShortReceiver(char* strArgs)
+{
+    char buffer[4];
+
+    console_output(FALSE, "%s: receive returned %d\n", strArgs, k_mailbox_receive(gMailbox, buffer, sizeof(buffer)));
+
+    k_exit(0);
+
+    return 0;
+}
+
+int WaitingSender(char* strArgs)
+{
+    console_output(FALSE, "WaitingSender: send returned %d\n", k_mailbox_send(gMailbox, strArgs, 16));
+
+    k_exit(0);
+
+    return 0;
+}
+
+static void RunPattern(char* testName, char* pattern, int producers, int consumers)
+{
+    int status = -1, kidpid = -1;
+    char nameBuffer[512];
+    DWORD startTime, elapsed;
+
+    gMailbox = k_mailbox_create(MAILBOX_SLOTS, sizeof(BenchMessage));
+    gMessagesPerProducer = MESSAGE_COUNT / producers;
+    gMessagesPerConsumer = MESSAGE_COUNT / consumers;
+    gTotalLatency = 0;
+    gMessagesReceived = 0;
+
+    console_output(FALSE, "%s: %s pattern using mailbox %d\n", testName, pattern, gMailbox);
+
+    startTime = read_clock();
+    for (int i = 1; i <= consumers; i++)
+    {
+        snprintf(nameBuffer, sizeof(nameBuffer), "%s-Consumer%d", testName, i);
+        k_spawn(nameBuffer, Consumer, nameBuffer, THREADS_MIN_STACK_SIZE, 3);
+    }
+    for (int i = 1; i <= producers; i++)
+    {
+        snprintf(nameBuffer, sizeof(nameBuffer), "%s-Producer%d", testName, i);
+        k_spawn(nameBuffer, Producer, nameBuffer, THREADS_MIN_STACK_SIZE, 3);
+    }
+
+    for (int i = 0; i < producers + consumers; i++)
+    {
+        kidpid = k_wait(&status);
+        if (status != 0)
+        {
+            console_output(FALSE, "%s: child %d failed with status %d\n", testName, kidpid, status);
+        }
+    }
+    elapsed = read_clock() - startTime;
+
+    console_output(FALSE, "%s: %s received %d messages in %lu us, %lu messages/sec, average latency %lu us\n",
+        testName, pattern, gMessagesReceived, (unsigned long)elapsed,
+        elapsed > 0 ? (unsigned long)((unsigned long long)gMessagesReceived * 1000000 / elapsed) : 0,
+        gMessagesReceived > 0 ? gTotalLatency / gMessagesReceived : 0);
+
+    k_mailbox_release(gMailbox);
+}
+
+int Producer(char* strArgs)
+{
+    BenchMessage message;
+
+    for (int i = 0; i < gMessagesPerProducer; i++)
+    {
+        message.sequence = i;
+        message.sendTime = read_clock();
+        if (k_mailbox_send(gMailbox, &message, sizeof(message)) != 0)
+        {
+            console_output(FALSE, "%s: send failed\n", strArgs);
+            k_exit(1);
+        }
+    }
+
+    k_exit(0);
+
+    return 0;
+}
+
+int Consumer(char* strArgs)
+{
+    BenchMessage message;
+    int result;
+
+    for (int i = 0; i < gMessagesPerConsumer; i++)
+    {
+        result = k_mailbox_receive(gMailbox, &message, sizeof(message));
+        if (result != sizeof(message))
+        {
+            console_output(FALSE, "%s: receive returned %d\n", strArgs, result);
+            k_exit(1);
+        }
+        gTotalLatency += read_clock() - message.sendTime;
+        gMessagesReceived++;
+    }
+
+    k_exit(0);
+
+    return 0;
+}
@@ -0,0 +1,162 @@
+#include <stdio.h>
+#include "THREADSLib.h"
+#include "SchedulerTesting.h"
+#include "Scheduler.h"
+#include "Synchronization.h"
+
+#define UNCONTENDED_COUNT   20000
+#define CONTENDED_COUNT     2000
+#define WORKER_COUNT        4
+
+int FutexWorker(char* strArgs);
+int MutexWorker(char* strArgs);
+static void FutexLock(volatile LONG* pLock);
+static void FutexUnlock(volatile LONG* pLock);
+static void RunWorkers(char* testName, char* label, int(*worker)(char*));
+
+volatile LONG gFutexLock = 0;   // 0 = unlocked, 1 = locked, 2 = locked with waiters
+int gMutex;
+int gCounter;
+int gSystemCalls;
+
+/*********************************************************************************
+*
+* SchedulerTest33
+*
+* Compares a mutex built on k_futex_wait/k_futex_wake against the kernel mutex.
+*
+* The futex mutex only enters the kernel when the lock is contended, so the
+* uncontended run should make no system calls at all, while every kernel mutex
+* lock and unlock is a system call. The contended run has WORKER_COUNT processes
+* incrementing a shared counter under each lock and checks the final count.
+*
+*********************************************************************************/
+int SchedulerEntryPoint(void* pArgs)
+{
+    char* testName = "SchedulerTest33";
+    DWORD startTime, elapsed;
+
+    console_output(FALSE, "\n%s: started\n", testName);
+
+    gMutex = k_mutex_create();
+
+    gSystemCalls = 0;
+    startTime = read_clock();
+    for (int i = 0; i < UNCONTENDED_COUNT; i++)
+    {
+        FutexLock(&gFutexLock);
+        FutexUnlock(&gFutexLock);
+    }
+    elapsed = read_clock() - startTime;
+    console_output(FALSE, "%s: uncontended futex mutex: %d lock/unlock pairs in %lu us, %d system calls\n",
+        testName, UNCONTENDED_COUNT, (unsigned long)elapsed, gSystemCalls);
+
+    gSystemCalls = 0;
+    startTime = read_clock();
+    for (int i = 0; i < UNCONTENDED_COUNT; i++)
+    {
+        k_mutex_lock(gMutex);
+        k_mutex_unlock(gMutex);
+        gSystemCalls += 2;
+    }
+    elapsed = read_clock() - startTime;
+    console_output(FALSE, "%s: uncontended kernel mutex: %d lock/unlock pairs in %lu us, %d system calls\n",
+        testName, UNCONTENDED_COUNT, (unsigned long)elapsed, gSystemCalls);
+
+    RunWorkers(testName, "futex mutex", FutexWorker);
+    RunWorkers(testName, "kernel mutex", MutexWorker);
+
+    k_mutex_release(gMutex);
+    k_exit(0);
+
+    return 0;
+}
+
+static void RunWorkers(char* testName, char* label, int(*worker)(char*))
+{
+    int status = -1;
+    char nameBuffer[512];
+    DWORD startTime, elapsed;
+
+    gCounter = 0;
+    gSystemCalls = 0;
+
+    startTime = read_clock();
+    for (int i = 1; i <= WORKER_COUNT; i++)
+    {
+        snprintf(nameBuffer, sizeof(nameBuffer), "%s-Child%d", testName, i);
+        k_spawn(nameBuffer, worker, nameBuffer, THREADS_MIN_STACK_SIZE, 3);
+    }
+    for (int i = 1; i <= WORKER_COUNT; i++)
+    {
+        k_wait(&status);
+    }
+    elapsed = read_clock() - startTime;
+
+    console_output(FALSE, "%s: contended %s: counter = %d (expected %d) in %lu us, %d system calls\n",
+        testName, label, gCounter, WORKER_COUNT * CONTENDED_COUNT, (unsigned long)elapsed, gSystemCalls);
+}
+
+int FutexWorker(char* strArgs)
+{
+    for (int i = 0; i < CONTENDED_COUNT; i++)
+    {
+        FutexLock(&gFutexLock);
+        gCounter++;
+        FutexUnlock(&gFutexLock);
+    }
+
+    k_exit(0);
+    return 0;
+}
+
+int MutexWorker(char* strArgs)
+{
+    for (int i = 0; i < CONTENDED_COUNT; i++)
+    {
+        k_mutex_lock(gMutex);
+        gCounter++;
+        k_mutex_unlock(gMutex);
+        gSystemCalls += 2;
+    }
+
+    k_exit(0);
+    return 0;
+}
+
+/*
+*  FutexLock - takes the lock with a single compare-exchange when it is free
+*              and only calls into the kernel to wait when it is not.
+*/
+static void FutexLock(volatile LONG* pLock)
+{
+    LONG value = InterlockedCompareExchange(pLock, 1, 0);
+
+    if (value != 0)
+    {
+        if (value != 2)
+        {
+            value = InterlockedExchange(pLock, 2);
+        }
+        while (value != 0)
+        {
+            gSystemCalls++;
+            k_futex_wait((volatile int*)pLock, 2);
+            value = InterlockedExchange(pLock, 2);
+        }
+    }
+}
+
+/*
+*  FutexUnlock - releases the lock and only calls into the kernel when
+*                another process marked it as having waiters.
+*/
+static void FutexUnlock(volatile LONG* pLock)
+{
+    if (InterlockedDecrement(pLock) != 0)
+    {
+        *pLock = 0;
+        gSystemCalls++;
+        k_futex_wake((volatile int*)pLock, 1);
+    }
+}
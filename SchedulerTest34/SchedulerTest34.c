@@ -0,0 +1,52 @@
+#include <stdio.h>
+#include "THREADSLib.h"
+#include "SchedulerTesting.h"
+#include "Scheduler.h"
+
+/*********************************************************************************
+*
+* SchedulerTest34
+*
+* Sleep based variant of SchedulerTest05:
+*    spawn four children
+*    each child sleeps with k_sleep instead of a busy wait and then exits
+*    child with a name that ends in a number divisible by 4 dumps the process table
+*
+* A loop of this logic is repeated 3 times. The children are blocked while they
+* sleep, so they should report close to zero CPU time and each loop should take
+* about as long as a single child's delay rather than four of them.
+*
+*********************************************************************************/
+int SchedulerEntryPoint(void* pArgs)
+{
+    int status = -1, kidpid = -1;
+    int i, j;
+    char nameBuffer[1028];
+    char* testName = "SchedulerTest34";
+    int count = 1;
+    DWORD startTime;
+
+    console_output(FALSE, "\n%s: started\n", testName);
+    for (j = 0; j < 3; j++)
+    {
+        startTime = read_clock();
+        for (i = 2; i < 6; i++)
+        {
+            snprintf(nameBuffer, sizeof(nameBuffer), "%s-Child%d", testName, count++);
+            kidpid = k_spawn(nameBuffer, SleepAndDump, nameBuffer, THREADS_MIN_STACK_SIZE, 3);
+            console_output(FALSE, "%s: after spawn of child with pid %d\n", testName, kidpid);
+        }
+
+        for (i = 2; i < 6; i++)
+        {
+            kidpid = k_wait(&status);
+            console_output(FALSE, "%s: exit status for child %d is %d\n",
+                testName, kidpid, status);
+        }
+        console_output(FALSE, "%s: loop %d took %lu ms\n", testName, j + 1,
+            (unsigned long)((read_clock() - startTime) / 1000));
+    }
+    k_exit(0);
+
+    return 0;
+}
@@ -0,0 +1,73 @@
+#include <stdio.h>
+#include "THREADSLib.h"
+#include "SchedulerTesting.h"
+#include "Scheduler.h"
+
+#define TIMEOUT_MS  100
+
+int StuckProcess(char* strArgs);
+static void ReportTimeout(char* testName, char* function, int result, DWORD startTime);
+
+/*********************************************************************************
+*
+* SchedulerTest35
+*
+* Tests the timed variants of k_wait, k_join and block against a child that
+* blocks until it is unblocked. Each call should return TIMED_OUT after about
+* TIMEOUT_MS, and the time each one actually took is reported. The child is
+* then unblocked and waited for normally.
+*
+*********************************************************************************/
+int SchedulerEntryPoint(void* pArgs)
+{
+    int status = -1, kidpid = -1, result;
+    char* testName = "SchedulerTest35";
+    char nameBuffer[512];
+    DWORD startTime;
+
+    console_output(FALSE, "\n%s: started\n", testName);
+
+    snprintf(nameBuffer, sizeof(nameBuffer), "%s-Child1", testName);
+    kidpid = k_spawn(nameBuffer, StuckProcess, nameBuffer, THREADS_MIN_STACK_SIZE, 3);
+    console_output(FALSE, "%s: after spawn of child with pid %d\n", testName, kidpid);
+
+    startTime = read_clock();
+    result = k_wait_timeout(&status, TIMEOUT_MS);
+    ReportTimeout(testName, "k_wait_timeout", result, startTime);
+
+    startTime = read_clock();
+    result = k_join_timeout(kidpid, &status, TIMEOUT_MS);
+    ReportTimeout(testName, "k_join_timeout", result, startTime);
+
+    startTime = read_clock();
+    result = block_timeout(20, TIMEOUT_MS);
+    ReportTimeout(testName, "block_timeout", result, startTime);
+
+    console_output(FALSE, "%s: unblocking child %d\n", testName, kidpid);
+    unblock(kidpid);
+
+    kidpid = k_wait_timeout(&status, TIMEOUT_MS);
+    console_output(FALSE, "%s: exit status for child %d is %d\n", testName, kidpid, status);
+
+    k_exit(0);
+
+    return 0;
+}
+
+static void ReportTimeout(char* testName, char* function, int result, DWORD startTime)
+{
+    console_output(FALSE, "%s: %s returned %d (%s) after %lu ms\n", testName, function, result,
+        result == TIMED_OUT ? "timed out" : "did not time out",
+        (unsigned long)((read_clock() - startTime) / 1000));
+}
+
+int StuckProcess(char* strArgs)
+{
+    console_output(FALSE, "%s: started, blocking until unblocked\n", strArgs);
+    block(20);
+    console_output(FALSE, "%s: unblocked\n", strArgs);
+
+    k_exit(-3);
+
+    return 0;
+}
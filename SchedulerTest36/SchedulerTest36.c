@@ -0,0 +1,186 @@
+#include <stdio.h>
+#include "THREADSLib.h"
+#include "SchedulerTesting.h"
+#include "Scheduler.h"
+#include "Messaging.h"
+#include "Synchronization.h"
+
+int BlockTarget(char* strArgs);
+int SleepTarget(char* strArgs);
+int ReceiveTarget(char* strArgs);
+int FutexTarget(char* strArgs);
+int WaitTarget(char* strArgs);
+int JoinTarget(char* strArgs);
+int MaskedTarget(char* strArgs);
+int ConsumedTarget(char* strArgs);
+static void SignalTarget(char* testName, char* label, int(*target)(char*), int signal);
+static void ReportWake(char* strArgs, int result);
+
+DWORD gSignalTime;
+int gMailbox;
+int gParentPid;
+volatile int gFutexValue = 0;
+
+#define SIG_OTHER           10
+
+/*********************************************************************************
+*
+* SchedulerTest36
+*
+* Sends SIG_TERM to processes blocked in block, k_sleep, a mailbox receive,
+* k_futex_wait, k_wait and k_join. Each one should be woken right away with a
+* return of -5, and reports the time from k_kill to running again.
+*
+* A last child masks SIG_TERM with k_sigmask, so its sleep is not interrupted
+* and the signal only shows up in signaled() once it is unmasked.
+*
+* SIG_TERM stays pending until the process exits. Another signal is consumed
+* by the block it interrupts, so a child woken by signal SIG_OTHER can sleep
+* again undisturbed.
+*
+*********************************************************************************/
+int SchedulerEntryPoint(void* pArgs)
+{
+    char* testName = "SchedulerTest36";
+
+    console_output(FALSE, "\n%s: started\n", testName);
+
+    gParentPid = k_getpid();
+    gMailbox = k_mailbox_create(1, sizeof(int));
+
+    SignalTarget(testName, "block", BlockTarget, SIG_TERM);
+    SignalTarget(testName, "k_sleep", SleepTarget, SIG_TERM);
+    SignalTarget(testName, "k_mailbox_receive", ReceiveTarget, SIG_TERM);
+    SignalTarget(testName, "k_futex_wait", FutexTarget, SIG_TERM);
+    SignalTarget(testName, "k_wait", WaitTarget, SIG_TERM);
+    SignalTarget(testName, "k_join", JoinTarget, SIG_TERM);
+    SignalTarget(testName, "masked k_sleep", MaskedTarget, SIG_TERM);
+    SignalTarget(testName, "consumed k_sleep", ConsumedTarget, SIG_OTHER);
+
+    k_mailbox_release(gMailbox);
+    k_exit(0);
+
+    return 0;
+}
+
+static void SignalTarget(char* testName, char* label, int(*target)(char*), int signal)
+{
+    int status = -1, kidpid;
+    char nameBuffer[512];
+
+    snprintf(nameBuffer, sizeof(nameBuffer), "%s-%s", testName, label);
+    kidpid = k_spawn(nameBuffer, target, nameBuffer, THREADS_MIN_STACK_SIZE, 4);
+
+    // Let the child run until it blocks
+    k_sleep(20);
+
+    console_output(FALSE, "%s: signaling child %d blocked in %s\n", testName, kidpid, label);
+    gSignalTime = read_clock();
+    k_kill(kidpid, signal);
+
+    kidpid = k_wait(&status);
+    console_output(FALSE, "%s: exit status for child %d is %d\n", testName, kidpid, status);
+}
+
+static void ReportWake(char* strArgs, int result)
+{
+    console_output(FALSE, "%s: returned %d, signaled() = %d, signal-to-wake latency %lu us\n",
+        strArgs, result, signaled() != 0, (unsigned long)(read_clock() - gSignalTime));
+}
+
+int BlockTarget(char* strArgs)
+{
+    int result = block(20);
+
+    ReportWake(strArgs, result);
+    k_exit(result);
+    return 0;
+}
+
+int SleepTarget(char* strArgs)
+{
+    int result = k_sleep(10000);
+
+    ReportWake(strArgs, result);
+    k_exit(result);
+    return 0;
+}
+
+int ReceiveTarget(char* strArgs)
+{
+    int message;
+    int result = k_mailbox_receive(gMailbox, &message, sizeof(message));
+
+    ReportWake(strArgs, result);
+    k_exit(result);
+    return 0;
+}
+
+int FutexTarget(char* strArgs)
+{
+    int result = k_futex_wait(&gFutexValue, 0);
+
+    ReportWake(strArgs, result);
+    k_exit(result);
+    return 0;
+}
+
+int ShortSleep(char* strArgs)
+{
+    k_sleep(100);
+    k_exit(1);
+    return 0;
+}
+
+int WaitTarget(char* strArgs)
+{
+    int status;
+    char nameBuffer[512];
+    int result;
+
+    snprintf(nameBuffer, sizeof(nameBuffer), "%s-Child1", strArgs);
+    k_spawn(nameBuffer, ShortSleep, nameBuffer, THREADS_MIN_STACK_SIZE, 4);
+    result = k_wait(&status);
+
+    ReportWake(strArgs, result);
+
+    // Exiting while signaled waits for the sleeping child to quit first
+    k_exit(result);
+    return 0;
+}
+
+int JoinTarget(char* strArgs)
+{
+    int exitCode;
+    int result = k_join(gParentPid, &exitCode);
+
+    ReportWake(strArgs, result);
+    k_exit(result);
+    return 0;
+}
+
+int MaskedTarget(char* strArgs)
+{
+    int result;
+
+    k_sigmask(SIGNAL_BIT(SIG_TERM));
+    result = k_sleep(100);
+    console_output(FALSE, "%s: masked sleep returned %d, signaled() = %d\n", strArgs, result, signaled() != 0);
+
+    k_sigmask(0);
+    console_output(FALSE, "%s: after unmasking, signaled() = %d\n", strArgs, signaled() != 0);
+
+    k_exit(result);
+    return 0;
+}
+
+int ConsumedTarget(char* strArgs)
+{
+    int result = k_sleep(10000);
+
+    ReportWake(strArgs, result);
+    console_output(FALSE, "%s: sleeping again returned %d\n", strArgs, k_sleep(10));
+
+    k_exit(result);
+    return 0;
+}
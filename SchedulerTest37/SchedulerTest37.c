@@ -0,0 +1,148 @@
+#include <stdio.h>
+#include "THREADSLib.h"
+#include "SchedulerTesting.h"
+#include "Scheduler.h"
+
+#define GROUP_WORKERS       40
+#define GROUP_SIZE          (GROUP_WORKERS + 1)     // The workers and their leader
+#define TOTAL_MEMBERS       1000
+#define ROUNDS              ((TOTAL_MEMBERS + GROUP_SIZE - 1) / GROUP_SIZE)
+
+int GroupLeader(char* strArgs);
+int GroupWorker(char* strArgs);
+static int CancelGroup(char* testName, int useKillpg, unsigned long* pSignalTime);
+
+int gPids[GROUP_SIZE];
+int gReady;
+
+/*********************************************************************************
+*
+* SchedulerTest37
+*
+* Benchmarks cancelling a whole process group.
+*
+* Each round spawns a leader that moves itself into a new process group and
+* spawns GROUP_WORKERS workers, which inherit the group through k_spawn and
+* sleep. The group is then cancelled either with a single k_killpg or with a
+* k_kill per member, and the time to signal the group and the time until
+* k_waitpg has reaped the leader (and so the whole group) are reported.
+*
+* The process table only holds MAX_PROCESSES processes, so the TOTAL_MEMBERS
+* members are cancelled over ROUNDS rounds of GROUP_SIZE members each.
+*
+*********************************************************************************/
+int SchedulerEntryPoint(void* pArgs)
+{
+    char* testName = "SchedulerTest37";
+    unsigned long signalTime, cancelTime;
+
+    console_output(FALSE, "\n%s: started\n", testName);
+
+    for (int useKillpg = 1; useKillpg >= 0; useKillpg--)
+    {
+        signalTime = 0;
+        cancelTime = 0;
+        for (int round = 0; round < ROUNDS; round++)
+        {
+            unsigned long roundSignalTime;
+
+            cancelTime += CancelGroup(testName, useKillpg, &roundSignalTime);
+            signalTime += roundSignalTime;
+        }
+
+        console_output(FALSE, "%s: %s cancelled %d members in %lu us, %lu us to signal, %lu ns per member\n",
+            testName, useKillpg ? "k_killpg" : "k_kill per member", ROUNDS * GROUP_SIZE, cancelTime,
+            signalTime, (unsigned long)((unsigned long long)cancelTime * 1000 / (ROUNDS * GROUP_SIZE)));
+    }
+
+    k_exit(0);
+
+    return 0;
+}
+
+/*
+*  CancelGroup - builds one group, cancels it and returns the microseconds
+*                from the first signal until the leader has been reaped.
+*/
+static int CancelGroup(char* testName, int useKillpg, unsigned long* pSignalTime)
+{
+    int status = -1, kidpid, leaderPid, pgid, signaled;
+    char nameBuffer[512];
+    DWORD startTime;
+    int elapsed;
+
+    gReady = FALSE;
+    snprintf(nameBuffer, sizeof(nameBuffer), "%s-Leader", testName);
+    leaderPid = k_spawn(nameBuffer, GroupLeader, nameBuffer, THREADS_MIN_STACK_SIZE, 2);
+
+    while (!gReady)
+    {
+        k_sleep(1);
+    }
+
+    pgid = k_getpgid(leaderPid);
+    if (pgid != leaderPid || k_getpgid(gPids[GROUP_WORKERS]) != pgid || pgid == k_getpgid(0))
+    {
+        console_output(FALSE, "%s: group %d was not inherited\n", testName, pgid);
+    }
+
+    startTime = read_clock();
+    if (useKillpg)
+    {
+        signaled = k_killpg(pgid, SIG_TERM);
+    }
+    else
+    {
+        signaled = 0;
+        for (int i = 0; i < GROUP_SIZE; i++)
+        {
+            signaled += k_kill(gPids[i], SIG_TERM) == 0;
+        }
+    }
+    *pSignalTime = read_clock() - startTime;
+
+    kidpid = k_waitpg(pgid, &status);
+    elapsed = (int)(read_clock() - startTime);
+
+    if (signaled != GROUP_SIZE || kidpid != leaderPid || k_waitpg(pgid, &status) != -1)
+    {
+        console_output(FALSE, "%s: signaled %d of %d members, k_waitpg returned %d\n",
+            testName, signaled, GROUP_SIZE, kidpid);
+    }
+
+    return elapsed;
+}
+
+int GroupLeader(char* strArgs)
+{
+    char nameBuffer[512];
+    int status;
+
+    k_setpgid(0, 0);
+    gPids[0] = k_getpid();
+
+    for (int i = 1; i <= GROUP_WORKERS; i++)
+    {
+        snprintf(nameBuffer, sizeof(nameBuffer), "%s-Worker%d", strArgs, i);
+        gPids[i] = k_spawn(nameBuffer, GroupWorker, nameBuffer, THREADS_MIN_STACK_SIZE, 3);
+    }
+    gReady = TRUE;
+
+    // Interrupted by the signal, k_exit then reaps the rest of the group
+    while (k_waitpg(k_getpgid(0), &status) > 0)
+    {
+    }
+
+    k_exit(1);
+
+    return 0;
+}
+
+int GroupWorker(char* strArgs)
+{
+    k_sleep(60000);
+
+    k_exit(1);
+
+    return 0;
+}
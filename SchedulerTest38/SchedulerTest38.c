@@ -0,0 +1,114 @@
+#include <stdio.h>
+#include "THREADSLib.h"
+#include "SchedulerTesting.h"
+#include "Scheduler.h"
+#include "SystemCalls.h"
+
+#define CALL_COUNT      20000
+#define MESSAGE_COUNT   1000
+
+int UserProcess(char* strArgs);
+int UserChild(char* strArgs);
+
+int gMailbox;
+
+/*********************************************************************************
+*
+* SchedulerTest38
+*
+* Tests the system call layer and measures its overhead.
+*
+* The startup process runs in kernel mode and times CALL_COUNT direct k_getpid
+* calls against the same number of sys_getpid system calls. It then uses
+* sys_spawn to start a user process, which checks that it is running without
+* PSR_KERNEL_MODE, makes system calls of its own, passes MESSAGE_COUNT messages
+* to a user child through a mailbox and returns from its entry point, which
+* exits it through the exit system call.
+*
+* The per call counters are displayed at the end.
+*
+*********************************************************************************/
+int SchedulerEntryPoint(void* pArgs)
+{
+    char* testName = "SchedulerTest38";
+    char nameBuffer[512];
+    int status = -1, kidpid;
+    DWORD startTime, directTime, systemCallTime;
+
+    console_output(FALSE, "\n%s: started\n", testName);
+
+    reset_system_call_stats();
+
+    startTime = read_clock();
+    for (int i = 0; i < CALL_COUNT; i++)
+    {
+        k_getpid();
+    }
+    directTime = read_clock() - startTime;
+
+    startTime = read_clock();
+    for (int i = 0; i < CALL_COUNT; i++)
+    {
+        sys_getpid();
+    }
+    systemCallTime = read_clock() - startTime;
+
+    console_output(FALSE, "%s: %d k_getpid calls in %lu us, %d sys_getpid calls in %lu us\n",
+        testName, CALL_COUNT, (unsigned long)directTime, CALL_COUNT, (unsigned long)systemCallTime);
+
+    snprintf(nameBuffer, sizeof(nameBuffer), "%s-User", testName);
+    kidpid = sys_spawn(nameBuffer, UserProcess, nameBuffer, THREADS_MIN_STACK_SIZE, 3);
+    console_output(FALSE, "%s: spawned user process %d\n", testName, kidpid);
+
+    kidpid = k_wait(&status);
+    console_output(FALSE, "%s: user process %d quit with status %d\n", testName, kidpid, status);
+
+    display_system_call_stats();
+
+    k_exit(0);
+
+    return 0;
+}
+
+int UserProcess(char* strArgs)
+{
+    char nameBuffer[512];
+    int status = -1, kidpid, total = 0;
+
+    console_output(FALSE, "%s: running in %s mode as process %d\n", strArgs,
+        (get_psr() & PSR_KERNEL_MODE) ? "kernel" : "user", sys_getpid());
+
+    gMailbox = sys_mailbox_create(10, sizeof(int));
+
+    snprintf(nameBuffer, sizeof(nameBuffer), "%s-Child", strArgs);
+    sys_spawn(nameBuffer, UserChild, nameBuffer, THREADS_MIN_STACK_SIZE, 3);
+
+    for (int i = 0; i < MESSAGE_COUNT; i++)
+    {
+        sys_mailbox_send(gMailbox, &i, sizeof(i));
+        total += i;
+    }
+
+    kidpid = sys_wait(&status);
+    console_output(FALSE, "%s: child %d quit with status %d, expected %d\n", strArgs, kidpid, status, total & 0xff);
+
+    sys_mailbox_release(gMailbox);
+
+    return 7;
+}
+
+int UserChild(char* strArgs)
+{
+    int message, total = 0;
+
+    for (int i = 0; i < MESSAGE_COUNT; i++)
+    {
+        sys_mailbox_receive(gMailbox, &message, sizeof(message));
+        total += message;
+    }
+
+    console_output(FALSE, "%s: running in %s mode, received %d messages\n", strArgs,
+        (get_psr() & PSR_KERNEL_MODE) ? "kernel" : "user", MESSAGE_COUNT);
+
+    return total & 0xff;
+}
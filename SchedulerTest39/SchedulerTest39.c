@@ -0,0 +1,175 @@
+#include <stdio.h>
+#include "THREADSLib.h"
+#include "SchedulerTesting.h"
+#include "Scheduler.h"
+#include "SystemCalls.h"
+
+#define OPERATION_COUNT     20000
+
+int RingUser(char* strArgs);
+static void RunSingle(char* name, int callId);
+static void RunBatched(char* name, system_call_ring_t* pRing, int callId, int batchSize);
+static system_call_sqe_t* PrepareOperation(system_call_sqe_t* pSubmission, int callId, int sequence);
+
+int gMailbox;
+int gPid;
+
+/*********************************************************************************
+*
+* SchedulerTest39
+*
+* Benchmarks the system call rings against single system calls.
+*
+* A user process makes OPERATION_COUNT getpid calls, then OPERATION_COUNT
+* conditional mailbox send/receive pairs, first as single system calls and then
+* queued on its submission ring in batches of 1, 8 and 32 with one
+* sys_ring_submit per batch. Completions are reaped from the completion ring
+* without a system call and checked. The amortized time per operation is
+* reported for each run.
+*
+* It also checks that submissions that are only queued are run the next time
+* the process makes any other system call.
+*
+*********************************************************************************/
+int SchedulerEntryPoint(void* pArgs)
+{
+    char* testName = "SchedulerTest39";
+    char nameBuffer[512];
+    int status = -1;
+
+    console_output(FALSE, "\n%s: started\n", testName);
+
+    snprintf(nameBuffer, sizeof(nameBuffer), "%s-User", testName);
+    sys_spawn(nameBuffer, RingUser, nameBuffer, THREADS_MIN_STACK_SIZE, 3);
+    k_wait(&status);
+
+    display_system_call_stats();
+
+    k_exit(0);
+
+    return 0;
+}
+
+int RingUser(char* strArgs)
+{
+    system_call_ring_t* pRing;
+    system_call_cqe_t completion;
+    int reaped = 0;
+
+    gPid = sys_getpid();
+    gMailbox = sys_mailbox_create(64, sizeof(int));
+    pRing = sys_ring_setup();
+
+    RunSingle("getpid", SYS_GETPID);
+    RunBatched("getpid", pRing, SYS_GETPID, 1);
+    RunBatched("getpid", pRing, SYS_GETPID, 8);
+    RunBatched("getpid", pRing, SYS_GETPID, 32);
+
+    RunSingle("mailbox", SYS_MBOX_SEND);
+    RunBatched("mailbox", pRing, SYS_MBOX_SEND, 1);
+    RunBatched("mailbox", pRing, SYS_MBOX_SEND, 8);
+    RunBatched("mailbox", pRing, SYS_MBOX_SEND, 32);
+
+    // Queued without entering the kernel, then picked up by an unrelated call
+    for (int i = 0; i < 4; i++)
+    {
+        PrepareOperation(sys_ring_get_sqe(pRing), SYS_GETPID, i);
+    }
+    sys_ring_queue(pRing);
+    sys_sleep(0);
+    while (sys_ring_reap(pRing, &completion))
+    {
+        reaped += completion.result == gPid;
+    }
+    console_output(FALSE, "%s: %d of 4 queued calls completed by the next system call\n", strArgs, reaped);
+
+    sys_mailbox_release(gMailbox);
+
+    return 0;
+}
+
+static void RunSingle(char* name, int callId)
+{
+    int message;
+    DWORD startTime, elapsed;
+
+    startTime = read_clock();
+    for (int i = 0; i < OPERATION_COUNT; i++)
+    {
+        if (callId == SYS_GETPID)
+        {
+            sys_getpid();
+        }
+        else
+        {
+            sys_mailbox_send_cond(gMailbox, &i, sizeof(i));
+            sys_mailbox_receive_cond(gMailbox, &message, sizeof(message));
+        }
+    }
+    elapsed = read_clock() - startTime;
+
+    console_output(FALSE, "SchedulerTest39: %-8s single calls:      %lu ns per operation\n",
+        name, (unsigned long)((unsigned long long)elapsed * 1000 / OPERATION_COUNT));
+}
+
+static void RunBatched(char* name, system_call_ring_t* pRing, int callId, int batchSize)
+{
+    system_call_cqe_t completion;
+    DWORD startTime, elapsed;
+    int errors = 0;
+    int message;
+
+    startTime = read_clock();
+    for (int i = 0; i < OPERATION_COUNT; i += batchSize)
+    {
+        for (int j = 0; j < batchSize; j++)
+        {
+            if (callId == SYS_GETPID)
+            {
+                PrepareOperation(sys_ring_get_sqe(pRing), SYS_GETPID, i + j);
+            }
+            else
+            {
+                PrepareOperation(sys_ring_get_sqe(pRing), SYS_MBOX_SEND, i + j);
+                PrepareOperation(sys_ring_get_sqe(pRing), SYS_MBOX_RECEIVE, i + j)->arg[1] = (intptr_t)&message;
+            }
+        }
+
+        sys_ring_submit(pRing);
+
+        while (sys_ring_reap(pRing, &completion))
+        {
+            if ((callId == SYS_GETPID && completion.result != gPid) || completion.result < 0)
+            {
+                errors++;
+            }
+        }
+    }
+    elapsed = read_clock() - startTime;
+
+    console_output(FALSE, "SchedulerTest39: %-8s batches of %2d:     %lu ns per operation, %d errors\n",
+        name, batchSize, (unsigned long)((unsigned long long)elapsed * 1000 / OPERATION_COUNT), errors);
+}
+
+/*
+*  PrepareOperation - fills in a submission, a conditional send of the
+*                     sequence number for the mailbox calls.
+*/
+static system_call_sqe_t* PrepareOperation(system_call_sqe_t* pSubmission, int callId, int sequence)
+{
+    static int messages[SYS_RING_ENTRIES];
+    int* pMessage = &messages[sequence & (SYS_RING_ENTRIES - 1)];
+
+    pSubmission->call_id = callId;
+    pSubmission->userData = sequence;
+    if (callId != SYS_GETPID)
+    {
+        *pMessage = sequence;
+        pSubmission->arg[0] = gMailbox;
+        pSubmission->arg[1] = (intptr_t)pMessage;
+        pSubmission->arg[2] = sizeof(int);
+        pSubmission->arg[3] = FALSE;
+    }
+
+    return pSubmission;
+}
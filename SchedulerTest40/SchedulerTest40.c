@@ -0,0 +1,139 @@
+#include <stdio.h>
+#include <string.h>
+#include "THREADSLib.h"
+#include "SchedulerTesting.h"
+#include "Scheduler.h"
+#include "Disk.h"
+
+#define READERS             8
+#define READS_PER_READER    50
+#define TEST_UNIT           0
+
+int DiskReader(char* strArgs);
+static void CheckTransfer(char* testName);
+static void RunPolicy(char* testName, int policy, char* policyName);
+
+int gTracks, gPlatters;
+
+/*********************************************************************************
+*
+* SchedulerTest40
+*
+* Tests the disk driver and benchmarks its request scheduling.
+*
+* A transfer that crosses a track boundary is written and read back first. Then
+* READERS processes each read READS_PER_READER single sectors from tracks picked
+* by a fixed pseudo random sequence, once with every disk scheduling policy.
+* Every reader makes the same requests under each policy, so the difference in
+* seek distance and elapsed time is down to the order the disk served them in.
+*
+*********************************************************************************/
+int SchedulerEntryPoint(void* pArgs)
+{
+    char* testName = "SchedulerTest40";
+
+    console_output(FALSE, "\n%s: started\n", testName);
+
+    if (k_disk_info(TEST_UNIT, &gPlatters, &gTracks) != 0)
+    {
+        console_output(FALSE, "%s: disk %d is not available\n", testName, TEST_UNIT);
+        k_exit(1);
+    }
+    console_output(FALSE, "%s: disk %d has %d platters of %d tracks\n", testName, TEST_UNIT, gPlatters, gTracks);
+
+    CheckTransfer(testName);
+
+    RunPolicy(testName, DISK_SCHED_FIFO, "FIFO");
+    RunPolicy(testName, DISK_SCHED_SCAN, "SCAN");
+    RunPolicy(testName, DISK_SCHED_CLOOK, "C-LOOK");
+
+    k_exit(0);
+
+    return 0;
+}
+
+/*
+*  CheckTransfer - writes four sectors across the end of a track, reads them
+*                  back and compares them. Also checks an invalid request.
+*/
+static void CheckTransfer(char* testName)
+{
+    static char written[4 * THREADS_DISK_SECTOR_SIZE];
+    static char read[4 * THREADS_DISK_SECTOR_SIZE];
+    int writeResult, readResult;
+
+    for (int i = 0; i < (int)sizeof(written); i++)
+    {
+        written[i] = (char)(i * 7 + i / THREADS_DISK_SECTOR_SIZE);
+    }
+
+    writeResult = k_disk_write(TEST_UNIT, 1, 5, THREADS_DISK_SECTOR_COUNT - 2, 4, written);
+    readResult = k_disk_read(TEST_UNIT, 1, 5, THREADS_DISK_SECTOR_COUNT - 2, 4, read);
+
+    console_output(FALSE, "%s: write returned %d, read returned %d, data %s\n", testName, writeResult, readResult,
+        memcmp(written, read, sizeof(read)) == 0 ? "matches" : "does not match");
+
+    console_output(FALSE, "%s: read past the last track returned %d\n", testName,
+        k_disk_read(TEST_UNIT, 0, gTracks - 1, THREADS_DISK_SECTOR_COUNT - 1, 2, read));
+}
+
+/*
+*  RunPolicy - runs the readers with the disk using policy and reports the
+*              seek distance and throughput.
+*/
+static void RunPolicy(char* testName, int policy, char* policyName)
+{
+    char nameBuffer[READERS][512];
+    disk_stats_t stats;
+    DWORD startTime, elapsed;
+    int status;
+
+    disk_set_scheduler(TEST_UNIT, policy);
+    reset_disk_stats(TEST_UNIT);
+
+    startTime = read_clock();
+    for (int i = 0; i < READERS; i++)
+    {
+        snprintf(nameBuffer[i], sizeof(nameBuffer[i]), "%s-Reader%d", testName, i);
+        k_spawn(nameBuffer[i], DiskReader, nameBuffer[i], THREADS_MIN_STACK_SIZE, 3);
+    }
+    for (int i = 0; i < READERS; i++)
+    {
+        k_wait(&status);
+    }
+    elapsed = read_clock() - startTime;
+
+    get_disk_stats(TEST_UNIT, &stats);
+    console_output(FALSE, "%s: %-6s %u requests, %u seeks, %llu tracks moved (%llu per request), %lu us average wait\n",
+        testName, policyName, stats.requests, stats.seeks, stats.tracksMoved,
+        stats.tracksMoved / (stats.requests ? stats.requests : 1),
+        (unsigned long)(stats.waitTime / (stats.requests ? stats.requests : 1)));
+    console_output(FALSE, "%s: %-6s %u sectors in %lu us, %lu sectors per second\n", testName, policyName,
+        stats.sectors, (unsigned long)elapsed,
+        (unsigned long)((unsigned long long)stats.sectors * 1000000 / (elapsed ? elapsed : 1)));
+}
+
+int DiskReader(char* strArgs)
+{
+    char buffer[THREADS_DISK_SECTOR_SIZE];
+    unsigned int seed = 0;
+
+    for (char* p = strArgs; *p != '\0'; p++)
+    {
+        seed = seed * 31 + (unsigned char)*p;
+    }
+
+    for (int i = 0; i < READS_PER_READER; i++)
+    {
+        seed = seed * 1103515245 + 12345;
+        if (k_disk_read(TEST_UNIT, (seed >> 8) % gPlatters, (seed >> 16) % gTracks, (seed >> 4) % THREADS_DISK_SECTOR_COUNT,
+            1, buffer) != 0)
+        {
+            console_output(FALSE, "%s: read %d failed\n", strArgs, i);
+        }
+    }
+
+    k_exit(0);
+
+    return 0;
+}
@@ -0,0 +1,219 @@
+#include <stdio.h>
+#include <string.h>
+#include "THREADSLib.h"
+#include "SchedulerTesting.h"
+#include "Scheduler.h"
+#include "Disk.h"
+#include "BufferCache.h"
+
+#define TEST_UNIT           0
+#define READERS             8
+#define SHARED_SECTORS      32
+#define HOT_SECTORS         128
+#define SCAN_SECTORS        1024
+#define ROUNDS              8
+#define FILL_SECTORS        16      // Sectors the writer of the fill test writes at once
+
+int SharedReader(char* strArgs);
+int ColdReader(char* strArgs);
+int FillWriter(char* strArgs);
+int FillReader(char* strArgs);
+static void RunPolicy(char* testName, int policy, char* policyName);
+static void ReadSectors(int platter, int first, int count);
+static void ReadWhileFilling(char* testName);
+
+int gTracks;
+static char gFill[FILL_SECTORS * THREADS_DISK_SECTOR_SIZE];
+
+/*********************************************************************************
+*
+* SchedulerTest41
+*
+* Tests the buffer cache.
+*
+* READERS processes first read the same SHARED_SECTORS sectors at the same time
+* with the cache cold, which should cost one disk read per sector with the other
+* readers coalescing onto it, and then read them again without going to the disk.
+*
+* The scan resistance of the replacement policy is then measured by reading a
+* set of HOT_SECTORS sectors between sequential scans of SCAN_SECTORS sectors that
+* are not read again until long after they have left the cache, first with LRU and then with 2Q. The scans fill the whole
+* cache, so LRU loses the hot set every round while 2Q keeps it.
+*
+* Finally, with read ahead off, a reader starts a disk read of a sector and a
+* writer writes it and the FILL_SECTORS - 1 sectors after it. The writer waits
+* for the read with the buffers of the other sectors pinned before it has
+* filled them. A reader of one of those sectors must wait for the writer and
+* get its data, not fail.
+*
+*********************************************************************************/
+int SchedulerEntryPoint(void* pArgs)
+{
+    char* testName = "SchedulerTest41";
+    char nameBuffer[READERS][512];
+    cache_stats_t stats;
+    disk_stats_t diskStats;
+    int status;
+
+    console_output(FALSE, "\n%s: started\n", testName);
+
+    k_disk_info(TEST_UNIT, NULL, &gTracks);
+    reset_cache_stats();
+    reset_disk_stats(TEST_UNIT);
+
+    for (int pass = 0; pass < 2; pass++)
+    {
+        for (int i = 0; i < READERS; i++)
+        {
+            snprintf(nameBuffer[i], sizeof(nameBuffer[i]), "%s-Reader%d", testName, i);
+            k_spawn(nameBuffer[i], SharedReader, nameBuffer[i], THREADS_MIN_STACK_SIZE, 3);
+        }
+        for (int i = 0; i < READERS; i++)
+        {
+            k_wait(&status);
+        }
+
+        get_cache_stats(&stats);
+        get_disk_stats(TEST_UNIT, &diskStats);
+        console_output(FALSE, "%s: pass %d, %u reads, %u hits, %u coalesced, %u disk reads\n", testName, pass + 1,
+            stats.reads, stats.hits, stats.coalesced, diskStats.sectors);
+        reset_cache_stats();
+        reset_disk_stats(TEST_UNIT);
+    }
+
+    RunPolicy(testName, CACHE_POLICY_LRU, "LRU");
+    RunPolicy(testName, CACHE_POLICY_2Q, "2Q");
+
+    ReadWhileFilling(testName);
+
+    display_cache_stats();
+
+    k_exit(0);
+
+    return 0;
+}
+
+/*
+*  RunPolicy - reads the hot set between scans with policy and reports how
+*              many of the hot reads hit.
+*/
+static void RunPolicy(char* testName, int policy, char* policyName)
+{
+    cache_stats_t before, after;
+    unsigned int hotReads = 0, hotHits = 0;
+    int scanSector = 0;
+    DWORD startTime = read_clock();
+
+    cache_set_policy(policy);
+    reset_cache_stats();
+
+    for (int round = 0; round < ROUNDS; round++)
+    {
+        get_cache_stats(&before);
+        ReadSectors(0, 0, HOT_SECTORS);
+        get_cache_stats(&after);
+        hotReads += after.reads - before.reads;
+        hotHits += after.hits - before.hits;
+
+        // The scans run over the other two platters, so a sector is only read again two scans later
+        ReadSectors(1 + scanSector / (gTracks * THREADS_DISK_SECTOR_COUNT) % 2,
+            scanSector % (gTracks * THREADS_DISK_SECTOR_COUNT), SCAN_SECTORS);
+        scanSector += SCAN_SECTORS;
+    }
+
+    get_cache_stats(&after);
+    console_output(FALSE, "%s: %-3s %u of %u hot reads hit, %u misses, %u evictions, %lu us\n", testName, policyName,
+        hotHits, hotReads, after.misses, after.evictions, (unsigned long)(read_clock() - startTime));
+}
+
+/*
+*  ReadSectors - reads count sectors of platter through the cache, starting
+*                at sector first counted from the start of the platter.
+*/
+static void ReadSectors(int platter, int first, int count)
+{
+    static char buffer[THREADS_DISK_SECTOR_COUNT * THREADS_DISK_SECTOR_SIZE];
+
+    for (int sector = first; sector < first + count; sector += THREADS_DISK_SECTOR_COUNT)
+    {
+        if (k_cache_read(TEST_UNIT, platter, sector / THREADS_DISK_SECTOR_COUNT, sector % THREADS_DISK_SECTOR_COUNT,
+            THREADS_DISK_SECTOR_COUNT, buffer) != 0)
+        {
+            console_output(FALSE, "ReadSectors(): read of sector %d failed\n", sector);
+        }
+    }
+}
+
+/*
+*  ReadWhileFilling - has a reader find the buffer of a sector a writer has
+*                     pinned on a miss but not yet filled.
+*/
+static void ReadWhileFilling(char* testName)
+{
+    int readAhead = cache_set_read_ahead(FALSE);
+    int status;
+
+    for (int i = 0; i < sizeof(gFill); i++)
+    {
+        gFill[i] = (char)(i * 7 + 1);
+    }
+
+    // Each child runs once the one before it has blocked
+    k_spawn("ColdReader", ColdReader, "ColdReader", THREADS_MIN_STACK_SIZE, 4);
+    k_spawn("FillWriter", FillWriter, "FillWriter", THREADS_MIN_STACK_SIZE, 3);
+    k_spawn("FillReader", FillReader, "FillReader", THREADS_MIN_STACK_SIZE, 2);
+    for (int i = 0; i < 3; i++)
+    {
+        k_wait(&status);
+    }
+
+    cache_set_read_ahead(readAhead);
+}
+
+int ColdReader(char* strArgs)
+{
+    char buffer[THREADS_DISK_SECTOR_SIZE];
+
+    console_output(FALSE, "%s: read returned %d\n", strArgs, k_cache_read(TEST_UNIT, 0, gTracks - 1, 0, 1, buffer));
+
+    k_exit(0);
+
+    return 0;
+}
+
+int FillWriter(char* strArgs)
+{
+    console_output(FALSE, "%s: write returned %d\n", strArgs,
+        k_cache_write(TEST_UNIT, 0, gTracks - 1, 0, FILL_SECTORS, gFill));
+
+    k_exit(0);
+
+    return 0;
+}
+
+int FillReader(char* strArgs)
+{
+    char buffer[THREADS_DISK_SECTOR_SIZE];
+    int result = k_cache_read(TEST_UNIT, 0, gTracks - 1, FILL_SECTORS / 2, 1, buffer);
+
+    console_output(FALSE, "%s: read returned %d, data %s the writer's\n", strArgs, result,
+        memcmp(buffer, gFill + FILL_SECTORS / 2 * THREADS_DISK_SECTOR_SIZE, sizeof(buffer)) == 0 ? "is" : "is not");
+
+    k_exit(0);
+
+    return 0;
+}
+
+int SharedReader(char* strArgs)
+{
+    char buffer[SHARED_SECTORS * THREADS_DISK_SECTOR_SIZE];
+
+    if (k_cache_read(TEST_UNIT, 2, gTracks / 2, 0, SHARED_SECTORS, buffer) != 0)
+    {
+        console_output(FALSE, "%s: read failed\n", strArgs);
+    }
+
+    k_exit(0);
+
+    return 0;
+}
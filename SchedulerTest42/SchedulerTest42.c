@@ -0,0 +1,171 @@
+#include <stdio.h>
+#include <string.h>
+#include "THREADSLib.h"
+#include "SchedulerTesting.h"
+#include "Scheduler.h"
+#include "Disk.h"
+#include "BufferCache.h"
+
+#define TEST_UNIT           0
+#define SCAN_TRACKS         32
+#define READ_SECTORS        4       // Sectors per read of the scan
+#define WORK_US             500     // Time spent working on each read
+#define BURST_TRACKS        16
+
+static void ScanRaw(char* testName);
+static void ScanCached(char* testName, int readAhead);
+static void WriteBurst(char* testName);
+static void Work(int microseconds);
+
+static char gTrack[THREADS_DISK_SECTOR_COUNT * THREADS_DISK_SECTOR_SIZE];
+static char gBurst[BURST_TRACKS][THREADS_DISK_SECTOR_COUNT * THREADS_DISK_SECTOR_SIZE];
+
+/*********************************************************************************
+*
+* SchedulerTest42
+*
+* Tests read ahead and write back in the buffer cache.
+*
+* The disk's track bandwidth is measured by reading SCAN_TRACKS whole tracks
+* directly. The same tracks are then scanned through the cache READ_SECTORS at a
+* time, working for WORK_US after each read, without and with read ahead. With
+* read ahead the next track arrives while the scan works on the current one, so
+* the scan should run close to the track bandwidth.
+*
+* Finally BURST_TRACKS tracks are written, first directly and then through the
+* cache, whose writes should not wait for the disk. After k_cache_sync the data
+* is read back directly from the disk to check the flusher wrote it.
+*
+*********************************************************************************/
+int SchedulerEntryPoint(void* pArgs)
+{
+    char* testName = "SchedulerTest42";
+
+    console_output(FALSE, "\n%s: started\n", testName);
+
+    ScanRaw(testName);
+    ScanCached(testName, FALSE);
+    ScanCached(testName, TRUE);
+
+    WriteBurst(testName);
+
+    display_cache_stats();
+
+    k_exit(0);
+
+    return 0;
+}
+
+/*
+*  ScanRaw - reads the tracks straight from the disk, a whole track at a time.
+*/
+static void ScanRaw(char* testName)
+{
+    DWORD startTime = read_clock(), elapsed;
+
+    for (int track = 0; track < SCAN_TRACKS; track++)
+    {
+        k_disk_read(TEST_UNIT, 0, track, 0, THREADS_DISK_SECTOR_COUNT, gTrack);
+    }
+    elapsed = read_clock() - startTime;
+
+    console_output(FALSE, "%s: track bandwidth %lu sectors per second\n", testName,
+        (unsigned long)((unsigned long long)SCAN_TRACKS * THREADS_DISK_SECTOR_COUNT * 1000000 / elapsed));
+}
+
+/*
+*  ScanCached - scans the tracks through the cache, working on each read.
+*/
+static void ScanCached(char* testName, int readAhead)
+{
+    cache_stats_t stats;
+    DWORD startTime, elapsed;
+
+    cache_set_read_ahead(readAhead);
+    cache_set_policy(CACHE_POLICY_2Q);      // Starts the cache cold
+    reset_cache_stats();
+
+    startTime = read_clock();
+    for (int sector = 0; sector < SCAN_TRACKS * THREADS_DISK_SECTOR_COUNT; sector += READ_SECTORS)
+    {
+        k_cache_read(TEST_UNIT, 0, sector / THREADS_DISK_SECTOR_COUNT, sector % THREADS_DISK_SECTOR_COUNT,
+            READ_SECTORS, gTrack);
+        Work(WORK_US);
+    }
+    elapsed = read_clock() - startTime;
+
+    get_cache_stats(&stats);
+    console_output(FALSE, "%s: scan with read ahead %s, %lu sectors per second, %u misses, %u read ahead hits\n",
+        testName, readAhead ? "on" : "off",
+        (unsigned long)((unsigned long long)SCAN_TRACKS * THREADS_DISK_SECTOR_COUNT * 1000000 / elapsed),
+        stats.misses, stats.readAheadHits);
+}
+
+/*
+*  WriteBurst - writes the burst directly and then through the cache, and
+*               checks the cached writes reached the disk.
+*/
+static void WriteBurst(char* testName)
+{
+    DWORD startTime, directTime, cachedTime, syncTime;
+    int matches = 0;
+
+    for (int pass = 0; pass < 2; pass++)
+    {
+        for (int track = 0; track < BURST_TRACKS; track++)
+        {
+            for (int i = 0; i < (int)sizeof(gBurst[track]); i++)
+            {
+                gBurst[track][i] = (char)(track * 3 + i + pass);
+            }
+        }
+
+        startTime = read_clock();
+        for (int track = 0; track < BURST_TRACKS; track++)
+        {
+            if (pass == 0)
+            {
+                k_disk_write(TEST_UNIT, 1, track * 2, 0, THREADS_DISK_SECTOR_COUNT, gBurst[track]);
+            }
+            else
+            {
+                k_cache_write(TEST_UNIT, 1, track * 2, 0, THREADS_DISK_SECTOR_COUNT, gBurst[track]);
+            }
+        }
+        if (pass == 0)
+        {
+            directTime = read_clock() - startTime;
+        }
+        else
+        {
+            cachedTime = read_clock() - startTime;
+        }
+    }
+
+    startTime = read_clock();
+    k_cache_sync();
+    syncTime = read_clock() - startTime;
+
+    for (int track = 0; track < BURST_TRACKS; track++)
+    {
+        k_disk_read(TEST_UNIT, 1, track * 2, 0, THREADS_DISK_SECTOR_COUNT, gTrack);
+        matches += memcmp(gTrack, gBurst[track], sizeof(gTrack)) == 0;
+    }
+
+    console_output(FALSE, "%s: burst of %d sectors, %lu us direct, %lu us through the cache, %lu us to sync\n",
+        testName, BURST_TRACKS * THREADS_DISK_SECTOR_COUNT, (unsigned long)directTime, (unsigned long)cachedTime,
+        (unsigned long)syncTime);
+    console_output(FALSE, "%s: %d of %d tracks on the disk match after the sync\n", testName, matches, BURST_TRACKS);
+}
+
+/*
+*  Work - keeps the CPU busy for a number of microseconds.
+*/
+static void Work(int microseconds)
+{
+    DWORD startTime = read_clock();
+
+    while (read_clock() - startTime < (DWORD)microseconds)
+    {
+    }
+}
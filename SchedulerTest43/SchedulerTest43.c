@@ -0,0 +1,158 @@
+#include <stdio.h>
+#include <string.h>
+#include "THREADSLib.h"
+#include "SchedulerTesting.h"
+#include "Scheduler.h"
+#include "SystemCalls.h"
+#include "Terminal.h"
+
+#define OUTPUT_UNIT         0
+#define INPUT_UNIT          1
+#define WRITE_LINES         25      // Lines of TERM_LINE_MAX characters written by each writer
+
+int Reader(char* strArgs);
+int CharWriter(char* strArgs);
+int LineWriter(char* strArgs);
+static void RunWriter(char* testName, char* writerName, int (*entryPoint)(char*));
+static void FormatLine(char* pLine, int number);
+
+/*********************************************************************************
+*
+* SchedulerTest43
+*
+* Tests the terminal driver.
+*
+* The input of terminal 1 is written with lines that exercise the line
+* discipline: a carriage return before the newline, an erased character, a
+* killed line, a line too long for TERM_LINE_MAX that is broken in two, and a
+* last line the input ends in the middle of. A user process reads it back a line
+* at a time with sys_term_read until the end of the input.
+*
+* Then WRITE_LINES lines are written to terminal 0 by a user process making one
+* sys_term_write per character, and again by one making one sys_term_write per
+* line. The kernel flushes the terminal after each and reports the system calls
+* each writer made, how often it blocked on a full output ring, and how long it
+* took to queue its output.
+*
+*********************************************************************************/
+int SchedulerEntryPoint(void* pArgs)
+{
+    char* testName = "SchedulerTest43";
+    char nameBuffer[512];
+    FILE* pInput;
+    int status = -1;
+    int i;
+
+    console_output(FALSE, "\n%s: started\n", testName);
+
+    pInput = fopen("terminal1_input.txt", "w");
+    if (pInput == NULL)
+    {
+        console_output(FALSE, "%s: could not create terminal1_input.txt\n", testName);
+        k_exit(1);
+    }
+    fputs("hello, terminal\r\n", pInput);
+    fputs("abx\bc\n", pInput);
+    fputs("never read\x15kept\n", pInput);
+    for (i = 0; i < TERM_LINE_MAX + 20; i++)
+    {
+        fputc('x', pInput);
+    }
+    fputs("\nno newline at the end", pInput);
+    fclose(pInput);
+
+    snprintf(nameBuffer, sizeof(nameBuffer), "%s-Reader", testName);
+    sys_spawn(nameBuffer, Reader, nameBuffer, THREADS_MIN_STACK_SIZE, 3);
+    k_wait(&status);
+
+    RunWriter(testName, "CharWriter", CharWriter);
+    RunWriter(testName, "LineWriter", LineWriter);
+
+    k_exit(0);
+
+    return 0;
+}
+
+int Reader(char* strArgs)
+{
+    char line[128];
+    int length;
+
+    while ((length = sys_term_read(INPUT_UNIT, line, sizeof(line) - 1)) > 0)
+    {
+        line[length] = '\0';
+        if (line[length - 1] == '\n')
+        {
+            line[length - 1] = '\0';
+        }
+        console_output(FALSE, "%s: read %2d characters: '%s'\n", strArgs, length, line);
+    }
+    console_output(FALSE, "%s: end of input, sys_term_read returned %d\n", strArgs, length);
+
+    return 0;
+}
+
+int CharWriter(char* strArgs)
+{
+    char line[TERM_LINE_MAX + 1];
+
+    for (int i = 0; i < WRITE_LINES; i++)
+    {
+        FormatLine(line, i);
+        for (int j = 0; j < TERM_LINE_MAX; j++)
+        {
+            sys_term_write(OUTPUT_UNIT, &line[j], 1);
+        }
+    }
+
+    return 0;
+}
+
+int LineWriter(char* strArgs)
+{
+    char line[TERM_LINE_MAX + 1];
+
+    for (int i = 0; i < WRITE_LINES; i++)
+    {
+        FormatLine(line, i);
+        sys_term_write(OUTPUT_UNIT, line, TERM_LINE_MAX);
+    }
+
+    return 0;
+}
+
+static void RunWriter(char* testName, char* writerName, int (*entryPoint)(char*))
+{
+    char nameBuffer[512];
+    system_call_stats_t callStats;
+    terminal_stats_t stats;
+    DWORD startTime, queued;
+    int status = -1;
+
+    reset_terminal_stats(OUTPUT_UNIT);
+    reset_system_call_stats();
+
+    snprintf(nameBuffer, sizeof(nameBuffer), "%s-%s", testName, writerName);
+    startTime = read_clock();
+    sys_spawn(nameBuffer, entryPoint, nameBuffer, THREADS_MIN_STACK_SIZE, 3);
+    k_wait(&status);
+    queued = read_clock() - startTime;
+
+    k_term_flush(OUTPUT_UNIT);
+
+    get_system_call_stats(SYS_TERM_WRITE, &callStats);
+    get_terminal_stats(OUTPUT_UNIT, &stats);
+    console_output(FALSE, "%s: %-10s %5u system calls, %3u blocks, %4u of %d characters written, queued in %lu us\n",
+        testName, writerName, callStats.calls, stats.writerBlocks, stats.charsOut, WRITE_LINES * TERM_LINE_MAX,
+        (unsigned long)queued);
+}
+
+/* Fills pLine with TERM_LINE_MAX characters, the last a newline. */
+static void FormatLine(char* pLine, int number)
+{
+    memset(pLine, '.', TERM_LINE_MAX);
+    snprintf(pLine, TERM_LINE_MAX, "line %02d ", number);
+    pLine[strlen(pLine)] = '.';
+    pLine[TERM_LINE_MAX - 1] = '\n';
+    pLine[TERM_LINE_MAX] = '\0';
+}
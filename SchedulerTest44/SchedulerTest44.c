@@ -0,0 +1,118 @@
+#include <stdio.h>
+#include <string.h>
+#include "THREADSLib.h"
+#include "SchedulerTesting.h"
+#include "Scheduler.h"
+#include "Disk.h"
+#include "Terminal.h"
+#include "Devices.h"
+
+#define DISK_READERS        3
+#define TERM_UNIT           2
+
+int DiskReader(char* strArgs);
+int TermReader(char* strArgs);
+static void ShowDevice(char* testName, char* name);
+
+/*********************************************************************************
+*
+* SchedulerTest44
+*
+* Tests the kernel's I/O accounting.
+*
+* DISK_READERS processes read tracks far apart on disk 0 and one process reads a
+* line from terminal 2, all at a higher priority than the test. They block on
+* their devices at once, so when the test runs again it shows the commands in
+* flight and the processes waiting on each device. With every other process
+* blocked the watchdog must keep waiting for the I/O rather than report a
+* deadlock. Once they are all done and the test has read the terminal to the
+* end of its input, every device should have completed every command it was
+* issued and have nothing left in flight.
+*
+*********************************************************************************/
+int SchedulerEntryPoint(void* pArgs)
+{
+    char* testName = "SchedulerTest44";
+    char nameBuffer[DISK_READERS + 1][512];
+    FILE* pInput;
+    char line[TERM_LINE_MAX];
+    int status;
+
+    console_output(FALSE, "\n%s: started\n", testName);
+
+    pInput = fopen("terminal2_input.txt", "w");
+    if (pInput != NULL)
+    {
+        fputs("a line for the reader\n", pInput);
+        fclose(pInput);
+    }
+
+    // Wait for the disk's geometry, so the readers block on their reads
+    k_disk_info(0, NULL, NULL);
+
+    for (int i = 0; i < DISK_READERS; i++)
+    {
+        snprintf(nameBuffer[i], sizeof(nameBuffer[i]), "%s-DiskReader%d", testName, i);
+        k_spawn(nameBuffer[i], DiskReader, nameBuffer[i], THREADS_MIN_STACK_SIZE, 5);
+    }
+    snprintf(nameBuffer[DISK_READERS], sizeof(nameBuffer[DISK_READERS]), "%s-TermReader", testName);
+    k_spawn(nameBuffer[DISK_READERS], TermReader, nameBuffer[DISK_READERS], THREADS_MIN_STACK_SIZE, 5);
+
+    console_output(FALSE, "%s: all readers blocked\n", testName);
+    ShowDevice(testName, "disk0");
+    ShowDevice(testName, "term2");
+
+    for (int i = 0; i <= DISK_READERS; i++)
+    {
+        k_wait(&status);
+    }
+
+    // The driver reads ahead of the reader until the input ends
+    while (k_term_read(TERM_UNIT, line, sizeof(line)) > 0)
+    {
+    }
+
+    console_output(FALSE, "%s: all readers done\n", testName);
+    display_device_stats();
+
+    k_exit(0);
+
+    return 0;
+}
+
+int DiskReader(char* strArgs)
+{
+    char buffer[THREADS_DISK_SECTOR_SIZE];
+    int reader = strArgs[strlen(strArgs) - 1] - '0';
+
+    if (k_disk_read(0, 0, 20 * reader + 10, 0, 1, buffer) != 0)
+    {
+        console_output(FALSE, "%s: read failed\n", strArgs);
+    }
+
+    k_exit(0);
+
+    return 0;
+}
+
+int TermReader(char* strArgs)
+{
+    char line[TERM_LINE_MAX + 1];
+    int length;
+
+    length = k_term_read(TERM_UNIT, line, TERM_LINE_MAX);
+    console_output(FALSE, "%s: read %d characters\n", strArgs, length);
+
+    k_exit(0);
+
+    return 0;
+}
+
+static void ShowDevice(char* testName, char* name)
+{
+    device_stats_t stats;
+
+    get_device_stats(name, &stats);
+    console_output(FALSE, "%s: %s has %d commands in flight and %d processes waiting\n",
+        testName, name, stats.inFlight, stats.waiting);
+}
@@ -0,0 +1,242 @@
+#include <stdio.h>
+#include <string.h>
+#include "THREADSLib.h"
+#include "SchedulerTesting.h"
+#include "Scheduler.h"
+#include "SystemCalls.h"
+#include "Disk.h"
+#include "BufferCache.h"
+#include "FileSystem.h"
+
+#define FS_UNIT             1
+#define SMALL_FILES         50
+#define SMALL_SIZE          1000    // Bytes in each small file, not a whole number of blocks
+#define STREAM_SIZE         (512 * 1024)
+#define CHUNK_SIZE          (8 * 1024)
+#define SHARED_SIZE         (96 * 1024)  // Bytes each of two writers writes at the same time
+
+int UserFiles(char* strArgs);
+int SharedWriter(char* strArgs);
+static void SmallFiles(char* testName);
+static void Streaming(char* testName);
+static void SharedWriters(char* testName);
+static void StartMeasure(void);
+static void EndMeasure(char* testName, char* what, unsigned long long bytes);
+static void FillPattern(char* pData, int size, int seed);
+
+static char gChunk[CHUNK_SIZE];
+static char gCheck[CHUNK_SIZE];
+static DWORD gStartTime;
+
+/*********************************************************************************
+*
+* SchedulerTest45
+*
+* Tests and benchmarks the file system.
+*
+* Disk 1 is formatted and a user process checks that a file written with the
+* file system calls reads back the same after it is closed and reopened.
+*
+* The small file workload creates, writes and closes SMALL_FILES files of
+* SMALL_SIZE bytes, then reads them all back, then removes them. The streaming
+* workload writes a file of STREAM_SIZE bytes CHUNK_SIZE bytes at a time and
+* reads it back. Before every read phase the cache is synced and emptied so the
+* data comes from the disk. Each phase reports its throughput and the DISK_SEEKs
+* it cost, and the streaming file should be a single extent.
+*
+* Finally two processes write SHARED_SIZE bytes each to their own file at the
+* same time, to show how many extents files written together end up in.
+*
+*********************************************************************************/
+int SchedulerEntryPoint(void* pArgs)
+{
+    char* testName = "SchedulerTest45";
+    char nameBuffer[512];
+    int status;
+
+    console_output(FALSE, "\n%s: started\n", testName);
+
+    status = fs_format(FS_UNIT);
+    console_output(FALSE, "%s: fs_format returned %d\n", testName, status);
+    if (status != 0)
+    {
+        k_exit(1);
+    }
+
+    snprintf(nameBuffer, sizeof(nameBuffer), "%s-User", testName);
+    sys_spawn(nameBuffer, UserFiles, nameBuffer, THREADS_MIN_STACK_SIZE, 3);
+    k_wait(&status);
+
+    SmallFiles(testName);
+    Streaming(testName);
+    SharedWriters(testName);
+
+    k_exit(0);
+
+    return 0;
+}
+
+int UserFiles(char* strArgs)
+{
+    static char message[] = "written through the file system calls";
+    char buffer[64];
+    int fd, written, length;
+
+    fd = sys_open("user.txt", FS_WRITE | FS_CREATE);
+    written = sys_write(fd, message, sizeof(message));
+    sys_close(fd);
+
+    fd = sys_open("user.txt", FS_READ);
+    length = sys_read(fd, buffer, sizeof(buffer));
+    console_output(FALSE, "%s: wrote %d bytes, read back %d bytes, %s, %d at the end of the file\n", strArgs,
+        written, length, length == sizeof(message) && memcmp(buffer, message, length) == 0 ? "same" : "different",
+        sys_read(fd, buffer, sizeof(buffer)));
+    sys_close(fd);
+
+    console_output(FALSE, "%s: opening a missing file returned %d, reading a closed descriptor returned %d\n",
+        strArgs, sys_open("missing.txt", FS_READ), sys_read(fd, buffer, sizeof(buffer)));
+
+    return 0;
+}
+
+static void SmallFiles(char* testName)
+{
+    char name[FS_NAME_MAX];
+    int errors = 0;
+    int fd;
+
+    StartMeasure();
+    for (int i = 0; i < SMALL_FILES; i++)
+    {
+        snprintf(name, sizeof(name), "small%03d", i);
+        FillPattern(gChunk, SMALL_SIZE, i);
+        fd = k_open(name, FS_WRITE | FS_CREATE);
+        errors += k_write(fd, gChunk, SMALL_SIZE) != SMALL_SIZE;
+        errors += k_close(fd) != 0;
+    }
+    k_cache_sync();
+    EndMeasure(testName, "small file create", (unsigned long long)SMALL_FILES * SMALL_SIZE);
+
+    cache_set_policy(CACHE_POLICY_2Q);
+    StartMeasure();
+    for (int i = 0; i < SMALL_FILES; i++)
+    {
+        snprintf(name, sizeof(name), "small%03d", i);
+        FillPattern(gChunk, SMALL_SIZE, i);
+        fd = k_open(name, FS_READ);
+        errors += k_read(fd, gCheck, CHUNK_SIZE) != SMALL_SIZE || memcmp(gChunk, gCheck, SMALL_SIZE) != 0;
+        errors += k_close(fd) != 0;
+    }
+    EndMeasure(testName, "small file read", (unsigned long long)SMALL_FILES * SMALL_SIZE);
+
+    for (int i = 0; i < SMALL_FILES; i++)
+    {
+        snprintf(name, sizeof(name), "small%03d", i);
+        errors += k_unlink(name) != 0;
+    }
+    k_cache_sync();
+
+    console_output(FALSE, "%s: %d small file errors\n", testName, errors);
+}
+
+static void Streaming(char* testName)
+{
+    fs_file_info_t info;
+    int errors = 0;
+    int fd;
+
+    StartMeasure();
+    fd = k_open("stream", FS_WRITE | FS_CREATE | FS_TRUNCATE);
+    for (int offset = 0; offset < STREAM_SIZE; offset += CHUNK_SIZE)
+    {
+        FillPattern(gChunk, CHUNK_SIZE, offset);
+        errors += k_write(fd, gChunk, CHUNK_SIZE) != CHUNK_SIZE;
+    }
+    k_close(fd);
+    k_cache_sync();
+    EndMeasure(testName, "streaming write", STREAM_SIZE);
+
+    cache_set_policy(CACHE_POLICY_2Q);
+    StartMeasure();
+    fd = k_open("stream", FS_READ);
+    for (int offset = 0; offset < STREAM_SIZE; offset += CHUNK_SIZE)
+    {
+        FillPattern(gChunk, CHUNK_SIZE, offset);
+        errors += k_read(fd, gCheck, CHUNK_SIZE) != CHUNK_SIZE || memcmp(gChunk, gCheck, CHUNK_SIZE) != 0;
+    }
+    k_close(fd);
+    EndMeasure(testName, "streaming read", STREAM_SIZE);
+
+    get_file_info("stream", &info);
+    console_output(FALSE, "%s: stream is %u bytes in %u blocks and %d extents, %d errors\n",
+        testName, info.size, info.blocks, info.extents, errors);
+}
+
+static void SharedWriters(char* testName)
+{
+    char nameBuffer[2][512];
+    fs_file_info_t info;
+    int status;
+
+    for (int i = 0; i < 2; i++)
+    {
+        snprintf(nameBuffer[i], sizeof(nameBuffer[i]), "shared%d", i);
+        k_spawn(nameBuffer[i], SharedWriter, nameBuffer[i], THREADS_MIN_STACK_SIZE, 3);
+    }
+    for (int i = 0; i < 2; i++)
+    {
+        k_wait(&status);
+    }
+
+    for (int i = 0; i < 2; i++)
+    {
+        get_file_info(nameBuffer[i], &info);
+        console_output(FALSE, "%s: %s is %u bytes in %u blocks and %d extents\n",
+            testName, nameBuffer[i], info.size, info.blocks, info.extents);
+    }
+}
+
+int SharedWriter(char* strArgs)
+{
+    char chunk[1024];
+    int fd = k_open(strArgs, FS_WRITE | FS_CREATE | FS_TRUNCATE);
+
+    memset(chunk, strArgs[strlen(strArgs) - 1], sizeof(chunk));
+    for (int written = 0; written < SHARED_SIZE; written += sizeof(chunk))
+    {
+        k_write(fd, chunk, sizeof(chunk));
+
+        // Let the other writer have a turn
+        k_sleep(0);
+    }
+    k_close(fd);
+
+    k_exit(0);
+
+    return 0;
+}
+
+static void StartMeasure(void)
+{
+    reset_disk_stats(FS_UNIT);
+    gStartTime = read_clock();
+}
+
+static void EndMeasure(char* testName, char* what, unsigned long long bytes)
+{
+    DWORD elapsed = read_clock() - gStartTime;
+    disk_stats_t stats;
+
+    get_disk_stats(FS_UNIT, &stats);
+    console_output(FALSE, "%s: %-17s %7llu bytes in %7lu us, %5lu KB/s, %u sectors, %u seeks\n", testName, what,
+        bytes, (unsigned long)elapsed, (unsigned long)(bytes * 1000000 / 1024 / (elapsed ? elapsed : 1)),
+        stats.sectors, stats.seeks);
+}
+
+static void FillPattern(char* pData, int size, int seed)
+{
+    for (int i = 0; i < size; i++)
+    {
+        pData[i] = (char)(seed * 31 + i * 7 + i / 512);
+    }
+}
@@ -0,0 +1,159 @@
+#include <stdio.h>
+#include <string.h>
+#include "THREADSLib.h"
+#include "SchedulerTesting.h"
+#include "Scheduler.h"
+#include "Disk.h"
+#include "BufferCache.h"
+#include "FileSystem.h"
+
+#define DEVICE_UNIT         1
+#define IMAGE_PATH          "SchedulerTest46.img"
+#define FILE_SIZE           (256 * 1024)
+#define CHUNK_SIZE          (8 * 1024)
+
+static int Populate(char* testName, int unit);
+static int Verify(char* testName, int unit);
+static void StartMeasure(void);
+static void EndMeasure(char* testName, char* what, int unit);
+static void FillPattern(char* pData, int size, int seed);
+
+static char gChunk[CHUNK_SIZE];
+static char gCheck[CHUNK_SIZE];
+static DWORD gStartTime;
+
+/*********************************************************************************
+*
+* SchedulerTest46
+*
+* Tests image disks, disks backed by a host file mapped into memory.
+*
+* A new image with the geometry of disk 1 is attached, formatted, and given a
+* file of FILE_SIZE bytes, and disk 1 is populated the same way through the
+* device, so the two can be timed against each other. The image is then
+* detached and attached again, and the file system on it is mounted and the
+* file read back, to show the data lasts without populating the disk again.
+*
+* Attaching the image with the wrong geometry must fail, and every image unit
+* must be usable at once.
+*
+*********************************************************************************/
+int SchedulerEntryPoint(void* pArgs)
+{
+    char* testName = "SchedulerTest46";
+    int platters, tracks;
+    int unit, other, errors, status;
+
+    console_output(FALSE, "\n%s: started\n", testName);
+
+    k_disk_info(DEVICE_UNIT, &platters, &tracks);
+    remove(IMAGE_PATH);
+
+    unit = disk_attach_image(IMAGE_PATH, platters, tracks);
+    console_output(FALSE, "%s: new image attached as unit %d\n", testName, unit);
+    if (unit < 0)
+    {
+        k_exit(1);
+    }
+
+    errors = Populate(testName, unit);
+    errors += Populate(testName, DEVICE_UNIT);
+    console_output(FALSE, "%s: %d errors populating the disks\n", testName, errors);
+
+    // Nothing for the image may be left in the cache once it is detached
+    cache_set_policy(CACHE_POLICY_2Q);
+    status = disk_detach_image(unit);
+    console_output(FALSE, "%s: disk_detach_image returned %d, detaching again returned %d\n", testName,
+        status, disk_detach_image(unit));
+
+    console_output(FALSE, "%s: attaching with the wrong geometry returned %d\n", testName,
+        disk_attach_image(IMAGE_PATH, platters, tracks / 2));
+
+    StartMeasure();
+    unit = disk_attach_image(IMAGE_PATH, platters, tracks);
+    console_output(FALSE, "%s: fs_mount returned %d\n", testName, fs_mount(unit));
+    EndMeasure(testName, "attach and mount", unit);
+    errors = Verify(testName, unit);
+    console_output(FALSE, "%s: %d errors reading the file back from the image\n", testName, errors);
+
+    other = disk_attach_image("SchedulerTest46b.img", 1, 1);
+    status = disk_attach_image("SchedulerTest46c.img", 1, 1);
+    console_output(FALSE, "%s: second image attached as unit %d, a third returned %d\n", testName, other, status);
+    disk_detach_image(other);
+    remove("SchedulerTest46b.img");
+
+    fs_mount(DEVICE_UNIT);
+    cache_set_policy(CACHE_POLICY_2Q);
+    disk_detach_image(unit);
+    remove(IMAGE_PATH);
+
+    k_exit(0);
+
+    return 0;
+}
+
+static int Populate(char* testName, int unit)
+{
+    int errors = 0;
+    int fd;
+
+    cache_set_policy(CACHE_POLICY_2Q);
+    StartMeasure();
+    errors += fs_format(unit) != 0;
+    fd = k_open("data", FS_WRITE | FS_CREATE);
+    for (int offset = 0; offset < FILE_SIZE; offset += CHUNK_SIZE)
+    {
+        FillPattern(gChunk, CHUNK_SIZE, offset);
+        errors += k_write(fd, gChunk, CHUNK_SIZE) != CHUNK_SIZE;
+    }
+    errors += k_close(fd) != 0;
+    k_cache_sync();
+    EndMeasure(testName, "format and write", unit);
+
+    return errors;
+}
+
+static int Verify(char* testName, int unit)
+{
+    int errors = 0;
+    int fd;
+
+    StartMeasure();
+    fd = k_open("data", FS_READ);
+    for (int offset = 0; offset < FILE_SIZE; offset += CHUNK_SIZE)
+    {
+        FillPattern(gChunk, CHUNK_SIZE, offset);
+        errors += k_read(fd, gCheck, CHUNK_SIZE) != CHUNK_SIZE || memcmp(gChunk, gCheck, CHUNK_SIZE) != 0;
+    }
+    errors += k_close(fd) != 0;
+    EndMeasure(testName, "read", unit);
+
+    return errors;
+}
+
+static void StartMeasure(void)
+{
+    for (int unit = 0; unit < THREADS_MAX_DISKS + DISK_IMAGE_UNITS; unit++)
+    {
+        reset_disk_stats(unit);
+    }
+    gStartTime = read_clock();
+}
+
+static void EndMeasure(char* testName, char* what, int unit)
+{
+    DWORD elapsed = read_clock() - gStartTime;
+    disk_stats_t stats;
+
+    get_disk_stats(unit, &stats);
+    console_output(FALSE, "%s: unit %d %-17s %8lu us, %u sectors, %u seeks\n", testName, unit, what,
+        (unsigned long)elapsed, stats.sectors, stats.seeks);
+}
+
+static void FillPattern(char* pData, int size, int seed)
+{
+    for (int i = 0; i < size; i++)
+    {
+        pData[i] = (char)(seed * 31 + i * 7 + i / 512);
+    }
+}
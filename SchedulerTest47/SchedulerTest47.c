@@ -0,0 +1,205 @@
+#include <stdio.h>
+#include <string.h>
+#include "THREADSLib.h"
+#include "SchedulerTesting.h"
+#include "Scheduler.h"
+#include "Disk.h"
+
+#define TEST_UNIT           1
+#define FIRST_TRACK         10
+#define TRACKS              8
+#define SECTORS             (TRACKS * THREADS_DISK_SECTOR_COUNT)
+#define BYTES               (SECTORS * THREADS_DISK_SECTOR_SIZE)
+
+static void ReadBySector(char* testName);
+static void ReadVector(char* testName);
+static void ReadContiguous(char* testName);
+static void WriteVector(char* testName);
+static void StartMeasure(void);
+static void EndMeasure(char* testName, char* what, int errors);
+static void FillPattern(char* pData, int sector);
+static int CheckPattern(char* pData, int sector);
+
+static char gSectors[SECTORS][THREADS_DISK_SECTOR_SIZE];
+static disk_segment_t gSegments[SECTORS];
+static DWORD gStartTime;
+
+/*********************************************************************************
+*
+* SchedulerTest47
+*
+* Tests and benchmarks vectored disk transfers.
+*
+* SECTORS consecutive sectors of disk 1 are written with a pattern and read
+* back three ways: one k_disk_read per sector, one k_disk_readv with every
+* sector going to a different place in memory, and one k_disk_read into a
+* contiguous buffer. Each reports the time per byte, the requests the disk
+* served and the times the caller was woken. The vectored read should need
+* one request per track and a single wakeup.
+*
+* k_disk_writev is then given the sectors with the tracks out of order and
+* the result is read back. A vector with an invalid segment must fail without
+* transferring anything.
+*
+*********************************************************************************/
+int SchedulerEntryPoint(void* pArgs)
+{
+    char* testName = "SchedulerTest47";
+
+    console_output(FALSE, "\n%s: started\n", testName);
+
+    for (int i = 0; i < SECTORS; i++)
+    {
+        FillPattern(gSectors[i], i);
+    }
+    k_disk_write(TEST_UNIT, 0, FIRST_TRACK, 0, SECTORS, gSectors);
+
+    ReadBySector(testName);
+    ReadVector(testName);
+    ReadContiguous(testName);
+    WriteVector(testName);
+
+    k_exit(0);
+
+    return 0;
+}
+
+static void ReadBySector(char* testName)
+{
+    int errors = 0;
+
+    memset(gSectors, 0, sizeof(gSectors));
+    StartMeasure();
+    for (int i = 0; i < SECTORS; i++)
+    {
+        errors += k_disk_read(TEST_UNIT, 0, FIRST_TRACK + i / THREADS_DISK_SECTOR_COUNT,
+            i % THREADS_DISK_SECTOR_COUNT, 1, gSectors[i]) != 0;
+    }
+    for (int i = 0; i < SECTORS; i++)
+    {
+        errors += CheckPattern(gSectors[i], i);
+    }
+    EndMeasure(testName, "per sector read", errors);
+}
+
+static void ReadVector(char* testName)
+{
+    int errors;
+
+    // Every sector lands in the opposite end of memory from where it is on the disk
+    memset(gSectors, 0, sizeof(gSectors));
+    for (int i = 0; i < SECTORS; i++)
+    {
+        gSegments[i].platter = 0;
+        gSegments[i].track = FIRST_TRACK + i / THREADS_DISK_SECTOR_COUNT;
+        gSegments[i].sector = i % THREADS_DISK_SECTOR_COUNT;
+        gSegments[i].pBuffer = gSectors[SECTORS - 1 - i];
+    }
+
+    StartMeasure();
+    errors = k_disk_readv(TEST_UNIT, gSegments, SECTORS) != 0;
+    for (int i = 0; i < SECTORS; i++)
+    {
+        errors += CheckPattern(gSectors[SECTORS - 1 - i], i);
+    }
+    EndMeasure(testName, "vectored read", errors);
+}
+
+static void ReadContiguous(char* testName)
+{
+    int errors;
+
+    memset(gSectors, 0, sizeof(gSectors));
+    StartMeasure();
+    errors = k_disk_read(TEST_UNIT, 0, FIRST_TRACK, 0, SECTORS, gSectors) != 0;
+    for (int i = 0; i < SECTORS; i++)
+    {
+        errors += CheckPattern(gSectors[i], i);
+    }
+    EndMeasure(testName, "contiguous read", errors);
+}
+
+static void WriteVector(char* testName)
+{
+    int errors = 0;
+    int count = 0;
+    int result;
+
+    // Odd tracks first, then even ones, each sector from its own buffer
+    for (int pass = 1; pass >= 0; pass--)
+    {
+        for (int i = 0; i < SECTORS; i++)
+        {
+            if ((i / THREADS_DISK_SECTOR_COUNT) % 2 == pass)
+            {
+                FillPattern(gSectors[count], i + SECTORS);
+                gSegments[count].platter = 0;
+                gSegments[count].track = FIRST_TRACK + i / THREADS_DISK_SECTOR_COUNT;
+                gSegments[count].sector = i % THREADS_DISK_SECTOR_COUNT;
+                gSegments[count].pBuffer = gSectors[count];
+                count++;
+            }
+        }
+    }
+
+    StartMeasure();
+    errors += k_disk_writev(TEST_UNIT, gSegments, SECTORS) != 0;
+    EndMeasure(testName, "vectored write", errors);
+
+    memset(gSectors, 0, sizeof(gSectors));
+    errors += k_disk_read(TEST_UNIT, 0, FIRST_TRACK, 0, SECTORS, gSectors) != 0;
+    for (int i = 0; i < SECTORS; i++)
+    {
+        errors += CheckPattern(gSectors[i], i + SECTORS);
+    }
+    console_output(FALSE, "%s: %d errors reading back the vectored write\n", testName, errors);
+
+    // The last segment is past the end of its track
+    gSegments[0].pBuffer = gSectors[0];
+    gSegments[1].pBuffer = gSectors[1];
+    gSegments[1].track = gSegments[0].track;
+    gSegments[1].sector = THREADS_DISK_SECTOR_COUNT;
+    FillPattern(gSectors[0], 0);
+    StartMeasure();
+    result = k_disk_writev(TEST_UNIT, gSegments, 2);
+    EndMeasure(testName, "invalid vector", 0);
+    console_output(FALSE, "%s: invalid vector returned %d\n", testName, result);
+}
+
+static void StartMeasure(void)
+{
+    reset_disk_stats(TEST_UNIT);
+    gStartTime = read_clock();
+}
+
+static void EndMeasure(char* testName, char* what, int errors)
+{
+    DWORD elapsed = read_clock() - gStartTime;
+    disk_stats_t stats;
+
+    get_disk_stats(TEST_UNIT, &stats);
+    console_output(FALSE, "%s: %-16s %7lu us, %5lu ns/byte, %3u requests, %3u wakeups, %d errors\n", testName,
+        what, (unsigned long)elapsed, (unsigned long)((unsigned long long)elapsed * 1000 / BYTES),
+        stats.requests, stats.wakeups, errors);
+}
+
+static void FillPattern(char* pData, int sector)
+{
+    for (int i = 0; i < THREADS_DISK_SECTOR_SIZE; i++)
+    {
+        pData[i] = (char)(sector * 13 + i);
+    }
+}
+
+static int CheckPattern(char* pData, int sector)
+{
+    for (int i = 0; i < THREADS_DISK_SECTOR_SIZE; i++)
+    {
+        if (pData[i] != (char)(sector * 13 + i))
+        {
+            return 1;
+        }
+    }
+
+    return 0;
+}
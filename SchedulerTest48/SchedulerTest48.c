@@ -0,0 +1,130 @@
+#include <stdio.h>
+#include <string.h>
+#include "THREADSLib.h"
+#include "SchedulerTesting.h"
+#include "Scheduler.h"
+#include "Disk.h"
+#include "Devices.h"
+
+#define READERS             4       // Two on each of disks 0 and 1
+#define READS               48      // Single sector reads by each reader
+#define VECTOR_SECTORS      32      // Sectors in the vectored read each reader ends with
+
+int DiskReader(char* strArgs);
+static void RunWorkload(char* testName, char* what);
+
+static char gExpected[2][VECTOR_SECTORS][THREADS_DISK_SECTOR_SIZE];
+static int gErrors;
+
+/*********************************************************************************
+*
+* SchedulerTest48
+*
+* Measures deferred I/O interrupt handling.
+*
+* READERS processes read from disks 0 and 1 at the same time, first one sector
+* per request and then with one vectored read, so that completions from the
+* two disks arrive close together. The workload is run once with the drivers'
+* interrupt code run in the interrupt handler and once with it deferred to the
+* bottom half. Each run reports the time spent in the handler per interrupt,
+* where interrupts are disabled, and for the deferred run the time the bottom
+* half spent per interrupt and how many interrupts each pass handled.
+*
+* The bottom half is a kernel daemon, so k_kill on it returns -1 and k_killpg
+* on its group signals nobody. The deferred workload is then run again to check
+* that it still waits for interrupts normally.
+*
+*********************************************************************************/
+int SchedulerEntryPoint(void* pArgs)
+{
+    char* testName = "SchedulerTest48";
+
+    console_output(FALSE, "\n%s: started\n", testName);
+
+    for (int unit = 0; unit < 2; unit++)
+    {
+        for (int i = 0; i < VECTOR_SECTORS; i++)
+        {
+            memset(gExpected[unit][i], unit * 100 + i, THREADS_DISK_SECTOR_SIZE);
+        }
+        k_disk_write(unit, 0, 20, 0, VECTOR_SECTORS, gExpected[unit]);
+    }
+
+    RunWorkload(testName, "in the handler");
+
+    io_set_deferred(TRUE);
+    RunWorkload(testName, "deferred");
+    console_output(FALSE, "%s: signaling the bottom half returned %d, its group %d\n", testName,
+        k_kill(get_bottom_half_pid(), SIG_TERM), k_killpg(get_bottom_half_pid(), SIG_TERM));
+    RunWorkload(testName, "after signals");
+    io_set_deferred(FALSE);
+
+    k_exit(0);
+
+    return 0;
+}
+
+static void RunWorkload(char* testName, char* what)
+{
+    char nameBuffer[READERS][512];
+    interrupt_stats_t stats;
+    LARGE_INTEGER frequency;
+    int status;
+
+    gErrors = 0;
+    reset_interrupt_stats();
+
+    for (int i = 0; i < READERS; i++)
+    {
+        snprintf(nameBuffer[i], sizeof(nameBuffer[i]), "Reader%d", i);
+        k_spawn(nameBuffer[i], DiskReader, nameBuffer[i], THREADS_MIN_STACK_SIZE, 3);
+    }
+    for (int i = 0; i < READERS; i++)
+    {
+        k_wait(&status);
+    }
+
+    get_interrupt_stats(&stats);
+    QueryPerformanceFrequency(&frequency);
+
+    console_output(FALSE, "%s: %-14s %4u interrupts, %5llu ns each in the handler, %d errors\n", testName, what,
+        stats.interrupts, stats.handlerTicks * 1000000000 / frequency.QuadPart / (stats.interrupts ? stats.interrupts : 1),
+        gErrors);
+    console_output(FALSE, "%s: %-14s %4u deferred, %5llu ns each in the bottom half, %u passes, %u wakeups, "
+        "%u most in a pass, %u overflows\n", testName, what, stats.deferred,
+        stats.bottomHalfTicks * 1000000000 / frequency.QuadPart / (stats.deferred ? stats.deferred : 1),
+        stats.passes, stats.wakeups, stats.maxBatch, stats.overflows);
+}
+
+int DiskReader(char* strArgs)
+{
+    char sectors[VECTOR_SECTORS][THREADS_DISK_SECTOR_SIZE];
+    disk_segment_t segments[VECTOR_SECTORS];
+    int unit = (strArgs[strlen(strArgs) - 1] - '0') % 2;
+
+    for (int i = 0; i < READS; i++)
+    {
+        int sector = i % VECTOR_SECTORS;
+
+        gErrors += k_disk_read(unit, 0, 20 + sector / THREADS_DISK_SECTOR_COUNT,
+            sector % THREADS_DISK_SECTOR_COUNT, 1, sectors[0]) != 0 ||
+            memcmp(sectors[0], gExpected[unit][sector], THREADS_DISK_SECTOR_SIZE) != 0;
+    }
+
+    for (int i = 0; i < VECTOR_SECTORS; i++)
+    {
+        segments[i].platter = 0;
+        segments[i].track = 20 + i / THREADS_DISK_SECTOR_COUNT;
+        segments[i].sector = i % THREADS_DISK_SECTOR_COUNT;
+        segments[i].pBuffer = sectors[VECTOR_SECTORS - 1 - i];
+    }
+    gErrors += k_disk_readv(unit, segments, VECTOR_SECTORS) != 0;
+    for (int i = 0; i < VECTOR_SECTORS; i++)
+    {
+        gErrors += memcmp(sectors[VECTOR_SECTORS - 1 - i], gExpected[unit][i], THREADS_DISK_SECTOR_SIZE) != 0;
+    }
+
+    k_exit(0);
+
+    return 0;
+}
@@ -0,0 +1,142 @@
+#include <stdio.h>
+#include <string.h>
+#include "THREADSLib.h"
+#include "SchedulerTesting.h"
+#include "Scheduler.h"
+#include "VirtualMemory.h"
+
+#define ARRAY_PAGES         96      // More pages than the default frames
+#define HOT_PAGES           8       // Working set of the looping workload
+#define HOT_READS           4000
+
+int Sweeper(char* strArgs);
+int Looper(char* strArgs);
+static void RunWorkload(char* testName, int frames);
+static void ReportStats(char* name);
+
+/*********************************************************************************
+*
+* SchedulerTest49
+*
+* Tests simulated paged virtual memory.
+*
+* A sweeper process allocates ARRAY_PAGES pages, more than physical memory
+* has frames, writes every page and reads them all back twice in order, so
+* the clock has to evict pages and bring them back. A looper process reads
+* HOT_PAGES pages over and over, which should almost always hit in the TLB.
+* Each reports its TLB hits and misses, page faults, zero fills, page ins and
+* page outs. The workload runs with VM_DEFAULT_FRAMES frames and again with
+* 128 frames, when all of the sweeper's pages fit.
+*
+* The sweeper also checks that an untouched page reads as zeros and that
+* addresses it never allocated fault.
+*
+*********************************************************************************/
+int SchedulerEntryPoint(void* pArgs)
+{
+    char* testName = "SchedulerTest49";
+
+    console_output(FALSE, "\n%s: started\n", testName);
+
+    RunWorkload(testName, VM_DEFAULT_FRAMES);
+    RunWorkload(testName, 128);
+
+    k_exit(0);
+
+    return 0;
+}
+
+static void RunWorkload(char* testName, int frames)
+{
+    int status;
+
+    console_output(FALSE, "%s: %d frames, vm_set_frames returned %d\n", testName, frames, vm_set_frames(frames));
+
+    k_spawn("Sweeper", Sweeper, "Sweeper", THREADS_MIN_STACK_SIZE, 3);
+    k_spawn("Looper", Looper, "Looper", THREADS_MIN_STACK_SIZE, 3);
+    k_wait(&status);
+    k_wait(&status);
+}
+
+int Sweeper(char* strArgs)
+{
+    int page[VM_PAGE_SIZE / sizeof(int)];
+    int base = k_vm_allocate(ARRAY_PAGES * VM_PAGE_SIZE);
+    int zeroPage = k_vm_allocate(VM_PAGE_SIZE);
+    int errors = 0;
+    int value;
+
+    for (int i = 0; i < ARRAY_PAGES; i++)
+    {
+        for (int j = 0; j < VM_PAGE_SIZE / sizeof(int); j++)
+        {
+            page[j] = i * 1000 + j;
+        }
+        errors += k_vm_write(base + i * VM_PAGE_SIZE, page, VM_PAGE_SIZE) != 0;
+    }
+
+    for (int pass = 0; pass < 2; pass++)
+    {
+        for (int i = 0; i < ARRAY_PAGES; i++)
+        {
+            errors += k_vm_read(base + i * VM_PAGE_SIZE, page, VM_PAGE_SIZE) != 0;
+            for (int j = 0; j < VM_PAGE_SIZE / sizeof(int); j++)
+            {
+                errors += page[j] != i * 1000 + j;
+            }
+        }
+    }
+
+    value = -1;
+    k_vm_read(zeroPage + 100, &value, sizeof(value));
+    console_output(FALSE, "%s: %d errors, untouched page reads %d, address 0 returned %d, past the end returned %d\n",
+        strArgs, errors, value, k_vm_read(0, &value, sizeof(value)),
+        k_vm_read(zeroPage + VM_PAGE_SIZE, &value, sizeof(value)));
+    ReportStats(strArgs);
+
+    k_exit(0);
+
+    return 0;
+}
+
+int Looper(char* strArgs)
+{
+    int base = k_vm_allocate(HOT_PAGES * VM_PAGE_SIZE);
+    int errors = 0;
+    int value;
+
+    for (int i = 0; i < HOT_PAGES; i++)
+    {
+        errors += k_vm_write(base + i * VM_PAGE_SIZE, &i, sizeof(i)) != 0;
+    }
+
+    for (int i = 0; i < HOT_READS; i++)
+    {
+        int hot = i % HOT_PAGES;
+
+        errors += k_vm_read(base + hot * VM_PAGE_SIZE, &value, sizeof(value)) != 0 || value != hot;
+
+        // Let the sweeper run in between
+        if (i % 500 == 0)
+        {
+            k_sleep(0);
+        }
+    }
+
+    console_output(FALSE, "%s: %d errors\n", strArgs, errors);
+    ReportStats(strArgs);
+
+    k_exit(0);
+
+    return 0;
+}
+
+static void ReportStats(char* name)
+{
+    vm_stats_t stats;
+
+    get_vm_stats(k_getpid(), &stats);
+    console_output(FALSE, "%s: %u TLB hits, %u misses, %u faults, %u zero fills, %u page ins, %u page outs, "
+        "%u evictions, %d of %d pages resident\n", name, stats.tlbHits, stats.tlbMisses, stats.pageFaults,
+        stats.zeroFills, stats.pageIns, stats.pageOuts, stats.evictions, stats.residentPages, stats.allocatedPages);
+}
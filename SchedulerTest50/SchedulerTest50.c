@@ -0,0 +1,145 @@
+#include <stdio.h>
+#include <string.h>
+#include "THREADSLib.h"
+#include "SchedulerTesting.h"
+#include "Scheduler.h"
+#include "Disk.h"
+#include "VirtualMemory.h"
+
+#define SWAP_UNIT           1
+#define FRAMES              32
+#define ARRAY_PAGES         128     // Four times the frames
+#define SWEEPS              2
+
+int Sweeper(char* strArgs);
+int Counter(char* strArgs);
+static void RunWorkload(char* testName, int cluster);
+
+static volatile int gSweeping;
+static int gCount;
+
+/*********************************************************************************
+*
+* SchedulerTest50
+*
+* Benchmarks demand paging to a swap disk under memory pressure.
+*
+* With FRAMES frames and disk 1 as swap, a sweeper process writes ARRAY_PAGES
+* pages, then SWEEPS times reads every page back, checks it and writes it
+* again, so nearly every access faults and every page taken back has to be
+* written to the swap disk between reads. A counter
+* process of the same priority that never faults counts while the sweeper
+* runs, which it can only do if the sweeper's faults block on the disk rather
+* than holding the processor.
+*
+* The workload runs with swap clustering off, one page written at a time, and
+* with clusters of 16 pages. Each run reports the average fault latency, the
+* swap write and read throughput, and the seeks and tracks the head moved
+* per page transferred.
+*
+*********************************************************************************/
+int SchedulerEntryPoint(void* pArgs)
+{
+    char* testName = "SchedulerTest50";
+
+    console_output(FALSE, "\n%s: started\n", testName);
+
+    console_output(FALSE, "%s: vm_set_frames returned %d\n", testName, vm_set_frames(FRAMES));
+
+    RunWorkload(testName, 1);
+    RunWorkload(testName, 16);
+
+    // The swap disk cannot change while pages are on it, it can once they are gone
+    console_output(FALSE, "%s: turning swap off returned %d\n", testName, vm_set_swap(-1, 1));
+
+    k_exit(0);
+
+    return 0;
+}
+
+static void RunWorkload(char* testName, int cluster)
+{
+    vm_swap_stats_t swap;
+    disk_stats_t disk;
+    unsigned int pages;
+    int status;
+
+    console_output(FALSE, "%s: cluster of %d, vm_set_swap returned %d\n", testName, cluster,
+        vm_set_swap(SWAP_UNIT, cluster));
+    reset_swap_stats();
+    reset_disk_stats(SWAP_UNIT);
+
+    gCount = 0;
+    gSweeping = TRUE;
+    k_spawn("Sweeper", Sweeper, "Sweeper", THREADS_MIN_STACK_SIZE, 3);
+    k_spawn("Counter", Counter, "Counter", THREADS_MIN_STACK_SIZE, 3);
+    k_wait(&status);
+    k_wait(&status);
+
+    get_swap_stats(&swap);
+    get_disk_stats(SWAP_UNIT, &disk);
+    console_output(FALSE, "%s: cluster of %d, %u pages written in %u clusters, %u read, %u errors, %d slots in use\n",
+        testName, cluster, swap.pagesWritten, swap.clusters, swap.pagesRead, swap.errors, swap.slotsUsed);
+    pages = swap.pagesWritten + swap.pagesRead;
+    console_output(FALSE, "%s: cluster of %d, %llu KB/s written, %llu KB/s read, %u.%02u seeks and %llu tracks moved "
+        "per page\n", testName, cluster,
+        swap.writeTime ? (unsigned long long)swap.pagesWritten * VM_PAGE_SIZE * 1000000 / 1024 / swap.writeTime : 0,
+        swap.readTime ? (unsigned long long)swap.pagesRead * VM_PAGE_SIZE * 1000000 / 1024 / swap.readTime : 0,
+        disk.seeks / (pages ? pages : 1), disk.seeks * 100 / (pages ? pages : 1) % 100,
+        disk.tracksMoved / (pages ? pages : 1));
+}
+
+int Sweeper(char* strArgs)
+{
+    int page[VM_PAGE_SIZE / sizeof(int)];
+    int base = k_vm_allocate(ARRAY_PAGES * VM_PAGE_SIZE);
+    vm_stats_t stats;
+    int errors = 0;
+
+    // Every pass checks what the last one wrote and writes the page again, so pages are dirty when evicted
+    for (int pass = 0; pass <= SWEEPS; pass++)
+    {
+        for (int i = 0; i < ARRAY_PAGES; i++)
+        {
+            if (pass > 0)
+            {
+                errors += k_vm_read(base + i * VM_PAGE_SIZE, page, VM_PAGE_SIZE) != 0;
+                for (int j = 0; j < VM_PAGE_SIZE / sizeof(int); j++)
+                {
+                    errors += page[j] != (pass - 1) * 1000000 + i * 1000 + j;
+                }
+            }
+            for (int j = 0; j < VM_PAGE_SIZE / sizeof(int); j++)
+            {
+                page[j] = pass * 1000000 + i * 1000 + j;
+            }
+            errors += k_vm_write(base + i * VM_PAGE_SIZE, page, VM_PAGE_SIZE) != 0;
+        }
+    }
+
+    gSweeping = FALSE;
+
+    get_vm_stats(k_getpid(), &stats);
+    console_output(FALSE, "%s: %d errors, %u faults, %u page ins, %u page outs, %llu us per fault\n", strArgs,
+        errors, stats.pageFaults, stats.pageIns, stats.pageOuts,
+        stats.faultTime / (stats.pageFaults ? stats.pageFaults : 1));
+
+    k_exit(0);
+
+    return 0;
+}
+
+int Counter(char* strArgs)
+{
+    while (gSweeping)
+    {
+        gCount++;
+        k_sleep(0);
+    }
+
+    console_output(FALSE, "%s: counted to %d while the sweeper was paging\n", strArgs, gCount);
+
+    k_exit(0);
+
+    return 0;
+}
@@ -0,0 +1,204 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include "THREADSLib.h"
+#include "SchedulerTesting.h"
+#include "Scheduler.h"
+#include "Slab.h"
+#include "VirtualMemory.h"
+
+#define OBJECTS             1000
+#define OBJECT_MAGIC        0x51AB0B1E
+#define ROUNDS              20
+#define CHILDREN            4
+
+typedef struct
+{
+    int     magic;
+    int     uses;
+    char    payload[32];
+} TestObject;
+
+int Child(char* strArgs);
+static void ConstructObject(void* pObject);
+static void CheckObjects(char* testName, int cache);
+static void MeasureLatency(char* testName, int cache);
+
+static TestObject* gObjects[OBJECTS];
+static int gConstructed;
+
+/*********************************************************************************
+*
+* SchedulerTest51
+*
+* Tests and benchmarks the slab allocator.
+*
+* OBJECTS objects are allocated from a cache with a constructor. Each must
+* start on a cache line, be distinct from the others and be constructed. Once
+* freed and allocated again they must come back in the state they were freed
+* in, without the constructor running again. Once they are freed again,
+* slab_cache_shrink must release every slab.
+*
+* The time to allocate and free OBJECTS objects is then compared with malloc
+* and free, and CHILDREN processes use virtual memory so the kernel's own
+* caches show up in the statistics.
+*
+*********************************************************************************/
+int SchedulerEntryPoint(void* pArgs)
+{
+    char* testName = "SchedulerTest51";
+    char nameBuffer[CHILDREN][512];
+    int cache;
+    int status;
+
+    console_output(FALSE, "\n%s: started\n", testName);
+
+    cache = slab_cache_create("test objects", sizeof(TestObject), ConstructObject);
+    console_output(FALSE, "%s: slab_cache_create returned %s, invalid size returned %d\n", testName,
+        cache >= 0 ? "a cache" : "an error", slab_cache_create("bad", 0, NULL));
+
+    CheckObjects(testName, cache);
+    MeasureLatency(testName, cache);
+
+    for (int i = 0; i < CHILDREN; i++)
+    {
+        snprintf(nameBuffer[i], sizeof(nameBuffer[i]), "Child%d", i);
+        k_spawn(nameBuffer[i], Child, nameBuffer[i], THREADS_MIN_STACK_SIZE, 3);
+    }
+    for (int i = 0; i < CHILDREN; i++)
+    {
+        k_wait(&status);
+    }
+
+    display_slab_stats();
+
+    k_exit(0);
+
+    return 0;
+}
+
+static void CheckObjects(char* testName, int cache)
+{
+    slab_stats_t stats;
+    int misaligned = 0;
+    int unconstructed = 0;
+    int duplicates = 0;
+    int changed = 0;
+
+    for (int i = 0; i < OBJECTS; i++)
+    {
+        gObjects[i] = slab_alloc(cache);
+        misaligned += ((uintptr_t)gObjects[i] % SLAB_CACHE_LINE) != 0;
+        unconstructed += gObjects[i]->magic != OBJECT_MAGIC;
+        gObjects[i]->uses++;
+    }
+    for (int i = 1; i < OBJECTS; i++)
+    {
+        duplicates += gObjects[i] == gObjects[i - 1];
+    }
+
+    get_slab_stats(cache, &stats);
+    console_output(FALSE, "%s: %d byte objects in %d byte slots, %d per %d byte slab, %d slabs, %u constructed\n",
+        testName, stats.objectSize, stats.slotSize, stats.objectsPerSlab, stats.slabBytes, stats.slabs,
+        stats.constructed);
+    console_output(FALSE, "%s: %d misaligned, %d unconstructed, %d duplicates\n", testName, misaligned,
+        unconstructed, duplicates);
+
+    for (int i = 0; i < OBJECTS; i++)
+    {
+        slab_free(cache, gObjects[i]);
+    }
+    get_slab_stats(cache, &stats);
+    console_output(FALSE, "%s: all freed, %d in use, %d slabs kept\n", testName, stats.objectsInUse, stats.slabs);
+
+    // Objects come back as they were freed, so every one has been used exactly once or is new
+    gConstructed = 0;
+    for (int i = 0; i < OBJECTS; i++)
+    {
+        gObjects[i] = slab_alloc(cache);
+        changed += gObjects[i]->magic != OBJECT_MAGIC || gObjects[i]->uses > 1;
+    }
+    console_output(FALSE, "%s: reallocated, %d changed, constructor ran %d times\n", testName, changed,
+        gConstructed);
+    for (int i = 0; i < OBJECTS; i++)
+    {
+        slab_free(cache, gObjects[i]);
+    }
+
+    console_output(FALSE, "%s: slab_cache_shrink released %d bytes\n", testName, slab_cache_shrink(cache));
+    get_slab_stats(cache, &stats);
+    console_output(FALSE, "%s: %d slabs left, %u released\n", testName, stats.slabs, stats.slabsReleased);
+}
+
+static void MeasureLatency(char* testName, int cache)
+{
+    LARGE_INTEGER frequency, start, end;
+    unsigned long long slabTicks = 0;
+    unsigned long long mallocTicks = 0;
+    slab_stats_t stats;
+
+    QueryPerformanceFrequency(&frequency);
+    reset_slab_stats(cache);
+
+    for (int round = 0; round < ROUNDS; round++)
+    {
+        QueryPerformanceCounter(&start);
+        for (int i = 0; i < OBJECTS; i++)
+        {
+            gObjects[i] = slab_alloc(cache);
+        }
+        for (int i = 0; i < OBJECTS; i++)
+        {
+            slab_free(cache, gObjects[i]);
+        }
+        QueryPerformanceCounter(&end);
+        slabTicks += end.QuadPart - start.QuadPart;
+
+        QueryPerformanceCounter(&start);
+        for (int i = 0; i < OBJECTS; i++)
+        {
+            gObjects[i] = malloc(sizeof(TestObject));
+            ConstructObject(gObjects[i]);
+        }
+        for (int i = 0; i < OBJECTS; i++)
+        {
+            free(gObjects[i]);
+        }
+        QueryPerformanceCounter(&end);
+        mallocTicks += end.QuadPart - start.QuadPart;
+    }
+
+    get_slab_stats(cache, &stats);
+    console_output(FALSE, "%s: slab %llu ns per allocation and free, malloc and constructor %llu ns\n", testName,
+        slabTicks * 1000000000 / frequency.QuadPart / (ROUNDS * OBJECTS),
+        mallocTicks * 1000000000 / frequency.QuadPart / (ROUNDS * OBJECTS));
+    console_output(FALSE, "%s: %u allocations, %u frees, %u slabs created, %u released, peak %d in use\n", testName,
+        stats.allocations, stats.frees, stats.slabsCreated, stats.slabsReleased, stats.peakInUse);
+}
+
+int Child(char* strArgs)
+{
+    char page[VM_PAGE_SIZE];
+    int base = k_vm_allocate(16 * VM_PAGE_SIZE);
+
+    memset(page, strArgs[strlen(strArgs) - 1], sizeof(page));
+    for (int i = 0; i < 16; i++)
+    {
+        k_vm_write(base + i * VM_PAGE_SIZE, page, VM_PAGE_SIZE);
+    }
+
+    k_exit(0);
+
+    return 0;
+}
+
+static void ConstructObject(void* pObject)
+{
+    TestObject* pTest = pObject;
+
+    pTest->magic = OBJECT_MAGIC;
+    pTest->uses = 0;
+    memset(pTest->payload, 0, sizeof(pTest->payload));
+    gConstructed++;
+}
@@ -0,0 +1,169 @@
+#include <stdio.h>
+#include <string.h>
+#include "THREADSLib.h"
+#include "SchedulerTesting.h"
+#include "Scheduler.h"
+#include "SystemCalls.h"
+#include "StackPool.h"
+
+#define ROUNDS              20
+#define CHILDREN            8
+#define DEPTH               8       // Frames a child exits from with k_exit
+
+int Child(char* strArgs);
+int UserChild(char* strArgs);
+static int Descend(char* strArgs, int depth, int errors, int exitAtBottom);
+static void RunRound(int round, int* pErrors);
+static void ReportStats(char* testName, char* what);
+
+static int gSizes[CHILDREN] =
+{
+    THREADS_MIN_STACK_SIZE, THREADS_MIN_STACK_SIZE, THREADS_MIN_STACK_SIZE * 2, THREADS_MIN_STACK_SIZE * 2,
+    THREADS_MIN_STACK_SIZE * 6, THREADS_MIN_STACK_SIZE * 8, THREADS_MIN_STACK_SIZE, THREADS_MIN_STACK_SIZE * 64
+};
+
+/*********************************************************************************
+*
+* SchedulerTest52
+*
+* Tests and benchmarks the pool of process stacks.
+*
+* Every round spawns CHILDREN children with a mix of stack sizes and waits for
+* them. Some return from their entry point, some call k_exit DEPTH frames
+* down, and one is a user process that exits through the exit system call, so
+* stacks are pooled from every way a process can exit. Each child checks a
+* pattern it leaves in its frames, which would be damaged if two processes
+* shared a stack. The last size is bigger than the largest bucket and is never
+* pooled.
+*
+* The first round has to create every stack, later rounds should reuse them.
+* The time per spawn and exit of the first round is compared with the rest,
+* and stack_pool_prefill is shown giving a new size its stacks ahead of time.
+*
+*********************************************************************************/
+int SchedulerEntryPoint(void* pArgs)
+{
+    char* testName = "SchedulerTest52";
+    DWORD startTime, firstTime, restTime;
+    int errors = 0;
+
+    console_output(FALSE, "\n%s: started\n", testName);
+
+    reset_stack_pool_stats();
+    startTime = read_clock();
+    RunRound(0, &errors);
+    firstTime = read_clock() - startTime;
+    ReportStats(testName, "first round");
+
+    reset_stack_pool_stats();
+    startTime = read_clock();
+    for (int round = 1; round < ROUNDS; round++)
+    {
+        RunRound(round, &errors);
+    }
+    restTime = read_clock() - startTime;
+    ReportStats(testName, "later rounds");
+
+    console_output(FALSE, "%s: %lu us per spawn and exit in the first round, %lu us later, %d errors\n", testName,
+        (unsigned long)(firstTime / CHILDREN), (unsigned long)(restTime / ((ROUNDS - 1) * CHILDREN)), errors);
+
+    // A size no child has used yet
+    reset_stack_pool_stats();
+    console_output(FALSE, "%s: stack_pool_prefill returned %d\n", testName,
+        stack_pool_prefill(THREADS_MIN_STACK_SIZE * 4, 4));
+    for (int i = 0; i < 4; i++)
+    {
+        k_spawn("Prefilled", Child, "Prefilled", THREADS_MIN_STACK_SIZE * 4, 3);
+    }
+    for (int i = 0; i < 4; i++)
+    {
+        int status;
+
+        k_wait(&status);
+        errors += status != 0;
+    }
+    ReportStats(testName, "prefilled");
+
+    k_exit(0);
+
+    return 0;
+}
+
+static void RunRound(int round, int* pErrors)
+{
+    char nameBuffer[CHILDREN][64];
+    int status;
+
+    for (int i = 0; i < CHILDREN; i++)
+    {
+        snprintf(nameBuffer[i], sizeof(nameBuffer[i]), "Child%d-%d", round, i);
+        if (i == CHILDREN - 2)
+        {
+            sys_spawn(nameBuffer[i], UserChild, nameBuffer[i], gSizes[i], 3);
+        }
+        else
+        {
+            k_spawn(nameBuffer[i], Child, nameBuffer[i], gSizes[i], 3);
+        }
+    }
+    for (int i = 0; i < CHILDREN; i++)
+    {
+        k_wait(&status);
+        *pErrors += status != 0;
+    }
+}
+
+static void ReportStats(char* testName, char* what)
+{
+    stack_pool_stats_t stats;
+
+    get_stack_pool_stats(&stats);
+    console_output(FALSE, "%s: %-12s %3u reused, %3u created, %u prefilled, %3u returned, %3u released, "
+        "pooled %d %d %d %d %d %d\n", testName, what, stats.reused, stats.created, stats.prefilled, stats.returned,
+        stats.released, stats.pooled[0], stats.pooled[1], stats.pooled[2], stats.pooled[3], stats.pooled[4],
+        stats.pooled[5]);
+}
+
+int Child(char* strArgs)
+{
+    // Odd children exit from deep in their stack, the others return
+    return Descend(strArgs, DEPTH, 0, strArgs[strlen(strArgs) - 1] % 2 == 1);
+}
+
+static int Descend(char* strArgs, int depth, int errors, int exitAtBottom)
+{
+    char frame[256];
+
+    memset(frame, (char)(depth + strArgs[0]), sizeof(frame));
+    k_sleep(0);
+    for (int i = 0; i < sizeof(frame); i++)
+    {
+        errors += frame[i] != (char)(depth + strArgs[0]);
+    }
+
+    if (depth > 1)
+    {
+        return Descend(strArgs, depth - 1, errors, exitAtBottom);
+    }
+    if (exitAtBottom)
+    {
+        k_exit(errors);
+    }
+
+    return errors;
+}
+
+int UserChild(char* strArgs)
+{
+    char frame[256];
+    int result = 0;
+
+    memset(frame, 'U', sizeof(frame));
+    sys_sleep(0);
+    for (int i = 0; i < sizeof(frame); i++)
+    {
+        result += frame[i] != 'U';
+    }
+
+    return result;
+}
@@ -0,0 +1,71 @@
+#include <stdio.h>
+#include <string.h>
+#include "THREADSLib.h"
+#include "SchedulerTesting.h"
+#include "Scheduler.h"
+#include "StackPool.h"
+
+#define FRAME_BYTES         1024
+
+int Shallow(char* strArgs);
+int Overflow(char* strArgs);
+static int Recurse(int depth);
+
+/*********************************************************************************
+*
+* SchedulerTest53
+*
+* Tests the stack guard zone.
+*
+* With the guard on, a child that stays well inside its THREADS_MIN_STACK_SIZE
+* stack runs and exits normally. A second child then recurses through twice its
+* stack size before giving up the CPU, which must stop the system at that
+* context switch.
+*
+* Expected Output:
+* Process Overflow (pid 4) overflowed its 8192 byte stack, stopping...
+*
+*********************************************************************************/
+int SchedulerEntryPoint(void* pArgs)
+{
+    char* testName = "SchedulerTest53";
+    int status = -1;
+
+    console_output(FALSE, "\n%s: started\n", testName);
+
+    stack_pool_set_guard(TRUE);
+
+    k_spawn("Shallow", Shallow, NULL, THREADS_MIN_STACK_SIZE, 3);
+    k_wait(&status);
+    console_output(FALSE, "%s: Shallow quit with status %d\n", testName, status);
+
+    k_spawn("Overflow", Overflow, NULL, THREADS_MIN_STACK_SIZE, 3);
+    k_wait(&status);
+    console_output(FALSE, "%s: Overflow was not caught, quit with status %d\n", testName, status);
+
+    k_exit(0);
+
+    return 0;
+}
+
+int Shallow(char* strArgs)
+{
+    return Recurse(2) != 2;
+}
+
+int Overflow(char* strArgs)
+{
+    Recurse(2 * THREADS_MIN_STACK_SIZE / FRAME_BYTES);
+    k_sleep(0);
+
+    return 0;
+}
+
+static int Recurse(int depth)
+{
+    volatile char frame[FRAME_BYTES];
+
+    memset((char*)frame, depth, sizeof(frame));
+
+    return depth > 1 ? Recurse(depth - 1) + 1 : frame[0];
+}
@@ -0,0 +1,134 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "THREADSLib.h"
+#include "SchedulerTesting.h"
+#include "Scheduler.h"
+#include "StackPool.h"
+
+#define CHILD_STACK         (4 * THREADS_MIN_STACK_SIZE)
+#define FRAME_BYTES         1024
+#define SPAWN_ROUNDS        200
+
+int Recurser(char* strArgs);
+int Quick(char* strArgs);
+static int Recurse(int depth);
+static void TimeSpawns(char* testName, int paint);
+
+/*********************************************************************************
+*
+* SchedulerTest54
+*
+* Tests the stack high-water mark.
+*
+* Three processes with CHILD_STACK byte stacks recurse 2, 8 and 20 frames of
+* about FRAME_BYTES each, then sleep. While they sleep the process table is
+* displayed and get_stack_usage is called for each of them, and the stack
+* they used should grow with their depth. After they are cleaned up, the
+* most stack used is read from the stack pool counters for their bucket.
+*
+* Then a process that returns at once is spawned and waited for SPAWN_ROUNDS
+* times with painting on and off, to show what painting costs a spawn.
+*
+*********************************************************************************/
+int SchedulerEntryPoint(void* pArgs)
+{
+    char* testName = "SchedulerTest54";
+    int pids[3];
+    char* depths[] = { "2", "8", "20" };
+    stack_pool_stats_t stats;
+    int status;
+
+    console_output(FALSE, "\n%s: started\n", testName);
+
+    reset_stack_pool_stats();
+    for (int i = 0; i < 3; i++)
+    {
+        pids[i] = k_spawn("Recurser", Recurser, depths[i], CHILD_STACK, 3);
+    }
+
+    k_sleep(50);
+    display_process_table();
+
+    for (int i = 0; i < 3; i++)
+    {
+        unsigned int used = 0;
+        unsigned int size = 0;
+        int result = get_stack_usage(pids[i], &used, &size);
+
+        console_output(FALSE, "%s: %s frames, get_stack_usage returned %d, %u of %u bytes used\n", testName,
+            depths[i], result, used, size);
+    }
+
+    for (int i = 0; i < 3; i++)
+    {
+        k_wait(&status);
+    }
+
+    get_stack_pool_stats(&stats);
+    console_output(FALSE, "%s: after cleanup, most used %u of %d bytes, %u used all of their stack\n", testName,
+        stats.highWater[2], CHILD_STACK, stats.exhausted);
+    console_output(FALSE, "%s: get_stack_usage of a cleaned up process returned %d\n", testName,
+        get_stack_usage(pids[0], NULL, NULL));
+
+    TimeSpawns(testName, TRUE);
+    TimeSpawns(testName, FALSE);
+    stack_pool_set_paint(TRUE);
+
+    k_exit(0);
+
+    return 0;
+}
+
+static void TimeSpawns(char* testName, int paint)
+{
+    LARGE_INTEGER frequency;
+    LARGE_INTEGER start;
+    LARGE_INTEGER end;
+    int status;
+
+    stack_pool_set_paint(paint);
+    QueryPerformanceFrequency(&frequency);
+    QueryPerformanceCounter(&start);
+    for (int i = 0; i < SPAWN_ROUNDS; i++)
+    {
+        k_spawn("Quick", Quick, "Quick", CHILD_STACK, 3);
+        k_wait(&status);
+    }
+    QueryPerformanceCounter(&end);
+
+    console_output(FALSE, "%s: painting %s, %lld us per spawn and wait\n", testName, paint ? "on" : "off",
+        (end.QuadPart - start.QuadPart) * 1000000 / frequency.QuadPart / SPAWN_ROUNDS);
+}
+
+int Recurser(char* strArgs)
+{
+    int depth = atoi(strArgs);
+
+    console_output(FALSE, "Recurser %d: checksum %d\n", depth, Recurse(depth));
+    k_sleep(100);
+
+    k_exit(0);
+
+    return 0;
+}
+
+int Quick(char* strArgs)
+{
+    k_exit(0);
+
+    return 0;
+}
+
+static int Recurse(int depth)
+{
+    volatile char frame[FRAME_BYTES];
+
+    memset((char*)frame, depth, sizeof(frame));
+    if (depth > 1)
+    {
+        return frame[depth] + Recurse(depth - 1);
+    }
+
+    return frame[0];
+}
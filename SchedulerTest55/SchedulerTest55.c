@@ -0,0 +1,209 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "THREADSLib.h"
+#include "SchedulerTesting.h"
+#include "Scheduler.h"
+#include "Arena.h"
+
+#define WORKERS             16
+#define ROUNDS              10
+#define ALLOCATIONS         1000    // Blocks each worker allocates
+#define WORKER_STACK        (4 * THREADS_MIN_STACK_SIZE)
+
+#define ARENA_NO_FREE       0       // k_malloc, left for cleanup to release
+#define ARENA_FREE          1       // k_malloc and k_free
+#define HOST_FREE           2       // malloc and free, with interrupts disabled so no other process is switched
+                                    // to in the middle of the host's allocator
+
+int Checker(char* strArgs);
+int Worker(char* strArgs);
+static void RunWorkers(char* testName, int mode);
+
+static char* modeNames[] = { "k_malloc, released at cleanup", "k_malloc and k_free", "malloc and free" };
+
+/*********************************************************************************
+*
+* SchedulerTest55
+*
+* Tests and benchmarks per process heap arenas.
+*
+* A checker process allocates blocks of many sizes, small and large, fills
+* each with a pattern and checks them all, then frees every other block and
+* allocates again, which should reuse the freed blocks. It also checks that
+* k_free refuses a pointer that is not from its arena and a block freed twice.
+*
+* Then WORKERS short lived workers at a time each allocate ALLOCATIONS small
+* blocks and exit, ROUNDS times, leaving their blocks for cleanup to release,
+* freeing them with k_free, and using malloc and free. The time per worker
+* includes its spawn and cleanup. After the first round the arenas should
+* get all their chunks from the chunk cache.
+*
+*********************************************************************************/
+int SchedulerEntryPoint(void* pArgs)
+{
+    char* testName = "SchedulerTest55";
+    arena_chunk_stats_t chunkStats;
+    int checkerPid;
+    int status;
+
+    console_output(FALSE, "\n%s: started\n", testName);
+
+    checkerPid = k_spawn("Checker", Checker, "Checker", WORKER_STACK, 3);
+    k_wait(&status);
+    console_output(FALSE, "%s: get_arena_stats of the cleaned up checker returned %d\n", testName,
+        get_arena_stats(checkerPid, NULL));
+
+    reset_arena_chunk_stats();
+    for (int mode = ARENA_NO_FREE; mode <= HOST_FREE; mode++)
+    {
+        RunWorkers(testName, mode);
+    }
+
+    get_arena_chunk_stats(&chunkStats);
+    console_output(FALSE, "%s: %u chunks created, %u reused, %u arenas released, %d cached\n", testName,
+        chunkStats.created, chunkStats.reused, chunkStats.arenasReleased, chunkStats.cached);
+    console_output(FALSE, "%s: arena_shrink returned %d\n", testName, arena_shrink());
+
+    k_exit(0);
+
+    return 0;
+}
+
+static void RunWorkers(char* testName, int mode)
+{
+    char modeArg[8];
+    DWORD startTime;
+    DWORD elapsed;
+    int status;
+    int failures = 0;
+
+    snprintf(modeArg, sizeof(modeArg), "%d", mode);
+
+    startTime = read_clock();
+    for (int round = 0; round < ROUNDS; round++)
+    {
+        for (int i = 0; i < WORKERS; i++)
+        {
+            k_spawn("Worker", Worker, modeArg, WORKER_STACK, 3);
+        }
+        for (int i = 0; i < WORKERS; i++)
+        {
+            k_wait(&status);
+            failures += status != 0;
+        }
+    }
+    elapsed = read_clock() - startTime;
+
+    console_output(FALSE, "%s: %s, %lu us per worker, %d failed\n", testName, modeNames[mode],
+        (unsigned long)(elapsed / (ROUNDS * WORKERS)), failures);
+}
+
+int Worker(char* strArgs)
+{
+    int mode = atoi(strArgs);
+    char* blocks[ALLOCATIONS];
+    int errors = 0;
+
+    for (int i = 0; i < ALLOCATIONS; i++)
+    {
+        int size = (i * 37) % 496 + 16;
+
+        if (mode == HOST_FREE)
+        {
+            disableInterrupts();
+            blocks[i] = malloc(size);
+            enableInterrupts();
+        }
+        else
+        {
+            blocks[i] = k_malloc(size);
+        }
+        if (blocks[i] == NULL)
+        {
+            return 1;
+        }
+        blocks[i][0] = (char)i;
+        blocks[i][size - 1] = (char)i;
+    }
+
+    for (int i = 0; i < ALLOCATIONS; i++)
+    {
+        errors += blocks[i][0] != (char)i;
+    }
+
+    if (mode == ARENA_FREE)
+    {
+        for (int i = 0; i < ALLOCATIONS; i++)
+        {
+            errors += k_free(blocks[i]) != 0;
+        }
+    }
+    else if (mode == HOST_FREE)
+    {
+        for (int i = 0; i < ALLOCATIONS; i++)
+        {
+            disableInterrupts();
+            free(blocks[i]);
+            enableInterrupts();
+        }
+    }
+
+    return errors != 0;
+}
+
+int Checker(char* strArgs)
+{
+    static int sizes[] = { 1, 8, 16, 17, 100, 512, 1000, 2048, 2049, 5000, 100000 };
+    char* blocks[sizeof(sizes) / sizeof(sizes[0])];
+    int count = sizeof(sizes) / sizeof(sizes[0]);
+    arena_stats_t stats;
+    char notFromArena[32];
+    int firstFree;
+    int errors = 0;
+
+    for (int i = 0; i < count; i++)
+    {
+        blocks[i] = k_malloc(sizes[i]);
+        errors += blocks[i] == NULL || ((size_t)blocks[i] & 15) != 0;
+        memset(blocks[i], 'a' + i, sizes[i]);
+    }
+    for (int i = 0; i < count; i++)
+    {
+        for (int j = 0; j < sizes[i]; j++)
+        {
+            errors += blocks[i][j] != 'a' + i;
+        }
+    }
+
+    get_arena_stats(k_getpid(), &stats);
+    console_output(FALSE, "%s: %u allocations, %u large, %d chunks, %d bytes in use, %d errors\n", strArgs,
+        stats.allocations, stats.large, stats.chunks, stats.bytesInUse, errors);
+
+    for (int i = 0; i < count; i += 2)
+    {
+        errors += k_free(blocks[i]) != 0;
+    }
+    for (int i = 0; i < count; i += 2)
+    {
+        blocks[i] = k_malloc(sizes[i]);
+        errors += blocks[i] == NULL;
+    }
+
+    get_arena_stats(k_getpid(), &stats);
+    console_output(FALSE, "%s: after freeing and allocating every other block, %u reused, %d large blocks, "
+        "%d bytes in use, peak %d, %d errors\n", strArgs, stats.reused, stats.largeBlocks, stats.bytesInUse,
+        stats.peakBytesInUse, errors);
+
+    memset(notFromArena, 0, sizeof(notFromArena));
+    console_output(FALSE, "%s: k_free of a stack buffer returned %d, k_free(NULL) returned %d\n", strArgs,
+        k_free(notFromArena + 16), k_free(NULL));
+    firstFree = k_free(blocks[1]);
+    console_output(FALSE, "%s: first k_free returned %d, second returned %d, k_malloc(0) returned %p\n", strArgs,
+        firstFree, k_free(blocks[1]), k_malloc(0));
+
+    // The rest, the large blocks included, are left for cleanup to release
+    k_exit(0);
+
+    return 0;
+}
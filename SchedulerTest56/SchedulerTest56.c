@@ -0,0 +1,265 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "THREADSLib.h"
+#include "SchedulerTesting.h"
+#include "Scheduler.h"
+#include "Messaging.h"
+#include "SharedMemory.h"
+
+#define TOTAL_BYTES         (4 * 1024 * 1024)   // Sent from the producer to the consumer
+#define BUFFER_BYTES        (64 * 1024)         // Each of the two buffers in the shared segment
+#define BUFFERS             2
+
+int Writer(char* strArgs);
+int Survivor(char* strArgs);
+int MailboxProducer(char* strArgs);
+int MailboxConsumer(char* strArgs);
+int SharedProducer(char* strArgs);
+int SharedConsumer(char* strArgs);
+static void TestLifetime(char* testName);
+static void RunTransfer(char* testName, char* how, int (*producer)(char*), int (*consumer)(char*));
+static void ReportStats(char* testName);
+
+static int dataMailbox;         // Carries the data, or the index of a full buffer
+static int freeMailbox;         // Carries the index of a buffer the producer can fill
+static unsigned int producerSum;
+static unsigned int consumerSum;
+
+/*********************************************************************************
+*
+* SchedulerTest56
+*
+* Tests shared memory segments.
+*
+* A child attaches to a segment its parent created, writes to it and exits
+* without detaching, and the parent reads what it wrote. The segment is freed
+* when the parent detaches. A second segment is detached by its creator while
+* a child is still attached; the child can still read it, and it is freed
+* when the child is cleaned up. Creating a name that exists, attaching to one
+* that does not and detaching an address that is not a segment all fail.
+*
+* Then TOTAL_BYTES are sent from a producer to a consumer, first copied
+* through a mailbox MAX_MESSAGE bytes at a time, then written into BUFFERS
+* buffers of a shared segment, with only the index of each full buffer sent
+* through a mailbox. Both ways should deliver the same checksum.
+*
+*********************************************************************************/
+int SchedulerEntryPoint(void* pArgs)
+{
+    char* testName = "SchedulerTest56";
+
+    console_output(FALSE, "\n%s: started\n", testName);
+
+    TestLifetime(testName);
+
+    RunTransfer(testName, "through a mailbox", MailboxProducer, MailboxConsumer);
+    RunTransfer(testName, "through shared memory", SharedProducer, SharedConsumer);
+    ReportStats(testName);
+
+    k_exit(0);
+
+    return 0;
+}
+
+static void TestLifetime(char* testName)
+{
+    char* pResults;
+    char* pOrphan;
+    void* pAddress;
+    int result;
+    int status;
+
+    console_output(FALSE, "%s: k_shm_create returned %d\n", testName,
+        k_shm_create("results", 4096, (void**)&pResults));
+    console_output(FALSE, "%s: creating it again returned %d\n", testName,
+        k_shm_create("results", 4096, &pAddress));
+
+    k_spawn("Writer", Writer, "Writer", THREADS_MIN_STACK_SIZE, 3);
+    k_wait(&status);
+    console_output(FALSE, "%s: after the writer was cleaned up, %d attached, it wrote \"%s\"\n", testName,
+        get_shm_refs("results"), pResults);
+
+    result = k_shm_detach(pResults);
+    console_output(FALSE, "%s: k_shm_detach returned %d, then %d attached\n", testName, result,
+        get_shm_refs("results"));
+    result = k_shm_detach(pResults);
+    console_output(FALSE, "%s: detaching again returned %d, attaching returned %d\n", testName, result,
+        k_shm_attach("results", &pAddress, NULL));
+
+    k_shm_create("orphan", 4096, (void**)&pOrphan);
+    strcpy(pOrphan, "left by the parent");
+    k_spawn("Survivor", Survivor, "Survivor", THREADS_MIN_STACK_SIZE, 3);
+    k_sleep(20);
+    console_output(FALSE, "%s: orphan has %d attached\n", testName, get_shm_refs("orphan"));
+    result = k_shm_detach(pOrphan);
+    console_output(FALSE, "%s: parent detaching returned %d, then %d attached\n", testName, result,
+        get_shm_refs("orphan"));
+    k_wait(&status);
+    console_output(FALSE, "%s: after the survivor was cleaned up, orphan has %d attached\n", testName,
+        get_shm_refs("orphan"));
+
+    ReportStats(testName);
+}
+
+int Writer(char* strArgs)
+{
+    void* pAddress;
+    int size = 0;
+    int result = k_shm_attach("results", &pAddress, &size);
+
+    console_output(FALSE, "%s: k_shm_attach returned %d, size %d, %d attached\n", strArgs, result, size,
+        get_shm_refs("results"));
+    strcpy(pAddress, "written by the child");
+
+    k_exit(0);
+
+    return 0;
+}
+
+int Survivor(char* strArgs)
+{
+    void* pAddress;
+
+    // Attaches while the parent sleeps, then reads after the parent has detached
+    k_shm_attach("orphan", &pAddress, NULL);
+    k_sleep(50);
+    console_output(FALSE, "%s: orphan still reads \"%s\"\n", strArgs, (char*)pAddress);
+
+    k_exit(0);
+
+    return 0;
+}
+
+static void RunTransfer(char* testName, char* how, int (*producer)(char*), int (*consumer)(char*))
+{
+    DWORD startTime;
+    DWORD elapsed;
+    int status;
+
+    producerSum = 0;
+    consumerSum = 0;
+    dataMailbox = k_mailbox_create(BUFFERS, MAX_MESSAGE);
+    freeMailbox = k_mailbox_create(BUFFERS, sizeof(int));
+
+    startTime = read_clock();
+    k_spawn("Consumer", consumer, "Consumer", THREADS_MIN_STACK_SIZE, 3);
+    k_spawn("Producer", producer, "Producer", THREADS_MIN_STACK_SIZE, 3);
+    k_wait(&status);
+    k_wait(&status);
+    elapsed = read_clock() - startTime;
+
+    k_mailbox_release(dataMailbox);
+    k_mailbox_release(freeMailbox);
+
+    console_output(FALSE, "%s: %d bytes %s in %lu us, %lu MB/s, checksums %s\n", testName, TOTAL_BYTES, how,
+        (unsigned long)elapsed, (unsigned long)(elapsed > 0 ? (unsigned long long)TOTAL_BYTES / elapsed : 0),
+        producerSum == consumerSum ? "match" : "differ");
+}
+
+int MailboxProducer(char* strArgs)
+{
+    unsigned char message[MAX_MESSAGE];
+
+    for (int sent = 0; sent < TOTAL_BYTES; sent += MAX_MESSAGE)
+    {
+        for (int i = 0; i < MAX_MESSAGE; i++)
+        {
+            message[i] = (unsigned char)((sent + i) * 7);
+            producerSum += message[i];
+        }
+        k_mailbox_send(dataMailbox, message, MAX_MESSAGE);
+    }
+
+    k_exit(0);
+
+    return 0;
+}
+
+int MailboxConsumer(char* strArgs)
+{
+    unsigned char message[MAX_MESSAGE];
+
+    for (int received = 0; received < TOTAL_BYTES; received += MAX_MESSAGE)
+    {
+        k_mailbox_receive(dataMailbox, message, MAX_MESSAGE);
+        for (int i = 0; i < MAX_MESSAGE; i++)
+        {
+            consumerSum += message[i];
+        }
+    }
+
+    k_exit(0);
+
+    return 0;
+}
+
+int SharedProducer(char* strArgs)
+{
+    unsigned char* pBuffers;
+    int index;
+
+    k_shm_create("transfer", BUFFERS * BUFFER_BYTES, (void**)&pBuffers);
+    for (index = 0; index < BUFFERS; index++)
+    {
+        k_mailbox_send(freeMailbox, &index, sizeof(index));
+    }
+
+    for (int sent = 0; sent < TOTAL_BYTES; sent += BUFFER_BYTES)
+    {
+        unsigned char* pBuffer;
+
+        k_mailbox_receive(freeMailbox, &index, sizeof(index));
+        pBuffer = pBuffers + index * BUFFER_BYTES;
+        for (int i = 0; i < BUFFER_BYTES; i++)
+        {
+            pBuffer[i] = (unsigned char)((sent + i) * 7);
+            producerSum += pBuffer[i];
+        }
+        k_mailbox_send(dataMailbox, &index, sizeof(index));
+    }
+
+    // Exits attached; the segment lasts until the consumer is done with it too
+    k_exit(0);
+
+    return 0;
+}
+
+int SharedConsumer(char* strArgs)
+{
+    unsigned char* pBuffers = NULL;
+    int index;
+
+    for (int received = 0; received < TOTAL_BYTES; received += BUFFER_BYTES)
+    {
+        unsigned char* pBuffer;
+
+        k_mailbox_receive(dataMailbox, &index, sizeof(index));
+        if (pBuffers == NULL)
+        {
+            k_shm_attach("transfer", (void**)&pBuffers, NULL);
+        }
+        pBuffer = pBuffers + index * BUFFER_BYTES;
+        for (int i = 0; i < BUFFER_BYTES; i++)
+        {
+            consumerSum += pBuffer[i];
+        }
+        k_mailbox_send(freeMailbox, &index, sizeof(index));
+    }
+
+    k_shm_detach(pBuffers);
+
+    k_exit(0);
+
+    return 0;
+}
+
+static void ReportStats(char* testName)
+{
+    shm_stats_t stats;
+
+    get_shm_stats(&stats);
+    console_output(FALSE, "%s: %d segments of %d bytes, %u created, %u destroyed, %u attaches, %u detaches, "
+        "%u at cleanup\n", testName, stats.segments, stats.bytes, stats.created, stats.destroyed, stats.attaches,
+        stats.detaches, stats.cleanedUp);
+}
@@ -0,0 +1,247 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "THREADSLib.h"
+#include "SchedulerTesting.h"
+#include "Scheduler.h"
+#include "VirtualMemory.h"
+#include "SharedMemory.h"
+
+#define SWAP_UNIT           1
+#define FRAMES              32
+#define PAGES               64      // Twice the frames, so shared pages are paged out and back in
+#define BENCH_FRAMES        VM_MAX_FRAMES
+#define SPAWNS               20      // Spawns timed for each size
+#define WORKER_STACK        (4 * THREADS_MIN_STACK_SIZE)
+
+int Original(char* strArgs);
+int Reader(char* strArgs);
+int Writer(char* strArgs);
+int Spawner(char* strArgs);
+int Exiter(char* strArgs);
+int Toucher(char* strArgs);
+int Copier(char* strArgs);
+static int WritePages(int base, int first, int count, int pass);
+static int CheckPages(int base, int first, int count, int pass);
+static void ReportStats(char* name);
+
+static int sizes[] = { 0, 16, 64, 128, 255 };
+static int gBase;               // Address of the pages the children inherit
+static int gPages;
+
+/*********************************************************************************
+*
+* SchedulerTest57
+*
+* Tests and benchmarks k_spawn_cow, which spawns children that share their
+* parent's pages copy-on-write.
+*
+* With FRAMES frames and disk 1 as swap, a process writes PAGES pages and spawns
+* two children of lower priority with k_spawn_cow, which share all of them. It
+* then writes the first half again. The reader checks that it still sees every
+* page as it was at the spawn, and the writer writes the second half and checks
+* all of them. The parent, last, should see its own first half and the original
+* second half, as the writer's changes were copies of its own. The children are
+* also attached to a shared memory segment the parent created before spawning
+* them.
+*
+* Then, with BENCH_FRAMES frames, a spawner writes each of a range of sizes of
+* pages and spawns SPAWNS children that exit at once, timing k_spawn_cow, which
+* should grow with the size only by the cost of marking each page shared. A toucher
+* child reads every page it inherits and a copier child writes every page, the
+* second paying for a copy of each page, which k_spawn_cow did not.
+*
+*********************************************************************************/
+int SchedulerEntryPoint(void* pArgs)
+{
+    char* testName = "SchedulerTest57";
+    char sizeArg[8];
+    int status;
+
+    console_output(FALSE, "\n%s: started\n", testName);
+
+    console_output(FALSE, "%s: vm_set_swap returned %d, vm_set_frames returned %d\n", testName,
+        vm_set_swap(SWAP_UNIT, 16), vm_set_frames(FRAMES));
+    k_spawn("Original", Original, "Original", WORKER_STACK, 3);
+    k_wait(&status);
+
+    // The frames can change once the original and its children have released theirs
+    console_output(FALSE, "%s: vm_set_frames returned %d\n", testName, vm_set_frames(BENCH_FRAMES));
+    for (int i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++)
+    {
+        snprintf(sizeArg, sizeof(sizeArg), "%d", sizes[i]);
+        k_spawn("Spawner", Spawner, sizeArg, WORKER_STACK, 3);
+        k_wait(&status);
+    }
+
+    k_exit(0);
+
+    return 0;
+}
+
+int Original(char* strArgs)
+{
+    void* pSegment;
+    int errors;
+    int status;
+
+    gBase = k_vm_allocate(PAGES * VM_PAGE_SIZE);
+    errors = WritePages(gBase, 0, PAGES, 1);
+    k_shm_create("inherited", 64, &pSegment);
+
+    console_output(FALSE, "%s: spawned pid %d\n", strArgs, k_spawn_cow("Reader", Reader, "Reader", WORKER_STACK, 2));
+    console_output(FALSE, "%s: spawned pid %d\n", strArgs, k_spawn_cow("Writer", Writer, "Writer", WORKER_STACK, 2));
+    ReportStats(strArgs);
+
+    errors += WritePages(gBase, 0, PAGES / 2, 2);
+    k_wait(&status);
+    k_wait(&status);
+
+    errors += CheckPages(gBase, 0, PAGES / 2, 2);
+    errors += CheckPages(gBase, PAGES / 2, PAGES / 2, 1);
+    console_output(FALSE, "%s: %d errors, %d attached to the segment\n", strArgs, errors, get_shm_refs("inherited"));
+    ReportStats(strArgs);
+
+    k_exit(0);
+
+    return 0;
+}
+
+int Reader(char* strArgs)
+{
+    int errors = CheckPages(gBase, 0, PAGES, 1);
+
+    console_output(FALSE, "%s: %d errors, %d attached to the segment\n", strArgs, errors, get_shm_refs("inherited"));
+    ReportStats(strArgs);
+
+    k_exit(0);
+
+    return 0;
+}
+
+int Writer(char* strArgs)
+{
+    int errors = WritePages(gBase, PAGES / 2, PAGES / 2, 3);
+
+    errors += CheckPages(gBase, 0, PAGES / 2, 1);
+    errors += CheckPages(gBase, PAGES / 2, PAGES / 2, 3);
+    console_output(FALSE, "%s: %d errors\n", strArgs, errors);
+    ReportStats(strArgs);
+
+    k_exit(0);
+
+    return 0;
+}
+
+int Spawner(char* strArgs)
+{
+    DWORD startTime;
+    DWORD elapsed = 0;
+    int errors = 0;
+    int status;
+
+    gPages = atoi(strArgs);
+    gBase = gPages > 0 ? k_vm_allocate(gPages * VM_PAGE_SIZE) : 0;
+    errors += WritePages(gBase, 0, gPages, 1);
+
+    // The children are of lower priority, so each spawn returns before its child runs
+    for (int i = 0; i < SPAWNS; i++)
+    {
+        startTime = read_clock();
+        errors += k_spawn_cow("Exiter", Exiter, NULL, WORKER_STACK, 2) <= 0;
+        elapsed += read_clock() - startTime;
+        k_wait(&status);
+    }
+
+    k_spawn_cow("Toucher", Toucher, "Toucher", WORKER_STACK, 2);
+    k_wait(&status);
+    k_spawn_cow("Copier", Copier, "Copier", WORKER_STACK, 2);
+    k_wait(&status);
+
+    console_output(FALSE, "Spawner: %3d pages, %lu us per spawn, %d errors\n", gPages,
+        (unsigned long)(elapsed / SPAWNS), errors);
+
+    k_exit(0);
+
+    return 0;
+}
+
+int Exiter(char* strArgs)
+{
+    k_exit(0);
+
+    return 0;
+}
+
+int Toucher(char* strArgs)
+{
+    DWORD startTime = read_clock();
+    int errors = CheckPages(gBase, 0, gPages, 1);
+    DWORD elapsed = read_clock() - startTime;
+
+    console_output(FALSE, "%s: %3d pages read in %lu us, %d errors\n", strArgs, gPages, (unsigned long)elapsed,
+        errors);
+
+    k_exit(0);
+
+    return 0;
+}
+
+int Copier(char* strArgs)
+{
+    DWORD startTime = read_clock();
+    int errors = WritePages(gBase, 0, gPages, 2);
+    DWORD elapsed = read_clock() - startTime;
+    vm_stats_t stats = { 0 };
+
+    get_vm_stats(k_getpid(), &stats);
+    console_output(FALSE, "%s: %3d pages written in %lu us, %u copied on write, %d errors\n", strArgs, gPages,
+        (unsigned long)elapsed, stats.cowFaults, errors + CheckPages(gBase, 0, gPages, 2));
+
+    k_exit(0);
+
+    return 0;
+}
+
+static int WritePages(int base, int first, int count, int pass)
+{
+    int page[VM_PAGE_SIZE / sizeof(int)];
+    int errors = 0;
+
+    for (int i = first; i < first + count; i++)
+    {
+        for (int j = 0; j < VM_PAGE_SIZE / sizeof(int); j++)
+        {
+            page[j] = pass * 1000000 + i * 1000 + j;
+        }
+        errors += k_vm_write(base + i * VM_PAGE_SIZE, page, VM_PAGE_SIZE) != 0;
+    }
+
+    return errors;
+}
+
+static int CheckPages(int base, int first, int count, int pass)
+{
+    int page[VM_PAGE_SIZE / sizeof(int)];
+    int errors = 0;
+
+    for (int i = first; i < first + count; i++)
+    {
+        errors += k_vm_read(base + i * VM_PAGE_SIZE, page, VM_PAGE_SIZE) != 0;
+        for (int j = 0; j < VM_PAGE_SIZE / sizeof(int); j++)
+        {
+            errors += page[j] != pass * 1000000 + i * 1000 + j;
+        }
+    }
+
+    return errors;
+}
+
+static void ReportStats(char* name)
+{
+    vm_stats_t stats;
+
+    get_vm_stats(k_getpid(), &stats);
+    console_output(FALSE, "%s: %d pages shared, %d resident, %u copied on write, %u faults, %u page ins\n", name,
+        stats.sharedPages, stats.residentPages, stats.cowFaults, stats.pageFaults, stats.pageIns);
+}
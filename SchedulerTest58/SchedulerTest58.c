@@ -0,0 +1,121 @@
+#include <stdio.h>
+#include <string.h>
+#include "THREADSLib.h"
+#include "SchedulerTesting.h"
+#include "Scheduler.h"
+#include "SystemCalls.h"
+
+int UserSpawner(char* strArgs);
+int UserChild(char* strArgs);
+static void Report(char* name, char* label, int result);
+static void ReportKernel(char* name, char* label, int result);
+
+/*********************************************************************************
+*
+* SchedulerTest58
+*
+* Tests that the spawn system call refuses bad arguments from a user process
+* instead of halting or corrupting the kernel, and that k_spawn gives its
+* caller back the interrupt state it was called with.
+*
+* The entry process calls k_spawn with a stack that is too small and then with
+* good arguments, with interrupts enabled and again with them disabled, and
+* checks the interrupts right after each call. It cannot be checked after a
+* system call, as trap restores the caller's state.
+*
+* A user process then asks for a child with a name longer than MAXNAME,
+* arguments longer than MAXARG, a NULL entry point, a stack that is too small
+* and an invalid priority, each of which must fail. It then spawns lower
+* priority children until the process table is full, when the next spawn must
+* fail too, and waits for them all.
+*
+* Expected Output:
+* SchedulerTest58: failing spawn returned -4, interrupts enabled
+* SchedulerTest58: spawn returned 3, interrupts enabled
+* SchedulerTest58: failing spawn returned -4, interrupts disabled
+* SchedulerTest58: spawn returned 4, interrupts disabled
+* UserSpawner: name too long returned -1
+* UserSpawner: arguments too long returned -1
+* UserSpawner: NULL entry point returned -1
+* UserSpawner: stack too small returned -4
+* UserSpawner: invalid priority returned -5
+* UserSpawner: table full after 47 children
+* UserSpawner: process table full returned -1
+*
+*********************************************************************************/
+int SchedulerEntryPoint(void* pArgs)
+{
+    char* testName = "SchedulerTest58";
+    int status = -1, kidpid;
+
+    console_output(FALSE, "\n%s: started\n", testName);
+
+    ReportKernel(testName, "failing spawn", k_spawn("UserChild", UserChild, NULL, THREADS_MIN_STACK_SIZE - 1, 2));
+    ReportKernel(testName, "spawn", k_spawn("UserChild", UserChild, NULL, THREADS_MIN_STACK_SIZE, 2));
+    disableInterrupts();
+    ReportKernel(testName, "failing spawn", k_spawn("UserChild", UserChild, NULL, THREADS_MIN_STACK_SIZE - 1, 2));
+    ReportKernel(testName, "spawn", k_spawn("UserChild", UserChild, NULL, THREADS_MIN_STACK_SIZE, 2));
+    enableInterrupts();
+    k_wait(&status);
+    k_wait(&status);
+
+    kidpid = sys_spawn("UserSpawner", UserSpawner, "UserSpawner", THREADS_MIN_STACK_SIZE, 3);
+    kidpid = k_wait(&status);
+    console_output(FALSE, "%s: user process %d quit with status %d\n", testName, kidpid, status);
+
+    k_exit(0);
+
+    return 0;
+}
+
+int UserSpawner(char* strArgs)
+{
+    char longString[MAXNAME + MAXARG];
+    int status;
+    int children = 0;
+    int result;
+
+    memset(longString, 'x', sizeof(longString) - 1);
+    longString[sizeof(longString) - 1] = '\0';
+
+    Report(strArgs, "name too long", sys_spawn(longString, UserChild, NULL, THREADS_MIN_STACK_SIZE, 2));
+    Report(strArgs, "arguments too long", sys_spawn("UserChild", UserChild, longString, THREADS_MIN_STACK_SIZE, 2));
+    Report(strArgs, "NULL entry point", sys_spawn("UserChild", NULL, NULL, THREADS_MIN_STACK_SIZE, 2));
+    Report(strArgs, "stack too small", sys_spawn("UserChild", UserChild, NULL, THREADS_MIN_STACK_SIZE - 1, 2));
+    Report(strArgs, "invalid priority", sys_spawn("UserChild", UserChild, NULL, THREADS_MIN_STACK_SIZE, 9));
+
+    // The children are of lower priority, so none quits before the table is full
+    while ((result = sys_spawn("UserChild", UserChild, NULL, THREADS_MIN_STACK_SIZE, 2)) > 0)
+    {
+        children++;
+    }
+    console_output(FALSE, "%s: table full after %d children\n", strArgs, children);
+    Report(strArgs, "process table full", result);
+
+    while (children > 0 && sys_wait(&status) > 0)
+    {
+        children--;
+    }
+    console_output(FALSE, "%s: %d children left unwaited\n", strArgs, children);
+
+    return 0;
+}
+
+int UserChild(char* strArgs)
+{
+    return 1;
+}
+
+static void Report(char* name, char* label, int result)
+{
+    console_output(FALSE, "%s: %s returned %d\n", name, label, result);
+}
+
+// Must be called right after a kernel mode call, before anything changes the interrupts
+static void ReportKernel(char* name, char* label, int result)
+{
+    int enabled = (get_psr() & PSR_INTERRUPTS) != 0;
+
+    console_output(FALSE, "%s: %s returned %d, interrupts %s\n", name, label, result,
+        enabled ? "enabled" : "disabled");
+}
@@ -1,6 +1,7 @@
 
 #define _CRT_SECURE_NO_WARNINGS
 #include <stdio.h>
+#include <stdlib.h>
 #include "THREADSLib.h"
 #include "SchedulerTesting.h"
 #include "Scheduler.h"
@@ -15,7 +16,27 @@ int SignalAndJoinTwoLower(char* strArgs);
 
 
 /*
-*  SystemDelay - busy wait delay for the specified time.
+*  SleepingDelays - TRUE when the SCHEDULER_TEST_SLEEP environment variable
+*                   is set, making SystemDelay and DelayAndDump sleep with
+*                   k_sleep instead of busy waiting, so every delay based
+*                   test can be run both ways. Only the sleeping run reports
+*                   CPU times, so the busy waiting output stays as it was.
+*/
+int SleepingDelays(void)
+{
+    static int sleeping = -1;
+
+    if (sleeping < 0)
+    {
+        sleeping = getenv("SCHEDULER_TEST_SLEEP") != NULL;
+    }
+
+    return sleeping;
+}
+
+/*
+*  SystemDelay - busy wait delay for the specified time, or sleep for it
+*                when SleepingDelays is set.
 */
 #pragma optimize( "", off )
 void SystemDelay(int millisTime)
@@ -23,6 +44,12 @@ void SystemDelay(int millisTime)
     unsigned int startTime;
     unsigned int currentTime;
 
+    if (SleepingDelays())
+    {
+        k_sleep(millisTime);
+        return;
+    }
+
     currentTime = startTime = read_clock() / 1000;
     while ((currentTime - startTime) < (unsigned int)millisTime)
     {
@@ -33,7 +60,8 @@ void SystemDelay(int millisTime)
 
 /*
 *  DelayAndDump - delays and with dumps process if name ends 
-*                 in a value divisible by 4.
+*                 in a value divisible by 4. Runs SleepAndDump instead
+*                 when SleepingDelays is set.
 */
 int DelayAndDump(char* arg)
 {
@@ -46,6 +74,11 @@ int DelayAndDump(char* arg)
     char argString[256];
 
 
+    if (SleepingDelays())
+    {
+        return SleepAndDump(arg);
+    }
+
     memset(argString, 0, sizeof(argString));
     if (arg != NULL)
     {
@@ -90,6 +123,56 @@ int DelayAndDump(char* arg)
 }
 
 
+/*
+*  SleepAndDump - same schedule as DelayAndDump, but sleeps with k_sleep
+*                 instead of busy waiting and reports the CPU time it used.
+*/
+int SleepAndDump(char* arg)
+{
+    int printingThread = 0;
+    int printAt = 2500;
+    int stopAt = 10000;
+    int startTime;
+    int testNumber;
+    char argString[256];
+
+
+    memset(argString, 0, sizeof(argString));
+    if (arg != NULL)
+    {
+        strncpy(argString, arg, strlen(arg));
+    }
+
+    console_output(FALSE, "%s: started\n", argString);
+
+    // Get the test number
+    testNumber = GetChildNumber(argString);
+
+    console_output(FALSE, "%s: started, child number is %d\n", argString, testNumber);
+
+    if ((testNumber % 4) == 0)
+    {
+        printingThread = 1;
+    }
+
+    startTime = read_clock() / 1000;
+    if (printingThread)
+    {
+        while (printAt < stopAt)
+        {
+            k_sleep_until(startTime + printAt);
+            display_process_table();
+            printAt += 5000;
+        }
+    }
+    k_sleep_until(startTime + stopAt);
+
+    console_output(FALSE, "%s: exiting, pid = %d, cpu time = %d ms\n", argString, k_getpid(), read_time());
+    k_exit(-k_getpid());
+    return 0;
+}
+
+
 /*********************************************************************************
 *
 * SimpleDelayExit
@@ -103,7 +186,14 @@ int SimpleDelayExit(void* pArgs)
     {
         console_output(FALSE, "%s: started\n", (char*)pArgs);
         SystemDelay(10);
-        console_output(FALSE, "%s: quitting\n", (char*)pArgs);
+        if (SleepingDelays())
+        {
+            console_output(FALSE, "%s: quitting, cpu time = %d ms\n", (char*)pArgs, read_time());
+        }
+        else
+        {
+            console_output(FALSE, "%s: quitting\n", (char*)pArgs);
+        }
     }
 
     k_exit(-3);
@@ -0,0 +1,356 @@
+/*
+Program: SharedMemory
+Created by: Ian Penrose & Lindsay Wax
+Course: CYBV 489
+
+
+Description: Named shared memory segments. k_shm_create makes a zeroed segment and
+attaches the creating process to it, and other processes attach to it by name, getting
+the same memory, so producers and consumers can hand each other large buffers without
+copying them through mailboxes.
+
+Each segment counts the processes attached to it, each process at most once. A process
+is detached by k_shm_detach or, for the segments it is still attached to, when it is
+cleaned up. The segment is freed when its last process is detached, and its name can
+then be used again.
+*/
+
+
+
+#define _CRT_SECURE_NO_WARNINGS
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "THREADSLib.h"
+#include "Scheduler.h"
+#include "SharedMemory.h"
+#include "Processes.h"
+
+/*
+SharedSegments are the memory of one segment and which processes are attached to it.
+*/
+typedef struct
+{
+    int             inUse;
+    char            name[SHM_NAME_LENGTH];
+    int             size;
+    char*           pMemory;
+    int             refs;                       // Processes attached
+    char            attached[MAX_PROCESSES];    // TRUE for each process table slot attached
+
+} SharedSegment;
+
+static SharedSegment segments[SHM_MAX_SEGMENTS];
+static shm_stats_t shmStats;
+
+static SharedSegment* findByName(char* name);
+static SharedSegment* findByAddress(void* pAddress);
+static void detach(SharedSegment* pSegment, int slot);
+
+/**************************************************************************
+   Name - shm_initialize
+
+   Purpose - Clears the segment table. Called once from bootstrap.
+*************************************************************************/
+void shm_initialize(void)
+{
+    memset(segments, 0, sizeof(segments));
+    memset(&shmStats, 0, sizeof(shmStats));
+}
+
+/**************************************************************************
+   Name - k_shm_create
+
+   Purpose - Creates a segment of zeroed memory and attaches the running
+             process to it.
+
+   Parameters - name, the name other processes attach to it by
+                size, the number of bytes
+                ppAddress, where to store the address of the memory
+
+   Returns - 0 if successful, -1 if the parameters are invalid,
+        SHM_EXISTS if a segment already has the name, or SHM_NO_SPACE if
+        every segment is in use or the host has no memory left
+*************************************************************************/
+int k_shm_create(char* name, int size, void** ppAddress)
+{
+    SharedSegment* pSegment = NULL;
+    char* pMemory;
+
+    check_kernel_mode("k_shm_create");
+
+    if (name == NULL || name[0] == '\0' || strlen(name) >= SHM_NAME_LENGTH || size <= 0 || ppAddress == NULL)
+    {
+        return -1;
+    }
+
+    disableInterrupts();
+
+    if (findByName(name) != NULL)
+    {
+        enableInterrupts();
+        return SHM_EXISTS;
+    }
+
+    for (int i = 0; i < SHM_MAX_SEGMENTS && pSegment == NULL; i++)
+    {
+        if (!segments[i].inUse)
+        {
+            pSegment = &segments[i];
+        }
+    }
+    pMemory = pSegment != NULL ? calloc(1, size) : NULL;
+    if (pMemory == NULL)
+    {
+        enableInterrupts();
+        return SHM_NO_SPACE;
+    }
+
+    pSegment->inUse = TRUE;
+    strcpy(pSegment->name, name);
+    pSegment->size = size;
+    pSegment->pMemory = pMemory;
+    pSegment->refs = 1;
+    pSegment->attached[runningProcess - processTable] = TRUE;
+
+    shmStats.segments++;
+    shmStats.bytes += size;
+    shmStats.created++;
+    shmStats.attaches++;
+
+    enableInterrupts();
+
+    *ppAddress = pMemory;
+
+    return 0;
+}
+
+/**************************************************************************
+   Name - k_shm_attach
+
+   Purpose - Attaches the running process to a segment. A process already
+             attached gets the same memory without being counted again.
+
+   Parameters - name, the segment's name
+                ppAddress, where to store the address of the memory
+                pSize, where to store the size of the segment, or NULL
+
+   Returns - 0 if successful, -1 if the parameters are invalid, or
+        SHM_NOT_FOUND if no segment has the name
+*************************************************************************/
+int k_shm_attach(char* name, void** ppAddress, int* pSize)
+{
+    SharedSegment* pSegment;
+    int slot = runningProcess - processTable;
+
+    check_kernel_mode("k_shm_attach");
+
+    if (name == NULL || ppAddress == NULL)
+    {
+        return -1;
+    }
+
+    disableInterrupts();
+
+    pSegment = findByName(name);
+    if (pSegment == NULL)
+    {
+        enableInterrupts();
+        return SHM_NOT_FOUND;
+    }
+
+    if (!pSegment->attached[slot])
+    {
+        pSegment->attached[slot] = TRUE;
+        pSegment->refs++;
+        shmStats.attaches++;
+    }
+
+    *ppAddress = pSegment->pMemory;
+    if (pSize != NULL)
+    {
+        *pSize = pSegment->size;
+    }
+
+    enableInterrupts();
+
+    return 0;
+}
+
+/**************************************************************************
+   Name - k_shm_detach
+
+   Purpose - Detaches the running process from a segment, freeing the
+             segment if no other process is attached.
+
+   Parameters - pAddress, the address k_shm_create or k_shm_attach gave
+
+   Returns - 0 if successful, -1 if the running process is not attached
+        to a segment at pAddress
+*************************************************************************/
+int k_shm_detach(void* pAddress)
+{
+    SharedSegment* pSegment;
+    int slot = runningProcess - processTable;
+
+    check_kernel_mode("k_shm_detach");
+
+    disableInterrupts();
+
+    pSegment = findByAddress(pAddress);
+    if (pSegment == NULL || !pSegment->attached[slot])
+    {
+        enableInterrupts();
+        return -1;
+    }
+
+    shmStats.detaches++;
+    detach(pSegment, slot);
+
+    enableInterrupts();
+
+    return 0;
+}
+
+/**************************************************************************
+   Name - shm_release
+
+   Purpose - Detaches a process being cleaned up from every segment it is
+             still attached to.
+
+   Parameters - pProcess, the process, which must not be running
+*************************************************************************/
+void shm_release(Process* pProcess)
+{
+    int slot = pProcess - processTable;
+    uint32_t psr = get_psr();
+
+    disableInterrupts();
+
+    for (int i = 0; i < SHM_MAX_SEGMENTS; i++)
+    {
+        if (segments[i].inUse && segments[i].attached[slot])
+        {
+            shmStats.cleanedUp++;
+            detach(&segments[i], slot);
+        }
+    }
+
+    set_psr(psr);
+}
+
+/**************************************************************************
+   Name - shm_inherit
+
+   Purpose - Attaches a child being spawned by k_spawn_cow to every
+             segment its parent is attached to.
+
+   Parameters - pParent, the process spawning it
+                pChild, the child, which has not run yet
+*************************************************************************/
+void shm_inherit(Process* pParent, Process* pChild)
+{
+    int parentSlot = pParent - processTable;
+    int childSlot = pChild - processTable;
+    uint32_t psr = get_psr();
+
+    disableInterrupts();
+
+    for (int i = 0; i < SHM_MAX_SEGMENTS; i++)
+    {
+        if (segments[i].inUse && segments[i].attached[parentSlot] && !segments[i].attached[childSlot])
+        {
+            segments[i].attached[childSlot] = TRUE;
+            segments[i].refs++;
+            shmStats.attaches++;
+        }
+    }
+
+    set_psr(psr);
+}
+
+/**************************************************************************
+   Name - get_shm_refs
+
+   Returns - the number of processes attached to the segment with the
+        name, or SHM_NOT_FOUND if no segment has it
+*************************************************************************/
+int get_shm_refs(char* name)
+{
+    SharedSegment* pSegment = findByName(name);
+
+    return pSegment != NULL ? pSegment->refs : SHM_NOT_FOUND;
+}
+
+/**************************************************************************
+   Name - get_shm_stats
+
+   Purpose - Copies the shared memory counters.
+*************************************************************************/
+void get_shm_stats(shm_stats_t* pStats)
+{
+    if (pStats != NULL)
+    {
+        *pStats = shmStats;
+    }
+}
+
+/**************************************************************************
+   Name - findByName
+
+   Returns - the segment with the name, or NULL if there is none
+*************************************************************************/
+static SharedSegment* findByName(char* name)
+{
+    for (int i = 0; i < SHM_MAX_SEGMENTS; i++)
+    {
+        if (segments[i].inUse && strcmp(segments[i].name, name) == 0)
+        {
+            return &segments[i];
+        }
+    }
+
+    return NULL;
+}
+
+/**************************************************************************
+   Name - findByAddress
+
+   Returns - the segment whose memory starts at pAddress, or NULL if there
+        is none
+*************************************************************************/
+static SharedSegment* findByAddress(void* pAddress)
+{
+    for (int i = 0; i < SHM_MAX_SEGMENTS; i++)
+    {
+        if (segments[i].inUse && segments[i].pMemory == pAddress && pAddress != NULL)
+        {
+            return &segments[i];
+        }
+    }
+
+    return NULL;
+}
+
+/**************************************************************************
+   Name - detach
+
+   Purpose - Detaches a process table slot from a segment and frees the
+             segment if it was the last one attached. Called with
+             interrupts disabled.
+*************************************************************************/
+static void detach(SharedSegment* pSegment, int slot)
+{
+    pSegment->attached[slot] = FALSE;
+    if (--pSegment->refs > 0)
+    {
+        return;
+    }
+
+    free(pSegment->pMemory);
+    shmStats.segments--;
+    shmStats.bytes -= pSegment->size;
+    shmStats.destroyed++;
+    memset(pSegment, 0, sizeof(SharedSegment));
+}
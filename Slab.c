@@ -0,0 +1,581 @@
+/*
+Program: Slab
+Created by: Ian Penrose & Lindsay Wax
+Course: CYBV 489
+
+
+Description: Object caches for the kernel objects that are allocated and freed as
+processes come and go. Each cache hands out objects of one size from slabs, blocks of
+memory aligned to their own size and cut into slots of whole cache lines, so an object
+never shares a cache line with another and the slab an object belongs to is found by
+masking its address.
+
+Objects are built by the cache's constructor once, when their slab is created, and are
+freed back in that state, so allocating one only takes a slot off its slab's free stack.
+A cache keeps its slabs on three lists, partly used, full and empty, and takes objects
+from partly used slabs before empty ones so that slabs can empty out. Empty slabs are
+kept for later allocations until slab_cache_shrink releases them, so a burst of
+allocations and frees does not create and construct the same slabs over and over.
+
+Allocation and freeing disable interrupts and put back whatever state they found, so
+they can be called from code that already has interrupts disabled.
+*/
+
+
+
+#define _CRT_SECURE_NO_WARNINGS
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include "THREADSLib.h"
+#ifdef _WIN32
+#include <malloc.h>
+#endif
+#include "Scheduler.h"
+#include "Slab.h"
+#include "Processes.h"
+
+#define MIN_SLAB_BYTES      16384
+#define MIN_SLAB_OBJECTS    8       // Slabs are made bigger until this many objects fit
+#define TIMING_INTERVAL     16      // One allocation and one free in this many are timed
+
+#define LIST_PARTIAL        0
+#define LIST_FULL           1
+#define LIST_EMPTY          2
+
+/* Header at the start of each slab, followed by the free stack, then the slots. */
+typedef struct _slab
+{
+    struct _slab*       next;           // Next slab on the same list of the cache
+    struct _slab*       prev;
+    int                 cache;
+    int                 list;           // LIST_*
+    int                 inUse;          // Objects handed out
+    int                 freeCount;      // Entries on the free stack
+    char*               pSlots;
+    unsigned short      freeStack[];    // Slot numbers of the free objects
+} Slab;
+
+typedef struct
+{
+    int                 created;
+    slab_constructor_t  pConstructor;
+    Slab*               lists[3];       // Slabs indexed by LIST_*
+    int                 headerBytes;    // Header and free stack, rounded up to a cache line
+    slab_stats_t        stats;
+} SlabCache;
+
+static SlabCache caches[SLAB_MAX_CACHES];
+
+static Slab* createSlab(SlabCache* pCache, int cache);
+static void releaseSlab(SlabCache* pCache, Slab* pSlab);
+static void moveSlab(SlabCache* pCache, Slab* pSlab, int list);
+static SlabCache* getCache(int cache);
+static unsigned long long readTicks(void);
+
+/**************************************************************************
+   Name - slab_initialize
+
+   Purpose - Releases the slabs of every cache and forgets the caches.
+             Called by bootstrap before the modules that create caches.
+*************************************************************************/
+void slab_initialize(void)
+{
+    for (int cache = 0; cache < SLAB_MAX_CACHES; cache++)
+    {
+        SlabCache* pCache = &caches[cache];
+
+        for (int list = LIST_PARTIAL; list <= LIST_EMPTY; list++)
+        {
+            while (pCache->lists[list] != NULL)
+            {
+                releaseSlab(pCache, pCache->lists[list]);
+            }
+        }
+    }
+
+    memset(caches, 0, sizeof(caches));
+}
+
+/**************************************************************************
+   Name - slab_cache_create
+
+   Purpose - Creates a cache of objects of one size.
+
+   Parameters - name, shown in the statistics
+                size, the bytes in each object
+                pConstructor, called on each object when its slab is
+                    created, or NULL to leave new objects zeroed
+
+   Returns - the cache, or -1 if the parameters are invalid or every
+        cache is in use
+*************************************************************************/
+int slab_cache_create(char* name, int size, slab_constructor_t pConstructor)
+{
+    uint32_t psr = get_psr();
+    SlabCache* pCache = NULL;
+    int cache;
+    int slotSize, slabBytes, objects, headerBytes;
+
+    check_kernel_mode("slab_cache_create");
+
+    if (name == NULL || size <= 0 || size > 1024 * 1024)
+    {
+        return -1;
+    }
+
+    slotSize = (size + SLAB_CACHE_LINE - 1) / SLAB_CACHE_LINE * SLAB_CACHE_LINE;
+
+    // Double the slab until MIN_SLAB_OBJECTS slots fit after the header and free stack
+    slabBytes = MIN_SLAB_BYTES;
+    for (;;)
+    {
+        objects = (int)((slabBytes - sizeof(Slab)) / (slotSize + sizeof(unsigned short)));
+        headerBytes = 0;
+        while (objects > 0)
+        {
+            headerBytes = (int)(sizeof(Slab) + objects * sizeof(unsigned short));
+            headerBytes = (headerBytes + SLAB_CACHE_LINE - 1) / SLAB_CACHE_LINE * SLAB_CACHE_LINE;
+            if (headerBytes + objects * slotSize <= slabBytes)
+            {
+                break;
+            }
+            objects--;
+        }
+        if (objects >= MIN_SLAB_OBJECTS)
+        {
+            break;
+        }
+        slabBytes *= 2;
+    }
+    if (objects > 65535)
+    {
+        objects = 65535;
+    }
+
+    disableInterrupts();
+
+    for (cache = 0; cache < SLAB_MAX_CACHES; cache++)
+    {
+        if (!caches[cache].created)
+        {
+            pCache = &caches[cache];
+            break;
+        }
+    }
+    if (pCache == NULL)
+    {
+        set_psr(psr);
+        return -1;
+    }
+
+    memset(pCache, 0, sizeof(SlabCache));
+    pCache->created = TRUE;
+    pCache->pConstructor = pConstructor;
+    pCache->headerBytes = headerBytes;
+    strncpy(pCache->stats.name, name, SLAB_NAME_LENGTH - 1);
+    pCache->stats.objectSize = size;
+    pCache->stats.slotSize = slotSize;
+    pCache->stats.objectsPerSlab = objects;
+    pCache->stats.slabBytes = slabBytes;
+
+    set_psr(psr);
+
+    return cache;
+}
+
+/**************************************************************************
+   Name - slab_alloc
+
+   Purpose - Takes an object from a cache, from a partly used slab if
+             there is one, otherwise from an empty or a new slab.
+
+   Parameters - cache, from slab_cache_create
+
+   Returns - the object, in the state its constructor left it, or NULL
+        if the cache is invalid or no memory is left for a slab
+*************************************************************************/
+void* slab_alloc(int cache)
+{
+    unsigned long long start = 0;
+    uint32_t psr = get_psr();
+    SlabCache* pCache;
+    Slab* pSlab;
+    void* pObject;
+    int timed;
+
+    disableInterrupts();
+
+    pCache = getCache(cache);
+    if (pCache == NULL)
+    {
+        set_psr(psr);
+        return NULL;
+    }
+
+    // Reading the clock costs about as much as the allocation, so only some are timed
+    timed = pCache->stats.allocations % TIMING_INTERVAL == 0;
+    if (timed)
+    {
+        start = readTicks();
+    }
+
+    pSlab = pCache->lists[LIST_PARTIAL];
+    if (pSlab == NULL)
+    {
+        pSlab = pCache->lists[LIST_EMPTY];
+    }
+    if (pSlab == NULL)
+    {
+        pSlab = createSlab(pCache, cache);
+        if (pSlab == NULL)
+        {
+            pCache->stats.failures++;
+            set_psr(psr);
+            return NULL;
+        }
+    }
+
+    pObject = pSlab->pSlots + (size_t)pSlab->freeStack[--pSlab->freeCount] * pCache->stats.slotSize;
+    pSlab->inUse++;
+    moveSlab(pCache, pSlab, pSlab->freeCount == 0 ? LIST_FULL : LIST_PARTIAL);
+
+    pCache->stats.allocations++;
+    if (++pCache->stats.objectsInUse > pCache->stats.peakInUse)
+    {
+        pCache->stats.peakInUse = pCache->stats.objectsInUse;
+    }
+    if (timed)
+    {
+        pCache->stats.allocTicks += readTicks() - start;
+        pCache->stats.timedAllocations++;
+    }
+
+    set_psr(psr);
+
+    return pObject;
+}
+
+/**************************************************************************
+   Name - slab_free
+
+   Purpose - Gives an object back to its cache. The object must be in
+             the state the cache's constructor leaves it in.
+
+   Parameters - cache, the cache the object came from
+                pObject, the object, or NULL to do nothing
+*************************************************************************/
+void slab_free(int cache, void* pObject)
+{
+    unsigned long long start = 0;
+    uint32_t psr = get_psr();
+    SlabCache* pCache;
+    Slab* pSlab;
+    int timed;
+
+    if (pObject == NULL)
+    {
+        return;
+    }
+
+    disableInterrupts();
+
+    pCache = getCache(cache);
+    pSlab = (Slab*)((uintptr_t)pObject & ~(uintptr_t)(pCache != NULL ? pCache->stats.slabBytes - 1 : 0));
+    if (pCache == NULL || pSlab->cache != cache)
+    {
+        console_output(FALSE, "slab_free(): object 0x%p is not from cache %d, stopping...\n", pObject, cache);
+        stop(1);
+    }
+
+    timed = pCache->stats.frees % TIMING_INTERVAL == 0;
+    if (timed)
+    {
+        start = readTicks();
+    }
+
+    pSlab->freeStack[pSlab->freeCount++] =
+        (unsigned short)(((char*)pObject - pSlab->pSlots) / pCache->stats.slotSize);
+
+    pSlab->inUse--;
+    moveSlab(pCache, pSlab, pSlab->inUse == 0 ? LIST_EMPTY : LIST_PARTIAL);
+
+    pCache->stats.frees++;
+    pCache->stats.objectsInUse--;
+    if (timed)
+    {
+        pCache->stats.freeTicks += readTicks() - start;
+        pCache->stats.timedFrees++;
+    }
+
+    set_psr(psr);
+}
+
+/**************************************************************************
+   Name - slab_cache_shrink
+
+   Purpose - Releases a cache's empty slabs.
+
+   Returns - the bytes released, or -1 if the cache is invalid
+*************************************************************************/
+int slab_cache_shrink(int cache)
+{
+    uint32_t psr = get_psr();
+    SlabCache* pCache;
+    int released = 0;
+
+    disableInterrupts();
+
+    pCache = getCache(cache);
+    if (pCache == NULL)
+    {
+        set_psr(psr);
+        return -1;
+    }
+
+    while (pCache->lists[LIST_EMPTY] != NULL)
+    {
+        releaseSlab(pCache, pCache->lists[LIST_EMPTY]);
+        released += pCache->stats.slabBytes;
+    }
+
+    set_psr(psr);
+
+    return released;
+}
+
+/**************************************************************************
+   Name - get_slab_stats
+
+   Purpose - Copies a cache's counters.
+
+   Returns - 0 if successful, -1 if the cache is invalid
+*************************************************************************/
+int get_slab_stats(int cache, slab_stats_t* pStats)
+{
+    SlabCache* pCache = getCache(cache);
+
+    if (pCache == NULL || pStats == NULL)
+    {
+        return -1;
+    }
+
+    *pStats = pCache->stats;
+
+    return 0;
+}
+
+/**************************************************************************
+   Name - reset_slab_stats
+
+   Purpose - Zeroes a cache's event counters and timings, keeping its
+             geometry, its slabs and the objects in use.
+*************************************************************************/
+void reset_slab_stats(int cache)
+{
+    SlabCache* pCache = getCache(cache);
+
+    if (pCache != NULL)
+    {
+        pCache->stats.peakInUse = pCache->stats.objectsInUse;
+        pCache->stats.allocations = 0;
+        pCache->stats.frees = 0;
+        pCache->stats.failures = 0;
+        pCache->stats.slabsCreated = 0;
+        pCache->stats.slabsReleased = 0;
+        pCache->stats.constructed = 0;
+        pCache->stats.allocTicks = 0;
+        pCache->stats.freeTicks = 0;
+        pCache->stats.timedAllocations = 0;
+        pCache->stats.timedFrees = 0;
+    }
+}
+
+/**************************************************************************
+   Name - display_slab_stats
+
+   Purpose - Prints the memory each cache holds and its average
+             allocation and free times, from the ones that were timed.
+*************************************************************************/
+void display_slab_stats(void)
+{
+    LARGE_INTEGER frequency;
+
+    QueryPerformanceFrequency(&frequency);
+
+    console_output(FALSE, "%-20s %6s %6s %6s %6s %8s %6s %8s %8s\n", "Cache", "Size", "Slot", "Slabs", "InUse",
+        "Bytes", "Peak", "Alloc ns", "Free ns");
+    for (int cache = 0; cache < SLAB_MAX_CACHES; cache++)
+    {
+        slab_stats_t* pStats = &caches[cache].stats;
+
+        if (!caches[cache].created)
+        {
+            continue;
+        }
+
+        console_output(FALSE, "%-20s %6d %6d %6d %6d %8d %6d %8llu %8llu\n", pStats->name, pStats->objectSize,
+            pStats->slotSize, pStats->slabs, pStats->objectsInUse, pStats->slabs * pStats->slabBytes,
+            pStats->peakInUse,
+            pStats->timedAllocations ?
+                pStats->allocTicks * 1000000000 / frequency.QuadPart / pStats->timedAllocations : 0,
+            pStats->timedFrees ? pStats->freeTicks * 1000000000 / frequency.QuadPart / pStats->timedFrees : 0);
+    }
+}
+
+/**************************************************************************
+   Name - createSlab
+
+   Purpose - Allocates a slab aligned to its size, puts every slot on its
+             free stack and constructs the objects. The slab goes on the
+             cache's empty list. Called with interrupts disabled.
+
+   Returns - the slab, or NULL if there is no memory for it
+*************************************************************************/
+static Slab* createSlab(SlabCache* pCache, int cache)
+{
+    int objects = pCache->stats.objectsPerSlab;
+    int slabBytes = pCache->stats.slabBytes;
+    Slab* pSlab;
+
+#ifdef _WIN32
+    pSlab = _aligned_malloc(slabBytes, slabBytes);
+#else
+    if (posix_memalign((void**)&pSlab, slabBytes, slabBytes) != 0)
+    {
+        pSlab = NULL;
+    }
+#endif
+    if (pSlab == NULL)
+    {
+        return NULL;
+    }
+
+    memset(pSlab, 0, slabBytes);
+    pSlab->cache = cache;
+    pSlab->pSlots = (char*)pSlab + pCache->headerBytes;
+
+    // Slot 0 on top, so objects are handed out in address order
+    for (int i = 0; i < objects; i++)
+    {
+        pSlab->freeStack[i] = (unsigned short)(objects - 1 - i);
+        if (pCache->pConstructor != NULL)
+        {
+            pCache->pConstructor(pSlab->pSlots + (size_t)i * pCache->stats.slotSize);
+        }
+    }
+    pSlab->freeCount = objects;
+
+    pSlab->list = LIST_EMPTY;
+    pSlab->next = pCache->lists[LIST_EMPTY];
+    if (pSlab->next != NULL)
+    {
+        pSlab->next->prev = pSlab;
+    }
+    pCache->lists[LIST_EMPTY] = pSlab;
+
+    pCache->stats.slabs++;
+    pCache->stats.slabsCreated++;
+    if (pCache->pConstructor != NULL)
+    {
+        pCache->stats.constructed += objects;
+    }
+
+    return pSlab;
+}
+
+/**************************************************************************
+   Name - releaseSlab
+
+   Purpose - Takes a slab off its list and frees its memory.
+*************************************************************************/
+static void releaseSlab(SlabCache* pCache, Slab* pSlab)
+{
+    if (pSlab->prev != NULL)
+    {
+        pSlab->prev->next = pSlab->next;
+    }
+    else
+    {
+        pCache->lists[pSlab->list] = pSlab->next;
+    }
+    if (pSlab->next != NULL)
+    {
+        pSlab->next->prev = pSlab->prev;
+    }
+
+    pCache->stats.slabs--;
+    pCache->stats.slabsReleased++;
+
+#ifdef _WIN32
+    _aligned_free(pSlab);
+#else
+    free(pSlab);
+#endif
+}
+
+/**************************************************************************
+   Name - moveSlab
+
+   Purpose - Moves a slab to the head of one of its cache's lists, if it
+             is not on that list already.
+*************************************************************************/
+static void moveSlab(SlabCache* pCache, Slab* pSlab, int list)
+{
+    if (pSlab->list == list)
+    {
+        return;
+    }
+
+    if (pSlab->prev != NULL)
+    {
+        pSlab->prev->next = pSlab->next;
+    }
+    else
+    {
+        pCache->lists[pSlab->list] = pSlab->next;
+    }
+    if (pSlab->next != NULL)
+    {
+        pSlab->next->prev = pSlab->prev;
+    }
+
+    pSlab->list = list;
+    pSlab->prev = NULL;
+    pSlab->next = pCache->lists[list];
+    if (pSlab->next != NULL)
+    {
+        pSlab->next->prev = pSlab;
+    }
+    pCache->lists[list] = pSlab;
+}
+
+/**************************************************************************
+   Name - getCache
+
+   Returns - the cache, or NULL if it was never created
+*************************************************************************/
+static SlabCache* getCache(int cache)
+{
+    if (cache < 0 || cache >= SLAB_MAX_CACHES || !caches[cache].created)
+    {
+        return NULL;
+    }
+
+    return &caches[cache];
+}
+
+/**************************************************************************
+   Name - readTicks
+
+   Returns - the current QueryPerformanceCounter value
+*************************************************************************/
+static unsigned long long readTicks(void)
+{
+    LARGE_INTEGER now;
+
+    QueryPerformanceCounter(&now);
+    return (unsigned long long)now.QuadPart;
+}
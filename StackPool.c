@@ -0,0 +1,406 @@
+/*
+Program: StackPool
+Created by: Ian Penrose & Lindsay Wax
+Course: CYBV 489
+
+
+Description: Pool of process stacks. THREADS gives every context a stack of its own
+and frees it only with the context, so stacks are recycled by keeping the contexts of
+cleaned up processes and handing them to later spawns. A pooled context is parked in
+the dispatcher call k_exit made; when it is switched to again, k_exit jumps back to the
+start of launch, which runs the new process on the same stack.
+
+Stacks are bucketed by size, THREADS_MIN_STACK_SIZE doubling up to STACK_POOL_BUCKETS
+sizes, and a spawn gets a stack of its bucket's size so any pooled stack of the bucket
+fits it. Stacks bigger than the largest bucket are not pooled.
+
+When a process starts, the part of its stack below launch is painted with a pattern,
+and how much of the stack the process has used is found by scanning up from the bottom
+for the first word that no longer holds it. The scan is done on demand and when the
+process is cleaned up, when the most used is kept for its bucket.
+
+Overflow detection is opt-in and after the fact. The guard is off by default, because
+the host grows stacks beyond the size asked for and existing programs count on that.
+Once stack_pool_set_guard turns it on, the bottom STACK_GUARD_BYTES of the stack size
+a process asked for are filled when the process starts and checked only when it gives
+up the CPU. A process that runs past its stack is therefore stopped at its next
+context switch, after the write has happened, and may already have corrupted memory
+below its stack. A frame that skips over the whole guard zone without writing to it
+is not caught at all.
+*/
+
+
+
+#define _CRT_SECURE_NO_WARNINGS
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <stddef.h>
+#include "THREADSLib.h"
+#include "Scheduler.h"
+#include "StackPool.h"
+#include "Processes.h"
+
+#define GUARD_FILL          0xFD
+#define GUARD_WORD          0xFDFDFDFDFDFDFDFDull   // GUARD_FILL in every byte
+#define ENTRY_RESERVE       1024    // Room THREADS may use above launch's frame
+#define PAINT_MARGIN        1024    // Left unpainted below the painting code's own frame
+
+static process_entrypoint_t contextEntry;      // Where every context starts, launch
+static void* pool[STACK_POOL_BUCKETS][STACK_POOL_DEPTH];
+static int pooled[STACK_POOL_BUCKETS];
+static stack_pool_stats_t poolStats;
+static int guardEnabled;
+static int paintEnabled;
+
+static int bucketOf(int stacksize);
+static unsigned int highWater(Process* pProcess);
+
+/**************************************************************************
+   Name - stack_pool_initialize
+
+   Purpose - Empties the pool. Called once from bootstrap.
+
+   Parameters - entryPoint, the function every context starts in
+*************************************************************************/
+void stack_pool_initialize(process_entrypoint_t entryPoint)
+{
+    contextEntry = entryPoint;
+    memset(pool, 0, sizeof(pool));
+    memset(pooled, 0, sizeof(pooled));
+    memset(&poolStats, 0, sizeof(poolStats));
+    guardEnabled = FALSE;
+    paintEnabled = TRUE;
+}
+
+/**************************************************************************
+   Name - stack_pool_get
+
+   Purpose - Gives a new process a context, a pooled one of the right
+             bucket if there is one, otherwise a new one from THREADS.
+
+   Parameters - stacksize, the stack the process asked for
+                pStackBytes, where to store the size of the stack given
+
+   Returns - the context, or NULL if THREADS could not create one
+*************************************************************************/
+void* stack_pool_get(int stacksize, unsigned int* pStackBytes)
+{
+    uint32_t psr = get_psr();
+    int bucket = bucketOf(stacksize);
+    void* context;
+
+    disableInterrupts();
+
+    if (bucket >= 0 && pooled[bucket] > 0)
+    {
+        context = pool[bucket][--pooled[bucket]];
+        poolStats.reused++;
+        set_psr(psr);
+        *pStackBytes = THREADS_MIN_STACK_SIZE << bucket;
+        return context;
+    }
+
+    poolStats.created++;
+    set_psr(psr);
+
+    *pStackBytes = bucket >= 0 ? THREADS_MIN_STACK_SIZE << bucket : stacksize;
+    return context_initialize(contextEntry, *pStackBytes, NULL);
+}
+
+/**************************************************************************
+   Name - stack_pool_put
+
+   Purpose - Takes back the context of a process that has been cleaned
+             up, keeping it for a later spawn if its bucket has room and
+             stopping it otherwise, and records how much of its stack the
+             process used.
+
+   Parameters - pProcess, the process, which must not be running
+*************************************************************************/
+void stack_pool_put(Process* pProcess)
+{
+    uint32_t psr = get_psr();
+    void* context = pProcess->context;
+    unsigned int stackBytes = pProcess->stackBytes;
+    int bucket = bucketOf(stackBytes);
+    unsigned int used = highWater(pProcess);
+
+    if (context == NULL)
+    {
+        return;
+    }
+
+    disableInterrupts();
+
+    if (bucket >= 0 && used > poolStats.highWater[bucket])
+    {
+        poolStats.highWater[bucket] = used;
+    }
+    poolStats.exhausted += used == stackBytes;
+
+    if (bucket >= 0 && (unsigned int)(THREADS_MIN_STACK_SIZE << bucket) == stackBytes && pooled[bucket] < STACK_POOL_DEPTH)
+    {
+        pool[bucket][pooled[bucket]++] = context;
+        poolStats.returned++;
+        set_psr(psr);
+        return;
+    }
+
+    poolStats.released++;
+    set_psr(psr);
+
+    context_stop(context);
+}
+
+/**************************************************************************
+   Name - stack_pool_prefill
+
+   Purpose - Creates stacks ahead of time, so the spawns that take them
+             do not wait on THREADS.
+
+   Parameters - stacksize, the stack size the spawns will ask for
+                count, how many stacks to add
+
+   Returns - the number of stacks added, fewer than count if the bucket
+        is full, or -1 if stacksize is too small or too big to pool
+*************************************************************************/
+int stack_pool_prefill(int stacksize, int count)
+{
+    int bucket = bucketOf(stacksize);
+    int added = 0;
+
+    check_kernel_mode("stack_pool_prefill");
+
+    if (stacksize < THREADS_MIN_STACK_SIZE || bucket < 0)
+    {
+        return -1;
+    }
+
+    while (added < count && pooled[bucket] < STACK_POOL_DEPTH)
+    {
+        void* context = context_initialize(contextEntry, THREADS_MIN_STACK_SIZE << bucket, NULL);
+
+        if (context == NULL)
+        {
+            break;
+        }
+
+        disableInterrupts();
+        pool[bucket][pooled[bucket]++] = context;
+        poolStats.prefilled++;
+        enableInterrupts();
+
+        added++;
+    }
+
+    return added;
+}
+
+/**************************************************************************
+   Name - stack_pool_set_guard
+
+   Purpose - Turns the guard zone on or off for the processes started
+             from now on. It is off until this turns it on, and an
+             overflow is only found at the process's next context switch.
+
+   Returns - TRUE if it was on before
+*************************************************************************/
+int stack_pool_set_guard(int enabled)
+{
+    int previous = guardEnabled;
+
+    guardEnabled = enabled != 0;
+
+    return previous;
+}
+
+/**************************************************************************
+   Name - stack_pool_set_paint
+
+   Purpose - Turns stack painting on or off for the processes started
+             from now on. Without it their stack use is not known.
+
+   Returns - TRUE if it was on before
+*************************************************************************/
+int stack_pool_set_paint(int enabled)
+{
+    int previous = paintEnabled;
+
+    paintEnabled = enabled != 0;
+
+    return previous;
+}
+
+/**************************************************************************
+   Name - stack_prepare
+
+   Purpose - Paints the stack a process is starting on, below the frame
+             of this function, and fills the guard zone at its bottom if
+             the guard is on. Called by launch on the process's own stack.
+
+   Parameters - pProcess, the process
+                pTop, an address in launch's frame, near the top of the
+                    stack
+*************************************************************************/
+void stack_prepare(Process* pProcess, char* pTop)
+{
+    char here;
+    char* pBottom = pTop + ENTRY_RESERVE - pProcess->stackBytes;
+    ptrdiff_t paintBytes = &here - PAINT_MARGIN - pBottom;
+
+    pProcess->stack = NULL;
+    pProcess->stackTop = pTop + ENTRY_RESERVE;
+    pProcess->stackGuarded = guardEnabled;
+    pProcess->stackPainted = paintEnabled && paintBytes > STACK_GUARD_BYTES;
+
+    if (pProcess->stackPainted)
+    {
+        pProcess->stack = pBottom;
+        memset(pBottom, GUARD_FILL, paintBytes);
+    }
+    else if (guardEnabled)
+    {
+        pProcess->stack = pBottom;
+        memset(pBottom, GUARD_FILL, STACK_GUARD_BYTES);
+    }
+}
+
+/**************************************************************************
+   Name - get_stack_usage
+
+   Purpose - Finds how much of its stack a process has used so far.
+
+   Parameters - pid, the process
+                pUsed, where to store the most bytes of stack it has used
+                pSize, where to store the size of its stack
+
+   Returns - 0 if successful, -1 if there is no such process or its stack
+        was not painted
+*************************************************************************/
+int get_stack_usage(int pid, unsigned int* pUsed, unsigned int* pSize)
+{
+    for (int i = 0; i < MAX_PROCESSES; i++)
+    {
+        Process* pProcess = &processTable[i];
+
+        if (pProcess->pid == pid && pid != 0)
+        {
+            if (!pProcess->stackPainted)
+            {
+                return -1;
+            }
+            if (pUsed != NULL)
+            {
+                *pUsed = highWater(pProcess);
+            }
+            if (pSize != NULL)
+            {
+                *pSize = pProcess->stackBytes;
+            }
+            return 0;
+        }
+    }
+
+    return -1;
+}
+
+/**************************************************************************
+   Name - stack_guard_check
+
+   Purpose - Stops the system if a process started with the guard on has
+             written into the guard zone of its stack. Called when the
+             process gives up the CPU.
+*************************************************************************/
+void stack_guard_check(Process* pProcess)
+{
+    uint64_t* pGuard = (uint64_t*)pProcess->stack;
+
+    if (!pProcess->stackGuarded)
+    {
+        return;
+    }
+
+    for (size_t i = 0; i < STACK_GUARD_BYTES / sizeof(uint64_t); i++)
+    {
+        if (pGuard[i] != GUARD_WORD)
+        {
+            console_output(FALSE, "Process %s (pid %d) overflowed its %u byte stack, stopping...\n",
+                pProcess->name, pProcess->pid, pProcess->stackBytes);
+            stop(1);
+        }
+    }
+}
+
+/**************************************************************************
+   Name - get_stack_pool_stats
+
+   Purpose - Copies the pool counters and how many stacks each bucket has.
+*************************************************************************/
+void get_stack_pool_stats(stack_pool_stats_t* pStats)
+{
+    if (pStats != NULL)
+    {
+        *pStats = poolStats;
+        memcpy(pStats->pooled, pooled, sizeof(pooled));
+    }
+}
+
+/**************************************************************************
+   Name - reset_stack_pool_stats
+
+   Purpose - Zeroes the pool counters.
+*************************************************************************/
+void reset_stack_pool_stats(void)
+{
+    memset(&poolStats, 0, sizeof(poolStats));
+}
+
+/**************************************************************************
+   Name - bucketOf
+
+   Returns - the bucket of the smallest pooled stack that holds stacksize,
+        or -1 if stacksize is bigger than the largest bucket
+*************************************************************************/
+static int bucketOf(int stacksize)
+{
+    for (int bucket = 0; bucket < STACK_POOL_BUCKETS; bucket++)
+    {
+        if (stacksize <= (THREADS_MIN_STACK_SIZE << bucket))
+        {
+            return bucket;
+        }
+    }
+
+    return -1;
+}
+
+/**************************************************************************
+   Name - highWater
+
+   Purpose - Scans a process's painted stack up from the bottom for the
+             first word the process has written.
+
+   Returns - the bytes from there to the top of the stack, the whole
+        stack if the bottom word was written, or 0 if the stack was not
+        painted
+*************************************************************************/
+static unsigned int highWater(Process* pProcess)
+{
+    uint64_t* pWord = (uint64_t*)pProcess->stack;
+    uint64_t* pEnd = (uint64_t*)pProcess->stackTop;
+
+    if (!pProcess->stackPainted)
+    {
+        return 0;
+    }
+
+    while (pWord < pEnd && *pWord == GUARD_WORD)
+    {
+        pWord++;
+    }
+
+    return (unsigned int)(pProcess->stackTop - (char*)pWord);
+}
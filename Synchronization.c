@@ -0,0 +1,298 @@
+/*
+Program: Synchronization
+Created by: Ian Penrose & Lindsay Wax
+Course: CYBV 489
+
+
+Description: Kernel synchronization primitives. Futexes let processes build their own
+locks on an integer in memory and only enter the kernel when they actually have to wait
+or wake someone; the waiters are kept in a small hash table of wait queues keyed by the
+address. Kernel mutexes are the plain kernel-managed alternative.
+*/
+
+
+
+#define _CRT_SECURE_NO_WARNINGS
+
+#include <stdio.h>
+#include <string.h>
+#include <stdint.h>
+#include "THREADSLib.h"
+#include "Scheduler.h"
+#include "Synchronization.h"
+#include "Processes.h"
+
+#define MUTEX_FREE      0   // Mutex entry is unused
+#define MUTEX_IN_USE    1   // Mutex entry was created and can be used
+
+/*
+Kernel mutexes are handed directly to the first waiter when unlocked.
+*/
+typedef struct _mutex
+{
+    int         status;     // MUTEX_FREE or MUTEX_IN_USE
+    Process*    pOwner;     // Process holding the mutex, NULL if unlocked
+    WaitQueue   waiters;    // Processes blocked waiting for the mutex
+
+} Mutex;
+
+static WaitQueue futexQueues[FUTEX_HASH_SIZE];
+static Mutex mutexes[MAXMUTEX];
+
+static WaitQueue* getFutexQueue(volatile int* pAddress);
+static Mutex* getMutex(int mutex_id);
+
+
+/**************************************************************************
+   Name - k_futex_wait
+
+   Purpose - Blocks the calling process on pAddress as long as it still
+             holds the expected value. The check and the block happen with
+             interrupts disabled so a wake cannot be missed in between.
+
+   Parameters - pAddress, the address to wait on
+                expected, the value the caller last saw at pAddress
+
+   Returns - 0 when woken by k_futex_wake
+        -1 if pAddress is NULL
+        -2 if pAddress no longer holds expected
+        -5 if the process was signaled while blocked
+*************************************************************************/
+int k_futex_wait(volatile int* pAddress, int expected)
+{
+    check_kernel_mode("k_futex_wait");
+
+    if (pAddress == NULL)
+    {
+        return -1;
+    }
+
+    disableInterrupts();
+
+    if (*pAddress != expected)
+    {
+        enableInterrupts();
+        return -2;
+    }
+
+    runningProcess->pFutexAddress = pAddress;
+    runningProcess->waitResult = 0;
+    block_on(getFutexQueue(pAddress), BLOCKED_FUTEX);
+    runningProcess->pFutexAddress = NULL;
+
+    enableInterrupts();
+    return runningProcess->waitResult;
+}
+
+/**************************************************************************
+   Name - k_futex_wake
+
+   Purpose - Wakes up to count processes waiting on pAddress, oldest first.
+
+   Parameters - pAddress, the address being waited on
+                count, the most processes to wake
+
+   Returns - the number of processes woken, -1 if pAddress is NULL
+*************************************************************************/
+int k_futex_wake(volatile int* pAddress, int count)
+{
+    WaitQueue* pQueue;
+    Process* waiter;
+    Process* next;
+    int woken = 0;
+
+    check_kernel_mode("k_futex_wake");
+
+    if (pAddress == NULL)
+    {
+        return -1;
+    }
+
+    disableInterrupts();
+
+    // Other addresses may hash to the same queue, so only take the matching waiters
+    pQueue = getFutexQueue(pAddress);
+    waiter = pQueue->head;
+    while (waiter != NULL && woken < count)
+    {
+        next = waiter->nextWaitingProcess;
+        if (waiter->pFutexAddress == pAddress)
+        {
+            wait_queue_remove(pQueue, waiter);
+            ready_process(waiter);
+            woken++;
+        }
+        waiter = next;
+    }
+
+    if (woken > 0)
+    {
+        dispatcher();
+    }
+
+    enableInterrupts();
+    return woken;
+}
+
+/**************************************************************************
+   Name - k_mutex_create
+
+   Returns - the id of the new, unlocked mutex, or -1 if none are left
+*************************************************************************/
+int k_mutex_create()
+{
+    check_kernel_mode("k_mutex_create");
+
+    disableInterrupts();
+
+    for (int i = 0; i < MAXMUTEX; i++)
+    {
+        if (mutexes[i].status == MUTEX_FREE)
+        {
+            memset(&mutexes[i], 0, sizeof(Mutex));
+            mutexes[i].status = MUTEX_IN_USE;
+            enableInterrupts();
+            return i;
+        }
+    }
+
+    enableInterrupts();
+    return -1;
+}
+
+/**************************************************************************
+   Name - k_mutex_release
+
+   Purpose - Releases a mutex. Processes still waiting for it are woken
+             and their k_mutex_lock returns -3.
+
+   Returns - 0 on success, -1 if the mutex does not exist
+*************************************************************************/
+int k_mutex_release(int mutex_id)
+{
+    Mutex* pMutex = getMutex(mutex_id);
+    Process* waiter;
+
+    check_kernel_mode("k_mutex_release");
+
+    if (pMutex == NULL)
+    {
+        return -1;
+    }
+
+    disableInterrupts();
+
+    pMutex->status = MUTEX_FREE;
+    while ((waiter = wait_queue_pop(&pMutex->waiters)) != NULL)
+    {
+        waiter->waitResult = -3;
+        ready_process(waiter);
+    }
+
+    dispatcher();
+
+    enableInterrupts();
+    return 0;
+}
+
+/**************************************************************************
+   Name - k_mutex_lock
+
+   Purpose - Locks the mutex, blocking while another process holds it.
+
+   Returns - 0 once the mutex is held
+        -1 if the mutex does not exist or is already held by the caller
+        -3 if the mutex was released while blocked
+        -5 if the process was signaled while blocked
+*************************************************************************/
+int k_mutex_lock(int mutex_id)
+{
+    Mutex* pMutex = getMutex(mutex_id);
+
+    check_kernel_mode("k_mutex_lock");
+
+    if (pMutex == NULL || pMutex->pOwner == runningProcess)
+    {
+        return -1;
+    }
+
+    disableInterrupts();
+
+    if (pMutex->pOwner == NULL)
+    {
+        pMutex->pOwner = runningProcess;
+        enableInterrupts();
+        return 0;
+    }
+
+    // k_mutex_unlock makes this process the owner before waking it
+    runningProcess->waitResult = 0;
+    block_on(&pMutex->waiters, BLOCKED_MUTEX);
+
+    enableInterrupts();
+    return runningProcess->waitResult;
+}
+
+/**************************************************************************
+   Name - k_mutex_unlock
+
+   Purpose - Unlocks the mutex, handing it to the oldest waiter if any.
+
+   Returns - 0 on success, -1 if the caller does not hold the mutex
+*************************************************************************/
+int k_mutex_unlock(int mutex_id)
+{
+    Mutex* pMutex = getMutex(mutex_id);
+    Process* waiter;
+
+    check_kernel_mode("k_mutex_unlock");
+
+    if (pMutex == NULL || pMutex->pOwner != runningProcess)
+    {
+        return -1;
+    }
+
+    disableInterrupts();
+
+    waiter = wait_queue_pop(&pMutex->waiters);
+    pMutex->pOwner = waiter;
+    if (waiter != NULL)
+    {
+        ready_process(waiter);
+        dispatcher();
+    }
+
+    enableInterrupts();
+    return 0;
+}
+
+
+/**************************************************************************
+   Name - getFutexQueue
+
+   Returns - the wait queue that pAddress hashes to
+   *************************************************************************/
+static WaitQueue* getFutexQueue(volatile int* pAddress)
+{
+    uintptr_t key = (uintptr_t)pAddress;
+
+    // Ints are at least 4 byte aligned, so the low bits carry no information
+    key = (key >> 2) ^ (key >> 12);
+
+    return &futexQueues[key & (FUTEX_HASH_SIZE - 1)];
+}
+
+/**************************************************************************
+   Name - getMutex
+
+   Returns - a pointer to the mutex, or NULL if mutex_id is not in use
+   *************************************************************************/
+static Mutex* getMutex(int mutex_id)
+{
+    if (mutex_id < 0 || mutex_id >= MAXMUTEX || mutexes[mutex_id].status != MUTEX_IN_USE)
+    {
+        return NULL;
+    }
+
+    return &mutexes[mutex_id];
+}
@@ -0,0 +1,873 @@
+/*
+Program: SystemCalls
+Created by: Ian Penrose & Lindsay Wax
+Course: CYBV 489
+
+
+Description: The system call layer. User processes run without PSR_KERNEL_MODE and
+can only enter the kernel through the sys_* functions, which trap through the
+THREADS_SYS_CALL_INTERRUPT vector. The trap switches to kernel mode with interrupts
+disabled, the interrupt handler looks the call up in the system call vector and runs
+the kernel function, and the caller's mode is restored on the way back out. The cost
+of getting in and out of the kernel is counted for each call.
+
+A process can also queue system calls on a submission ring it shares with the kernel.
+Every time the process enters the kernel, the kernel runs what is queued and posts the
+results on the completion ring, so a batch of calls costs a single trap.
+*/
+
+
+
+#define _CRT_SECURE_NO_WARNINGS
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "THREADSLib.h"
+#include "Scheduler.h"
+#include "Messaging.h"
+#include "Synchronization.h"
+#include "SystemCalls.h"
+#include "Terminal.h"
+#include "FileSystem.h"
+#include "Slab.h"
+#include "Processes.h"
+
+#define FRAME(pArgs)    ((system_call_frame_t*)(pArgs))
+
+static system_call_stats_t callStats[SYS_CALL_COUNT];
+static system_call_frame_t* pTrapFrame;     // Frame of the call being trapped, only valid until the handler reads it
+static uint32_t trapPsr;                    // Caller's psr at the time of the trap
+static int ringCache;                       // Processes' system call rings
+
+static char* callNames[SYS_CALL_COUNT] =
+{
+    "spawn", "wait", "exit", "kill", "getpid", "join", "sleep", "sigmask",
+    "setpgid", "getpgid", "mbox_create", "mbox_release", "mbox_send", "mbox_receive",
+    "futex_wait", "futex_wake", "ring_setup", "ring_enter", "term_read", "term_write",
+    "open", "read", "write", "close"
+};
+
+static intptr_t trap(system_call_frame_t* pFrame, int call_id);
+static void system_call_handler(char deviceId[32], uint8_t command, uint32_t status);
+static int drainRing(system_call_ring_t* pRing);
+static void sysSpawn(system_call_arguments_t* pArgs);
+static void sysWait(system_call_arguments_t* pArgs);
+static void sysExit(system_call_arguments_t* pArgs);
+static void sysKill(system_call_arguments_t* pArgs);
+static void sysGetPid(system_call_arguments_t* pArgs);
+static void sysJoin(system_call_arguments_t* pArgs);
+static void sysSleep(system_call_arguments_t* pArgs);
+static void sysSigmask(system_call_arguments_t* pArgs);
+static void sysSetPgid(system_call_arguments_t* pArgs);
+static void sysGetPgid(system_call_arguments_t* pArgs);
+static void sysMailboxCreate(system_call_arguments_t* pArgs);
+static void sysMailboxRelease(system_call_arguments_t* pArgs);
+static void sysMailboxSend(system_call_arguments_t* pArgs);
+static void sysMailboxReceive(system_call_arguments_t* pArgs);
+static void sysFutexWait(system_call_arguments_t* pArgs);
+static void sysFutexWake(system_call_arguments_t* pArgs);
+static void sysRingSetup(system_call_arguments_t* pArgs);
+static void sysRingEnter(system_call_arguments_t* pArgs);
+static void sysTermRead(system_call_arguments_t* pArgs);
+static void sysTermWrite(system_call_arguments_t* pArgs);
+static void sysOpen(system_call_arguments_t* pArgs);
+static void sysRead(system_call_arguments_t* pArgs);
+static void sysWrite(system_call_arguments_t* pArgs);
+static void sysClose(system_call_arguments_t* pArgs);
+
+
+/**************************************************************************
+   Name - system_call_initialize
+
+   Purpose - Fills in the system call vector, installs the system call
+             interrupt handler and creates the cache rings come from.
+             Called once from bootstrap.
+*************************************************************************/
+void system_call_initialize()
+{
+    system_call_handler_t* vector = get_system_call_vector();
+
+    vector[SYS_SPAWN] = sysSpawn;
+    vector[SYS_WAIT] = sysWait;
+    vector[SYS_EXIT] = sysExit;
+    vector[SYS_KILL] = sysKill;
+    vector[SYS_GETPID] = sysGetPid;
+    vector[SYS_JOIN] = sysJoin;
+    vector[SYS_SLEEP] = sysSleep;
+    vector[SYS_SIGMASK] = sysSigmask;
+    vector[SYS_SETPGID] = sysSetPgid;
+    vector[SYS_GETPGID] = sysGetPgid;
+    vector[SYS_MBOX_CREATE] = sysMailboxCreate;
+    vector[SYS_MBOX_RELEASE] = sysMailboxRelease;
+    vector[SYS_MBOX_SEND] = sysMailboxSend;
+    vector[SYS_MBOX_RECEIVE] = sysMailboxReceive;
+    vector[SYS_FUTEX_WAIT] = sysFutexWait;
+    vector[SYS_FUTEX_WAKE] = sysFutexWake;
+    vector[SYS_RING_SETUP] = sysRingSetup;
+    vector[SYS_RING_ENTER] = sysRingEnter;
+    vector[SYS_TERM_READ] = sysTermRead;
+    vector[SYS_TERM_WRITE] = sysTermWrite;
+    vector[SYS_OPEN] = sysOpen;
+    vector[SYS_READ] = sysRead;
+    vector[SYS_WRITE] = sysWrite;
+    vector[SYS_CLOSE] = sysClose;
+
+    get_interrupt_handlers()[THREADS_SYS_CALL_INTERRUPT] = system_call_handler;
+
+    ringCache = slab_cache_create("system call rings", sizeof(system_call_ring_t), NULL);
+
+    reset_system_call_stats();
+}
+
+/**************************************************************************
+   Name - sys_ring_release
+
+   Purpose - Gives a process's system call ring back to its cache, zeroed
+             as the cache hands rings out. Called when the process is
+             cleaned up.
+*************************************************************************/
+void sys_ring_release(Process* pProcess)
+{
+    if (pProcess->pRing != NULL)
+    {
+        memset(pProcess->pRing, 0, sizeof(system_call_ring_t));
+        slab_free(ringCache, pProcess->pRing);
+        pProcess->pRing = NULL;
+    }
+}
+
+/**************************************************************************
+   Name - get_system_call_stats
+
+   Purpose - Copies the counters for one system call.
+
+   Parameters - call_id, the SYS_* id of the call
+                pStats, where to copy the counters
+
+   Returns - 0 on success, -1 if call_id is invalid
+*************************************************************************/
+int get_system_call_stats(int call_id, system_call_stats_t* pStats)
+{
+    check_kernel_mode("get_system_call_stats");
+
+    if (call_id < 0 || call_id >= SYS_CALL_COUNT || pStats == NULL)
+    {
+        return -1;
+    }
+
+    disableInterrupts();
+    *pStats = callStats[call_id];
+    enableInterrupts();
+
+    return 0;
+}
+
+/**************************************************************************
+   Name - reset_system_call_stats
+*************************************************************************/
+void reset_system_call_stats()
+{
+    check_kernel_mode("reset_system_call_stats");
+
+    disableInterrupts();
+    memset(callStats, 0, sizeof(callStats));
+    enableInterrupts();
+}
+
+/**************************************************************************
+   Name - display_system_call_stats
+
+   Purpose - Prints the call counts and the average entry, kernel and exit
+             time in nanoseconds for every system call that was made. Calls
+             run from a ring have no entry or exit of their own.
+*************************************************************************/
+void display_system_call_stats()
+{
+    system_call_stats_t stats;
+    LARGE_INTEGER frequency;
+
+    QueryPerformanceFrequency(&frequency);
+
+    console_output(FALSE, "%-14s %8s %8s %10s %10s %10s\n", "System call", "Calls", "Ring", "Entry ns", "Kernel ns", "Exit ns");
+    for (int i = 0; i < SYS_CALL_COUNT; i++)
+    {
+        get_system_call_stats(i, &stats);
+        if (stats.calls + stats.ringCalls == 0)
+        {
+            continue;
+        }
+
+        console_output(FALSE, "%-14s %8u %8u %10llu %10llu %10llu\n", callNames[i], stats.calls, stats.ringCalls,
+            stats.calls > 0 ? stats.entryTicks * 1000000000ULL / frequency.QuadPart / stats.calls : 0,
+            stats.kernelTicks * 1000000000ULL / frequency.QuadPart / (stats.calls + stats.ringCalls),
+            stats.calls > 0 ? stats.exitTicks * 1000000000ULL / frequency.QuadPart / stats.calls : 0);
+    }
+}
+
+
+/**************************************************************************
+   System call stubs. Each one packs its arguments into a frame and traps.
+*************************************************************************/
+int sys_spawn(char* name, int(*entryPoint)(void*), void* arg, int stacksize, int priority)
+{
+    system_call_frame_t frame;
+
+    frame.arg[0] = (intptr_t)name;
+    frame.arg[1] = (intptr_t)entryPoint;
+    frame.arg[2] = (intptr_t)arg;
+    frame.arg[3] = stacksize;
+    frame.arg[4] = priority;
+
+    return (int)trap(&frame, SYS_SPAWN);
+}
+
+int sys_wait(int* pChildExitCode)
+{
+    return sys_waitpg(0, pChildExitCode);
+}
+
+int sys_waitpg(int pgid, int* pChildExitCode)
+{
+    system_call_frame_t frame;
+
+    frame.arg[0] = pgid;
+    frame.arg[1] = (intptr_t)pChildExitCode;
+
+    return (int)trap(&frame, SYS_WAIT);
+}
+
+void sys_exit(int exitCode)
+{
+    system_call_frame_t frame;
+
+    frame.arg[0] = exitCode;
+
+    trap(&frame, SYS_EXIT);
+}
+
+int sys_kill(int pid, int signal)
+{
+    system_call_frame_t frame;
+
+    frame.arg[0] = pid;
+    frame.arg[1] = signal;
+
+    return (int)trap(&frame, SYS_KILL);
+}
+
+int sys_killpg(int pgid, int signal)
+{
+    return pgid > 0 ? sys_kill(-pgid, signal) : -1;
+}
+
+int sys_getpid()
+{
+    system_call_frame_t frame;
+
+    return (int)trap(&frame, SYS_GETPID);
+}
+
+int sys_join(int pid, int* pChildExitCode)
+{
+    system_call_frame_t frame;
+
+    frame.arg[0] = pid;
+    frame.arg[1] = (intptr_t)pChildExitCode;
+
+    return (int)trap(&frame, SYS_JOIN);
+}
+
+int sys_sleep(int milliseconds)
+{
+    system_call_frame_t frame;
+
+    frame.arg[0] = milliseconds;
+
+    return (int)trap(&frame, SYS_SLEEP);
+}
+
+unsigned int sys_sigmask(unsigned int blocked_signals)
+{
+    system_call_frame_t frame;
+
+    frame.arg[0] = blocked_signals;
+
+    return (unsigned int)trap(&frame, SYS_SIGMASK);
+}
+
+int sys_setpgid(int pid, int pgid)
+{
+    system_call_frame_t frame;
+
+    frame.arg[0] = pid;
+    frame.arg[1] = pgid;
+
+    return (int)trap(&frame, SYS_SETPGID);
+}
+
+int sys_getpgid(int pid)
+{
+    system_call_frame_t frame;
+
+    frame.arg[0] = pid;
+
+    return (int)trap(&frame, SYS_GETPGID);
+}
+
+int sys_mailbox_create(int slots, int slot_size)
+{
+    system_call_frame_t frame;
+
+    frame.arg[0] = slots;
+    frame.arg[1] = slot_size;
+
+    return (int)trap(&frame, SYS_MBOX_CREATE);
+}
+
+int sys_mailbox_release(int mbox_id)
+{
+    system_call_frame_t frame;
+
+    frame.arg[0] = mbox_id;
+
+    return (int)trap(&frame, SYS_MBOX_RELEASE);
+}
+
+int sys_mailbox_send(int mbox_id, void* pMsg, int msg_size)
+{
+    system_call_frame_t frame;
+
+    frame.arg[0] = mbox_id;
+    frame.arg[1] = (intptr_t)pMsg;
+    frame.arg[2] = msg_size;
+    frame.arg[3] = TRUE;
+
+    return (int)trap(&frame, SYS_MBOX_SEND);
+}
+
+int sys_mailbox_send_cond(int mbox_id, void* pMsg, int msg_size)
+{
+    system_call_frame_t frame;
+
+    frame.arg[0] = mbox_id;
+    frame.arg[1] = (intptr_t)pMsg;
+    frame.arg[2] = msg_size;
+    frame.arg[3] = FALSE;
+
+    return (int)trap(&frame, SYS_MBOX_SEND);
+}
+
+int sys_mailbox_receive(int mbox_id, void* pMsg, int max_msg_size)
+{
+    system_call_frame_t frame;
+
+    frame.arg[0] = mbox_id;
+    frame.arg[1] = (intptr_t)pMsg;
+    frame.arg[2] = max_msg_size;
+    frame.arg[3] = TRUE;
+
+    return (int)trap(&frame, SYS_MBOX_RECEIVE);
+}
+
+int sys_mailbox_receive_cond(int mbox_id, void* pMsg, int max_msg_size)
+{
+    system_call_frame_t frame;
+
+    frame.arg[0] = mbox_id;
+    frame.arg[1] = (intptr_t)pMsg;
+    frame.arg[2] = max_msg_size;
+    frame.arg[3] = FALSE;
+
+    return (int)trap(&frame, SYS_MBOX_RECEIVE);
+}
+
+int sys_futex_wait(volatile int* pAddress, int expected)
+{
+    system_call_frame_t frame;
+
+    frame.arg[0] = (intptr_t)pAddress;
+    frame.arg[1] = expected;
+
+    return (int)trap(&frame, SYS_FUTEX_WAIT);
+}
+
+int sys_futex_wake(volatile int* pAddress, int count)
+{
+    system_call_frame_t frame;
+
+    frame.arg[0] = (intptr_t)pAddress;
+    frame.arg[1] = count;
+
+    return (int)trap(&frame, SYS_FUTEX_WAKE);
+}
+
+int sys_term_read(int unit, char* pBuffer, int size)
+{
+    system_call_frame_t frame;
+
+    frame.arg[0] = unit;
+    frame.arg[1] = (intptr_t)pBuffer;
+    frame.arg[2] = size;
+
+    return (int)trap(&frame, SYS_TERM_READ);
+}
+
+int sys_term_write(int unit, char* pBuffer, int size)
+{
+    system_call_frame_t frame;
+
+    frame.arg[0] = unit;
+    frame.arg[1] = (intptr_t)pBuffer;
+    frame.arg[2] = size;
+
+    return (int)trap(&frame, SYS_TERM_WRITE);
+}
+
+int sys_open(char* name, int flags)
+{
+    system_call_frame_t frame;
+
+    frame.arg[0] = (intptr_t)name;
+    frame.arg[1] = flags;
+
+    return (int)trap(&frame, SYS_OPEN);
+}
+
+int sys_read(int fd, void* pBuffer, int size)
+{
+    system_call_frame_t frame;
+
+    frame.arg[0] = fd;
+    frame.arg[1] = (intptr_t)pBuffer;
+    frame.arg[2] = size;
+
+    return (int)trap(&frame, SYS_READ);
+}
+
+int sys_write(int fd, void* pBuffer, int size)
+{
+    system_call_frame_t frame;
+
+    frame.arg[0] = fd;
+    frame.arg[1] = (intptr_t)pBuffer;
+    frame.arg[2] = size;
+
+    return (int)trap(&frame, SYS_WRITE);
+}
+
+int sys_close(int fd)
+{
+    system_call_frame_t frame;
+
+    frame.arg[0] = fd;
+
+    return (int)trap(&frame, SYS_CLOSE);
+}
+
+system_call_ring_t* sys_ring_setup()
+{
+    system_call_frame_t frame;
+
+    return (system_call_ring_t*)trap(&frame, SYS_RING_SETUP);
+}
+
+/*
+*  sys_ring_get_sqe - returns the next free submission to fill in, or NULL
+*                     if the ring is full. It is not seen by the kernel until
+*                     it is queued or submitted.
+*/
+system_call_sqe_t* sys_ring_get_sqe(system_call_ring_t* pRing)
+{
+    if (pRing->sqReserved - pRing->sqHead >= SYS_RING_ENTRIES)
+    {
+        return NULL;
+    }
+
+    return &pRing->sq[pRing->sqReserved++ & (SYS_RING_ENTRIES - 1)];
+}
+
+/*
+*  sys_ring_queue - hands the filled in submissions to the kernel, which runs
+*                   them the next time the process makes any system call.
+*/
+void sys_ring_queue(system_call_ring_t* pRing)
+{
+    pRing->sqTail = pRing->sqReserved;
+}
+
+/*
+*  sys_ring_submit - hands the filled in submissions to the kernel and enters
+*                    it to run them. Returns the number of submissions run.
+*/
+int sys_ring_submit(system_call_ring_t* pRing)
+{
+    system_call_frame_t frame;
+
+    sys_ring_queue(pRing);
+
+    return (int)trap(&frame, SYS_RING_ENTER);
+}
+
+/*
+*  sys_ring_reap - takes the oldest completion off the ring. Returns 1 if
+*                  there was one, 0 if the ring is empty.
+*/
+int sys_ring_reap(system_call_ring_t* pRing, system_call_cqe_t* pCompletion)
+{
+    if (pRing->cqHead == pRing->cqTail)
+    {
+        return 0;
+    }
+
+    *pCompletion = pRing->cq[pRing->cqHead & (SYS_RING_ENTRIES - 1)];
+    pRing->cqHead++;
+
+    return 1;
+}
+
+
+/**************************************************************************
+   Name - trap
+
+   Purpose - Stands in for the trap instruction. Switches to kernel mode
+        with interrupts disabled, raises the system call interrupt and
+        puts the caller's mode back once the call returns.
+
+   Parameters - pFrame, the frame holding the call's arguments
+                call_id, the SYS_* id of the call
+
+   Returns - the result of the call
+   *************************************************************************/
+static intptr_t trap(system_call_frame_t* pFrame, int call_id)
+{
+    uint32_t psr = get_psr();
+    LARGE_INTEGER now;
+
+    pFrame->call.call_id = call_id;
+    pFrame->result = -1;
+    QueryPerformanceCounter(&pFrame->trapTime);
+
+    set_psr(PSR_KERNEL_MODE);
+    pTrapFrame = pFrame;
+    trapPsr = psr;
+    get_interrupt_handlers()[THREADS_SYS_CALL_INTERRUPT]("system_call", (uint8_t)call_id, 0);
+
+    QueryPerformanceCounter(&now);
+    if (call_id < SYS_CALL_COUNT)
+    {
+        callStats[call_id].exitTicks += now.QuadPart - pFrame->returnTime.QuadPart;
+    }
+
+    set_psr(psr);
+
+    return pFrame->result;
+}
+
+/**************************************************************************
+   Name - system_call_handler
+
+   Purpose - The THREADS_SYS_CALL_INTERRUPT handler. Runs the call from the
+        system call vector with the caller's interrupt state, and counts
+        the time spent getting to it and in it.
+   *************************************************************************/
+static void system_call_handler(char deviceId[32], uint8_t command, uint32_t status)
+{
+    system_call_frame_t* pFrame = pTrapFrame;
+    uint32_t callerPsr = trapPsr;
+    int call_id = (int)pFrame->call.call_id;
+    system_call_handler_t handler = NULL;
+    LARGE_INTEGER start;
+
+    if (call_id < SYS_CALL_COUNT)
+    {
+        handler = get_system_call_vector()[call_id];
+    }
+    if (handler == NULL)
+    {
+        console_output(FALSE, "system_call_handler(): invalid system call %d by process %d.\n",
+            call_id, runningProcess->pid);
+        QueryPerformanceCounter(&pFrame->returnTime);
+        return;
+    }
+
+    QueryPerformanceCounter(&start);
+    callStats[call_id].calls++;
+    callStats[call_id].entryTicks += start.QuadPart - pFrame->trapTime.QuadPart;
+
+    set_psr(PSR_KERNEL_MODE | (callerPsr & PSR_INTERRUPTS));
+    handler(&pFrame->call);
+    set_psr(PSR_KERNEL_MODE);
+
+    QueryPerformanceCounter(&pFrame->returnTime);
+    callStats[call_id].kernelTicks += pFrame->returnTime.QuadPart - start.QuadPart;
+
+    // Already in the kernel, so anything queued on the ring runs for free
+    if (call_id != SYS_RING_ENTER && runningProcess->pRing != NULL &&
+        runningProcess->pRing->sqHead != runningProcess->pRing->sqTail)
+    {
+        set_psr(PSR_KERNEL_MODE | (callerPsr & PSR_INTERRUPTS));
+        drainRing(runningProcess->pRing);
+        set_psr(PSR_KERNEL_MODE);
+        QueryPerformanceCounter(&pFrame->returnTime);
+    }
+}
+
+/**************************************************************************
+   Name - drainRing
+
+   Purpose - Runs the submissions queued on the ring in order, posting a
+        completion for each. Stops early if the completion ring is full,
+        leaving the rest queued. A submission that blocks holds up the
+        ones behind it until it completes.
+
+   Parameters - pRing, the running Process's rings
+
+   Returns - the number of submissions run
+   *************************************************************************/
+static int drainRing(system_call_ring_t* pRing)
+{
+    system_call_frame_t frame;
+    system_call_sqe_t* pSubmission;
+    system_call_cqe_t* pCompletion;
+    system_call_handler_t handler;
+    LARGE_INTEGER start, end;
+    int count = 0;
+
+    while (pRing->sqHead != pRing->sqTail && pRing->cqTail - pRing->cqHead < SYS_RING_ENTRIES)
+    {
+        // Take the submission before running it, the process can add more meanwhile
+        pSubmission = &pRing->sq[pRing->sqHead & (SYS_RING_ENTRIES - 1)];
+        frame.call.call_id = pSubmission->call_id;
+        memcpy(frame.arg, pSubmission->arg, sizeof(frame.arg));
+        frame.result = -1;
+        pCompletion = &pRing->cq[pRing->cqTail & (SYS_RING_ENTRIES - 1)];
+        pCompletion->userData = pSubmission->userData;
+        pRing->sqHead++;
+
+        handler = NULL;
+        if (frame.call.call_id < SYS_CALL_COUNT && frame.call.call_id != SYS_RING_SETUP &&
+            frame.call.call_id != SYS_RING_ENTER)
+        {
+            handler = get_system_call_vector()[frame.call.call_id];
+        }
+
+        if (handler != NULL)
+        {
+            QueryPerformanceCounter(&start);
+            handler(&frame.call);
+            QueryPerformanceCounter(&end);
+
+            callStats[frame.call.call_id].ringCalls++;
+            callStats[frame.call.call_id].kernelTicks += end.QuadPart - start.QuadPart;
+        }
+
+        pCompletion->result = frame.result;
+        pRing->cqTail++;
+        count++;
+    }
+
+    return count;
+}
+
+
+/**************************************************************************
+   System call vector entries. Each one unpacks its frame and calls the
+   kernel function.
+*************************************************************************/
+static void sysSpawn(system_call_arguments_t* pArgs)
+{
+    system_call_frame_t* pFrame = FRAME(pArgs);
+
+    // Processes spawned by user processes are user processes too, and spawn_process refuses their bad arguments
+    pFrame->result = spawn_process((char*)pFrame->arg[0], (int(*)(void*))pFrame->arg[1], (void*)pFrame->arg[2],
+        (int)pFrame->arg[3], (int)pFrame->arg[4], SPAWN_USER_MODE);
+}
+
+static void sysWait(system_call_arguments_t* pArgs)
+{
+    system_call_frame_t* pFrame = FRAME(pArgs);
+
+    if (pFrame->arg[0] == 0)
+    {
+        pFrame->result = k_wait((int*)pFrame->arg[1]);
+    }
+    else
+    {
+        pFrame->result = k_waitpg((int)pFrame->arg[0], (int*)pFrame->arg[1]);
+    }
+}
+
+static void sysExit(system_call_arguments_t* pArgs)
+{
+    k_exit((int)FRAME(pArgs)->arg[0]);
+}
+
+static void sysKill(system_call_arguments_t* pArgs)
+{
+    system_call_frame_t* pFrame = FRAME(pArgs);
+
+    if (pFrame->arg[0] < 0)
+    {
+        pFrame->result = k_killpg((int)-pFrame->arg[0], (int)pFrame->arg[1]);
+    }
+    else
+    {
+        pFrame->result = k_kill((int)pFrame->arg[0], (int)pFrame->arg[1]);
+    }
+}
+
+static void sysGetPid(system_call_arguments_t* pArgs)
+{
+    FRAME(pArgs)->result = k_getpid();
+}
+
+static void sysJoin(system_call_arguments_t* pArgs)
+{
+    system_call_frame_t* pFrame = FRAME(pArgs);
+
+    pFrame->result = k_join((int)pFrame->arg[0], (int*)pFrame->arg[1]);
+}
+
+static void sysSleep(system_call_arguments_t* pArgs)
+{
+    system_call_frame_t* pFrame = FRAME(pArgs);
+
+    pFrame->result = k_sleep((int)pFrame->arg[0]);
+}
+
+static void sysSigmask(system_call_arguments_t* pArgs)
+{
+    system_call_frame_t* pFrame = FRAME(pArgs);
+
+    pFrame->result = k_sigmask((unsigned int)pFrame->arg[0]);
+}
+
+static void sysSetPgid(system_call_arguments_t* pArgs)
+{
+    system_call_frame_t* pFrame = FRAME(pArgs);
+
+    pFrame->result = k_setpgid((int)pFrame->arg[0], (int)pFrame->arg[1]);
+}
+
+static void sysGetPgid(system_call_arguments_t* pArgs)
+{
+    system_call_frame_t* pFrame = FRAME(pArgs);
+
+    pFrame->result = k_getpgid((int)pFrame->arg[0]);
+}
+
+static void sysMailboxCreate(system_call_arguments_t* pArgs)
+{
+    system_call_frame_t* pFrame = FRAME(pArgs);
+
+    pFrame->result = k_mailbox_create((int)pFrame->arg[0], (int)pFrame->arg[1]);
+}
+
+static void sysMailboxRelease(system_call_arguments_t* pArgs)
+{
+    system_call_frame_t* pFrame = FRAME(pArgs);
+
+    pFrame->result = k_mailbox_release((int)pFrame->arg[0]);
+}
+
+static void sysMailboxSend(system_call_arguments_t* pArgs)
+{
+    system_call_frame_t* pFrame = FRAME(pArgs);
+
+    if (pFrame->arg[3])
+    {
+        pFrame->result = k_mailbox_send((int)pFrame->arg[0], (void*)pFrame->arg[1], (int)pFrame->arg[2]);
+    }
+    else
+    {
+        pFrame->result = k_mailbox_send_cond((int)pFrame->arg[0], (void*)pFrame->arg[1], (int)pFrame->arg[2]);
+    }
+}
+
+static void sysMailboxReceive(system_call_arguments_t* pArgs)
+{
+    system_call_frame_t* pFrame = FRAME(pArgs);
+
+    if (pFrame->arg[3])
+    {
+        pFrame->result = k_mailbox_receive((int)pFrame->arg[0], (void*)pFrame->arg[1], (int)pFrame->arg[2]);
+    }
+    else
+    {
+        pFrame->result = k_mailbox_receive_cond((int)pFrame->arg[0], (void*)pFrame->arg[1], (int)pFrame->arg[2]);
+    }
+}
+
+static void sysFutexWait(system_call_arguments_t* pArgs)
+{
+    system_call_frame_t* pFrame = FRAME(pArgs);
+
+    pFrame->result = k_futex_wait((volatile int*)pFrame->arg[0], (int)pFrame->arg[1]);
+}
+
+static void sysFutexWake(system_call_arguments_t* pArgs)
+{
+    system_call_frame_t* pFrame = FRAME(pArgs);
+
+    pFrame->result = k_futex_wake((volatile int*)pFrame->arg[0], (int)pFrame->arg[1]);
+}
+
+static void sysRingSetup(system_call_arguments_t* pArgs)
+{
+    if (runningProcess->pRing == NULL)
+    {
+        runningProcess->pRing = slab_alloc(ringCache);
+    }
+
+    FRAME(pArgs)->result = (intptr_t)runningProcess->pRing;
+}
+
+static void sysRingEnter(system_call_arguments_t* pArgs)
+{
+    system_call_frame_t* pFrame = FRAME(pArgs);
+
+    pFrame->result = runningProcess->pRing != NULL ? drainRing(runningProcess->pRing) : -1;
+}
+
+static void sysTermRead(system_call_arguments_t* pArgs)
+{
+    system_call_frame_t* pFrame = FRAME(pArgs);
+
+    pFrame->result = k_term_read((int)pFrame->arg[0], (char*)pFrame->arg[1], (int)pFrame->arg[2]);
+}
+
+static void sysTermWrite(system_call_arguments_t* pArgs)
+{
+    system_call_frame_t* pFrame = FRAME(pArgs);
+
+    pFrame->result = k_term_write((int)pFrame->arg[0], (char*)pFrame->arg[1], (int)pFrame->arg[2]);
+}
+
+static void sysOpen(system_call_arguments_t* pArgs)
+{
+    system_call_frame_t* pFrame = FRAME(pArgs);
+
+    pFrame->result = k_open((char*)pFrame->arg[0], (int)pFrame->arg[1]);
+}
+
+static void sysRead(system_call_arguments_t* pArgs)
+{
+    system_call_frame_t* pFrame = FRAME(pArgs);
+
+    pFrame->result = k_read((int)pFrame->arg[0], (void*)pFrame->arg[1], (int)pFrame->arg[2]);
+}
+
+static void sysWrite(system_call_arguments_t* pArgs)
+{
+    system_call_frame_t* pFrame = FRAME(pArgs);
+
+    pFrame->result = k_write((int)pFrame->arg[0], (void*)pFrame->arg[1], (int)pFrame->arg[2]);
+}
+
+static void sysClose(system_call_arguments_t* pArgs)
+{
+    system_call_frame_t* pFrame = FRAME(pArgs);
+
+    pFrame->result = k_close((int)pFrame->arg[0]);
+}
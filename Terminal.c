@@ -0,0 +1,648 @@
+/*
+Program: Terminal
+Created by: Ian Penrose & Lindsay Wax
+Course: CYBV 489
+
+
+Description: Interrupt driven terminal driver. The devices move one character per
+TERMINAL_READ_CHAR or TERMINAL_WRITE_CHAR, so each terminal keeps a ring of characters
+in each direction and the I/O interrupt of one command starts the next. Processes only
+enter the driver to hand over or pick up whole buffers: k_term_write copies into the
+output ring and returns, and k_term_read blocks until the line discipline has finished
+a line of input.
+*/
+
+
+
+#define _CRT_SECURE_NO_WARNINGS
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "THREADSLib.h"
+#include "Scheduler.h"
+#include "Terminal.h"
+#include "Processes.h"
+
+#define TERM_UNITS          THREADS_MAX_TERMINALS
+#define TERM_LOW_WATER      (TERM_RING_SIZE / 2)    // Writers are woken once the output ring drains to here
+
+/* Characters queued in one direction, oldest at head. */
+typedef struct
+{
+    char    data[TERM_RING_SIZE];
+    int     head;
+    int     count;
+
+} CharRing;
+
+/*
+Terminals are the driver's state for each unit. Typed characters go into line until
+the line is finished, and only then into the input ring where k_term_read can see it.
+*/
+typedef struct _terminal
+{
+    int             present;            // TRUE if the device could be initialized
+    char            name[THREADS_MAX_DEVICE_NAME];
+    CharRing        output;             // Characters waiting to be written
+    int             writing;            // TRUE while a TERMINAL_WRITE_CHAR is outstanding
+    WaitQueue       writers;            // Processes blocked until the output ring has room
+    WaitQueue       drainers;           // Processes blocked in k_term_flush
+    CharRing        input;              // Finished lines waiting to be read
+    int             lines;              // Lines in the input ring
+    char            line[TERM_LINE_MAX];    // Line being typed
+    int             lineLength;
+    int             reading;            // TRUE while a TERMINAL_READ_CHAR is outstanding
+    int             eof;                // TRUE once the device has no more input
+    int             echo;               // TRUE to write typed characters back out
+    WaitQueue       readers;            // Processes blocked in k_term_read
+    IoDevice        io;                 // Commands in flight, and a count of the processes on the queues above
+    terminal_stats_t stats;
+
+} Terminal;
+
+static Terminal terminals[TERM_UNITS];
+
+static Terminal* getTerminal(int unit);
+static int lineDiscipline(Terminal* pTerm, char c);
+static void commitLine(Terminal* pTerm);
+static void endInput(Terminal* pTerm);
+static void echoChar(Terminal* pTerm, char c);
+static void startInput(Terminal* pTerm);
+static void startOutput(Terminal* pTerm);
+static int wakeAll(WaitQueue* pQueue);
+static void ringPut(CharRing* pRing, char c);
+static char ringGet(CharRing* pRing);
+
+
+/**************************************************************************
+   Name - terminal_initialize
+
+   Purpose - Initializes every terminal the library accepts. Input is not
+             read until a process first asks for it. Called once from
+             bootstrap.
+*************************************************************************/
+void terminal_initialize(void)
+{
+    memset(terminals, 0, sizeof(terminals));
+
+    for (int unit = 0; unit < TERM_UNITS; unit++)
+    {
+        Terminal* pTerm = &terminals[unit];
+
+        snprintf(pTerm->name, sizeof(pTerm->name), "term%d", unit);
+        pTerm->present = device_initialize(pTerm->name) == 0;
+        if (pTerm->present)
+        {
+            io_register(&pTerm->io, pTerm->name);
+        }
+    }
+}
+
+/**************************************************************************
+   Name - k_term_read
+
+   Purpose - Reads the next line typed on a terminal, blocking until one
+             has been finished. A line longer than size is returned over
+             several calls.
+
+   Parameters - unit, the terminal to read
+                pBuffer, where to store the line
+                size, the size of pBuffer
+
+   Returns - the number of characters read, including the newline that
+        ends the line, 0 once the input has ended, -1 if the parameters
+        are invalid, or SIGNAL_INTERRUPTED
+*************************************************************************/
+int k_term_read(int unit, char* pBuffer, int size)
+{
+    Terminal* pTerm;
+    int length = 0;
+
+    check_kernel_mode("k_term_read");
+
+    disableInterrupts();
+
+    pTerm = getTerminal(unit);
+    if (pTerm == NULL || pBuffer == NULL || size <= 0)
+    {
+        enableInterrupts();
+        return -1;
+    }
+
+    while (pTerm->lines == 0 && !pTerm->eof)
+    {
+        startInput(pTerm);
+
+        runningProcess->waitResult = 0;
+        io_wait(&pTerm->io, &pTerm->readers, BLOCKED_TERMINAL);
+        if (runningProcess->waitResult == SIGNAL_INTERRUPTED)
+        {
+            enableInterrupts();
+            return SIGNAL_INTERRUPTED;
+        }
+    }
+
+    while (length < size && pTerm->input.count > 0)
+    {
+        pBuffer[length] = ringGet(&pTerm->input);
+        if (pBuffer[length++] == '\n')
+        {
+            break;
+        }
+    }
+
+    // The last line before the end of input has no newline, it ends with the ring
+    if (length > 0 && (pBuffer[length - 1] == '\n' || pTerm->input.count == 0))
+    {
+        pTerm->lines--;
+        pTerm->stats.linesIn++;
+    }
+
+    startInput(pTerm);
+
+    enableInterrupts();
+
+    return length;
+}
+
+/**************************************************************************
+   Name - k_term_write
+
+   Purpose - Queues characters to be written to a terminal. Returns as
+             soon as they are all in the output ring, only blocking while
+             the ring is full.
+
+   Parameters - unit, the terminal to write
+                pBuffer, the characters
+                size, the number of characters
+
+   Returns - the number of characters queued, -1 if the parameters are
+        invalid, or SIGNAL_INTERRUPTED if a signal arrived before any
+        were queued
+*************************************************************************/
+int k_term_write(int unit, char* pBuffer, int size)
+{
+    Terminal* pTerm;
+    int written = 0;
+
+    check_kernel_mode("k_term_write");
+
+    disableInterrupts();
+
+    pTerm = getTerminal(unit);
+    if (pTerm == NULL || pBuffer == NULL || size < 0)
+    {
+        enableInterrupts();
+        return -1;
+    }
+
+    pTerm->stats.writes++;
+
+    while (written < size)
+    {
+        while (pTerm->output.count == TERM_RING_SIZE)
+        {
+            pTerm->stats.writerBlocks++;
+
+            runningProcess->waitResult = 0;
+            io_wait(&pTerm->io, &pTerm->writers, BLOCKED_TERMINAL);
+            if (runningProcess->waitResult == SIGNAL_INTERRUPTED)
+            {
+                enableInterrupts();
+                return written > 0 ? written : SIGNAL_INTERRUPTED;
+            }
+        }
+
+        while (written < size && pTerm->output.count < TERM_RING_SIZE)
+        {
+            ringPut(&pTerm->output, pBuffer[written++]);
+        }
+        startOutput(pTerm);
+    }
+
+    enableInterrupts();
+
+    return written;
+}
+
+/**************************************************************************
+   Name - k_term_flush
+
+   Purpose - Blocks until everything queued for a terminal has been
+             written to the device.
+
+   Parameters - unit, the terminal
+
+   Returns - 0 if successful, -1 if there is no such terminal, or
+        SIGNAL_INTERRUPTED
+*************************************************************************/
+int k_term_flush(int unit)
+{
+    Terminal* pTerm;
+
+    check_kernel_mode("k_term_flush");
+
+    disableInterrupts();
+
+    pTerm = getTerminal(unit);
+    if (pTerm == NULL)
+    {
+        enableInterrupts();
+        return -1;
+    }
+
+    while (pTerm->output.count > 0 || pTerm->writing)
+    {
+        runningProcess->waitResult = 0;
+        io_wait(&pTerm->io, &pTerm->drainers, BLOCKED_TERMINAL);
+        if (runningProcess->waitResult == SIGNAL_INTERRUPTED)
+        {
+            enableInterrupts();
+            return SIGNAL_INTERRUPTED;
+        }
+    }
+
+    enableInterrupts();
+
+    return 0;
+}
+
+/**************************************************************************
+   Name - term_set_echo
+
+   Purpose - Turns echoing of typed characters on or off. Echoes are
+             dropped when the output ring is full rather than holding up
+             the input.
+
+   Returns - the previous setting, or -1 if there is no such terminal
+*************************************************************************/
+int term_set_echo(int unit, int enabled)
+{
+    Terminal* pTerm = getTerminal(unit);
+    int previous;
+
+    if (pTerm == NULL)
+    {
+        return -1;
+    }
+
+    previous = pTerm->echo;
+    pTerm->echo = enabled != 0;
+
+    return previous;
+}
+
+/**************************************************************************
+   Name - get_terminal_stats
+
+   Purpose - Copies the counters of a terminal.
+
+   Returns - 0 if successful, -1 if there is no such terminal
+*************************************************************************/
+int get_terminal_stats(int unit, terminal_stats_t* pStats)
+{
+    Terminal* pTerm = getTerminal(unit);
+
+    if (pTerm == NULL || pStats == NULL)
+    {
+        return -1;
+    }
+
+    *pStats = pTerm->stats;
+
+    return 0;
+}
+
+/**************************************************************************
+   Name - reset_terminal_stats
+
+   Purpose - Clears the counters of a terminal.
+*************************************************************************/
+void reset_terminal_stats(int unit)
+{
+    Terminal* pTerm = getTerminal(unit);
+
+    if (pTerm != NULL)
+    {
+        memset(&pTerm->stats, 0, sizeof(pTerm->stats));
+    }
+}
+
+/**************************************************************************
+   Name - terminal_interrupt
+
+   Purpose - Handles the I/O interrupt for a command a terminal finished.
+             A read passes its character through the line discipline and
+             a write starts on the next queued character, and in both
+             cases the next command is started.
+
+             Writers are only woken once the output ring has drained to
+             TERM_LOW_WATER, so a process writing more than the ring holds
+             is not switched back in for every character.
+
+   Parameters - unit, the terminal that interrupted
+                command and status, from the interrupt. The status holds
+                    the character read in its low byte and the device's
+                    result code above it.
+
+   Returns - TRUE if a process was readied, so the caller should let the
+        dispatcher run, otherwise FALSE
+*************************************************************************/
+int terminal_interrupt(int unit, uint8_t command, uint32_t status)
+{
+    Terminal* pTerm = getTerminal(unit);
+    int code = (status >> 8) & 0xff;
+    int completed = FALSE;
+
+    if (pTerm == NULL)
+    {
+        return FALSE;
+    }
+
+    pTerm->stats.interrupts++;
+    io_complete(&pTerm->io);
+
+    switch (command)
+    {
+    case TERMINAL_READ_CHAR:
+        if (!pTerm->reading)
+        {
+            break;
+        }
+        pTerm->reading = FALSE;
+
+        // The device has nothing more to read, or could not open the input
+        if (code != 0)
+        {
+            endInput(pTerm);
+            completed = wakeAll(&pTerm->readers);
+        }
+        else
+        {
+            pTerm->stats.charsIn++;
+            if (lineDiscipline(pTerm, (char)(status & 0xff)))
+            {
+                completed = wakeAll(&pTerm->readers);
+            }
+        }
+        startInput(pTerm);
+        break;
+
+    case TERMINAL_WRITE_CHAR:
+        if (!pTerm->writing)
+        {
+            break;
+        }
+        pTerm->writing = FALSE;
+
+        if (code != 0)
+        {
+            pTerm->stats.errors++;
+        }
+        else
+        {
+            pTerm->stats.charsOut++;
+        }
+        startOutput(pTerm);
+
+        if (pTerm->output.count <= TERM_LOW_WATER)
+        {
+            completed |= wakeAll(&pTerm->writers);
+        }
+        if (pTerm->output.count == 0 && !pTerm->writing)
+        {
+            completed |= wakeAll(&pTerm->drainers);
+        }
+        break;
+    }
+
+    return completed;
+}
+
+/**************************************************************************
+   Name - getTerminal
+
+   Returns - the terminal for unit, or NULL if there is no such terminal
+*************************************************************************/
+static Terminal* getTerminal(int unit)
+{
+    if (unit < 0 || unit >= TERM_UNITS || !terminals[unit].present)
+    {
+        return NULL;
+    }
+
+    return &terminals[unit];
+}
+
+/**************************************************************************
+   Name - lineDiscipline
+
+   Purpose - Edits the line being typed with a character read from the
+             device. Carriage returns are dropped, TERM_ERASE and 0x7f
+             take back the last character, TERM_KILL the whole line, and
+             TERM_EOF ends the input. A newline finishes the line, as does
+             running out of room, which breaks the line as if a newline
+             had been typed.
+
+   Returns - TRUE if a line was finished or the input ended
+*************************************************************************/
+static int lineDiscipline(Terminal* pTerm, char c)
+{
+    switch (c)
+    {
+    case '\r':
+        return FALSE;
+
+    case TERM_ERASE:
+    case 0x7f:
+        if (pTerm->lineLength > 0)
+        {
+            pTerm->lineLength--;
+            echoChar(pTerm, '\b');
+            echoChar(pTerm, ' ');
+            echoChar(pTerm, '\b');
+        }
+        return FALSE;
+
+    case TERM_KILL:
+        pTerm->lineLength = 0;
+        echoChar(pTerm, '\n');
+        return FALSE;
+
+    case TERM_EOF:
+        endInput(pTerm);
+        return TRUE;
+    }
+
+    pTerm->line[pTerm->lineLength++] = c;
+    echoChar(pTerm, c);
+
+    if (c != '\n' && pTerm->lineLength == TERM_LINE_MAX - 1)
+    {
+        pTerm->line[pTerm->lineLength++] = '\n';
+        echoChar(pTerm, '\n');
+    }
+
+    if (pTerm->line[pTerm->lineLength - 1] == '\n')
+    {
+        commitLine(pTerm);
+        return TRUE;
+    }
+
+    return FALSE;
+}
+
+/**************************************************************************
+   Name - commitLine
+
+   Purpose - Moves the line being typed into the input ring, where it can
+             be read. startInput only reads while the ring has room for a
+             whole line, so it always fits.
+*************************************************************************/
+static void commitLine(Terminal* pTerm)
+{
+    for (int i = 0; i < pTerm->lineLength; i++)
+    {
+        ringPut(&pTerm->input, pTerm->line[i]);
+    }
+
+    pTerm->lineLength = 0;
+    pTerm->lines++;
+}
+
+/**************************************************************************
+   Name - endInput
+
+   Purpose - Stops reading from the terminal. Whatever was typed of the
+             last line becomes a line of its own, without a newline.
+*************************************************************************/
+static void endInput(Terminal* pTerm)
+{
+    if (pTerm->lineLength > 0)
+    {
+        commitLine(pTerm);
+    }
+
+    pTerm->eof = TRUE;
+}
+
+/**************************************************************************
+   Name - echoChar
+
+   Purpose - Writes a typed character back to the terminal if echo is on.
+*************************************************************************/
+static void echoChar(Terminal* pTerm, char c)
+{
+    if (pTerm->echo && pTerm->output.count < TERM_RING_SIZE)
+    {
+        ringPut(&pTerm->output, c);
+        startOutput(pTerm);
+    }
+}
+
+/**************************************************************************
+   Name - startInput
+
+   Purpose - Asks the terminal for its next character, unless a read is
+             already outstanding, the input has ended, or the input ring
+             could not take another whole line.
+*************************************************************************/
+static void startInput(Terminal* pTerm)
+{
+    device_control_block_t controlBlock;
+
+    if (pTerm->reading || pTerm->eof || TERM_RING_SIZE - pTerm->input.count < TERM_LINE_MAX)
+    {
+        return;
+    }
+
+    memset(&controlBlock, 0, sizeof(controlBlock));
+    controlBlock.command = TERMINAL_READ_CHAR;
+
+    if (device_control(pTerm->name, controlBlock) != 0)
+    {
+        console_output(FALSE, "startInput(): %s did not accept TERMINAL_READ_CHAR\n", pTerm->name);
+        pTerm->stats.errors++;
+        endInput(pTerm);
+        return;
+    }
+
+    pTerm->reading = TRUE;
+    io_issue(&pTerm->io);
+}
+
+/**************************************************************************
+   Name - startOutput
+
+   Purpose - Sends the oldest queued character to the terminal, unless a
+             write is already outstanding. If the device will not take
+             the command nothing more can be written, so the output ring
+             is emptied rather than leaving writers waiting on it.
+*************************************************************************/
+static void startOutput(Terminal* pTerm)
+{
+    device_control_block_t controlBlock;
+    char c;
+
+    if (pTerm->writing || pTerm->output.count == 0)
+    {
+        return;
+    }
+
+    c = ringGet(&pTerm->output);
+
+    // The library writes the low byte of output_data itself, not a byte it points to
+    memset(&controlBlock, 0, sizeof(controlBlock));
+    controlBlock.command = TERMINAL_WRITE_CHAR;
+    controlBlock.control1 = (uint8_t)c;
+    controlBlock.output_data = (void*)(uintptr_t)(uint8_t)c;
+    controlBlock.data_length = 1;
+
+    if (device_control(pTerm->name, controlBlock) != 0)
+    {
+        console_output(FALSE, "startOutput(): %s did not accept TERMINAL_WRITE_CHAR\n", pTerm->name);
+        pTerm->stats.errors += 1 + pTerm->output.count;
+        pTerm->output.count = 0;
+        return;
+    }
+
+    pTerm->writing = TRUE;
+    io_issue(&pTerm->io);
+}
+
+/**************************************************************************
+   Name - wakeAll
+
+   Purpose - Readies every process on a wait queue. They check again for
+             what they were waiting on once they run.
+
+   Returns - TRUE if any process was readied
+*************************************************************************/
+static int wakeAll(WaitQueue* pQueue)
+{
+    int woken = pQueue->size > 0;
+
+    while (pQueue->size > 0)
+    {
+        ready_process(wait_queue_pop(pQueue));
+    }
+
+    return woken;
+}
+
+static void ringPut(CharRing* pRing, char c)
+{
+    pRing->data[(pRing->head + pRing->count) % TERM_RING_SIZE] = c;
+    pRing->count++;
+}
+
+static char ringGet(CharRing* pRing)
+{
+    char c = pRing->data[pRing->head];
+
+    pRing->head = (pRing->head + 1) % TERM_RING_SIZE;
+    pRing->count--;
+
+    return c;
+}
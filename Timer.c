@@ -0,0 +1,231 @@
+/*
+Program: Timer
+Created by: Ian Penrose & Lindsay Wax
+Course: CYBV 489
+
+
+Description: Kernel timers kept in a hierarchical timing wheel that is advanced by the
+clock interrupt. The wheel has WHEEL_LEVELS levels of WHEEL_SIZE slots; level 0 holds
+timers due within the next WHEEL_SIZE ticks, and each level above covers WHEEL_SIZE
+times the range of the one below it. Starting and cancelling a timer are O(1), and a
+timer is moved down a level at most WHEEL_LEVELS - 1 times before it fires.
+*/
+
+
+
+#define _CRT_SECURE_NO_WARNINGS
+
+#include <stdio.h>
+#include <string.h>
+#include "THREADSLib.h"
+#include "Scheduler.h"
+#include "Processes.h"
+
+#define WHEEL_BITS      6
+#define WHEEL_SIZE      (1 << WHEEL_BITS)   // Slots per level
+#define WHEEL_MASK      (WHEEL_SIZE - 1)
+#define WHEEL_LEVELS    4                   // 64 ms, 4 s, 4.4 min and 4.7 hours
+
+static Timer* wheel[WHEEL_LEVELS][WHEEL_SIZE];
+static DWORD currentTick;       // Last clock tick (ms) the wheel was advanced to
+static int pendingTimers;       // Number of timers in the wheel
+
+static void insertTimer(Timer* pTimer);
+static void cascade(int level);
+
+
+/**************************************************************************
+   Name - timer_initialize
+
+   Purpose - Empties the wheel and starts it at the current clock tick.
+
+   Parameters - now, the current clock tick in milliseconds
+*************************************************************************/
+void timer_initialize(DWORD now)
+{
+    memset(wheel, 0, sizeof(wheel));
+    currentTick = now;
+    pendingTimers = 0;
+}
+
+/**************************************************************************
+   Name - timer_start
+
+   Purpose - Adds the timer to the wheel so its callback is called once
+             the clock reaches expires. A timer that is already running
+             is restarted.
+
+   Parameters - pTimer, the timer with its callback already set
+                expires, the clock tick in milliseconds to fire at
+*************************************************************************/
+void timer_start(Timer* pTimer, DWORD expires)
+{
+    if (pTimer->active)
+    {
+        timer_cancel(pTimer);
+    }
+
+    // A timer that is already due fires on the next tick
+    if ((int)(expires - currentTick) <= 0)
+    {
+        expires = currentTick + 1;
+    }
+
+    pTimer->expires = expires;
+    pTimer->active = TRUE;
+    insertTimer(pTimer);
+    pendingTimers++;
+}
+
+/**************************************************************************
+   Name - timer_cancel
+
+   Purpose - Removes the timer from the wheel if it has not fired yet.
+*************************************************************************/
+void timer_cancel(Timer* pTimer)
+{
+    if (!pTimer->active)
+    {
+        return;
+    }
+
+    if (pTimer->prev != NULL)
+    {
+        pTimer->prev->next = pTimer->next;
+    }
+    else
+    {
+        // Head of its slot, which is the slot that points at it
+        for (int level = 0; level < WHEEL_LEVELS; level++)
+        {
+            Timer** pSlot = &wheel[level][(pTimer->expires >> (WHEEL_BITS * level)) & WHEEL_MASK];
+            if (*pSlot == pTimer)
+            {
+                *pSlot = pTimer->next;
+                break;
+            }
+        }
+    }
+    if (pTimer->next != NULL)
+    {
+        pTimer->next->prev = pTimer->prev;
+    }
+
+    pTimer->next = NULL;
+    pTimer->prev = NULL;
+    pTimer->active = FALSE;
+    pendingTimers--;
+}
+
+/**************************************************************************
+   Name - timer_advance
+
+   Purpose - Moves the wheel forward to now, firing every timer that
+             expires along the way. Called from the clock interrupt.
+
+   Parameters - now, the current clock tick in milliseconds
+*************************************************************************/
+void timer_advance(DWORD now)
+{
+    Timer* pTimer;
+    int slot;
+
+    while ((int)(now - currentTick) > 0)
+    {
+        currentTick++;
+        slot = currentTick & WHEEL_MASK;
+
+        // Entering a new block of level 0, pull the timers due in it down
+        if (slot == 0)
+        {
+            cascade(1);
+        }
+
+        while ((pTimer = wheel[0][slot]) != NULL)
+        {
+            wheel[0][slot] = pTimer->next;
+            if (pTimer->next != NULL)
+            {
+                pTimer->next->prev = NULL;
+            }
+            pTimer->next = NULL;
+            pTimer->active = FALSE;
+            pendingTimers--;
+
+            pTimer->callback(pTimer);
+        }
+    }
+}
+
+/**************************************************************************
+   Name - timer_pending
+
+   Returns - the number of timers that have not fired yet
+*************************************************************************/
+int timer_pending()
+{
+    return pendingTimers;
+}
+
+
+/**************************************************************************
+   Name - insertTimer
+
+   Purpose - Links the timer into the slot for its expiry on the lowest
+        level whose range still reaches it.
+   *************************************************************************/
+static void insertTimer(Timer* pTimer)
+{
+    DWORD delta = pTimer->expires - currentTick;
+    int level = 0;
+    Timer** pSlot;
+
+    while (level < WHEEL_LEVELS - 1 && delta >= ((DWORD)1 << (WHEEL_BITS * (level + 1))))
+    {
+        level++;
+    }
+
+    pSlot = &wheel[level][(pTimer->expires >> (WHEEL_BITS * level)) & WHEEL_MASK];
+    pTimer->prev = NULL;
+    pTimer->next = *pSlot;
+    if (*pSlot != NULL)
+    {
+        (*pSlot)->prev = pTimer;
+    }
+    *pSlot = pTimer;
+}
+
+/**************************************************************************
+   Name - cascade
+
+   Purpose - Re-inserts the timers of the current slot of level, which now
+        fall within the range of the levels below it. When level itself
+        wraps around, the level above is cascaded first.
+   *************************************************************************/
+static void cascade(int level)
+{
+    int slot;
+    Timer* pTimer;
+    Timer* pNext;
+
+    if (level >= WHEEL_LEVELS)
+    {
+        return;
+    }
+
+    slot = (currentTick >> (WHEEL_BITS * level)) & WHEEL_MASK;
+    if (slot == 0)
+    {
+        cascade(level + 1);
+    }
+
+    pTimer = wheel[level][slot];
+    wheel[level][slot] = NULL;
+
+    while (pTimer != NULL)
+    {
+        pNext = pTimer->next;
+        insertTimer(pTimer);
+        pTimer = pNext;
+    }
+}
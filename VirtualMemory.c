@@ -0,0 +1,1616 @@
+/*
+Program: VirtualMemory
+Created by: Ian Penrose & Lindsay Wax
+Course: CYBV 489
+
+
+Description: Simulated paged virtual memory. Every process can have an address space of
+VM_MAX_PAGES pages, described by its own page table, and reaches it through k_vm_read
+and k_vm_write, which translate each address the way an MMU would: first through a
+small TLB shared by all processes and tagged with the pid, then through the page table.
+Pages are allocated demand-zero; a page gets a frame of physical memory, filled with
+zeros, only when it is first touched. When every frame is in use the clock algorithm
+picks the frame to take back, sweeping the frames and giving each page whose referenced
+bit is set a second chance. A page taken out of its frame is brought back on its next
+fault from wherever it was paged out to.
+
+Once a swap disk is set, pages are paged out to it. The clock then takes back a cluster
+of frames at a time, and the written pages among them go to consecutive slots of the
+swap disk in one vectored write, so the burst costs a seek per track rather than per
+page. A page read back keeps its slot while it stays clean and is not written again.
+Faults are handled one at a time under the pager mutex and block on the disk, so other
+processes run while a fault waits for the swap disk. Without a swap disk, pages are
+copied to memory.
+
+vm_inherit gives a child spawned by k_spawn_cow the pages of its parent copy-on-write.
+Each page with data becomes a shared page, which holds the frame, swap slot or copy the
+page had and counts the page tables that map it. Reads of a shared page go to its
+frame; the first write by a process copies it into a frame of the process's own, unless
+no other process still shares it, when the process takes it over. Shared pages the
+clock takes back are paged out to memory, keeping a swap slot only if they had one when
+shared.
+*/
+
+
+
+#define _CRT_SECURE_NO_WARNINGS
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "THREADSLib.h"
+#include "Scheduler.h"
+#include "Synchronization.h"
+#include "Disk.h"
+#include "Slab.h"
+#include "VirtualMemory.h"
+#include "Processes.h"
+
+#define FIRST_PAGE      1       // Page 0 is never allocated, so address 0 always faults
+#define PAGE_SECTORS    (VM_PAGE_SIZE / THREADS_DISK_SECTOR_SIZE)
+#define DEFAULT_CLUSTER 16
+
+/* One page of an address space. */
+typedef struct
+{
+    int             allocated;      // TRUE once k_vm_allocate has given out the page
+    int             present;        // TRUE while the page is mapped to its frame
+    int             referenced;     // Set on every access, cleared by the clock hand
+    int             dirty;          // Written since it was last brought into its frame
+    int             frame;
+    int             swapSlot;       // Slot holding the page on the swap disk, -1 if none
+    char*           pBacking;       // Copy of the page in memory when it was paged out without swap
+    struct _shared_page* pShared;   // Page shared copy-on-write, which has the data instead, NULL if none
+
+} PageTableEntry;
+
+/*
+A page shared copy-on-write by a process and the children it spawned with k_spawn_cow.
+Its data does not change.
+*/
+typedef struct _shared_page
+{
+    int             refs;           // Page table entries that map it
+    int             frame;          // -1 while it is not in a frame
+    int             referenced;
+    int             dirty;          // The frame is newer than the swap slot or copy
+    int             swapSlot;
+    char*           pBacking;
+
+} SharedPage;
+
+/*
+AddressSpaces are the page table and counters of one process.
+*/
+typedef struct _address_space
+{
+    int             pid;
+    int             nextPage;       // First page k_vm_allocate has not given out
+    PageTableEntry  pages[VM_MAX_PAGES];
+    vm_stats_t      stats;
+
+} AddressSpace;
+
+/* A frame of physical memory and the page in it. */
+typedef struct
+{
+    AddressSpace*   pOwner;         // NULL while the frame is free, set while it is being filled or written out
+    int             page;
+    SharedPage*     pShared;        // Shared page in the frame, instead of pOwner and page
+    int             orphaned;       // The owner was cleaned up while the frame was written out
+
+} Frame;
+
+/* A TLB entry, which caches the frame of one page of one process. */
+typedef struct
+{
+    int             valid;
+    int             pid;
+    int             page;
+    int             frame;
+
+} TlbEntry;
+
+static char* physicalMemory;        // frameCount frames of VM_PAGE_SIZE bytes
+static Frame frames[VM_MAX_FRAMES];
+static int frameCount;
+static int framesUsed;
+static int clockHand;               // Next frame the clock looks at
+static TlbEntry tlb[VM_TLB_ENTRIES];
+static int tlbNext;                 // Next TLB entry to replace
+
+static int swapUnit;                // Swap disk, -1 if there is none
+static int swapCluster;             // Most frames taken back at once with a swap disk
+static int sectorsPerPlatter;       // Of the swap disk
+static unsigned char* pSlotUsed;    // Byte per swap slot, TRUE while it holds a page
+static int slotRotor;               // Where the search for free slots starts
+static disk_segment_t clusterSegments[VM_MAX_CLUSTER * PAGE_SECTORS];
+static vm_swap_stats_t swapStats;
+static int pagerMutex;              // Held while a fault is handled, -1 until the first fault
+static int addressSpaceCache;
+static int pageCopyCache;           // Pages copied to memory when they were paged out without swap
+static int sharedPageCache;
+
+static AddressSpace* getAddressSpace(Process* pProcess);
+static void constructAddressSpace(void* pObject);
+static int vm_access(int address, char* pBuffer, int size, int write);
+static char* translate(AddressSpace* pSpace, int page, int write);
+static int pageFault(AddressSpace* pSpace, int page, int write);
+static int pageInPrivate(AddressSpace* pSpace, int page);
+static int pageInShared(AddressSpace* pSpace, SharedPage* pShared);
+static int copyOnWrite(AddressSpace* pSpace, int page);
+static void takeOverShared(AddressSpace* pSpace, int page);
+static void releaseShared(SharedPage* pShared);
+static int fillFrame(char* pFrame, int swapSlot, char* pBacking);
+static int takeFrame(AddressSpace* pSpace, int page, SharedPage* pShared);
+static int findFreeFrame(void);
+static void reclaimFrames(void);
+static void unmapPage(int frame);
+static int evictShared(int frame);
+static void copyToMemory(PageTableEntry* pEntry, int frame);
+static void writeCluster(int* pFrames, int count);
+static int keepPage(int frame, int slot);
+static int readSlot(int slot, char* pFrame);
+static void slotLocation(int slot, int* pPlatter, int* pTrack, int* pSector);
+static int allocateSlots(int* pSlots, int count);
+static void freeSlot(int* pSwapSlot);
+static void tlbLoad(int pid, int page, int frame);
+static void tlbInvalidate(int pid, int page);
+static void tlbInvalidateFrame(int frame);
+
+
+/**************************************************************************
+   Name - vm_initialize
+
+   Purpose - Gives physical memory VM_DEFAULT_FRAMES frames, all free,
+             and creates the caches address spaces and page copies come
+             from. Called once from bootstrap.
+*************************************************************************/
+void vm_initialize(void)
+{
+    free(physicalMemory);
+    physicalMemory = malloc((size_t)VM_DEFAULT_FRAMES * VM_PAGE_SIZE);
+    memset(frames, 0, sizeof(frames));
+    frameCount = physicalMemory != NULL ? VM_DEFAULT_FRAMES : 0;
+    framesUsed = 0;
+    clockHand = 0;
+    memset(tlb, 0, sizeof(tlb));
+    tlbNext = 0;
+
+    free(pSlotUsed);
+    pSlotUsed = NULL;
+    swapUnit = -1;
+    swapCluster = DEFAULT_CLUSTER;
+    memset(&swapStats, 0, sizeof(swapStats));
+    swapStats.unit = -1;
+    pagerMutex = -1;
+
+    addressSpaceCache = slab_cache_create("address spaces", sizeof(AddressSpace), constructAddressSpace);
+    pageCopyCache = slab_cache_create("page copies", VM_PAGE_SIZE, NULL);
+    sharedPageCache = slab_cache_create("shared pages", sizeof(SharedPage), NULL);
+}
+
+/**************************************************************************
+   Name - k_vm_allocate
+
+   Purpose - Gives the running process size more bytes of address space,
+             rounded up to whole pages. The pages have no frame until they
+             are first touched, and read as zeros.
+
+   Parameters - size, the number of bytes
+
+   Returns - the address of the first byte, -1 if size is invalid, or
+        VM_NO_SPACE if the address space has too few pages left
+*************************************************************************/
+int k_vm_allocate(int size)
+{
+    AddressSpace* pSpace;
+    int pages = (size + VM_PAGE_SIZE - 1) / VM_PAGE_SIZE;
+    int first;
+
+    check_kernel_mode("k_vm_allocate");
+
+    if (size <= 0)
+    {
+        return -1;
+    }
+
+    disableInterrupts();
+
+    pSpace = getAddressSpace(runningProcess);
+    if (pSpace == NULL || pages > VM_MAX_PAGES - pSpace->nextPage)
+    {
+        enableInterrupts();
+        return VM_NO_SPACE;
+    }
+
+    first = pSpace->nextPage;
+    for (int page = first; page < first + pages; page++)
+    {
+        pSpace->pages[page].allocated = TRUE;
+        pSpace->pages[page].swapSlot = -1;
+    }
+    pSpace->nextPage += pages;
+    pSpace->stats.allocatedPages += pages;
+
+    enableInterrupts();
+
+    return first * VM_PAGE_SIZE;
+}
+
+/**************************************************************************
+   Name - k_vm_read
+
+   Purpose - Copies bytes out of the running process's address space,
+             faulting in any page that is not in a frame.
+
+   Parameters - address, the first byte to read
+                pBuffer, where to copy them
+                size, the number of bytes
+
+   Returns - 0 if successful, -1 if the parameters are invalid or a page
+        could not be brought in, VM_FAULT if any of the bytes was never
+        allocated, or SIGNAL_INTERRUPTED
+*************************************************************************/
+int k_vm_read(int address, void* pBuffer, int size)
+{
+    check_kernel_mode("k_vm_read");
+
+    return vm_access(address, pBuffer, size, FALSE);
+}
+
+/**************************************************************************
+   Name - k_vm_write
+
+   Purpose - Copies bytes into the running process's address space,
+             faulting in any page that is not in a frame.
+
+   Parameters - address, the first byte to write
+                pBuffer, the bytes
+                size, the number of bytes
+
+   Returns - same as k_vm_read
+*************************************************************************/
+int k_vm_write(int address, void* pBuffer, int size)
+{
+    check_kernel_mode("k_vm_write");
+
+    return vm_access(address, pBuffer, size, TRUE);
+}
+
+/**************************************************************************
+   Name - vm_set_frames
+
+   Purpose - Sets how many frames physical memory has. Only possible
+             while no frame is in use.
+
+   Parameters - count, the number of frames, from 1 to VM_MAX_FRAMES
+
+   Returns - 0 if successful, -1 if frames is invalid, the memory cannot
+        be allocated, or a frame is in use
+*************************************************************************/
+int vm_set_frames(int count)
+{
+    char* pMemory;
+
+    check_kernel_mode("vm_set_frames");
+
+    if (count < 1 || count > VM_MAX_FRAMES || framesUsed > 0)
+    {
+        return -1;
+    }
+
+    pMemory = malloc((size_t)count * VM_PAGE_SIZE);
+    if (pMemory == NULL)
+    {
+        return -1;
+    }
+
+    disableInterrupts();
+
+    free(physicalMemory);
+    physicalMemory = pMemory;
+    frameCount = count;
+    clockHand = 0;
+    memset(tlb, 0, sizeof(tlb));
+    tlbNext = 0;
+
+    enableInterrupts();
+
+    return 0;
+}
+
+/**************************************************************************
+   Name - vm_set_swap
+
+   Purpose - Sets the disk pages are paged out to, which is then used
+             whole as swap, and how many frames are taken back at once.
+             The disk can only be changed while no page is on swap.
+
+   Parameters - unit, the swap disk, or -1 to page out to memory
+                cluster, the most frames taken back at once, from 1 to
+                    VM_MAX_CLUSTER
+
+   Returns - 0 if successful, -1 if the parameters are invalid or pages
+        are on the current swap disk
+*************************************************************************/
+int vm_set_swap(int unit, int cluster)
+{
+    unsigned char* pSlots = NULL;
+    int platters, tracks;
+    int slots = 0;
+
+    check_kernel_mode("vm_set_swap");
+
+    if (cluster < 1 || cluster > VM_MAX_CLUSTER)
+    {
+        return -1;
+    }
+
+    if (unit != swapUnit)
+    {
+        if (swapStats.slotsUsed > 0)
+        {
+            return -1;
+        }
+
+        if (unit >= 0)
+        {
+            if (k_disk_info(unit, &platters, &tracks) != 0)
+            {
+                return -1;
+            }
+            slots = platters * tracks * THREADS_DISK_SECTOR_COUNT / PAGE_SECTORS;
+            pSlots = calloc(slots, 1);
+            if (pSlots == NULL)
+            {
+                return -1;
+            }
+            sectorsPerPlatter = tracks * THREADS_DISK_SECTOR_COUNT;
+        }
+
+        disableInterrupts();
+        free(pSlotUsed);
+        pSlotUsed = pSlots;
+        swapUnit = unit;
+        swapStats.unit = unit;
+        swapStats.slots = slots;
+        slotRotor = 0;
+        enableInterrupts();
+    }
+
+    swapCluster = cluster;
+
+    return 0;
+}
+
+/**************************************************************************
+   Name - get_vm_stats
+
+   Purpose - Copies the paging counters of a process.
+
+   Parameters - pid, the process
+                pStats, where to store them
+
+   Returns - 0 if successful, -1 if there is no such process or it has
+        never allocated any virtual memory
+*************************************************************************/
+int get_vm_stats(int pid, vm_stats_t* pStats)
+{
+    for (int i = 0; i < MAX_PROCESSES; i++)
+    {
+        if (processTable[i].pid == pid && pid != 0 && processTable[i].pAddressSpace != NULL)
+        {
+            if (pStats != NULL)
+            {
+                *pStats = processTable[i].pAddressSpace->stats;
+            }
+            return 0;
+        }
+    }
+
+    return -1;
+}
+
+/**************************************************************************
+   Name - get_swap_stats
+
+   Purpose - Copies the swap counters.
+*************************************************************************/
+void get_swap_stats(vm_swap_stats_t* pStats)
+{
+    if (pStats != NULL)
+    {
+        *pStats = swapStats;
+    }
+}
+
+/**************************************************************************
+   Name - reset_swap_stats
+
+   Purpose - Zeroes the swap counters, keeping the disk and its slots.
+*************************************************************************/
+void reset_swap_stats(void)
+{
+    swapStats.clusters = 0;
+    swapStats.pagesWritten = 0;
+    swapStats.pagesRead = 0;
+    swapStats.writeTime = 0;
+    swapStats.readTime = 0;
+    swapStats.errors = 0;
+}
+
+/**************************************************************************
+   Name - vm_release
+
+   Purpose - Frees a process's frames, swap slots, copies and page table.
+             Called when the process is cleaned up, which cannot happen
+             while it is in a fault. A frame of the process that is being
+             written out is freed by the write. Shared pages are freed
+             when no other process maps them.
+*************************************************************************/
+void vm_release(Process* pProcess)
+{
+    AddressSpace* pSpace = pProcess->pAddressSpace;
+    uint32_t psr = get_psr();
+
+    if (pSpace == NULL)
+    {
+        return;
+    }
+
+    disableInterrupts();
+
+    for (int page = FIRST_PAGE; page < pSpace->nextPage; page++)
+    {
+        PageTableEntry* pEntry = &pSpace->pages[page];
+
+        if (pEntry->pShared != NULL)
+        {
+            releaseShared(pEntry->pShared);
+            tlbInvalidate(pSpace->pid, page);
+        }
+        else if (pEntry->present)
+        {
+            frames[pEntry->frame].pOwner = NULL;
+            framesUsed--;
+            tlbInvalidate(pSpace->pid, page);
+        }
+        else if (frames[pEntry->frame].pOwner == pSpace && frames[pEntry->frame].page == page)
+        {
+            // Being written out, so the write frees the frame and must not look at the page again
+            frames[pEntry->frame].orphaned = TRUE;
+        }
+        freeSlot(&pEntry->swapSlot);
+        slab_free(pageCopyCache, pEntry->pBacking);
+        memset(pEntry, 0, sizeof(PageTableEntry));
+    }
+
+    // Back to the state constructAddressSpace leaves it in
+    pSpace->nextPage = FIRST_PAGE;
+    memset(&pSpace->stats, 0, sizeof(pSpace->stats));
+    slab_free(addressSpaceCache, pSpace);
+    pProcess->pAddressSpace = NULL;
+
+    set_psr(psr);
+}
+
+/**************************************************************************
+   Name - vm_inherit
+
+   Purpose - Gives a child being spawned by k_spawn_cow the address
+             space of its parent, sharing every page that has data
+             copy-on-write. Pages never touched are left to be zero
+             filled by each process. Nothing is copied; a page is copied
+             when either process first writes it. The parent is the
+             running process, so none of its pages is being faulted in.
+
+   Parameters - pParent, the process spawning it
+                pChild, the child, which has not run yet
+
+   Returns - 0 if successful, -1 if the address space or shared pages
+        could not be allocated, when nothing is changed
+*************************************************************************/
+int vm_inherit(Process* pParent, Process* pChild)
+{
+    AddressSpace* pSpace = pParent->pAddressSpace;
+    AddressSpace* pCopy;
+    SharedPage* newShared[VM_MAX_PAGES];
+    int needed = 0;
+    int allocated = 0;
+    uint32_t psr = get_psr();
+
+    if (pSpace == NULL)
+    {
+        return 0;
+    }
+
+    disableInterrupts();
+
+    // Everything is allocated first, so a spawn that cannot get it all changes nothing
+    for (int page = FIRST_PAGE; page < pSpace->nextPage; page++)
+    {
+        PageTableEntry* pEntry = &pSpace->pages[page];
+
+        needed += pEntry->allocated && pEntry->pShared == NULL &&
+            (pEntry->present || pEntry->swapSlot >= 0 || pEntry->pBacking != NULL);
+    }
+
+    pCopy = slab_alloc(addressSpaceCache);
+    while (pCopy != NULL && allocated < needed && (newShared[allocated] = slab_alloc(sharedPageCache)) != NULL)
+    {
+        allocated++;
+    }
+    if (pCopy == NULL || allocated < needed)
+    {
+        while (allocated > 0)
+        {
+            slab_free(sharedPageCache, newShared[--allocated]);
+        }
+        slab_free(addressSpaceCache, pCopy);
+        set_psr(psr);
+        return -1;
+    }
+
+    pCopy->pid = pChild->pid;
+    pCopy->nextPage = pSpace->nextPage;
+    pCopy->stats.allocatedPages = pSpace->stats.allocatedPages;
+
+    for (int page = FIRST_PAGE; page < pSpace->nextPage; page++)
+    {
+        PageTableEntry* pEntry = &pSpace->pages[page];
+        PageTableEntry* pChildEntry = &pCopy->pages[page];
+        SharedPage* pShared;
+
+        if (!pEntry->allocated)
+        {
+            continue;
+        }
+        pChildEntry->allocated = TRUE;
+        pChildEntry->swapSlot = -1;
+
+        if (pEntry->pShared != NULL)
+        {
+            pChildEntry->pShared = pEntry->pShared;
+            pEntry->pShared->refs++;
+            pCopy->stats.sharedPages++;
+            continue;
+        }
+        if (!pEntry->present && pEntry->swapSlot < 0 && pEntry->pBacking == NULL)
+        {
+            continue;
+        }
+
+        // The page's data moves to a shared page, which both page tables map
+        pShared = newShared[--allocated];
+        pShared->refs = 2;
+        pShared->frame = -1;
+        pShared->referenced = pEntry->referenced;
+        pShared->dirty = FALSE;
+        pShared->swapSlot = pEntry->swapSlot;
+        pShared->pBacking = pEntry->pBacking;
+        if (pEntry->present)
+        {
+            pShared->frame = pEntry->frame;
+            pShared->dirty = pEntry->dirty;
+            frames[pEntry->frame].pOwner = NULL;
+            frames[pEntry->frame].pShared = pShared;
+            pSpace->stats.residentPages--;
+        }
+
+        // A write through the TLB must fault from now on
+        tlbInvalidate(pSpace->pid, page);
+        memset(pEntry, 0, sizeof(PageTableEntry));
+        pEntry->allocated = TRUE;
+        pEntry->swapSlot = -1;
+        pEntry->pShared = pShared;
+        pChildEntry->pShared = pShared;
+        pSpace->stats.sharedPages++;
+        pCopy->stats.sharedPages++;
+    }
+
+    pChild->pAddressSpace = pCopy;
+
+    set_psr(psr);
+
+    return 0;
+}
+
+/**************************************************************************
+   Name - getAddressSpace
+
+   Returns - the process's address space, created empty the first time,
+        or NULL if it cannot be allocated
+*************************************************************************/
+static AddressSpace* getAddressSpace(Process* pProcess)
+{
+    if (pProcess->pAddressSpace == NULL)
+    {
+        pProcess->pAddressSpace = slab_alloc(addressSpaceCache);
+        if (pProcess->pAddressSpace != NULL)
+        {
+            pProcess->pAddressSpace->pid = pProcess->pid;
+        }
+    }
+
+    return pProcess->pAddressSpace;
+}
+
+/**************************************************************************
+   Name - constructAddressSpace
+
+   Purpose - Builds an address space with no pages allocated, the state
+             address spaces are kept in while in their cache.
+*************************************************************************/
+static void constructAddressSpace(void* pObject)
+{
+    AddressSpace* pSpace = pObject;
+
+    memset(pSpace, 0, sizeof(AddressSpace));
+    pSpace->nextPage = FIRST_PAGE;
+}
+
+/**************************************************************************
+   Name - vm_access
+
+   Purpose - Common path for k_vm_read and k_vm_write. Translates the
+             address one page at a time and copies the part of the
+             transfer that falls in each page, handling a fault and
+             trying again when a page is not mapped.
+
+   Returns - same as k_vm_read
+*************************************************************************/
+static int vm_access(int address, char* pBuffer, int size, int write)
+{
+    AddressSpace* pSpace = runningProcess->pAddressSpace;
+    int result = 0;
+
+    if (pBuffer == NULL || size < 0 || address < 0)
+    {
+        return -1;
+    }
+    if (pSpace == NULL)
+    {
+        return VM_FAULT;
+    }
+
+    while (size > 0 && result == 0)
+    {
+        int page = address / VM_PAGE_SIZE;
+        int offset = address % VM_PAGE_SIZE;
+        int length = VM_PAGE_SIZE - offset < size ? VM_PAGE_SIZE - offset : size;
+        char* pFrame;
+
+        if (page >= VM_MAX_PAGES || !pSpace->pages[page].allocated)
+        {
+            result = VM_FAULT;
+            break;
+        }
+
+        disableInterrupts();
+        pFrame = translate(pSpace, page, write);
+        if (pFrame != NULL)
+        {
+            if (write)
+            {
+                memcpy(pFrame + offset, pBuffer, length);
+            }
+            else
+            {
+                memcpy(pBuffer, pFrame + offset, length);
+            }
+        }
+        enableInterrupts();
+
+        if (pFrame == NULL)
+        {
+            result = pageFault(pSpace, page, write);
+            continue;
+        }
+
+        address += length;
+        pBuffer += length;
+        size -= length;
+    }
+
+    return result;
+}
+
+/**************************************************************************
+   Name - translate
+
+   Purpose - Finds the frame holding a page the way the MMU would: in the
+             TLB, or on a miss in the page table, loading the translation
+             into the TLB. The page's referenced bit, and on a write its
+             dirty bit, are set. Shared pages are mapped for reading only.
+             Called with interrupts disabled.
+
+   Returns - the frame's memory, or NULL if the page is not mapped, or is
+        shared and being written
+*************************************************************************/
+static char* translate(AddressSpace* pSpace, int page, int write)
+{
+    PageTableEntry* pEntry = &pSpace->pages[page];
+    SharedPage* pShared = pEntry->pShared;
+    int frame = -1;
+
+    if (write && pShared != NULL)
+    {
+        return NULL;
+    }
+
+    for (int i = 0; i < VM_TLB_ENTRIES; i++)
+    {
+        if (tlb[i].valid && tlb[i].pid == pSpace->pid && tlb[i].page == page)
+        {
+            frame = tlb[i].frame;
+            break;
+        }
+    }
+
+    if (frame >= 0)
+    {
+        pSpace->stats.tlbHits++;
+    }
+    else
+    {
+        pSpace->stats.tlbMisses++;
+
+        frame = pShared != NULL ? pShared->frame : pEntry->present ? pEntry->frame : -1;
+        if (frame < 0)
+        {
+            return NULL;
+        }
+        tlbLoad(pSpace->pid, page, frame);
+    }
+
+    if (pShared != NULL)
+    {
+        pShared->referenced = TRUE;
+        return physicalMemory + (size_t)frame * VM_PAGE_SIZE;
+    }
+
+    pEntry->referenced = TRUE;
+    if (write)
+    {
+        pEntry->dirty = TRUE;
+    }
+
+    return physicalMemory + (size_t)frame * VM_PAGE_SIZE;
+}
+
+/**************************************************************************
+   Name - pageFault
+
+   Purpose - Handles a fault under the pager mutex: a write to a shared
+             page copies it or takes it over, a read of a shared page
+             brings it into a frame, and a private page is brought in as
+             pageInPrivate describes.
+
+   Returns - 0 if successful, -1 if no frame could be taken or the swap
+        disk failed the read, or SIGNAL_INTERRUPTED
+*************************************************************************/
+static int pageFault(AddressSpace* pSpace, int page, int write)
+{
+    PageTableEntry* pEntry = &pSpace->pages[page];
+    DWORD start = read_clock();
+    int result = 0;
+
+    disableInterrupts();
+    if (pagerMutex < 0)
+    {
+        pagerMutex = k_mutex_create();
+    }
+    enableInterrupts();
+
+    result = k_mutex_lock(pagerMutex);
+    if (result != 0)
+    {
+        return result;
+    }
+
+    if (pEntry->pShared != NULL)
+    {
+        result = write ? copyOnWrite(pSpace, page) : pageInShared(pSpace, pEntry->pShared);
+    }
+    if (result == 0 && pEntry->pShared == NULL && !pEntry->present)
+    {
+        result = pageInPrivate(pSpace, page);
+    }
+
+    disableInterrupts();
+    pSpace->stats.pageFaults++;
+    pSpace->stats.faultTime += read_clock() - start;
+    enableInterrupts();
+
+    k_mutex_unlock(pagerMutex);
+
+    return result;
+}
+
+/**************************************************************************
+   Name - pageInPrivate
+
+   Purpose - Brings a page of one process into a frame: from its swap
+             slot, blocking until the disk has read it, from its copy in
+             memory, or as a page of zeros if it has never been paged out.
+             The page is mapped and loaded into the TLB as referenced, so
+             the access that faulted finds it. Called holding the pager
+             mutex.
+
+   Returns - 0 if successful, -1 if no frame could be taken or the swap
+        disk failed the read
+*************************************************************************/
+static int pageInPrivate(AddressSpace* pSpace, int page)
+{
+    PageTableEntry* pEntry = &pSpace->pages[page];
+    int frame;
+    int result;
+
+    frame = takeFrame(pSpace, page, NULL);
+    if (frame < 0)
+    {
+        return -1;
+    }
+
+    if (pEntry->swapSlot < 0 && pEntry->pBacking == NULL)
+    {
+        pSpace->stats.zeroFills++;
+    }
+    else
+    {
+        pSpace->stats.pageIns++;
+    }
+    result = fillFrame(physicalMemory + (size_t)frame * VM_PAGE_SIZE, pEntry->swapSlot, pEntry->pBacking);
+
+    disableInterrupts();
+
+    if (result == 0)
+    {
+        pEntry->frame = frame;
+        pEntry->present = TRUE;
+        pEntry->referenced = TRUE;
+        pEntry->dirty = FALSE;
+        tlbLoad(pSpace->pid, page, frame);
+        pSpace->stats.residentPages++;
+    }
+    else
+    {
+        frames[frame].pOwner = NULL;
+        framesUsed--;
+    }
+
+    enableInterrupts();
+
+    return result;
+}
+
+/**************************************************************************
+   Name - pageInShared
+
+   Purpose - Brings a shared page into a frame for reading, unless another
+             process's fault brought it in while this one waited for the
+             pager mutex. Called holding the pager mutex.
+
+   Returns - 0 if successful, -1 if no frame could be taken or the swap
+        disk failed the read
+*************************************************************************/
+static int pageInShared(AddressSpace* pSpace, SharedPage* pShared)
+{
+    int frame;
+    int result;
+
+    if (pShared->frame >= 0)
+    {
+        return 0;
+    }
+
+    frame = takeFrame(NULL, 0, pShared);
+    if (frame < 0)
+    {
+        return -1;
+    }
+    result = fillFrame(physicalMemory + (size_t)frame * VM_PAGE_SIZE, pShared->swapSlot, pShared->pBacking);
+
+    disableInterrupts();
+
+    if (result == 0)
+    {
+        pShared->frame = frame;
+        pShared->referenced = TRUE;
+        pShared->dirty = FALSE;
+        pSpace->stats.pageIns++;
+    }
+    else
+    {
+        frames[frame].pShared = NULL;
+        framesUsed--;
+    }
+
+    enableInterrupts();
+
+    return result;
+}
+
+/**************************************************************************
+   Name - copyOnWrite
+
+   Purpose - Gives a process being written its own copy of a shared page,
+             in a new frame, or lets it take the page over if no other
+             process shares it any more. Called holding the pager mutex.
+
+   Returns - 0 if successful, -1 if no frame could be taken or the swap
+        disk failed the read
+*************************************************************************/
+static int copyOnWrite(AddressSpace* pSpace, int page)
+{
+    PageTableEntry* pEntry = &pSpace->pages[page];
+    SharedPage* pShared = pEntry->pShared;
+    char* pFrame;
+    int frame;
+    int result = 0;
+
+    disableInterrupts();
+    if (pShared->refs == 1)
+    {
+        takeOverShared(pSpace, page);
+        enableInterrupts();
+        return 0;
+    }
+    enableInterrupts();
+
+    frame = takeFrame(pSpace, page, NULL);
+    if (frame < 0)
+    {
+        return -1;
+    }
+    pFrame = physicalMemory + (size_t)frame * VM_PAGE_SIZE;
+
+    // The shared page may have lost its frame while this one was taken
+    disableInterrupts();
+    if (pShared->frame >= 0)
+    {
+        memcpy(pFrame, physicalMemory + (size_t)pShared->frame * VM_PAGE_SIZE, VM_PAGE_SIZE);
+    }
+    else
+    {
+        enableInterrupts();
+        result = fillFrame(pFrame, pShared->swapSlot, pShared->pBacking);
+        disableInterrupts();
+    }
+
+    if (result == 0)
+    {
+        releaseShared(pShared);
+        pEntry->pShared = NULL;
+        pEntry->frame = frame;
+        pEntry->present = TRUE;
+        pEntry->referenced = TRUE;
+        pEntry->dirty = TRUE;
+        tlbInvalidate(pSpace->pid, page);
+        tlbLoad(pSpace->pid, page, frame);
+        pSpace->stats.residentPages++;
+        pSpace->stats.sharedPages--;
+        pSpace->stats.cowFaults++;
+    }
+    else
+    {
+        frames[frame].pOwner = NULL;
+        framesUsed--;
+    }
+
+    enableInterrupts();
+
+    return result;
+}
+
+/**************************************************************************
+   Name - takeOverShared
+
+   Purpose - Makes a shared page that only one page table maps private to
+             it again, with the frame, swap slot and copy it had. Called
+             with interrupts disabled.
+*************************************************************************/
+static void takeOverShared(AddressSpace* pSpace, int page)
+{
+    PageTableEntry* pEntry = &pSpace->pages[page];
+    SharedPage* pShared = pEntry->pShared;
+
+    pEntry->pShared = NULL;
+    pEntry->swapSlot = pShared->swapSlot;
+    pEntry->pBacking = pShared->pBacking;
+    if (pShared->frame >= 0)
+    {
+        frames[pShared->frame].pShared = NULL;
+        frames[pShared->frame].pOwner = pSpace;
+        frames[pShared->frame].page = page;
+        pEntry->frame = pShared->frame;
+        pEntry->present = TRUE;
+        pEntry->referenced = pShared->referenced;
+        pEntry->dirty = pShared->dirty;
+        pSpace->stats.residentPages++;
+    }
+    pSpace->stats.sharedPages--;
+
+    slab_free(sharedPageCache, pShared);
+}
+
+/**************************************************************************
+   Name - releaseShared
+
+   Purpose - Drops a page table's reference to a shared page, freeing its
+             frame, swap slot and copy with it when it was the last one.
+             Called with interrupts disabled.
+*************************************************************************/
+static void releaseShared(SharedPage* pShared)
+{
+    if (--pShared->refs > 0)
+    {
+        return;
+    }
+
+    if (pShared->frame >= 0)
+    {
+        tlbInvalidateFrame(pShared->frame);
+        frames[pShared->frame].pShared = NULL;
+        framesUsed--;
+    }
+    freeSlot(&pShared->swapSlot);
+    slab_free(pageCopyCache, pShared->pBacking);
+    slab_free(sharedPageCache, pShared);
+}
+
+/**************************************************************************
+   Name - fillFrame
+
+   Purpose - Fills a frame with a page's data: from its swap slot,
+             blocking until the disk has read it, from its copy in
+             memory, or with zeros if it has neither.
+
+   Returns - 0 if successful, -1 if the swap disk failed the read
+*************************************************************************/
+static int fillFrame(char* pFrame, int swapSlot, char* pBacking)
+{
+    if (swapSlot >= 0)
+    {
+        return readSlot(swapSlot, pFrame);
+    }
+
+    if (pBacking != NULL)
+    {
+        memcpy(pFrame, pBacking, VM_PAGE_SIZE);
+    }
+    else
+    {
+        memset(pFrame, 0, VM_PAGE_SIZE);
+    }
+
+    return 0;
+}
+
+/**************************************************************************
+   Name - takeFrame
+
+   Purpose - Reserves a frame for a page fault, taking frames back with
+             the clock when none is free. Called holding the pager mutex
+             with interrupts enabled, and may block while frames are
+             written out. The frame is given to a page of pSpace, or to
+             pShared if it is not NULL.
+
+   Returns - the frame, or -1 if physical memory has no frames
+*************************************************************************/
+static int takeFrame(AddressSpace* pSpace, int page, SharedPage* pShared)
+{
+    int frame;
+
+    if (frameCount == 0)
+    {
+        return -1;
+    }
+
+    disableInterrupts();
+
+    frame = findFreeFrame();
+    while (frame < 0)
+    {
+        reclaimFrames();
+        frame = findFreeFrame();
+    }
+
+    frames[frame].pOwner = pSpace;
+    frames[frame].page = page;
+    frames[frame].pShared = pShared;
+    framesUsed++;
+
+    enableInterrupts();
+
+    return frame;
+}
+
+/**************************************************************************
+   Name - findFreeFrame
+
+   Returns - a free frame, or -1 if every frame is in use
+*************************************************************************/
+static int findFreeFrame(void)
+{
+    if (framesUsed < frameCount)
+    {
+        for (int frame = 0; frame < frameCount; frame++)
+        {
+            if (frames[frame].pOwner == NULL && frames[frame].pShared == NULL)
+            {
+                return frame;
+            }
+        }
+    }
+
+    return -1;
+}
+
+/**************************************************************************
+   Name - reclaimFrames
+
+   Purpose - Takes frames back with the clock: the hand sweeps the frames,
+             clearing referenced bits, and takes every mapped page that
+             has not been referenced since the hand last passed it, up to
+             one page without a swap disk or a cluster with one. Frames
+             whose pages are clean are free at once; the written pages are
+             paged out together and their frames freed once the write is
+             done. Called with interrupts disabled, which are enabled
+             while the cluster is written.
+*************************************************************************/
+static void reclaimFrames(void)
+{
+    int victims[VM_MAX_CLUSTER];
+    int limit = swapUnit >= 0 ? swapCluster : 1;
+    int taken = 0;
+    int count = 0;
+
+    for (int steps = 0; steps < 2 * frameCount && taken < limit; steps++)
+    {
+        int frame = clockHand;
+        Frame* pFrame = &frames[frame];
+        PageTableEntry* pEntry;
+
+        clockHand = (clockHand + 1) % frameCount;
+
+        // A shared page being filled does not have its frame yet
+        if (pFrame->pShared != NULL)
+        {
+            if (pFrame->pShared->frame != frame)
+            {
+                continue;
+            }
+            if (pFrame->pShared->referenced)
+            {
+                pFrame->pShared->referenced = FALSE;
+                continue;
+            }
+            taken += evictShared(frame);
+            continue;
+        }
+
+        // Skip free frames and the ones being filled or written out
+        if (pFrame->pOwner == NULL || !pFrame->pOwner->pages[pFrame->page].present)
+        {
+            continue;
+        }
+
+        pEntry = &pFrame->pOwner->pages[pFrame->page];
+        if (pEntry->referenced)
+        {
+            pEntry->referenced = FALSE;
+            continue;
+        }
+
+        unmapPage(frame);
+        taken++;
+
+        if (pEntry->dirty && swapUnit >= 0)
+        {
+            freeSlot(&pEntry->swapSlot);
+            victims[count++] = frame;
+        }
+        else
+        {
+            if (pEntry->dirty)
+            {
+                copyToMemory(pEntry, frame);
+            }
+            pFrame->pOwner = NULL;
+            framesUsed--;
+        }
+    }
+
+    if (count > 0)
+    {
+        writeCluster(victims, count);
+    }
+}
+
+/**************************************************************************
+   Name - evictShared
+
+   Purpose - Takes the frame of a shared page away from every page table
+             that maps it. A page written before it was shared is copied
+             to memory, not the swap disk, as its slot would be freed and
+             the cluster written for pages of one page table.
+
+   Returns - 1 if the frame was freed, 0 if the page could not be copied
+*************************************************************************/
+static int evictShared(int frame)
+{
+    SharedPage* pShared = frames[frame].pShared;
+
+    if (pShared->dirty)
+    {
+        if (pShared->pBacking == NULL)
+        {
+            pShared->pBacking = slab_alloc(pageCopyCache);
+            if (pShared->pBacking == NULL)
+            {
+                return 0;
+            }
+        }
+        memcpy(pShared->pBacking, physicalMemory + (size_t)frame * VM_PAGE_SIZE, VM_PAGE_SIZE);
+        freeSlot(&pShared->swapSlot);
+        pShared->dirty = FALSE;
+    }
+
+    tlbInvalidateFrame(frame);
+    pShared->frame = -1;
+    frames[frame].pShared = NULL;
+    framesUsed--;
+
+    return 1;
+}
+
+/**************************************************************************
+   Name - unmapPage
+
+   Purpose - Takes the page in a frame out of its page table and the TLB,
+             so the next access to it faults. The frame stays owned.
+*************************************************************************/
+static void unmapPage(int frame)
+{
+    AddressSpace* pSpace = frames[frame].pOwner;
+    PageTableEntry* pEntry = &pSpace->pages[frames[frame].page];
+
+    tlbInvalidate(pSpace->pid, frames[frame].page);
+
+    pEntry->present = FALSE;
+    pSpace->stats.residentPages--;
+    pSpace->stats.evictions++;
+}
+
+/**************************************************************************
+   Name - copyToMemory
+
+   Purpose - Pages a written page out to a copy in memory, for when there
+             is no room for it on a swap disk.
+*************************************************************************/
+static void copyToMemory(PageTableEntry* pEntry, int frame)
+{
+    if (pEntry->pBacking == NULL)
+    {
+        pEntry->pBacking = slab_alloc(pageCopyCache);
+    }
+    if (pEntry->pBacking != NULL)
+    {
+        memcpy(pEntry->pBacking, physicalMemory + (size_t)frame * VM_PAGE_SIZE, VM_PAGE_SIZE);
+        frames[frame].pOwner->stats.pageOuts++;
+    }
+    pEntry->dirty = FALSE;
+}
+
+/**************************************************************************
+   Name - writeCluster
+
+   Purpose - Pages out the written pages of a cluster of frames to swap
+             slots allocated together, with one vectored write, and frees
+             the frames. Pages there is no slot for are copied to memory.
+             The slots are recorded before the write, so a fault on one
+             of the pages waits for the pager mutex and reads it back. If
+             the write fails, the pages get their data from the frames
+             again through keepPage. Called with interrupts disabled,
+             which are enabled during the write.
+*************************************************************************/
+static void writeCluster(int* pFrames, int count)
+{
+    int slots[VM_MAX_CLUSTER];
+    int allocated = allocateSlots(slots, count);
+    int segments = 0;
+    DWORD start;
+    int result = 0;
+
+    for (int i = 0; i < count; i++)
+    {
+        Frame* pFrame = &frames[pFrames[i]];
+        PageTableEntry* pEntry = &pFrame->pOwner->pages[pFrame->page];
+        char* pData = physicalMemory + (size_t)pFrames[i] * VM_PAGE_SIZE;
+        int platter, track, sector;
+
+        if (i >= allocated)
+        {
+            copyToMemory(pEntry, pFrames[i]);
+            continue;
+        }
+
+        slab_free(pageCopyCache, pEntry->pBacking);
+        pEntry->pBacking = NULL;
+        pEntry->swapSlot = slots[i];
+        pEntry->dirty = FALSE;
+        pFrame->pOwner->stats.pageOuts++;
+
+        slotLocation(slots[i], &platter, &track, &sector);
+        for (int j = 0; j < PAGE_SECTORS; j++)
+        {
+            clusterSegments[segments].platter = platter;
+            clusterSegments[segments].track = track;
+            clusterSegments[segments].sector = sector + j;
+            clusterSegments[segments].pBuffer = pData + j * THREADS_DISK_SECTOR_SIZE;
+            segments++;
+        }
+    }
+
+    if (segments > 0)
+    {
+        enableInterrupts();
+        start = read_clock();
+        result = k_disk_writev(swapUnit, clusterSegments, segments);
+        disableInterrupts();
+
+        swapStats.writeTime += read_clock() - start;
+        swapStats.clusters++;
+        swapStats.pagesWritten += allocated;
+        if (result != 0)
+        {
+            swapStats.errors++;
+        }
+    }
+
+    // The owners may have been cleaned up during the write, their frames are free either way
+    for (int i = 0; i < count; i++)
+    {
+        Frame* pFrame = &frames[pFrames[i]];
+
+        if (result != 0 && i < allocated && !pFrame->orphaned && keepPage(pFrames[i], slots[i]))
+        {
+            continue;
+        }
+        pFrame->pOwner = NULL;
+        pFrame->orphaned = FALSE;
+        framesUsed--;
+    }
+}
+
+/**************************************************************************
+   Name - keepPage
+
+   Purpose - Saves a page whose write to its swap slot failed, while its
+             frame still has the data. The slot is freed and the page is
+             copied to memory, or if there is no memory for the copy, put
+             back in its frame mapped and dirty. k_spawn_cow may have moved
+             the page to a shared page during the write, which is saved
+             the same way. Called with interrupts disabled.
+
+   Parameters - frame, the frame written
+                slot, the slot it was written to
+
+   Returns - TRUE if the page kept its frame, FALSE if the frame can be
+        freed
+*************************************************************************/
+static int keepPage(int frame, int slot)
+{
+    AddressSpace* pSpace = frames[frame].pOwner;
+    PageTableEntry* pEntry = &pSpace->pages[frames[frame].page];
+    char* pData = physicalMemory + (size_t)frame * VM_PAGE_SIZE;
+
+    if (pEntry->pShared != NULL && pEntry->pShared->swapSlot == slot)
+    {
+        SharedPage* pShared = pEntry->pShared;
+
+        freeSlot(&pShared->swapSlot);
+        pShared->pBacking = slab_alloc(pageCopyCache);
+        if (pShared->pBacking != NULL)
+        {
+            memcpy(pShared->pBacking, pData, VM_PAGE_SIZE);
+            return FALSE;
+        }
+
+        pShared->frame = frame;
+        pShared->dirty = TRUE;
+        frames[frame].pOwner = NULL;
+        frames[frame].pShared = pShared;
+        return TRUE;
+    }
+    if (pEntry->swapSlot != slot)
+    {
+        return FALSE;
+    }
+
+    freeSlot(&pEntry->swapSlot);
+    pEntry->pBacking = slab_alloc(pageCopyCache);
+    if (pEntry->pBacking != NULL)
+    {
+        memcpy(pEntry->pBacking, pData, VM_PAGE_SIZE);
+        return FALSE;
+    }
+
+    pEntry->present = TRUE;
+    pEntry->dirty = TRUE;
+    pSpace->stats.residentPages++;
+    pSpace->stats.evictions--;
+    pSpace->stats.pageOuts--;
+
+    return TRUE;
+}
+
+/**************************************************************************
+   Name - readSlot
+
+   Purpose - Reads a page back from its swap slot, blocking until the
+             disk has read it.
+
+   Returns - 0 if successful, -1 if the swap disk failed the read
+*************************************************************************/
+static int readSlot(int slot, char* pFrame)
+{
+    DWORD start = read_clock();
+    int platter, track, sector;
+    int result;
+
+    slotLocation(slot, &platter, &track, &sector);
+    result = k_disk_read(swapUnit, platter, track, sector, PAGE_SECTORS, pFrame);
+
+    disableInterrupts();
+    swapStats.readTime += read_clock() - start;
+    swapStats.pagesRead++;
+    if (result != 0)
+    {
+        swapStats.errors++;
+    }
+    enableInterrupts();
+
+    return result == 0 ? 0 : -1;
+}
+
+/**************************************************************************
+   Name - slotLocation
+
+   Purpose - Finds where a swap slot is on the swap disk. Slots are
+             numbered along each platter, two to a track, so consecutive
+             slots are consecutive sectors.
+*************************************************************************/
+static void slotLocation(int slot, int* pPlatter, int* pTrack, int* pSector)
+{
+    int position = slot * PAGE_SECTORS;
+
+    *pPlatter = position / sectorsPerPlatter;
+    position %= sectorsPerPlatter;
+    *pTrack = position / THREADS_DISK_SECTOR_COUNT;
+    *pSector = position % THREADS_DISK_SECTOR_COUNT;
+}
+
+/**************************************************************************
+   Name - allocateSlots
+
+   Purpose - Allocates swap slots for a cluster, consecutive ones if there
+             is a run of them free after the rotor, otherwise whichever
+             are free. Called with interrupts disabled.
+
+   Returns - the number of slots allocated, fewer than count if swap is
+        nearly full
+*************************************************************************/
+static int allocateSlots(int* pSlots, int count)
+{
+    int slots = swapStats.slots;
+    int allocated = 0;
+    int run = 0;
+
+    // Look for a run from the rotor to the end of swap, then from the start
+    for (int i = 0; i < slots && run < count; i++)
+    {
+        int slot = (slotRotor + i) % slots;
+
+        if (slot == 0)
+        {
+            run = 0;
+        }
+        run = pSlotUsed[slot] ? 0 : run + 1;
+        if (run == count)
+        {
+            for (int j = 0; j < count; j++)
+            {
+                pSlots[j] = slot - count + 1 + j;
+            }
+            allocated = count;
+        }
+    }
+
+    for (int slot = 0; slot < slots && allocated < count; slot++)
+    {
+        if (!pSlotUsed[slot])
+        {
+            pSlots[allocated++] = slot;
+        }
+    }
+
+    for (int i = 0; i < allocated; i++)
+    {
+        pSlotUsed[pSlots[i]] = TRUE;
+    }
+    if (allocated > 0)
+    {
+        slotRotor = (pSlots[allocated - 1] + 1) % slots;
+    }
+    swapStats.slotsUsed += allocated;
+
+    return allocated;
+}
+
+/**************************************************************************
+   Name - freeSlot
+
+   Purpose - Lets go of the swap slot of a page or shared page, if it
+             has one.
+*************************************************************************/
+static void freeSlot(int* pSwapSlot)
+{
+    if (*pSwapSlot >= 0 && pSlotUsed != NULL)
+    {
+        pSlotUsed[*pSwapSlot] = FALSE;
+        swapStats.slotsUsed--;
+    }
+    *pSwapSlot = -1;
+}
+
+/**************************************************************************
+   Name - tlbLoad
+
+   Purpose - Puts a translation in the TLB, replacing its entries in turn.
+*************************************************************************/
+static void tlbLoad(int pid, int page, int frame)
+{
+    TlbEntry* pTlb = &tlb[tlbNext];
+
+    tlbNext = (tlbNext + 1) % VM_TLB_ENTRIES;
+    pTlb->valid = TRUE;
+    pTlb->pid = pid;
+    pTlb->page = page;
+    pTlb->frame = frame;
+}
+
+/**************************************************************************
+   Name - tlbInvalidateFrame
+
+   Purpose - Drops every TLB entry that maps a frame, which for a shared
+             page may be one for each process sharing it.
+*************************************************************************/
+static void tlbInvalidateFrame(int frame)
+{
+    for (int i = 0; i < VM_TLB_ENTRIES; i++)
+    {
+        if (tlb[i].valid && tlb[i].frame == frame)
+        {
+            tlb[i].valid = FALSE;
+        }
+    }
+}
+
+/**************************************************************************
+   Name - tlbInvalidate
+
+   Purpose - Drops the TLB entry for a page, if there is one.
+*************************************************************************/
+static void tlbInvalidate(int pid, int page)
+{
+    for (int i = 0; i < VM_TLB_ENTRIES; i++)
+    {
+        if (tlb[i].valid && tlb[i].pid == pid && tlb[i].page == page)
+        {
+            tlb[i].valid = FALSE;
+        }
+    }
+}